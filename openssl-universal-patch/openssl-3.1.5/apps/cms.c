@@ -239,10 +239,19 @@ const OPTIONS cms_options[] = {
 };
 
 static CMS_ContentInfo *load_content_info(int informat, BIO *in, int flags,
-                                          BIO **indata, const char *name)
+                                          int stream, BIO **indata,
+                                          const char *name)
 {
     CMS_ContentInfo *ret, *ci;
 
+    /* The content is read as it is being processed */
+    if (stream && informat == FORMAT_ASN1) {
+        ret = d2i_CMS_bio_stream(in, indata, app_get0_libctx(),
+                                 app_get0_propq());
+        if (ret == NULL)
+            BIO_printf(bio_err, "Error reading %s Content Info\n", name);
+        return ret;
+    }
     ret = CMS_ContentInfo_new_ex(app_get0_libctx(), app_get0_propq());
     if (ret == NULL) {
         BIO_printf(bio_err, "Error allocating CMS_contentinfo\n");
@@ -891,7 +900,13 @@ int cms_main(int argc, char **argv)
         goto end;
 
     if (operation & SMIME_IP) {
-        cms = load_content_info(informat, in, flags, &indata, "SMIME");
+        int stream = (flags & CMS_STREAM) != 0 && contfile == NULL
+            && certsoutfile == NULL
+            && (operation == SMIME_DECRYPT || operation == SMIME_VERIFY
+                || operation == SMIME_ENCRYPTED_DECRYPT);
+
+        cms = load_content_info(informat, in, flags, stream, &indata,
+                                "SMIME");
         if (cms == NULL)
             goto end;
         if (contfile != NULL) {
@@ -922,7 +937,7 @@ int cms_main(int argc, char **argv)
             goto end;
         }
 
-        rcms = load_content_info(rctformat, rctin, 0, NULL, "receipt");
+        rcms = load_content_info(rctformat, rctin, 0, 0, NULL, "receipt");
         if (rcms == NULL)
             goto end;
     }
@@ -92,6 +92,10 @@ VirtualLock(
 # define NO_FORK
 #endif
 
+#if defined(OPENSSL_THREADS) && !defined(OPENSSL_SYS_WINDOWS)
+# include <pthread.h>
+#endif
+
 #define MAX_MISALIGNMENT 63
 #define MAX_ECDH_SIZE   256
 #define MISALIGN        64
@@ -116,12 +120,16 @@ static volatile int run = 0;
 
 static int mr = 0;  /* machine-readeable output format to merge fork results */
 static int usertime = 1;
+static unsigned int threads = 0; /* number of benchmark threads, 0 = none */
+static int last_tm = 0; /* duration of the benchmark currently running */
 
 static double Time_F(int s);
 static void print_message(const char *s, long num, int length, int tm);
 static void pkey_print_message(const char *str, const char *str2,
                                long num, unsigned int bits, int sec);
 static void print_result(int alg, int run_no, int count, double time_used);
+static void print_sym_results(int alg, const char *alg_name,
+                              unsigned int num);
 #ifndef NO_FORK
 static int do_multi(int multi, int size_num);
 #endif
@@ -138,6 +146,12 @@ static const int aead_lengths_list[] = {
     2, 31, 136, 1024, 8 * 1024, 16 * 1024
 };
 
+static const int rand_lengths_list[] = {
+    16, 256, 4 * 1024, 1024 * 1024
+};
+static const int *rand_lengths = rand_lengths_list;
+static unsigned int rand_size_num = OSSL_NELEM(rand_lengths_list);
+
 #define START   0
 #define STOP    1
 
@@ -229,7 +243,8 @@ typedef enum OPTION_choice {
     OPT_COMMON,
     OPT_ELAPSED, OPT_EVP, OPT_HMAC, OPT_DECRYPT, OPT_ENGINE, OPT_MULTI,
     OPT_MR, OPT_MB, OPT_MISALIGN, OPT_ASYNCJOBS, OPT_R_ENUM, OPT_PROV_ENUM, OPT_CONFIG,
-    OPT_PRIMES, OPT_SECONDS, OPT_BYTES, OPT_AEAD, OPT_CMAC, OPT_MLOCK
+    OPT_PRIMES, OPT_SECONDS, OPT_BYTES, OPT_AEAD, OPT_CMAC, OPT_MLOCK,
+    OPT_THREADS
 } OPTION_CHOICE;
 
 const OPTIONS speed_options[] = {
@@ -247,6 +262,10 @@ const OPTIONS speed_options[] = {
     {"async_jobs", OPT_ASYNCJOBS, 'p',
      "Enable async mode and start specified number of jobs"},
 #endif
+#ifdef OPENSSL_THREADS
+    {"threads", OPT_THREADS, 'p',
+     "Run benchmarks in specified number of threads sharing one library context"},
+#endif
 #ifndef OPENSSL_NO_ENGINE
     {"engine", OPT_ENGINE, 's', "Use engine, possibly a hardware device"},
 #endif
@@ -735,7 +754,7 @@ static int RAND_bytes_loop(void *args)
     int count;
 
     for (count = 0; COND(c[D_RAND][testnum]); count++)
-        RAND_bytes(buf, lengths[testnum]);
+        RAND_bytes(buf, rand_lengths[testnum]);
     return count;
 }
 
@@ -1139,6 +1158,134 @@ static int SM2_verify_loop(void *args)
 }
 #endif                         /* OPENSSL_NO_SM2 */
 
+#ifdef OPENSSL_THREADS
+typedef struct thread_args_st {
+    int (*loop_function) (void *);
+    loopargs_t *looparg;
+    int count;
+# if defined(OPENSSL_SYS_WINDOWS)
+    HANDLE handle;
+# else
+    pthread_t handle;
+# endif
+} thread_args_t;
+
+# if defined(OPENSSL_SYS_WINDOWS)
+static DWORD WINAPI thread_run(LPVOID arg)
+# else
+static void *thread_run(void *arg)
+# endif
+{
+    thread_args_t *targ = arg;
+    loopargs_t *looparg_item = targ->looparg;
+
+    targ->count = targ->loop_function((void *)&looparg_item);
+    return 0;
+}
+
+static int thread_start(thread_args_t *targ)
+{
+# if defined(OPENSSL_SYS_WINDOWS)
+    targ->handle = CreateThread(NULL, 0, thread_run, targ, 0, NULL);
+    return targ->handle != NULL;
+# else
+    return pthread_create(&targ->handle, NULL, thread_run, targ) == 0;
+# endif
+}
+
+static void thread_join(thread_args_t *targ)
+{
+# if defined(OPENSSL_SYS_WINDOWS)
+    WaitForSingleObject(targ->handle, INFINITE);
+    CloseHandle(targ->handle);
+# else
+    pthread_join(targ->handle, NULL);
+# endif
+}
+
+/*
+ * Run |loop_function| on |threads| threads at once, one loopargs_t each.
+ * All threads share the application library context and the keys set up
+ * by speed_main(), so the figures include lock and refcount contention.
+ *
+ * When more than one thread is requested the time slot is first used for
+ * an uncontended single-thread run on the calling thread, and then re-armed
+ * for the threaded run, so that the scaling efficiency relative to one
+ * thread can be reported.  Only the threaded run is seen by the caller.
+ */
+static int run_threads(int (*loop_function) (void *), loopargs_t *loopargs)
+{
+    thread_args_t *targs;
+    loopargs_t *looparg_item = loopargs;
+    double single_rate = 0.0, d, mean, var = 0.0, min, max, eff = -1.0;
+    int single, total = 0, error = 0;
+    unsigned int i, started;
+
+    if (threads > 1) {
+        single = loop_function((void *)&looparg_item);
+        d = Time_F(STOP);
+        if (single < 0)
+            return -1;
+        single_rate = d > 0.0 ? single / d : 0.0;
+        run = 1;
+        alarm(last_tm);
+        Time_F(START);
+    }
+
+    targs = app_malloc(threads * sizeof(*targs), "array of thread args");
+    for (started = 0; started < threads; started++) {
+        targs[started].loop_function = loop_function;
+        targs[started].looparg = loopargs + started;
+        targs[started].count = 0;
+        if (!thread_start(&targs[started])) {
+            BIO_printf(bio_err, "Failure starting benchmark thread\n");
+            run = 0;
+            error = 1;
+            break;
+        }
+    }
+    for (i = 0; i < started; i++) {
+        thread_join(&targs[i]);
+        if (targs[i].count < 0)
+            error = 1;
+        else
+            total += targs[i].count;
+    }
+    d = app_tminterval(STOP, usertime);
+    if (error) {
+        OPENSSL_free(targs);
+        return -1;
+    }
+
+    mean = (double)total / threads;
+    min = max = targs[0].count;
+    for (i = 0; i < threads; i++) {
+        var += (targs[i].count - mean) * (targs[i].count - mean);
+        if (targs[i].count < min)
+            min = targs[i].count;
+        if (targs[i].count > max)
+            max = targs[i].count;
+    }
+    var /= threads;
+    if (single_rate > 0.0 && d > 0.0)
+        eff = total / d / (threads * single_rate);
+    OPENSSL_free(targs);
+
+    if (mr) {
+        BIO_printf(bio_err, "+TH:%u:%d:%f:%f:%f:%f:%f\n", threads, total,
+                   mean, var, min, max, eff);
+    } else if (mean > 0.0) {
+        BIO_printf(bio_err, "[%u threads: per-thread min %.1f%%, max %.1f%%"
+                   " of mean", threads, 100.0 * min / mean,
+                   100.0 * max / mean);
+        if (eff >= 0.0)
+            BIO_printf(bio_err, ", scaling %.1f%%", 100.0 * eff);
+        BIO_printf(bio_err, "] ");
+    }
+    return total;
+}
+#endif
+
 static int run_benchmark(int async_jobs,
                          int (*loop_function) (void *), loopargs_t * loopargs)
 {
@@ -1149,6 +1296,11 @@ static int run_benchmark(int async_jobs,
     OSSL_ASYNC_FD job_fd = 0;
     size_t num_job_fds = 0;
 
+#ifdef OPENSSL_THREADS
+    if (threads > 0)
+        return run_threads(loop_function, loopargs);
+#endif
+
     if (async_jobs == 0) {
         return loop_function((void *)&loopargs);
     }
@@ -1602,6 +1754,15 @@ int speed_main(int argc, char **argv)
                 BIO_printf(bio_err, "%s: too many async_jobs\n", prog);
                 goto opterr;
             }
+#endif
+            break;
+        case OPT_THREADS:
+#ifdef OPENSSL_THREADS
+            threads = atoi(opt_arg());
+            if (threads > 1024) {
+                BIO_printf(bio_err, "%s: too many threads\n", prog);
+                goto opterr;
+            }
 #endif
             break;
         case OPT_MISALIGN:
@@ -1649,6 +1810,8 @@ int speed_main(int argc, char **argv)
             lengths_single = atoi(opt_arg());
             lengths = &lengths_single;
             size_num = 1;
+            rand_lengths = &lengths_single;
+            rand_size_num = 1;
             break;
         case OPT_AEAD:
             aead = 1;
@@ -1798,6 +1961,9 @@ int speed_main(int argc, char **argv)
         } else if (async_jobs > 0) {
             BIO_printf(bio_err, "Async mode is not supported with -mb");
             goto end;
+        } else if (threads > 0) {
+            BIO_printf(bio_err, "-threads is not supported with -mb\n");
+            goto end;
         }
     }
 
@@ -1810,12 +1976,33 @@ int speed_main(int argc, char **argv)
         }
     }
 
+    if (threads > 0) {
+        if (async_jobs > 0) {
+            BIO_printf(bio_err, "-threads cannot be used with -async_jobs\n");
+            goto end;
+        }
+#ifndef NO_FORK
+        if (multi) {
+            BIO_printf(bio_err, "-threads cannot be used with -multi\n");
+            goto end;
+        }
+#endif
+        /* CPU time is summed over all threads, wall-clock time is needed */
+        usertime = 0;
+    }
+
     loopargs_len = (async_jobs == 0 ? 1 : async_jobs);
+    if (threads > 0)
+        loopargs_len = threads;
     loopargs =
         app_malloc(loopargs_len * sizeof(loopargs_t), "array of loopargs");
     memset(loopargs, 0, loopargs_len * sizeof(loopargs_t));
 
     buflen = lengths[size_num - 1];
+    /* Without any algorithm arguments rand is run as well, see below */
+    if ((doit[D_RAND] || argc == 0)
+        && buflen < rand_lengths[rand_size_num - 1])
+        buflen = rand_lengths[rand_size_num - 1];
     if (buflen < 36)    /* size of random vector in RSA benchmark */
         buflen = 36;
     if (INT_MAX - (MAX_MISALIGNMENT + 1) < buflen) {
@@ -1911,7 +2098,7 @@ int speed_main(int argc, char **argv)
 #endif
     }
     for (i = 0; i < ALGOR_NUM; i++)
-        if (doit[i])
+        if (doit[i] && (i != D_RAND || rand_lengths == lengths))
             pr_header++;
 
     if (usertime == 0 && !mr)
@@ -2245,9 +2432,9 @@ skip_hmac:
     }
 
     if (doit[D_RAND]) {
-        for (testnum = 0; testnum < size_num; testnum++) {
-            print_message(names[D_RAND], c[D_RAND][testnum], lengths[testnum],
-                          seconds.sym);
+        for (testnum = 0; testnum < rand_size_num; testnum++) {
+            print_message(names[D_RAND], c[D_RAND][testnum],
+                          rand_lengths[testnum], seconds.sym);
             Time_F(START);
             count = run_benchmark(async_jobs, RAND_bytes_loop, loopargs);
             d = Time_F(STOP);
@@ -3197,6 +3384,9 @@ skip_hmac:
 
         if (!doit[k])
             continue;
+        /* rand uses its own set of lengths and is printed separately */
+        if (k == D_RAND && rand_lengths != lengths)
+            continue;
 
         if (k == D_EVP) {
             if (evp_cipher == NULL)
@@ -3205,17 +3395,16 @@ skip_hmac:
                 app_bail_out("failed to get name of cipher '%s'\n", evp_cipher);
         }
 
-        if (mr)
-            printf("+F:%u:%s", k, alg_name);
-        else
-            printf("%-13s", alg_name);
-        for (testnum = 0; testnum < size_num; testnum++) {
-            if (results[k][testnum] > 10000 && !mr)
-                printf(" %11.2fk", results[k][testnum] / 1e3);
-            else
-                printf(mr ? ":%.2f" : " %11.2f ", results[k][testnum]);
-        }
+        print_sym_results(k, alg_name, size_num);
+    }
+    if (doit[D_RAND] && rand_lengths != lengths) {
+        if (!mr && !pr_header)
+            printf("The 'numbers' are in 1000s of bytes per second processed.\n");
+        printf(mr ? "+H" : "type        ");
+        for (testnum = 0; testnum < rand_size_num; testnum++)
+            printf(mr ? ":%d" : "%7d bytes", rand_lengths[testnum]);
         printf("\n");
+        print_sym_results(D_RAND, names[D_RAND], rand_size_num);
     }
     testnum = 1;
     for (k = 0; k < RSA_NUM; k++) {
@@ -3431,6 +3620,7 @@ static void print_message(const char *s, long num, int length, int tm)
                : "Doing %s for %ds on %d size blocks: ", s, tm, length);
     (void)BIO_flush(bio_err);
     run = 1;
+    last_tm = tm;
     alarm(tm);
 }
 
@@ -3442,9 +3632,28 @@ static void pkey_print_message(const char *str, const char *str2, long num,
                : "Doing %u bits %s %s's for %ds: ", bits, str, str2, tm);
     (void)BIO_flush(bio_err);
     run = 1;
+    last_tm = tm;
     alarm(tm);
 }
 
+static void print_sym_results(int alg, const char *alg_name,
+                              unsigned int num)
+{
+    unsigned int i;
+
+    if (mr)
+        printf("+F:%u:%s", alg, alg_name);
+    else
+        printf("%-13s", alg_name);
+    for (i = 0; i < num; i++) {
+        if (results[alg][i] > 10000 && !mr)
+            printf(" %11.2fk", results[alg][i] / 1e3);
+        else
+            printf(mr ? ":%.2f" : " %11.2f ", results[alg][i]);
+    }
+    printf("\n");
+}
+
 static void print_result(int alg, int run_no, int count, double time_used)
 {
     if (count == -1) {
@@ -3455,7 +3664,8 @@ static void print_result(int alg, int run_no, int count, double time_used)
     BIO_printf(bio_err,
                mr ? "+R:%d:%s:%f\n"
                : "%d %s's in %.2fs\n", count, names[alg], time_used);
-    results[alg][run_no] = ((double)count) / time_used * lengths[run_no];
+    results[alg][run_no] = ((double)count) / time_used
+        * (alg == D_RAND ? rand_lengths[run_no] : lengths[run_no]);
 }
 
 #ifndef NO_FORK
@@ -3546,12 +3756,15 @@ static int do_multi(int multi, int size_num)
             printf("Got: %s from %d\n", buf, n);
             if (strncmp(buf, "+F:", 3) == 0) {
                 int alg;
-                int j;
+                int j, num;
 
                 p = buf + 3;
                 alg = atoi(sstrsep(&p, sep));
                 sstrsep(&p, sep);
-                for (j = 0; j < size_num; ++j)
+                num = size_num;
+                if (alg == D_RAND && rand_lengths != lengths)
+                    num = rand_size_num;
+                for (j = 0; j < num; ++j)
                     results[alg][j] += atof(sstrsep(&p, sep));
             } else if (strncmp(buf, "+F2:", 4) == 0) {
                 int k;
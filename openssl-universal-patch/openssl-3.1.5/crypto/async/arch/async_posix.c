@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2015-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -13,12 +13,49 @@
 #ifdef ASYNC_POSIX
 
 # include <stddef.h>
+# include <string.h>
 # include <unistd.h>
+# include <sys/mman.h>
 
-#define STACKSIZE       32768
+# if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define MAP_ANONYMOUS MAP_ANON
+# endif
+# if defined(MAP_ANONYMOUS) && defined(_SC_PAGESIZE)
+#  define USE_GUARD_PAGE
+# endif
+
+/*
+ * The size of the stacks made by the default allocator.  Applications that
+ * need another size can install their own with ASYNC_set_mem_functions().
+ */
+# ifndef OPENSSL_ASYNC_STACK_SIZE
+#  define OPENSSL_ASYNC_STACK_SIZE      32768
+# endif
+# define STACKSIZE      OPENSSL_ASYNC_STACK_SIZE
+
+/*
+ * The default allocator keeps up to this many freed stacks on a process
+ * wide list, so that jobs created later, in any thread, can reuse them
+ * without a system call.
+ */
+# define STACK_CACHE_MAX        64
+
+static CRYPTO_RWLOCK *stack_lock = NULL;
+static void *stack_cache = NULL;
+static size_t stack_cache_num = 0;
+
+static void *async_stack_alloc(size_t *num);
+static void async_stack_free(void *addr);
+
+static int allow_customize = 1;
+static ASYNC_stack_alloc_fn stack_alloc_impl = async_stack_alloc;
+static ASYNC_stack_free_fn stack_free_impl = async_stack_free;
 
 int ASYNC_is_capable(void)
 {
+# ifdef USE_ASM_SWITCH
+    return 1;
+# else
     ucontext_t ctx;
 
     /*
@@ -26,21 +63,263 @@ int ASYNC_is_capable(void)
      * MacOSX PPC64). Check for a working getcontext();
      */
     return getcontext(&ctx) == 0;
+# endif
+}
+
+int ASYNC_set_mem_functions(ASYNC_stack_alloc_fn alloc_fn,
+                            ASYNC_stack_free_fn free_fn)
+{
+    OPENSSL_init_crypto(OPENSSL_INIT_ASYNC, NULL);
+
+    if (!allow_customize || alloc_fn == NULL || free_fn == NULL)
+        return 0;
+    stack_alloc_impl = alloc_fn;
+    stack_free_impl = free_fn;
+    return 1;
+}
+
+void ASYNC_get_mem_functions(ASYNC_stack_alloc_fn *alloc_fn,
+                             ASYNC_stack_free_fn *free_fn)
+{
+    if (alloc_fn != NULL)
+        *alloc_fn = stack_alloc_impl;
+    if (free_fn != NULL)
+        *free_fn = stack_free_impl;
+}
+
+/*
+ * Stacks grow down on all the platforms we support, so the guard page is
+ * placed below the usable area.
+ */
+static void *stack_new(void)
+{
+# ifdef USE_GUARD_PAGE
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char *p;
+
+    p = mmap(NULL, STACKSIZE + page, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+    if (mprotect(p, page, PROT_NONE) != 0) {
+        munmap(p, STACKSIZE + page);
+        return NULL;
+    }
+    return p + page;
+# else
+    return OPENSSL_malloc(STACKSIZE);
+# endif
+}
+
+static void stack_release(void *addr)
+{
+# ifdef USE_GUARD_PAGE
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    munmap((char *)addr - page, STACKSIZE + page);
+# else
+    OPENSSL_free(addr);
+# endif
+}
+
+/* The default allocator ignores the requested size */
+static void *async_stack_alloc(size_t *num)
+{
+    void *p = NULL;
+
+    *num = STACKSIZE;
+    if (stack_lock != NULL && CRYPTO_THREAD_write_lock(stack_lock)) {
+        if ((p = stack_cache) != NULL) {
+            memcpy(&stack_cache, p, sizeof(stack_cache));
+            stack_cache_num--;
+        }
+        CRYPTO_THREAD_unlock(stack_lock);
+    }
+    return p != NULL ? p : stack_new();
+}
+
+static void async_stack_free(void *addr)
+{
+    if (addr == NULL)
+        return;
+    if (stack_lock != NULL && CRYPTO_THREAD_write_lock(stack_lock)) {
+        if (stack_cache_num < STACK_CACHE_MAX) {
+            memcpy(addr, &stack_cache, sizeof(stack_cache));
+            stack_cache = addr;
+            stack_cache_num++;
+            addr = NULL;
+        }
+        CRYPTO_THREAD_unlock(stack_lock);
+    }
+    if (addr != NULL)
+        stack_release(addr);
+}
+
+int async_local_init(void)
+{
+    return (stack_lock = CRYPTO_THREAD_lock_new()) != NULL;
+}
+
+void async_local_deinit(void)
+{
+    void *p;
+
+    while ((p = stack_cache) != NULL) {
+        memcpy(&stack_cache, p, sizeof(stack_cache));
+        stack_release(p);
+    }
+    stack_cache_num = 0;
+    CRYPTO_THREAD_lock_free(stack_lock);
+    stack_lock = NULL;
 }
 
 void async_local_cleanup(void)
 {
 }
 
+# ifdef USE_ASM_SWITCH
+/*
+ * ossl_async_fibre_switch(save_sp, sp) pushes the callee-saved registers,
+ * stores the stack pointer in |*save_sp|, switches to |sp| and pops the
+ * registers saved there by an earlier switch, or by
+ * async_fibre_makecontext(), before returning on the new stack.
+ */
+#  if defined(__x86_64__)
+/* Frame: mxcsr and x87 control word, r15, r14, r13, r12, rbx, rbp, return */
+#   define FRAME_WORDS  8
+#   define FRAME_RET    7
+__asm__(
+    ".text\n"
+    ".globl ossl_async_fibre_switch\n"
+    ".hidden ossl_async_fibre_switch\n"
+    ".type ossl_async_fibre_switch,@function\n"
+    ".align 16\n"
+"ossl_async_fibre_switch:\n"
+    "pushq %rbp\n"
+    "pushq %rbx\n"
+    "pushq %r12\n"
+    "pushq %r13\n"
+    "pushq %r14\n"
+    "pushq %r15\n"
+    "subq $8, %rsp\n"
+    "stmxcsr (%rsp)\n"
+    "fnstcw 4(%rsp)\n"
+    "movq %rsp, (%rdi)\n"
+    "movq %rsi, %rsp\n"
+    "ldmxcsr (%rsp)\n"
+    "fldcw 4(%rsp)\n"
+    "addq $8, %rsp\n"
+    "popq %r15\n"
+    "popq %r14\n"
+    "popq %r13\n"
+    "popq %r12\n"
+    "popq %rbx\n"
+    "popq %rbp\n"
+    "ret\n"
+    ".size ossl_async_fibre_switch,.-ossl_async_fibre_switch\n"
+);
+#  elif defined(__aarch64__)
+/* Frame: x19-x28, x29, x30 (the return address), d8-d15 */
+#   define FRAME_WORDS  20
+#   define FRAME_RET    11
+__asm__(
+    ".text\n"
+    ".globl ossl_async_fibre_switch\n"
+    ".hidden ossl_async_fibre_switch\n"
+    ".type ossl_async_fibre_switch,%function\n"
+    ".align 4\n"
+"ossl_async_fibre_switch:\n"
+    "sub sp, sp, #160\n"
+    "stp x19, x20, [sp, #0]\n"
+    "stp x21, x22, [sp, #16]\n"
+    "stp x23, x24, [sp, #32]\n"
+    "stp x25, x26, [sp, #48]\n"
+    "stp x27, x28, [sp, #64]\n"
+    "stp x29, x30, [sp, #80]\n"
+    "stp d8, d9, [sp, #96]\n"
+    "stp d10, d11, [sp, #112]\n"
+    "stp d12, d13, [sp, #128]\n"
+    "stp d14, d15, [sp, #144]\n"
+    "mov x2, sp\n"
+    "str x2, [x0]\n"
+    "mov sp, x1\n"
+    "ldp x19, x20, [sp, #0]\n"
+    "ldp x21, x22, [sp, #16]\n"
+    "ldp x23, x24, [sp, #32]\n"
+    "ldp x25, x26, [sp, #48]\n"
+    "ldp x27, x28, [sp, #64]\n"
+    "ldp x29, x30, [sp, #80]\n"
+    "ldp d8, d9, [sp, #96]\n"
+    "ldp d10, d11, [sp, #112]\n"
+    "ldp d12, d13, [sp, #128]\n"
+    "ldp d14, d15, [sp, #144]\n"
+    "add sp, sp, #160\n"
+    "ret\n"
+    ".size ossl_async_fibre_switch,.-ossl_async_fibre_switch\n"
+);
+#  endif
+
+static void async_fibre_entry(void)
+{
+    async_start_func();
+    /* Only reached if the thread has no async context */
+    OPENSSL_die("async fibre returned", __FILE__, __LINE__);
+}
+
+int async_fibre_makecontext(async_fibre *fibre)
+{
+    size_t num = STACKSIZE;
+    uintptr_t top;
+    uint64_t *frame;
+
+    allow_customize = 0;
+    fibre->stack = stack_alloc_impl(&num);
+    if (fibre->stack == NULL)
+        return 0;
+    fibre->stack_size = num;
+
+    /*
+     * Build the frame that the first switch to this fibre pops, so that it
+     * "returns" into async_fibre_entry() with the stack aligned as if the
+     * function had been called.
+     */
+    top = ((uintptr_t)fibre->stack + num) & ~(uintptr_t)15;
+#  if defined(__x86_64__)
+    /* One more word for a null return address from async_fibre_entry() */
+    frame = (uint64_t *)top - FRAME_WORDS - 1;
+    memset(frame, 0, (FRAME_WORDS + 1) * sizeof(*frame));
+    /* Power-on defaults: all exceptions masked, round to nearest */
+    frame[0] = 0x1f80 | ((uint64_t)0x037f << 32);
+#  else
+    frame = (uint64_t *)top - FRAME_WORDS;
+    memset(frame, 0, FRAME_WORDS * sizeof(*frame));
+#  endif
+    frame[FRAME_RET] = (uint64_t)(uintptr_t)async_fibre_entry;
+    fibre->sp = frame;
+    return 1;
+}
+
+void async_fibre_free(async_fibre *fibre)
+{
+    if (fibre->stack != NULL)
+        stack_free_impl(fibre->stack);
+    fibre->stack = NULL;
+}
+
+# else
+
 int async_fibre_makecontext(async_fibre *fibre)
 {
-#ifndef USE_SWAPCONTEXT
+    size_t num = STACKSIZE;
+
+#  ifndef USE_SWAPCONTEXT
     fibre->env_init = 0;
-#endif
+#  endif
+    allow_customize = 0;
     if (getcontext(&fibre->fibre) == 0) {
-        fibre->fibre.uc_stack.ss_sp = OPENSSL_malloc(STACKSIZE);
+        fibre->fibre.uc_stack.ss_sp = stack_alloc_impl(&num);
         if (fibre->fibre.uc_stack.ss_sp != NULL) {
-            fibre->fibre.uc_stack.ss_size = STACKSIZE;
+            fibre->fibre.uc_stack.ss_size = num;
             fibre->fibre.uc_link = NULL;
             makecontext(&fibre->fibre, async_start_func, 0);
             return 1;
@@ -53,8 +332,10 @@ int async_fibre_makecontext(async_fibre *fibre)
 
 void async_fibre_free(async_fibre *fibre)
 {
-    OPENSSL_free(fibre->fibre.uc_stack.ss_sp);
+    if (fibre->fibre.uc_stack.ss_sp != NULL)
+        stack_free_impl(fibre->fibre.uc_stack.ss_sp);
     fibre->fibre.uc_stack.ss_sp = NULL;
 }
 
+# endif
 #endif
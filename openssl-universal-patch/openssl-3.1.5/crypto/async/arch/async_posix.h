@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2015-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -48,24 +48,61 @@
  */
 #   define USE_SWAPCONTEXT
 #  endif
-#  include <ucontext.h>
-#  ifndef USE_SWAPCONTEXT
-#   include <setjmp.h>
+/* __has_feature is a clang-ism, while __SANITIZE_ADDRESS__ is a gcc-ism */
+#  if defined(__SANITIZE_ADDRESS__)
+#   define ASYNC_SANITIZE_ADDRESS
+#  elif defined(__has_feature)
+#   if __has_feature(address_sanitizer)
+#    define ASYNC_SANITIZE_ADDRESS
+#   endif
 #  endif
+#  if !defined(USE_SWAPCONTEXT) && defined(__GNUC__) && defined(__ELF__) \
+     && (defined(__x86_64__) || defined(__aarch64__)) \
+     && !defined(__ILP32__) && !defined(ASYNC_SANITIZE_ADDRESS) \
+     && !defined(OPENSSL_NO_ASM)
+/*
+ * On these platforms a fibre switch is a small assembler routine that saves
+ * the callee-saved registers on the current stack and loads the stack
+ * pointer of the other fibre.  Unlike setcontext() and swapcontext() it
+ * makes no system call to save or restore the signal mask.
+ * AddressSanitizer cannot follow stack switches that it does not intercept,
+ * so sanitizer builds keep using the libc functions.
+ */
+#   define USE_ASM_SWITCH
+#  endif
+#  ifdef USE_ASM_SWITCH
+typedef struct async_fibre_st {
+    void *sp;                   /* Stack pointer while switched out */
+    void *stack;
+    size_t stack_size;
+} async_fibre;
+
+void ossl_async_fibre_switch(void **save_sp, void *sp);
+
+static ossl_inline int async_fibre_swapcontext(async_fibre *o, async_fibre *n, int r)
+{
+    ossl_async_fibre_switch(&o->sp, n->sp);
+    return 1;
+}
+#  else
+#   include <ucontext.h>
+#   ifndef USE_SWAPCONTEXT
+#    include <setjmp.h>
+#   endif
 
 typedef struct async_fibre_st {
     ucontext_t fibre;
-#  ifndef USE_SWAPCONTEXT
+#   ifndef USE_SWAPCONTEXT
     jmp_buf env;
     int env_init;
-#  endif
+#   endif
 } async_fibre;
 
 static ossl_inline int async_fibre_swapcontext(async_fibre *o, async_fibre *n, int r)
 {
-#  ifdef USE_SWAPCONTEXT
+#   ifdef USE_SWAPCONTEXT
     swapcontext(&o->fibre, &n->fibre);
-#  else
+#   else
     o->env_init = 1;
 
     if (!r || !_setjmp(o->env)) {
@@ -74,10 +111,11 @@ static ossl_inline int async_fibre_swapcontext(async_fibre *o, async_fibre *n, i
         else
             setcontext(&n->fibre);
     }
-#  endif
+#   endif
 
     return 1;
 }
+#  endif
 
 #  define async_fibre_init_dispatcher(d)
 
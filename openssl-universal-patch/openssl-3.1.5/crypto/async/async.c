@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2015-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -340,6 +340,12 @@ int async_init(void)
         return 0;
     }
 
+    if (!async_local_init()) {
+        CRYPTO_THREAD_cleanup_local(&ctxkey);
+        CRYPTO_THREAD_cleanup_local(&poolkey);
+        return 0;
+    }
+
     return 1;
 }
 
@@ -347,6 +353,7 @@ void async_deinit(void)
 {
     CRYPTO_THREAD_cleanup_local(&ctxkey);
     CRYPTO_THREAD_cleanup_local(&poolkey);
+    async_local_deinit();
 }
 
 int ASYNC_init_thread(size_t max_size, size_t init_size)
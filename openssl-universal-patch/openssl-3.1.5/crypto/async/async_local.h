@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2015-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -73,6 +73,8 @@ struct async_pool_st {
     size_t max_size;
 };
 
+int async_local_init(void);
+void async_local_deinit(void);
 void async_local_cleanup(void);
 void async_start_func(void);
 async_ctx *async_get_ctx(void);
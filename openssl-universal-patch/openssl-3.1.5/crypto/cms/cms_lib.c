@@ -14,6 +14,7 @@
 #include <openssl/bio.h>
 #include <openssl/asn1.h>
 #include <openssl/cms.h>
+#include <openssl/thread.h>
 #include "internal/sizes.h"
 #include "crypto/x509.h"
 #include "cms_local.h"
@@ -75,6 +76,7 @@ CMS_ContentInfo *CMS_ContentInfo_new(void)
 void CMS_ContentInfo_free(CMS_ContentInfo *cms)
 {
     if (cms != NULL) {
+        ossl_cms_stream_detach(cms);
         ossl_cms_env_enc_content_free(cms);
         OPENSSL_free(cms->ctx.propq);
         ASN1_item_free((ASN1_VALUE *)cms, ASN1_ITEM_rptr(CMS_ContentInfo));
@@ -431,10 +433,19 @@ BIO *ossl_cms_DigestAlgorithm_init_bio(X509_ALGOR *digestAlgorithm,
     }
     (void)ERR_pop_to_mark();
 
-    mdbio = BIO_new(BIO_f_md());
-    if (mdbio == NULL || BIO_set_md(mdbio, digest) <= 0) {
-        ERR_raise(ERR_LIB_CMS, CMS_R_MD_BIO_INIT_ERROR);
-        goto err;
+    /* With worker threads, hash alongside other digests and the content I/O */
+    if (OSSL_get_max_threads(ossl_cms_ctx_get0_libctx(ctx)) > 0) {
+        mdbio = ossl_cms_mdpar_bio_new(digest, ossl_cms_ctx_get0_libctx(ctx));
+        if (mdbio == NULL) {
+            ERR_raise(ERR_LIB_CMS, CMS_R_MD_BIO_INIT_ERROR);
+            goto err;
+        }
+    } else {
+        mdbio = BIO_new(BIO_f_md());
+        if (mdbio == NULL || BIO_set_md(mdbio, digest) <= 0) {
+            ERR_raise(ERR_LIB_CMS, CMS_R_MD_BIO_INIT_ERROR);
+            goto err;
+        }
     }
     EVP_MD_free(fetched_digest);
     return mdbio;
@@ -461,7 +472,10 @@ int ossl_cms_DigestAlgorithm_find_ctx(EVP_MD_CTX *mctx, BIO *chain,
             ERR_raise(ERR_LIB_CMS, CMS_R_NO_MATCHING_DIGEST);
             return 0;
         }
-        BIO_get_md_ctx(chain, &mtmp);
+        if (BIO_get_md_ctx(chain, &mtmp) <= 0) {
+            ERR_raise(ERR_LIB_CMS, CMS_R_MD_BIO_INIT_ERROR);
+            return 0;
+        }
         if (EVP_MD_CTX_get_type(mtmp) == nid
             /*
              * Workaround for broken implementations that use signature
@@ -45,6 +45,7 @@ typedef struct CMS_PasswordRecipientInfo_st CMS_PasswordRecipientInfo;
 typedef struct CMS_OtherRecipientInfo_st CMS_OtherRecipientInfo;
 typedef struct CMS_ReceiptsFrom_st CMS_ReceiptsFrom;
 typedef struct CMS_CTX_st CMS_CTX;
+typedef struct cms_stream_st CMS_CONTENT_STREAM;
 
 struct CMS_CTX_st {
     OSSL_LIB_CTX *libctx;
@@ -67,6 +68,8 @@ struct CMS_ContentInfo_st {
         void *otherData;
     } d;
     CMS_CTX ctx;
+    /* Set while the content is still being read by d2i_CMS_bio_stream() */
+    CMS_CONTENT_STREAM *stream;
 };
 
 DEFINE_STACK_OF(CMS_CertificateChoices)
@@ -396,6 +399,9 @@ void ossl_cms_resolve_libctx(CMS_ContentInfo *ci);
 
 CMS_ContentInfo *ossl_cms_Data_create(OSSL_LIB_CTX *ctx, const char *propq);
 
+int ossl_cms_stream_pending(const CMS_ContentInfo *cms, BIO *dcont);
+void ossl_cms_stream_detach(CMS_ContentInfo *cms);
+
 CMS_ContentInfo *ossl_cms_DigestedData_create(const EVP_MD *md,
                                               OSSL_LIB_CTX *libctx,
                                               const char *propq);
@@ -420,6 +426,7 @@ BIO *ossl_cms_CompressedData_init_bio(const CMS_ContentInfo *cms);
 
 BIO *ossl_cms_DigestAlgorithm_init_bio(X509_ALGOR *digestAlgorithm,
                                        const CMS_CTX *ctx);
+BIO *ossl_cms_mdpar_bio_new(const EVP_MD *md, OSSL_LIB_CTX *libctx);
 int ossl_cms_DigestAlgorithm_find_ctx(EVP_MD_CTX *mctx, BIO *chain,
                                       X509_ALGOR *mdalg);
 
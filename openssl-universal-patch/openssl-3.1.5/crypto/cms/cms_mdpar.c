@@ -0,0 +1,261 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * A message digest BIO that hashes on the worker threads of the library
+ * context.  The content that passes through it is collected in blocks, each
+ * of which is hashed by a worker while the next one is being collected.  A
+ * chain of these BIOs, one per digest algorithm, thus hashes the content
+ * with all the algorithms at once, and alongside whatever produces or
+ * consumes it.
+ *
+ * It behaves like BIO_f_md() otherwise: BIO_get_md_ctx() returns the digest
+ * context once all the content seen so far has been hashed into it.
+ */
+
+#include <string.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/cms.h>
+#include "internal/bio.h"
+#include "internal/thread.h"
+#include "cms_local.h"
+
+#define CMS_MDPAR_BLOCK_SIZE    (64 * 1024)
+
+typedef struct {
+    OSSL_LIB_CTX *libctx;
+    EVP_MD_CTX *ctx;
+    /* The block being collected, the other one may be being hashed */
+    unsigned char *blocks[2];
+    int current;
+    size_t used;
+    /* The task hashing |pending| into |ctx| */
+    void *task;
+    const unsigned char *pending;
+    size_t pendinglen;
+    int failed;
+} CMS_MDPAR;
+
+static int mdpar_write(BIO *b, const char *in, int inl);
+static int mdpar_read(BIO *b, char *out, int outl);
+static long mdpar_ctrl(BIO *b, int cmd, long num, void *ptr);
+static long mdpar_callback_ctrl(BIO *b, int cmd, BIO_info_cb *fp);
+static int mdpar_new(BIO *b);
+static int mdpar_free(BIO *b);
+
+static const BIO_METHOD methods_mdpar = {
+    BIO_TYPE_MD,
+    "threaded message digest",
+    bwrite_conv,
+    mdpar_write,
+    bread_conv,
+    mdpar_read,
+    NULL,
+    NULL,
+    mdpar_ctrl,
+    mdpar_new,
+    mdpar_free,
+    mdpar_callback_ctrl,
+};
+
+static CRYPTO_THREAD_RETVAL mdpar_update(void *arg)
+{
+    CMS_MDPAR *m = arg;
+
+    return EVP_DigestUpdate(m->ctx, m->pending, m->pendinglen) > 0;
+}
+
+static void mdpar_wait(CMS_MDPAR *m)
+{
+    CRYPTO_THREAD_RETVAL ret = 0;
+
+    if (m->task == NULL)
+        return;
+    if (!ossl_crypto_thread_join(m->task, &ret) || !ret)
+        m->failed = 1;
+    m->task = NULL;
+}
+
+/* Hand the block collected so far to a worker, or hash it if there's none */
+static void mdpar_dispatch(CMS_MDPAR *m)
+{
+    mdpar_wait(m);
+    if (m->used == 0)
+        return;
+    m->pending = m->blocks[m->current];
+    m->pendinglen = m->used;
+    m->task = ossl_crypto_thread_start(m->libctx, mdpar_update, m);
+    if (m->task == NULL && !mdpar_update(m))
+        m->failed = 1;
+    m->current ^= 1;
+    m->used = 0;
+}
+
+static void mdpar_add(CMS_MDPAR *m, const unsigned char *data, size_t len)
+{
+    size_t n;
+
+    while (len > 0) {
+        n = CMS_MDPAR_BLOCK_SIZE - m->used;
+        if (n > len)
+            n = len;
+        memcpy(m->blocks[m->current] + m->used, data, n);
+        m->used += n;
+        data += n;
+        len -= n;
+        if (m->used == CMS_MDPAR_BLOCK_SIZE)
+            mdpar_dispatch(m);
+    }
+}
+
+/* Hash everything seen so far */
+static int mdpar_sync(CMS_MDPAR *m)
+{
+    mdpar_dispatch(m);
+    mdpar_wait(m);
+    return !m->failed;
+}
+
+static int mdpar_new(BIO *b)
+{
+    CMS_MDPAR *m = OPENSSL_zalloc(sizeof(*m));
+
+    if (m == NULL
+        || (m->ctx = EVP_MD_CTX_new()) == NULL
+        || (m->blocks[0] = OPENSSL_malloc(2 * CMS_MDPAR_BLOCK_SIZE)) == NULL) {
+        if (m != NULL)
+            EVP_MD_CTX_free(m->ctx);
+        OPENSSL_free(m);
+        ERR_raise(ERR_LIB_CMS, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    m->blocks[1] = m->blocks[0] + CMS_MDPAR_BLOCK_SIZE;
+    BIO_set_data(b, m);
+    return 1;
+}
+
+static int mdpar_free(BIO *b)
+{
+    CMS_MDPAR *m = BIO_get_data(b);
+
+    if (m == NULL)
+        return 0;
+    mdpar_wait(m);
+    EVP_MD_CTX_free(m->ctx);
+    OPENSSL_free(m->blocks[0]);
+    OPENSSL_free(m);
+    BIO_set_data(b, NULL);
+    BIO_set_init(b, 0);
+    return 1;
+}
+
+static int mdpar_write(BIO *b, const char *in, int inl)
+{
+    CMS_MDPAR *m = BIO_get_data(b);
+    BIO *next = BIO_next(b);
+    int ret;
+
+    if (in == NULL || inl <= 0 || next == NULL)
+        return 0;
+
+    ret = BIO_write(next, in, inl);
+    if (ret > 0)
+        mdpar_add(m, (const unsigned char *)in, ret);
+    BIO_clear_retry_flags(b);
+    BIO_copy_next_retry(b);
+    return ret;
+}
+
+static int mdpar_read(BIO *b, char *out, int outl)
+{
+    CMS_MDPAR *m = BIO_get_data(b);
+    BIO *next = BIO_next(b);
+    int ret;
+
+    if (out == NULL || next == NULL)
+        return 0;
+
+    ret = BIO_read(next, out, outl);
+    if (ret > 0)
+        mdpar_add(m, (unsigned char *)out, ret);
+    BIO_clear_retry_flags(b);
+    BIO_copy_next_retry(b);
+    return ret;
+}
+
+static long mdpar_ctrl(BIO *b, int cmd, long num, void *ptr)
+{
+    CMS_MDPAR *m = BIO_get_data(b);
+    BIO *next = BIO_next(b);
+    long ret = 1;
+
+    switch (cmd) {
+    case BIO_C_GET_MD_CTX:
+        if (!mdpar_sync(m))
+            return 0;
+        *(EVP_MD_CTX **)ptr = m->ctx;
+        break;
+    case BIO_C_GET_MD:
+        if (!BIO_get_init(b))
+            return 0;
+        *(const EVP_MD **)ptr = EVP_MD_CTX_get0_md(m->ctx);
+        break;
+    case BIO_CTRL_RESET:
+        mdpar_wait(m);
+        m->used = 0;
+        m->failed = 0;
+        ret = EVP_DigestInit_ex(m->ctx, EVP_MD_CTX_get0_md(m->ctx), NULL);
+        if (ret > 0)
+            ret = BIO_ctrl(next, cmd, num, ptr);
+        break;
+    case BIO_CTRL_FLUSH:
+        if (!mdpar_sync(m))
+            return 0;
+        ret = BIO_ctrl(next, cmd, num, ptr);
+        break;
+    case BIO_CTRL_DUP:
+        return 0;
+    case BIO_C_DO_STATE_MACHINE:
+        BIO_clear_retry_flags(b);
+        ret = BIO_ctrl(next, cmd, num, ptr);
+        BIO_copy_next_retry(b);
+        break;
+    default:
+        ret = BIO_ctrl(next, cmd, num, ptr);
+        break;
+    }
+    return ret;
+}
+
+static long mdpar_callback_ctrl(BIO *b, int cmd, BIO_info_cb *fp)
+{
+    BIO *next = BIO_next(b);
+
+    if (next == NULL)
+        return 0;
+    return BIO_callback_ctrl(next, cmd, fp);
+}
+
+BIO *ossl_cms_mdpar_bio_new(const EVP_MD *md, OSSL_LIB_CTX *libctx)
+{
+    BIO *b = BIO_new(&methods_mdpar);
+    CMS_MDPAR *m;
+
+    if (b == NULL)
+        return NULL;
+    m = BIO_get_data(b);
+    m->libctx = libctx;
+    if (!EVP_DigestInit_ex(m->ctx, md, NULL)) {
+        BIO_free(b);
+        return NULL;
+    }
+    BIO_set_init(b, 1);
+    return b;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright 2008-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2008-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -15,10 +15,13 @@
 #include <openssl/err.h>
 #include <openssl/cms.h>
 #include <openssl/ess.h>
+#include <openssl/thread.h>
 #include "internal/sizes.h"
+#include "internal/thread.h"
 #include "crypto/asn1.h"
 #include "crypto/evp.h"
 #include "crypto/ess.h"
+#include "crypto/err.h"
 #include "crypto/x509.h" /* for ossl_x509_add_cert_new() */
 #include "cms_local.h"
 
@@ -797,17 +800,105 @@ static int cms_SignerInfo_content_sign(CMS_ContentInfo *cms,
 
 }
 
+typedef struct {
+    CMS_ContentInfo *cms;
+    CMS_SignerInfo *si;
+    BIO *chain;
+    void *task;
+    ERR_STATE *errs;
+} CMS_SIGN_TASK;
+
+static CRYPTO_THREAD_RETVAL cms_sign_task(void *arg)
+{
+    CMS_SIGN_TASK *t = arg;
+    int ok;
+
+    /* The errors would be lost on a worker thread, keep them for the caller */
+    ERR_set_mark();
+    ok = cms_SignerInfo_content_sign(t->cms, t->si, t->chain);
+    if (!ok)
+        t->errs = ossl_err_state_save_to_mark();
+    else
+        ERR_pop_to_mark();
+    return ok;
+}
+
+/* Sign with all the signers at once on the worker threads */
+static int cms_SignedData_sign_parallel(CMS_ContentInfo *cms,
+                                        STACK_OF(CMS_SignerInfo) *sinfos,
+                                        BIO *chain)
+{
+    OSSL_LIB_CTX *libctx = ossl_cms_ctx_get0_libctx(ossl_cms_get0_cmsctx(cms));
+    int i, n = sk_CMS_SignerInfo_num(sinfos), ok = 1;
+    CRYPTO_THREAD_RETVAL ret;
+    CMS_SIGN_TASK *tasks;
+    EVP_MD_CTX *mctx;
+    BIO *b;
+
+    /* The digests must be complete before the signers share them */
+    for (b = chain; (b = BIO_find_type(b, BIO_TYPE_MD)) != NULL;
+         b = BIO_next(b))
+        if (BIO_get_md_ctx(b, &mctx) <= 0) {
+            ERR_raise(ERR_LIB_CMS, CMS_R_MD_BIO_INIT_ERROR);
+            return 0;
+        }
+
+    if ((tasks = OPENSSL_zalloc(n * sizeof(*tasks))) == NULL) {
+        ERR_raise(ERR_LIB_CMS, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        tasks[i].cms = cms;
+        tasks[i].si = sk_CMS_SignerInfo_value(sinfos, i);
+        tasks[i].chain = chain;
+    }
+    /* The first signer is this thread's, as are those the pool can't take */
+    for (i = 1; i < n; i++)
+        if ((tasks[i].task = ossl_crypto_thread_start(libctx, cms_sign_task,
+                                                      &tasks[i])) == NULL
+            && !cms_sign_task(&tasks[i]))
+            ok = 0;
+    if (!cms_sign_task(&tasks[0]))
+        ok = 0;
+    for (i = 1; i < n; i++) {
+        if (tasks[i].task == NULL)
+            continue;
+        ret = 0;
+        if (!ossl_crypto_thread_join(tasks[i].task, &ret) || !ret)
+            ok = 0;
+    }
+    if (!ok) {
+        for (i = 0; i < n && tasks[i].errs == NULL; i++)
+            continue;
+        if (i < n)
+            ossl_err_state_restore(tasks[i].errs);
+        else
+            ERR_raise(ERR_LIB_CMS, CMS_R_SIGNFINAL_ERROR);
+    }
+    for (i = 0; i < n; i++)
+        ossl_err_state_free(tasks[i].errs);
+    OPENSSL_free(tasks);
+    return ok;
+}
+
 int ossl_cms_SignedData_final(CMS_ContentInfo *cms, BIO *chain)
 {
     STACK_OF(CMS_SignerInfo) *sinfos;
     CMS_SignerInfo *si;
+    const CMS_CTX *ctx = ossl_cms_get0_cmsctx(cms);
     int i;
 
     sinfos = CMS_get0_SignerInfos(cms);
-    for (i = 0; i < sk_CMS_SignerInfo_num(sinfos); i++) {
-        si = sk_CMS_SignerInfo_value(sinfos, i);
-        if (!cms_SignerInfo_content_sign(cms, si, chain))
+    if (sk_CMS_SignerInfo_num(sinfos) > 1
+        && OSSL_get_max_threads(ossl_cms_ctx_get0_libctx(ctx)) > 0) {
+        if (!cms_SignedData_sign_parallel(cms, sinfos, chain))
             return 0;
+    } else {
+        for (i = 0; i < sk_CMS_SignerInfo_num(sinfos); i++) {
+            si = sk_CMS_SignerInfo_value(sinfos, i);
+            if (!cms_SignerInfo_content_sign(cms, si, chain))
+                return 0;
+        }
     }
     cms->d.signedData->encapContentInfo->partial = 0;
     return 1;
@@ -30,12 +30,43 @@ static BIO *cms_get_text_bio(BIO *out, unsigned int flags)
     return rbio;
 }
 
+/*
+ * Strip the MIME headers from text content as it is read through the chain,
+ * rather than after all of it has been collected in memory.
+ */
+static int cms_copy_text(BIO *out, BIO *in)
+{
+    BIO *bbio = BIO_new(BIO_f_buffer());
+    int r = 0;
+
+    if (bbio == NULL) {
+        ERR_raise(ERR_LIB_CMS, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    BIO_push(bbio, in);
+    if (!SMIME_text(bbio, out)) {
+        ERR_raise(ERR_LIB_CMS, CMS_R_SMIME_TEXT_ERROR);
+        goto err;
+    }
+    if (BIO_method_type(in) == BIO_TYPE_CIPHER
+        && BIO_get_cipher_status(in) <= 0)
+        goto err;
+    r = 1;
+ err:
+    BIO_pop(bbio);
+    BIO_free(bbio);
+    return r;
+}
+
 static int cms_copy_content(BIO *out, BIO *in, unsigned int flags)
 {
     unsigned char buf[4096];
     int r = 0, i;
     BIO *tmpout;
 
+    if (out != NULL && (flags & CMS_TEXT) != 0)
+        return cms_copy_text(out, in);
+
     tmpout = cms_get_text_bio(out, flags);
 
     if (tmpout == NULL) {
@@ -314,9 +345,22 @@ int CMS_verify(CMS_ContentInfo *cms, STACK_OF(X509) *certs,
     BIO *cmsbio = NULL, *tmpin = NULL, *tmpout = NULL;
     int cadesVerify = (flags & CMS_CADES) != 0;
     const CMS_CTX *ctx = ossl_cms_get0_cmsctx(cms);
+    int deferred = ossl_cms_stream_pending(cms, dcont);
 
     if (dcont == NULL && !check_content(cms))
         return 0;
+    if (deferred) {
+        /*
+         * The content is still being read by d2i_CMS_bio_stream(), and the
+         * signers come after it: read all of it first.  It is encapsulated,
+         * so it's digested exactly as it is.
+         */
+        flags |= CMS_BINARY;
+        tmpin = dcont;
+        cmsbio = CMS_dataInit(cms, dcont);
+        if (cmsbio == NULL || !cms_copy_content(out, cmsbio, flags))
+            goto err;
+    }
     if (dcont != NULL && !(flags & CMS_BINARY)) {
         const ASN1_OBJECT *coid = CMS_get0_eContentType(cms);
 
@@ -441,7 +485,7 @@ int CMS_verify(CMS_ContentInfo *cms, STACK_OF(X509) *certs,
                 goto err;
             }
         }
-    } else {
+    } else if (!deferred) {
         cmsbio = CMS_dataInit(cms, tmpin);
         if (cmsbio == NULL)
             goto err;
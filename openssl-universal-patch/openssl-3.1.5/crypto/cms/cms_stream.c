@@ -0,0 +1,697 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Reading of CMS structures with content too large to be held in memory.
+ *
+ * The encoding is read up to the content, which is then handed out through
+ * a BIO as it is read from the input, without ever being stored.  All the
+ * other elements are collected and parsed with the usual ASN.1 functions,
+ * as they would be for a structure with detached content.  The elements
+ * that enclose the content are collected with indefinite lengths instead of
+ * their own, since their length includes that of the content.
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <openssl/asn1t.h>
+#include <openssl/err.h>
+#include <openssl/cms.h>
+#include "internal/bio.h"
+#include "cms_local.h"
+
+/* The deepest nesting of enclosing elements and content chunks we accept */
+#define CMS_STREAM_MAX_DEPTH        30
+
+#define CMS_STREAM_INDEFINITE       UINT64_MAX
+
+/* The position of the SignedData among the elements that enclose content */
+#define CMS_STREAM_SIGNED_DATA      2
+
+/* Tags, shifted the way the first identifier octet has them */
+#define CMS_STREAM_CLASS_MASK       0xc0
+#define CMS_STREAM_CONSTRUCTED      0x20
+
+/* An element we're inside of */
+typedef struct {
+    /* The offset at which it ends, or CMS_STREAM_INDEFINITE */
+    uint64_t end;
+    /* Whether it is collected, it isn't for the content and its wrapper */
+    int collected;
+} CMS_STREAM_LEVEL;
+
+/* A decoded header (identifier and length octets) */
+typedef struct {
+    unsigned char octets[16];
+    size_t octetslen;
+    size_t idlen;
+    int class;
+    int constructed;
+    uint32_t tag;
+    uint64_t len;               /* CMS_STREAM_INDEFINITE if indefinite */
+} CMS_STREAM_HDR;
+
+struct cms_stream_st {
+    BIO *in;
+    CMS_ContentInfo *cms;
+    int nid;
+    /* The encoding of everything but the content */
+    BUF_MEM *der;
+    /* The number of octets read from |in| so far */
+    uint64_t pos;
+    /* The elements that enclose the content, outermost first */
+    CMS_STREAM_LEVEL path[CMS_STREAM_MAX_DEPTH];
+    int npath;
+    /* The constructed strings that the content is split into */
+    CMS_STREAM_LEVEL chunks[CMS_STREAM_MAX_DEPTH];
+    int nchunks;
+    /* The number of octets left in the current primitive string */
+    uint64_t left;
+    int done;
+    int failed;
+};
+
+static int read_octets(CMS_CONTENT_STREAM *s, unsigned char *buf, size_t len)
+{
+    int n;
+
+    while (len > 0) {
+        n = BIO_read(s->in, buf, len > INT_MAX ? INT_MAX : (int)len);
+        if (n <= 0) {
+            ERR_raise(ERR_LIB_ASN1, ASN1_R_NOT_ENOUGH_DATA);
+            return 0;
+        }
+        s->pos += n;
+        buf += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int collect(CMS_CONTENT_STREAM *s, const unsigned char *buf, size_t len)
+{
+    size_t used = s->der->length;
+
+    if (len == 0)
+        return 1;
+    if (BUF_MEM_grow_clean(s->der, used + len) == 0) {
+        ERR_raise(ERR_LIB_CMS, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    memcpy(s->der->data + used, buf, len);
+    return 1;
+}
+
+/* The offset at which the element we're in ends */
+static uint64_t current_end(const CMS_CONTENT_STREAM *s)
+{
+    int i;
+
+    for (i = s->nchunks - 1; i >= 0; i--)
+        if (s->chunks[i].end != CMS_STREAM_INDEFINITE)
+            return s->chunks[i].end;
+    for (i = s->npath - 1; i >= 0; i--)
+        if (s->path[i].end != CMS_STREAM_INDEFINITE)
+            return s->path[i].end;
+    return CMS_STREAM_INDEFINITE;
+}
+
+static int read_header(CMS_CONTENT_STREAM *s, CMS_STREAM_HDR *hdr)
+{
+    unsigned char *p = hdr->octets;
+    uint64_t end = current_end(s);
+    size_t i, n;
+
+    if (!read_octets(s, p, 1))
+        return 0;
+    hdr->class = *p & CMS_STREAM_CLASS_MASK;
+    hdr->constructed = (*p & CMS_STREAM_CONSTRUCTED) != 0;
+    hdr->tag = *p & 0x1f;
+    n = 1;
+    if (hdr->tag == 0x1f) {
+        /* High tag number form, we don't need more than 21 bits */
+        hdr->tag = 0;
+        do {
+            if (n > 3) {
+                ERR_raise(ERR_LIB_ASN1, ASN1_R_HEADER_TOO_LONG);
+                return 0;
+            }
+            if (!read_octets(s, p + n, 1))
+                return 0;
+            hdr->tag = (hdr->tag << 7) | (p[n] & 0x7f);
+        } while ((p[n++] & 0x80) != 0);
+    }
+    hdr->idlen = n;
+
+    if (!read_octets(s, p + n, 1))
+        return 0;
+    if (p[n] < 0x80) {
+        hdr->len = p[n++];
+    } else if (p[n] == 0x80) {
+        if (!hdr->constructed) {
+            ERR_raise(ERR_LIB_ASN1, ASN1_R_BAD_OBJECT_HEADER);
+            return 0;
+        }
+        hdr->len = CMS_STREAM_INDEFINITE;
+        n++;
+    } else {
+        size_t lenlen = p[n++] & 0x7f;
+
+        if (lenlen > 8 || n + lenlen > sizeof(hdr->octets)) {
+            ERR_raise(ERR_LIB_ASN1, ASN1_R_HEADER_TOO_LONG);
+            return 0;
+        }
+        if (!read_octets(s, p + n, lenlen))
+            return 0;
+        for (hdr->len = 0, i = 0; i < lenlen; i++)
+            hdr->len = (hdr->len << 8) | p[n++];
+        if (hdr->len == CMS_STREAM_INDEFINITE) {
+            ERR_raise(ERR_LIB_ASN1, ASN1_R_TOO_LONG);
+            return 0;
+        }
+    }
+    hdr->octetslen = n;
+
+    if (end != CMS_STREAM_INDEFINITE
+        && (s->pos > end
+            || (hdr->len != CMS_STREAM_INDEFINITE
+                && hdr->len > end - s->pos))) {
+        ERR_raise(ERR_LIB_ASN1, ASN1_R_TOO_LONG);
+        return 0;
+    }
+    return 1;
+}
+
+static int is_eoc(const CMS_STREAM_HDR *hdr)
+{
+    return hdr->octetslen == 2 && hdr->octets[0] == 0 && hdr->octets[1] == 0;
+}
+
+static int is_universal(const CMS_STREAM_HDR *hdr, uint32_t tag,
+                        int constructed)
+{
+    return hdr->class == V_ASN1_UNIVERSAL && hdr->tag == tag
+        && hdr->constructed == constructed;
+}
+
+/*
+ * Whether the innermost enclosing element of the content ends here.  For an
+ * element with indefinite length this reads the next header, which is put
+ * in |hdr| if it isn't the end-of-contents octets.
+ */
+static int path_ends(CMS_CONTENT_STREAM *s, CMS_STREAM_HDR *hdr, int *ends)
+{
+    CMS_STREAM_LEVEL *level = &s->path[s->npath - 1];
+
+    if (level->end != CMS_STREAM_INDEFINITE) {
+        *ends = s->pos == level->end;
+        return *ends || read_header(s, hdr);
+    }
+    if (!read_header(s, hdr))
+        return 0;
+    *ends = is_eoc(hdr);
+    return 1;
+}
+
+/* Collect the element whose header was just read, with all its content */
+static int collect_element(CMS_CONTENT_STREAM *s, const CMS_STREAM_HDR *hdr,
+                           int depth)
+{
+    unsigned char buf[4096];
+    CMS_STREAM_HDR sub;
+    uint64_t left;
+    size_t n;
+
+    if (!collect(s, hdr->octets, hdr->octetslen))
+        return 0;
+    if (hdr->len != CMS_STREAM_INDEFINITE) {
+        for (left = hdr->len; left > 0; left -= n) {
+            n = left > sizeof(buf) ? sizeof(buf) : (size_t)left;
+            if (!read_octets(s, buf, n) || !collect(s, buf, n))
+                return 0;
+        }
+        return 1;
+    }
+    if (depth >= CMS_STREAM_MAX_DEPTH) {
+        ERR_raise(ERR_LIB_ASN1, ASN1_R_NESTED_TOO_DEEP);
+        return 0;
+    }
+    for (;;) {
+        if (!read_header(s, &sub))
+            return 0;
+        if (is_eoc(&sub))
+            return collect(s, sub.octets, sub.octetslen);
+        if (!collect_element(s, &sub, depth + 1))
+            return 0;
+    }
+}
+
+/* Enter the element whose header was just read, on the way to the content */
+static int enter(CMS_CONTENT_STREAM *s, const CMS_STREAM_HDR *hdr,
+                 int collect_it)
+{
+    CMS_STREAM_LEVEL *level;
+    unsigned char indefinite = 0x80;
+
+    if (!hdr->constructed) {
+        ERR_raise(ERR_LIB_ASN1, ASN1_R_BAD_OBJECT_HEADER);
+        return 0;
+    }
+    if (s->npath == CMS_STREAM_MAX_DEPTH) {
+        ERR_raise(ERR_LIB_ASN1, ASN1_R_NESTED_TOO_DEEP);
+        return 0;
+    }
+    level = &s->path[s->npath++];
+    level->end = hdr->len == CMS_STREAM_INDEFINITE
+        ? CMS_STREAM_INDEFINITE : s->pos + hdr->len;
+    level->collected = collect_it;
+    return !collect_it
+        || (collect(s, hdr->octets, hdr->idlen)
+            && collect(s, &indefinite, 1));
+}
+
+/* Collect the rest of the innermost enclosing element and leave it */
+static int leave(CMS_CONTENT_STREAM *s)
+{
+    static const unsigned char eoc[2] = { 0, 0 };
+    CMS_STREAM_HDR hdr;
+    int ends;
+
+    for (;;) {
+        if (!path_ends(s, &hdr, &ends))
+            return 0;
+        if (ends)
+            break;
+        if (!s->path[s->npath - 1].collected) {
+            /* Only the content can be in its wrapper */
+            ERR_raise(ERR_LIB_ASN1, ASN1_R_TOO_LONG);
+            return 0;
+        }
+        if (!collect_element(s, &hdr, s->npath))
+            return 0;
+    }
+    return !s->path[--s->npath].collected || collect(s, eoc, sizeof(eoc));
+}
+
+/* Start handing out the content whose header was just read */
+static int start_content(CMS_CONTENT_STREAM *s, const CMS_STREAM_HDR *hdr)
+{
+    if (hdr->len == CMS_STREAM_INDEFINITE || hdr->constructed) {
+        s->chunks[0].end = hdr->len == CMS_STREAM_INDEFINITE
+            ? CMS_STREAM_INDEFINITE : s->pos + hdr->len;
+        s->chunks[0].collected = 0;
+        s->nchunks = 1;
+        s->left = 0;
+    } else {
+        s->nchunks = 0;
+        s->left = hdr->len;
+    }
+    return 1;
+}
+
+/*
+ * Read everything up to the content, which starts after the last header
+ * read.  The content type is put in |s->nid|.
+ */
+static int read_to_content(CMS_CONTENT_STREAM *s)
+{
+    CMS_STREAM_HDR hdr;
+    ASN1_OBJECT *type = NULL;
+    const unsigned char *p;
+    size_t oidpos;
+    int ends;
+
+    /* ContentInfo */
+    if (!read_header(s, &hdr))
+        return 0;
+    if (!is_universal(&hdr, V_ASN1_SEQUENCE, 1)) {
+        ERR_raise(ERR_LIB_ASN1, ASN1_R_WRONG_TAG);
+        return 0;
+    }
+    if (!enter(s, &hdr, 1))
+        return 0;
+
+    /* contentType */
+    if (!read_header(s, &hdr))
+        return 0;
+    if (!is_universal(&hdr, V_ASN1_OBJECT, 0)) {
+        ERR_raise(ERR_LIB_ASN1, ASN1_R_WRONG_TAG);
+        return 0;
+    }
+    oidpos = s->der->length;
+    if (!collect_element(s, &hdr, s->npath))
+        return 0;
+    p = (unsigned char *)s->der->data + oidpos;
+    type = d2i_ASN1_OBJECT(NULL, &p, s->der->length - oidpos);
+    if (type == NULL)
+        return 0;
+    s->nid = OBJ_obj2nid(type);
+    ASN1_OBJECT_free(type);
+    switch (s->nid) {
+    case NID_pkcs7_data:
+    case NID_pkcs7_signed:
+    case NID_pkcs7_enveloped:
+    case NID_pkcs7_encrypted:
+        break;
+    default:
+        ERR_raise(ERR_LIB_CMS, CMS_R_UNSUPPORTED_CONTENT_TYPE);
+        return 0;
+    }
+
+    /* [0] EXPLICIT content */
+    if (!read_header(s, &hdr))
+        return 0;
+    if (hdr.class != V_ASN1_CONTEXT_SPECIFIC || hdr.tag != 0) {
+        ERR_raise(ERR_LIB_CMS, CMS_R_NO_CONTENT);
+        return 0;
+    }
+    if (s->nid == NID_pkcs7_data) {
+        if (!enter(s, &hdr, 0) || !read_header(s, &hdr))
+            return 0;
+        if (!is_universal(&hdr, V_ASN1_OCTET_STRING, hdr.constructed)) {
+            ERR_raise(ERR_LIB_ASN1, ASN1_R_WRONG_TAG);
+            return 0;
+        }
+        return start_content(s, &hdr);
+    }
+    if (!enter(s, &hdr, 1) || !read_header(s, &hdr))
+        return 0;
+
+    /* SignedData, EnvelopedData or EncryptedData */
+    if (!is_universal(&hdr, V_ASN1_SEQUENCE, 1)) {
+        ERR_raise(ERR_LIB_ASN1, ASN1_R_WRONG_TAG);
+        return 0;
+    }
+    if (!enter(s, &hdr, 1))
+        return 0;
+
+    /*
+     * Everything up to the EncapsulatedContentInfo or EncryptedContentInfo,
+     * the first SEQUENCE in all of them.
+     */
+    for (;;) {
+        if (!path_ends(s, &hdr, &ends))
+            return 0;
+        if (ends) {
+            ERR_raise(ERR_LIB_CMS, CMS_R_NO_CONTENT);
+            return 0;
+        }
+        if (is_universal(&hdr, V_ASN1_SEQUENCE, 1))
+            break;
+        if (!collect_element(s, &hdr, s->npath))
+            return 0;
+    }
+    if (!enter(s, &hdr, 1))
+        return 0;
+
+    /* Everything up to the [0] content, which is last */
+    for (;;) {
+        if (!path_ends(s, &hdr, &ends))
+            return 0;
+        if (ends) {
+            ERR_raise(ERR_LIB_CMS, CMS_R_NO_CONTENT);
+            return 0;
+        }
+        if (hdr.class == V_ASN1_CONTEXT_SPECIFIC && hdr.tag == 0)
+            break;
+        if (!collect_element(s, &hdr, s->npath))
+            return 0;
+    }
+
+    /* The encrypted content is [0] IMPLICIT OCTET STRING */
+    if (s->nid != NID_pkcs7_signed)
+        return start_content(s, &hdr);
+
+    /* The signed one is [0] EXPLICIT OCTET STRING */
+    if (!enter(s, &hdr, 0) || !read_header(s, &hdr))
+        return 0;
+    if (!is_universal(&hdr, V_ASN1_OCTET_STRING, hdr.constructed)) {
+        ERR_raise(ERR_LIB_ASN1, ASN1_R_WRONG_TAG);
+        return 0;
+    }
+    return start_content(s, &hdr);
+}
+
+/*
+ * Parse what was collected so far, with the enclosing elements that are
+ * still open closed, into |*pcms|.
+ */
+static int parse_collected(CMS_CONTENT_STREAM *s, CMS_ContentInfo **pcms)
+{
+    static const unsigned char eoc[2] = { 0, 0 };
+    static const unsigned char empty_set[2] = {
+        V_ASN1_SET | CMS_STREAM_CONSTRUCTED, 0
+    };
+    size_t length = s->der->length;
+    const unsigned char *p;
+    int i, ok = 1;
+
+    for (i = s->npath - 1; i >= 0 && ok; i--) {
+        /* The signerInfos of SignedData come after the content */
+        if (s->nid == NID_pkcs7_signed && i == CMS_STREAM_SIGNED_DATA)
+            ok = collect(s, empty_set, sizeof(empty_set));
+        if (ok && s->path[i].collected)
+            ok = collect(s, eoc, sizeof(eoc));
+    }
+    p = (unsigned char *)s->der->data;
+    ok = ok && d2i_CMS_ContentInfo(pcms, &p, s->der->length) != NULL;
+    s->der->length = length;
+    return ok;
+}
+
+/* Read what follows the content and complete the structure with it */
+static int finish(CMS_CONTENT_STREAM *s)
+{
+    CMS_ContentInfo *cms = s->cms, *full = NULL;
+    CMS_SignedData *tmpsd;
+    STACK_OF(X509_ATTRIBUTE) *tmpattrs;
+    int ok = 0;
+
+    while (s->npath > 0)
+        if (!leave(s))
+            return 0;
+    if (cms == NULL || s->nid == NID_pkcs7_data)
+        return 1;
+
+    full = CMS_ContentInfo_new_ex(ossl_cms_ctx_get0_libctx(&cms->ctx),
+                                  ossl_cms_ctx_get0_propq(&cms->ctx));
+    if (full == NULL || !parse_collected(s, &full))
+        goto err;
+    switch (s->nid) {
+    case NID_pkcs7_signed:
+        /* The signers and certificates come after the content */
+        tmpsd = cms->d.signedData;
+        cms->d.signedData = full->d.signedData;
+        full->d.signedData = tmpsd;
+        ERR_set_mark();
+        ossl_cms_resolve_libctx(cms);
+        ERR_pop_to_mark();
+        break;
+    case NID_pkcs7_enveloped:
+        tmpattrs = cms->d.envelopedData->unprotectedAttrs;
+        cms->d.envelopedData->unprotectedAttrs =
+            full->d.envelopedData->unprotectedAttrs;
+        full->d.envelopedData->unprotectedAttrs = tmpattrs;
+        break;
+    case NID_pkcs7_encrypted:
+        tmpattrs = cms->d.encryptedData->unprotectedAttrs;
+        cms->d.encryptedData->unprotectedAttrs =
+            full->d.encryptedData->unprotectedAttrs;
+        full->d.encryptedData->unprotectedAttrs = tmpattrs;
+        break;
+    }
+    cms->stream = NULL;
+    s->cms = NULL;
+    ok = 1;
+ err:
+    CMS_ContentInfo_free(full);
+    return ok;
+}
+
+static int cms_stream_read(BIO *b, char *out, int outl);
+static long cms_stream_ctrl(BIO *b, int cmd, long num, void *ptr);
+static int cms_stream_new(BIO *b);
+static int cms_stream_free(BIO *b);
+
+static const BIO_METHOD methods_cms_stream = {
+    BIO_TYPE_SOURCE_SINK,
+    "CMS content stream",
+    NULL,
+    NULL,
+    bread_conv,
+    cms_stream_read,
+    NULL,
+    NULL,
+    cms_stream_ctrl,
+    cms_stream_new,
+    cms_stream_free,
+    NULL,
+};
+
+static int cms_stream_new(BIO *b)
+{
+    CMS_CONTENT_STREAM *s = OPENSSL_zalloc(sizeof(*s));
+
+    if (s == NULL || (s->der = BUF_MEM_new()) == NULL) {
+        OPENSSL_free(s);
+        ERR_raise(ERR_LIB_CMS, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    BIO_set_data(b, s);
+    BIO_set_init(b, 1);
+    return 1;
+}
+
+static int cms_stream_free(BIO *b)
+{
+    CMS_CONTENT_STREAM *s = BIO_get_data(b);
+
+    if (s == NULL)
+        return 0;
+    if (s->cms != NULL)
+        s->cms->stream = NULL;
+    BUF_MEM_free(s->der);
+    OPENSSL_free(s);
+    BIO_set_data(b, NULL);
+    return 1;
+}
+
+static int cms_stream_read(BIO *b, char *out, int outl)
+{
+    CMS_CONTENT_STREAM *s = BIO_get_data(b);
+    CMS_STREAM_LEVEL *level;
+    CMS_STREAM_HDR hdr;
+    int n;
+
+    BIO_clear_retry_flags(b);
+    if (s->failed)
+        return -1;
+    if (s->done || out == NULL || outl <= 0)
+        return 0;
+
+    while (s->left == 0) {
+        if (s->nchunks == 0) {
+            s->done = finish(s);
+            s->failed = !s->done;
+            return s->done ? 0 : -1;
+        }
+        level = &s->chunks[s->nchunks - 1];
+        if (level->end == s->pos) {
+            s->nchunks--;
+            continue;
+        }
+        if (!read_header(s, &hdr))
+            goto err;
+        if (is_eoc(&hdr) && level->end == CMS_STREAM_INDEFINITE) {
+            s->nchunks--;
+            continue;
+        }
+        if (!is_universal(&hdr, V_ASN1_OCTET_STRING, hdr.constructed)) {
+            ERR_raise(ERR_LIB_ASN1, ASN1_R_WRONG_TAG);
+            goto err;
+        }
+        if (hdr.constructed) {
+            if (s->nchunks == CMS_STREAM_MAX_DEPTH) {
+                ERR_raise(ERR_LIB_ASN1, ASN1_R_NESTED_TOO_DEEP);
+                goto err;
+            }
+            level = &s->chunks[s->nchunks++];
+            level->end = hdr.len == CMS_STREAM_INDEFINITE
+                ? CMS_STREAM_INDEFINITE : s->pos + hdr.len;
+            level->collected = 0;
+        } else {
+            s->left = hdr.len;
+        }
+    }
+
+    if ((uint64_t)outl > s->left)
+        outl = (int)s->left;
+    n = BIO_read(s->in, out, outl);
+    if (n <= 0) {
+        if (BIO_should_retry(s->in)) {
+            BIO_copy_next_retry(b);
+            return n;
+        }
+        ERR_raise(ERR_LIB_ASN1, ASN1_R_NOT_ENOUGH_DATA);
+        goto err;
+    }
+    s->pos += n;
+    s->left -= n;
+    return n;
+
+ err:
+    s->failed = 1;
+    return -1;
+}
+
+static long cms_stream_ctrl(BIO *b, int cmd, long num, void *ptr)
+{
+    CMS_CONTENT_STREAM *s = BIO_get_data(b);
+
+    switch (cmd) {
+    case BIO_CTRL_EOF:
+        return s->done || s->failed;
+    case BIO_CTRL_FLUSH:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+void ossl_cms_stream_detach(CMS_ContentInfo *cms)
+{
+    if (cms->stream != NULL) {
+        cms->stream->cms = NULL;
+        cms->stream = NULL;
+    }
+}
+
+int ossl_cms_stream_pending(const CMS_ContentInfo *cms, BIO *dcont)
+{
+    return dcont != NULL && cms->stream != NULL
+        && BIO_get_data(dcont) == cms->stream;
+}
+
+CMS_ContentInfo *d2i_CMS_bio_stream(BIO *in, BIO **content,
+                                    OSSL_LIB_CTX *libctx, const char *propq)
+{
+    CMS_ContentInfo *cms = NULL;
+    CMS_CONTENT_STREAM *s;
+    BIO *b;
+
+    if (in == NULL || content == NULL) {
+        ERR_raise(ERR_LIB_CMS, ERR_R_PASSED_NULL_PARAMETER);
+        return NULL;
+    }
+    if ((b = BIO_new(&methods_cms_stream)) == NULL)
+        return NULL;
+    s = BIO_get_data(b);
+    s->in = in;
+    if (!read_to_content(s))
+        goto err;
+
+    if (s->nid == NID_pkcs7_data) {
+        if ((cms = ossl_cms_Data_create(libctx, propq)) == NULL
+            || !CMS_set_detached(cms, 1))
+            goto err;
+    } else {
+        if ((cms = CMS_ContentInfo_new_ex(libctx, propq)) == NULL
+            || !parse_collected(s, &cms))
+            goto err;
+    }
+    cms->stream = s;
+    s->cms = cms;
+    *content = b;
+    return cms;
+
+ err:
+    CMS_ContentInfo_free(cms);
+    BIO_free(b);
+    return NULL;
+}
@@ -0,0 +1,790 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <openssl/objects.h>
+#include "internal/comp.h"
+#include <openssl/err.h>
+#include "crypto/cryptlib.h"
+#include "internal/bio.h"
+#include "internal/thread_once.h"
+#include "comp_local.h"
+
+#ifdef OPENSSL_NO_BROTLI
+# undef BROTLI_SHARED
+#else
+
+# include <brotli/decode.h>
+# include <brotli/encode.h>
+
+static COMP_METHOD brotli_method_nobrotli = {
+    NID_undef,
+    "(undef)",
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+/* memory allocations functions for brotli initialisation */
+static void *brotli_alloc(void *opaque, size_t size)
+{
+    return OPENSSL_zalloc(size);
+}
+
+static void brotli_free(void *opaque, void *address)
+{
+    OPENSSL_free(address);
+}
+
+/*
+ * When OpenSSL is built with BROTLI_SHARED, we do not want to require that
+ * the brotli libraries be available in order for the OpenSSL libraries to
+ * work.  Therefore, all brotli routines are loaded at run time.
+ */
+# ifdef BROTLI_SHARED
+#  include "internal/dso.h"
+
+/* Function pointers */
+typedef BrotliEncoderState *(*encode_init_ft)(brotli_alloc_func,
+                                              brotli_free_func, void *);
+typedef BROTLI_BOOL (*encode_stream_ft)(BrotliEncoderState *,
+                                        BrotliEncoderOperation, size_t *,
+                                        const uint8_t **, size_t *,
+                                        uint8_t **, size_t *);
+typedef BROTLI_BOOL (*encode_has_more_ft)(BrotliEncoderState *);
+typedef BROTLI_BOOL (*encode_is_finished_ft)(BrotliEncoderState *);
+typedef BROTLI_BOOL (*encode_set_param_ft)(BrotliEncoderState *,
+                                           BrotliEncoderParameter, uint32_t);
+typedef void (*encode_end_ft)(BrotliEncoderState *);
+typedef BROTLI_BOOL (*encode_oneshot_ft)(int, int, BrotliEncoderMode, size_t,
+                                         const uint8_t in[], size_t *,
+                                         uint8_t out[]);
+
+typedef BrotliDecoderState *(*decode_init_ft)(brotli_alloc_func,
+                                              brotli_free_func, void *);
+typedef BrotliDecoderResult (*decode_stream_ft)(BrotliDecoderState *,
+                                                size_t *, const uint8_t **,
+                                                size_t *, uint8_t **,
+                                                size_t *);
+typedef BROTLI_BOOL (*decode_has_more_ft)(const BrotliDecoderState *);
+typedef void (*decode_end_ft)(BrotliDecoderState *);
+typedef BrotliDecoderErrorCode (*decode_error_ft)(const BrotliDecoderState *);
+typedef const char *(*decode_error_string_ft)(BrotliDecoderErrorCode);
+typedef BrotliDecoderResult (*decode_oneshot_ft)(size_t, const uint8_t in[],
+                                                 size_t *, uint8_t out[]);
+
+static encode_init_ft p_encode_init = NULL;
+static encode_stream_ft p_encode_stream = NULL;
+static encode_has_more_ft p_encode_has_more = NULL;
+static encode_is_finished_ft p_encode_is_finished = NULL;
+static encode_set_param_ft p_encode_set_param = NULL;
+static encode_end_ft p_encode_end = NULL;
+static encode_oneshot_ft p_encode_oneshot = NULL;
+
+static decode_init_ft p_decode_init = NULL;
+static decode_stream_ft p_decode_stream = NULL;
+static decode_has_more_ft p_decode_has_more = NULL;
+static decode_end_ft p_decode_end = NULL;
+static decode_error_ft p_decode_error = NULL;
+static decode_error_string_ft p_decode_error_string = NULL;
+static decode_oneshot_ft p_decode_oneshot = NULL;
+
+static DSO *brotli_encode_dso = NULL;
+static DSO *brotli_decode_dso = NULL;
+
+#  define BrotliEncoderCreateInstance    p_encode_init
+#  define BrotliEncoderCompressStream    p_encode_stream
+#  define BrotliEncoderHasMoreOutput     p_encode_has_more
+#  define BrotliEncoderIsFinished        p_encode_is_finished
+#  define BrotliEncoderSetParameter      p_encode_set_param
+#  define BrotliEncoderDestroyInstance   p_encode_end
+#  define BrotliEncoderCompress          p_encode_oneshot
+
+#  define BrotliDecoderCreateInstance    p_decode_init
+#  define BrotliDecoderDecompressStream  p_decode_stream
+#  define BrotliDecoderHasMoreOutput     p_decode_has_more
+#  define BrotliDecoderDestroyInstance   p_decode_end
+#  define BrotliDecoderGetErrorCode      p_decode_error
+#  define BrotliDecoderErrorString       p_decode_error_string
+#  define BrotliDecoderDecompress        p_decode_oneshot
+# endif                         /* BROTLI_SHARED */
+
+struct brotli_state {
+    BrotliEncoderState *encoder;
+    BrotliDecoderState *decoder;
+};
+
+static int brotli_stateful_init(COMP_CTX *ctx)
+{
+    struct brotli_state *state = OPENSSL_zalloc(sizeof(*state));
+
+    if (state == NULL)
+        return 0;
+
+    state->encoder = BrotliEncoderCreateInstance(brotli_alloc, brotli_free,
+                                                 NULL);
+    if (state->encoder == NULL)
+        goto err;
+
+    state->decoder = BrotliDecoderCreateInstance(brotli_alloc, brotli_free,
+                                                 NULL);
+    if (state->decoder == NULL)
+        goto err;
+
+    ctx->data = state;
+    return 1;
+ err:
+    if (state->encoder != NULL)
+        BrotliEncoderDestroyInstance(state->encoder);
+    OPENSSL_free(state);
+    return 0;
+}
+
+static void brotli_stateful_finish(COMP_CTX *ctx)
+{
+    struct brotli_state *state = ctx->data;
+
+    if (state != NULL) {
+        BrotliDecoderDestroyInstance(state->decoder);
+        BrotliEncoderDestroyInstance(state->encoder);
+        OPENSSL_free(state);
+        ctx->data = NULL;
+    }
+}
+
+/*
+ * Each block is flushed, so that it can be expanded on its own once the
+ * blocks before it have been.
+ */
+static int brotli_stateful_compress_block(COMP_CTX *ctx, unsigned char *out,
+                                          unsigned int olen, unsigned char *in,
+                                          unsigned int ilen)
+{
+    struct brotli_state *state = ctx->data;
+    const uint8_t *next_in = in;
+    size_t avail_in = ilen;
+    size_t avail_out = olen;
+
+    if (state == NULL || olen > INT_MAX)
+        return -1;
+
+    if (ilen == 0)
+        return 0;
+
+    while (avail_in > 0 || BrotliEncoderHasMoreOutput(state->encoder)) {
+        /* The output buffer is too small */
+        if (avail_out == 0)
+            return -1;
+        if (!BrotliEncoderCompressStream(state->encoder,
+                                         BROTLI_OPERATION_FLUSH,
+                                         &avail_in, &next_in,
+                                         &avail_out, &out, NULL))
+            return -1;
+    }
+    return (int)(olen - avail_out);
+}
+
+static int brotli_stateful_expand_block(COMP_CTX *ctx, unsigned char *out,
+                                        unsigned int olen, unsigned char *in,
+                                        unsigned int ilen)
+{
+    struct brotli_state *state = ctx->data;
+    const uint8_t *next_in = in;
+    size_t avail_in = ilen;
+    size_t avail_out = olen;
+    BrotliDecoderResult result;
+
+    if (state == NULL || olen > INT_MAX)
+        return -1;
+
+    if (ilen == 0)
+        return 0;
+
+    result = BrotliDecoderDecompressStream(state->decoder, &avail_in, &next_in,
+                                           &avail_out, &out, NULL);
+    if (result == BROTLI_DECODER_RESULT_ERROR
+            || avail_in != 0
+            || BrotliDecoderHasMoreOutput(state->decoder))
+        return -1;
+
+    return (int)(olen - avail_out);
+}
+
+static COMP_METHOD brotli_stateful_method = {
+    NID_brotli,
+    LN_brotli,
+    brotli_stateful_init,
+    brotli_stateful_finish,
+    brotli_stateful_compress_block,
+    brotli_stateful_expand_block
+};
+
+/* Each block is compressed on its own, as a complete brotli stream */
+static int brotli_oneshot_compress_block(COMP_CTX *ctx, unsigned char *out,
+                                         unsigned int olen, unsigned char *in,
+                                         unsigned int ilen)
+{
+    size_t out_size = olen;
+
+    if (ilen == 0)
+        return 0;
+
+    if (!BrotliEncoderCompress(BROTLI_DEFAULT_QUALITY, BROTLI_DEFAULT_WINDOW,
+                               BROTLI_DEFAULT_MODE, ilen, in,
+                               &out_size, out)
+            || out_size > INT_MAX)
+        return -1;
+
+    return (int)out_size;
+}
+
+static int brotli_oneshot_expand_block(COMP_CTX *ctx, unsigned char *out,
+                                       unsigned int olen, unsigned char *in,
+                                       unsigned int ilen)
+{
+    size_t out_size = olen;
+
+    if (ilen == 0)
+        return 0;
+
+    if (BrotliDecoderDecompress(ilen, in, &out_size, out)
+            != BROTLI_DECODER_RESULT_SUCCESS
+            || out_size > INT_MAX)
+        return -1;
+
+    return (int)out_size;
+}
+
+static COMP_METHOD brotli_oneshot_method = {
+    NID_brotli,
+    LN_brotli,
+    NULL,
+    NULL,
+    brotli_oneshot_compress_block,
+    brotli_oneshot_expand_block
+};
+
+static CRYPTO_ONCE brotli_once = CRYPTO_ONCE_STATIC_INIT;
+DEFINE_RUN_ONCE_STATIC(ossl_comp_brotli_init)
+{
+# ifdef BROTLI_SHARED
+    /* LIBBROTLIENC and LIBBROTLIDEC may be externally defined */
+#  ifndef LIBBROTLIENC
+#   if defined(OPENSSL_SYS_WINDOWS) || defined(OPENSSL_SYS_WIN32)
+#    define LIBBROTLIENC "BROTLIENC"
+#    define LIBBROTLIDEC "BROTLIDEC"
+#   else
+#    define LIBBROTLIENC "brotlienc"
+#    define LIBBROTLIDEC "brotlidec"
+#   endif
+#  endif
+
+    brotli_encode_dso = DSO_load(NULL, LIBBROTLIENC, NULL, 0);
+    if (brotli_encode_dso != NULL) {
+        p_encode_init = (encode_init_ft)
+            DSO_bind_func(brotli_encode_dso, "BrotliEncoderCreateInstance");
+        p_encode_stream = (encode_stream_ft)
+            DSO_bind_func(brotli_encode_dso, "BrotliEncoderCompressStream");
+        p_encode_has_more = (encode_has_more_ft)
+            DSO_bind_func(brotli_encode_dso, "BrotliEncoderHasMoreOutput");
+        p_encode_is_finished = (encode_is_finished_ft)
+            DSO_bind_func(brotli_encode_dso, "BrotliEncoderIsFinished");
+        p_encode_set_param = (encode_set_param_ft)
+            DSO_bind_func(brotli_encode_dso, "BrotliEncoderSetParameter");
+        p_encode_end = (encode_end_ft)
+            DSO_bind_func(brotli_encode_dso, "BrotliEncoderDestroyInstance");
+        p_encode_oneshot = (encode_oneshot_ft)
+            DSO_bind_func(brotli_encode_dso, "BrotliEncoderCompress");
+    }
+
+    brotli_decode_dso = DSO_load(NULL, LIBBROTLIDEC, NULL, 0);
+    if (brotli_decode_dso != NULL) {
+        p_decode_init = (decode_init_ft)
+            DSO_bind_func(brotli_decode_dso, "BrotliDecoderCreateInstance");
+        p_decode_stream = (decode_stream_ft)
+            DSO_bind_func(brotli_decode_dso, "BrotliDecoderDecompressStream");
+        p_decode_has_more = (decode_has_more_ft)
+            DSO_bind_func(brotli_decode_dso, "BrotliDecoderHasMoreOutput");
+        p_decode_end = (decode_end_ft)
+            DSO_bind_func(brotli_decode_dso, "BrotliDecoderDestroyInstance");
+        p_decode_error = (decode_error_ft)
+            DSO_bind_func(brotli_decode_dso, "BrotliDecoderGetErrorCode");
+        p_decode_error_string = (decode_error_string_ft)
+            DSO_bind_func(brotli_decode_dso, "BrotliDecoderErrorString");
+        p_decode_oneshot = (decode_oneshot_ft)
+            DSO_bind_func(brotli_decode_dso, "BrotliDecoderDecompress");
+    }
+
+    if (p_encode_init == NULL || p_encode_stream == NULL
+            || p_encode_has_more == NULL || p_encode_is_finished == NULL
+            || p_encode_set_param == NULL || p_encode_end == NULL
+            || p_encode_oneshot == NULL || p_decode_init == NULL
+            || p_decode_stream == NULL || p_decode_has_more == NULL
+            || p_decode_end == NULL || p_decode_error == NULL
+            || p_decode_error_string == NULL || p_decode_oneshot == NULL) {
+        ossl_comp_brotli_cleanup();
+        return 0;
+    }
+# endif
+    return 1;
+}
+
+/*
+ * The stateful method compresses a sequence of blocks as one stream, like
+ * the zlib method, and the one-shot method each block as a stream of its
+ * own, as needed for TLS certificate compression (RFC 8879).
+ */
+COMP_METHOD *COMP_brotli(void)
+{
+    COMP_METHOD *meth = &brotli_method_nobrotli;
+
+    if (RUN_ONCE(&brotli_once, ossl_comp_brotli_init))
+        meth = &brotli_stateful_method;
+
+    return meth;
+}
+
+COMP_METHOD *COMP_brotli_oneshot(void)
+{
+    COMP_METHOD *meth = &brotli_method_nobrotli;
+
+    if (RUN_ONCE(&brotli_once, ossl_comp_brotli_init))
+        meth = &brotli_oneshot_method;
+
+    return meth;
+}
+#endif
+
+/* Also called from OPENSSL_cleanup() */
+void ossl_comp_brotli_cleanup(void)
+{
+#ifdef BROTLI_SHARED
+    DSO_free(brotli_encode_dso);
+    brotli_encode_dso = NULL;
+    DSO_free(brotli_decode_dso);
+    brotli_decode_dso = NULL;
+    p_encode_init = NULL;
+    p_encode_stream = NULL;
+    p_encode_has_more = NULL;
+    p_encode_is_finished = NULL;
+    p_encode_set_param = NULL;
+    p_encode_end = NULL;
+    p_encode_oneshot = NULL;
+    p_decode_init = NULL;
+    p_decode_stream = NULL;
+    p_decode_has_more = NULL;
+    p_decode_end = NULL;
+    p_decode_error = NULL;
+    p_decode_error_string = NULL;
+    p_decode_oneshot = NULL;
+#endif
+}
+
+#ifndef OPENSSL_NO_BROTLI
+
+/* Brotli based compression/decompression filter BIO */
+
+typedef struct {
+    struct { /* input structure */
+        BrotliDecoderState *state;
+        unsigned char *buf;     /* Input buffer */
+        size_t bufsize;         /* Buffer size */
+        const uint8_t *next_in; /* Unconsumed input */
+        size_t avail_in;        /* Amount of unconsumed input */
+    } decode;
+    struct { /* output structure */
+        BrotliEncoderState *state;
+        unsigned char *buf;     /* Output buffer */
+        size_t bufsize;         /* Output buffer size */
+        unsigned char *ptr;     /* Position in output buffer */
+        size_t count;           /* Amount of data in output buffer */
+        int done;               /* Stream finished */
+        int quality;            /* Quality to use */
+    } encode;
+} BIO_BROTLI_CTX;
+
+# define BROTLI_DEFAULT_BUFSIZE (16 * 1024)
+
+static int bio_brotli_new(BIO *bi);
+static int bio_brotli_free(BIO *bi);
+static int bio_brotli_read(BIO *b, char *out, int outl);
+static int bio_brotli_write(BIO *b, const char *in, int inl);
+static long bio_brotli_ctrl(BIO *b, int cmd, long num, void *ptr);
+static long bio_brotli_callback_ctrl(BIO *b, int cmd, BIO_info_cb *fp);
+
+static const BIO_METHOD bio_meth_brotli = {
+    BIO_TYPE_COMP,
+    "brotli",
+    bwrite_conv,
+    bio_brotli_write,
+    bread_conv,
+    bio_brotli_read,
+    NULL,                      /* bio_brotli_puts, */
+    NULL,                      /* bio_brotli_gets, */
+    bio_brotli_ctrl,
+    bio_brotli_new,
+    bio_brotli_free,
+    bio_brotli_callback_ctrl
+};
+
+const BIO_METHOD *BIO_f_brotli(void)
+{
+    return &bio_meth_brotli;
+}
+
+static int bio_brotli_new(BIO *bi)
+{
+    BIO_BROTLI_CTX *ctx;
+
+# ifdef BROTLI_SHARED
+    if (!RUN_ONCE(&brotli_once, ossl_comp_brotli_init)) {
+        ERR_raise(ERR_LIB_COMP, COMP_R_BROTLI_NOT_SUPPORTED);
+        return 0;
+    }
+# endif
+    ctx = OPENSSL_zalloc(sizeof(*ctx));
+    if (ctx == NULL) {
+        ERR_raise(ERR_LIB_COMP, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    ctx->decode.bufsize = BROTLI_DEFAULT_BUFSIZE;
+    ctx->encode.bufsize = BROTLI_DEFAULT_BUFSIZE;
+    ctx->encode.quality = BROTLI_DEFAULT_QUALITY;
+    BIO_set_init(bi, 1);
+    BIO_set_data(bi, ctx);
+
+    return 1;
+}
+
+static int bio_brotli_free(BIO *bi)
+{
+    BIO_BROTLI_CTX *ctx;
+
+    if (bi == NULL)
+        return 0;
+    ctx = BIO_get_data(bi);
+    if (ctx != NULL) {
+        if (ctx->decode.state != NULL)
+            BrotliDecoderDestroyInstance(ctx->decode.state);
+        OPENSSL_free(ctx->decode.buf);
+        if (ctx->encode.state != NULL)
+            BrotliEncoderDestroyInstance(ctx->encode.state);
+        OPENSSL_free(ctx->encode.buf);
+        OPENSSL_free(ctx);
+    }
+    BIO_set_data(bi, NULL);
+    BIO_set_init(bi, 0);
+
+    return 1;
+}
+
+static int bio_brotli_read(BIO *b, char *out, int outl)
+{
+    BIO_BROTLI_CTX *ctx;
+    BrotliDecoderResult bret;
+    int ret;
+    size_t avail_out;
+    BIO *next = BIO_next(b);
+
+    if (out == NULL || outl <= 0)
+        return 0;
+    ctx = BIO_get_data(b);
+    BIO_clear_retry_flags(b);
+    if (ctx->decode.state == NULL) {
+        ctx->decode.buf = OPENSSL_malloc(ctx->decode.bufsize);
+        if (ctx->decode.buf == NULL) {
+            ERR_raise(ERR_LIB_COMP, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+        ctx->decode.state = BrotliDecoderCreateInstance(brotli_alloc,
+                                                        brotli_free, NULL);
+        if (ctx->decode.state == NULL) {
+            OPENSSL_free(ctx->decode.buf);
+            ctx->decode.buf = NULL;
+            ERR_raise(ERR_LIB_COMP, COMP_R_BROTLI_DECODE_ERROR);
+            return 0;
+        }
+        ctx->decode.next_in = ctx->decode.buf;
+        ctx->decode.avail_in = 0;
+    }
+
+    /* Copy output data directly to supplied buffer */
+    avail_out = (size_t)outl;
+    for (;;) {
+        /* Decompress while data available */
+        bret = BrotliDecoderDecompressStream(ctx->decode.state,
+                                             &ctx->decode.avail_in,
+                                             &ctx->decode.next_in,
+                                             &avail_out,
+                                             (uint8_t **)&out, NULL);
+        if (bret == BROTLI_DECODER_RESULT_ERROR) {
+            BrotliDecoderErrorCode err
+                = BrotliDecoderGetErrorCode(ctx->decode.state);
+
+            ERR_raise_data(ERR_LIB_COMP, COMP_R_BROTLI_DECODE_ERROR,
+                           "brotli error: %s", BrotliDecoderErrorString(err));
+            return 0;
+        }
+        /* If EOF or we've read anything then return */
+        if (bret == BROTLI_DECODER_RESULT_SUCCESS || avail_out < (size_t)outl)
+            return outl - (int)avail_out;
+
+        /*
+         * No data in input buffer try to read some in, if an error then
+         * return the total data read.
+         */
+        ret = BIO_read(next, ctx->decode.buf, (int)ctx->decode.bufsize);
+        if (ret <= 0) {
+            BIO_copy_next_retry(b);
+            return ret;
+        }
+        ctx->decode.avail_in = ret;
+        ctx->decode.next_in = ctx->decode.buf;
+    }
+}
+
+static int bio_brotli_write(BIO *b, const char *in, int inl)
+{
+    BIO_BROTLI_CTX *ctx;
+    int ret;
+    const uint8_t *next_in;
+    size_t avail_in, avail_out;
+    uint8_t *next_out;
+    BIO *next = BIO_next(b);
+
+    if (in == NULL || inl <= 0)
+        return 0;
+    ctx = BIO_get_data(b);
+    if (ctx->encode.done)
+        return 0;
+    BIO_clear_retry_flags(b);
+    if (ctx->encode.state == NULL) {
+        ctx->encode.buf = OPENSSL_malloc(ctx->encode.bufsize);
+        if (ctx->encode.buf == NULL) {
+            ERR_raise(ERR_LIB_COMP, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+        ctx->encode.state = BrotliEncoderCreateInstance(brotli_alloc,
+                                                        brotli_free, NULL);
+        if (ctx->encode.state == NULL
+                || !BrotliEncoderSetParameter(ctx->encode.state,
+                                              BROTLI_PARAM_QUALITY,
+                                              ctx->encode.quality)) {
+            if (ctx->encode.state != NULL)
+                BrotliEncoderDestroyInstance(ctx->encode.state);
+            ctx->encode.state = NULL;
+            OPENSSL_free(ctx->encode.buf);
+            ctx->encode.buf = NULL;
+            ERR_raise(ERR_LIB_COMP, COMP_R_BROTLI_ENCODE_ERROR);
+            return 0;
+        }
+        ctx->encode.ptr = ctx->encode.buf;
+        ctx->encode.count = 0;
+    }
+    /* Obtain input data directly from supplied buffer */
+    next_in = (const uint8_t *)in;
+    avail_in = inl;
+    for (;;) {
+        /* If data in output buffer write it first */
+        while (ctx->encode.count > 0) {
+            ret = BIO_write(next, ctx->encode.ptr, (int)ctx->encode.count);
+            if (ret <= 0) {
+                /* Total data written */
+                int tot = inl - (int)avail_in;
+
+                BIO_copy_next_retry(b);
+                if (ret < 0)
+                    return (tot > 0) ? tot : ret;
+                return tot;
+            }
+            ctx->encode.ptr += ret;
+            ctx->encode.count -= ret;
+        }
+
+        /* Have we consumed all supplied data? */
+        if (avail_in == 0 && !BrotliEncoderHasMoreOutput(ctx->encode.state))
+            return inl;
+
+        /* Compress some more */
+
+        /* Reset buffer */
+        ctx->encode.ptr = ctx->encode.buf;
+        next_out = ctx->encode.buf;
+        avail_out = ctx->encode.bufsize;
+        if (!BrotliEncoderCompressStream(ctx->encode.state,
+                                         BROTLI_OPERATION_PROCESS,
+                                         &avail_in, &next_in,
+                                         &avail_out, &next_out, NULL)) {
+            ERR_raise(ERR_LIB_COMP, COMP_R_BROTLI_ENCODE_ERROR);
+            return 0;
+        }
+        ctx->encode.count = ctx->encode.bufsize - avail_out;
+    }
+}
+
+static int bio_brotli_flush(BIO *b)
+{
+    BIO_BROTLI_CTX *ctx;
+    int ret;
+    const uint8_t *next_in = NULL;
+    size_t avail_in = 0, avail_out;
+    uint8_t *next_out;
+    BIO *next = BIO_next(b);
+
+    ctx = BIO_get_data(b);
+    /* If no data written or already flush show success */
+    if (ctx->encode.state == NULL
+            || (ctx->encode.done && ctx->encode.count == 0))
+        return 1;
+    BIO_clear_retry_flags(b);
+    for (;;) {
+        /* If data in output buffer write it first */
+        while (ctx->encode.count > 0) {
+            ret = BIO_write(next, ctx->encode.ptr, (int)ctx->encode.count);
+            if (ret <= 0) {
+                BIO_copy_next_retry(b);
+                return ret;
+            }
+            ctx->encode.ptr += ret;
+            ctx->encode.count -= ret;
+        }
+        if (ctx->encode.done)
+            return 1;
+
+        /* Compress some more */
+
+        /* Reset buffer */
+        ctx->encode.ptr = ctx->encode.buf;
+        next_out = ctx->encode.buf;
+        avail_out = ctx->encode.bufsize;
+        if (!BrotliEncoderCompressStream(ctx->encode.state,
+                                         BROTLI_OPERATION_FINISH,
+                                         &avail_in, &next_in,
+                                         &avail_out, &next_out, NULL)) {
+            ERR_raise(ERR_LIB_COMP, COMP_R_BROTLI_ENCODE_ERROR);
+            return 0;
+        }
+        if (BrotliEncoderIsFinished(ctx->encode.state))
+            ctx->encode.done = 1;
+        ctx->encode.count = ctx->encode.bufsize - avail_out;
+    }
+}
+
+static long bio_brotli_ctrl(BIO *b, int cmd, long num, void *ptr)
+{
+    BIO_BROTLI_CTX *ctx;
+    int ret, *ip;
+    int ibs, obs;
+    BIO *next = BIO_next(b);
+
+    if (next == NULL)
+        return 0;
+    ctx = BIO_get_data(b);
+    switch (cmd) {
+
+    case BIO_CTRL_RESET:
+        ctx->encode.count = 0;
+        ctx->encode.done = 0;
+        ret = 1;
+        break;
+
+    case BIO_CTRL_FLUSH:
+        ret = bio_brotli_flush(b);
+        if (ret > 0)
+            ret = BIO_flush(next);
+        break;
+
+    case BIO_C_SET_BUFF_SIZE:
+        ibs = -1;
+        obs = -1;
+        if (ptr != NULL) {
+            ip = ptr;
+            if (*ip == 0)
+                ibs = (int)num;
+            else
+                obs = (int)num;
+        } else {
+            ibs = (int)num;
+            obs = ibs;
+        }
+
+        /* The buffers can't be changed once they are in use */
+        if ((ibs != -1 && (ibs <= 0 || ctx->decode.state != NULL))
+                || (obs != -1 && (obs <= 0 || ctx->encode.state != NULL)))
+            return 0;
+        if (ibs != -1)
+            ctx->decode.bufsize = ibs;
+        if (obs != -1)
+            ctx->encode.bufsize = obs;
+        ret = 1;
+        break;
+
+    case BIO_C_SET_COMP_LEVEL:
+        if (ctx->encode.state != NULL
+                || num < BROTLI_MIN_QUALITY || num > BROTLI_MAX_QUALITY)
+            return 0;
+        ctx->encode.quality = (int)num;
+        ret = 1;
+        break;
+
+    case BIO_C_DO_STATE_MACHINE:
+        BIO_clear_retry_flags(b);
+        ret = BIO_ctrl(next, cmd, num, ptr);
+        BIO_copy_next_retry(b);
+        break;
+
+    case BIO_CTRL_WPENDING:
+        if (ctx->encode.state == NULL)
+            return 0;
+
+        if (ctx->encode.done) {
+            ret = (int)ctx->encode.count;
+        } else {
+            ret = (int)ctx->encode.count;
+            if (ret == 0)
+                /* Unknown amount pending but we are not finished */
+                ret = 1;
+        }
+        if (ret == 0)
+            ret = BIO_ctrl(next, cmd, num, ptr);
+        break;
+
+    case BIO_CTRL_PENDING:
+        ret = (int)ctx->decode.avail_in;
+        if (ret == 0)
+            ret = BIO_ctrl(next, cmd, num, ptr);
+        break;
+
+    case BIO_C_SET_COMP_DICTIONARY:
+        /* Not supported by the brotli API */
+        return 0;
+
+    default:
+        ret = BIO_ctrl(next, cmd, num, ptr);
+        break;
+
+    }
+
+    return ret;
+}
+
+static long bio_brotli_callback_ctrl(BIO *b, int cmd, BIO_info_cb *fp)
+{
+    BIO *next = BIO_next(b);
+
+    if (next == NULL)
+        return 0;
+    return BIO_callback_ctrl(next, cmd, fp);
+}
+
+#endif
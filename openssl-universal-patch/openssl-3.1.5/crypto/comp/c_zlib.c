@@ -1,5 +1,5 @@
 /*
- * Copyright 1998-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1998-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <openssl/objects.h>
 #include "internal/comp.h"
 #include <openssl/err.h>
@@ -19,6 +20,7 @@
 #include "comp_local.h"
 
 COMP_METHOD *COMP_zlib(void);
+COMP_METHOD *COMP_zlib_oneshot(void);
 
 static COMP_METHOD zlib_method_nozlib = {
     NID_undef,
@@ -43,6 +45,12 @@ static int zlib_stateful_compress_block(COMP_CTX *ctx, unsigned char *out,
 static int zlib_stateful_expand_block(COMP_CTX *ctx, unsigned char *out,
                                       unsigned int olen, unsigned char *in,
                                       unsigned int ilen);
+static int zlib_oneshot_compress_block(COMP_CTX *ctx, unsigned char *out,
+                                       unsigned int olen, unsigned char *in,
+                                       unsigned int ilen);
+static int zlib_oneshot_expand_block(COMP_CTX *ctx, unsigned char *out,
+                                     unsigned int olen, unsigned char *in,
+                                     unsigned int ilen);
 
 /* memory allocations functions for zlib initialisation */
 static void *zlib_zalloc(void *opaque, unsigned int no, unsigned int size)
@@ -68,6 +76,15 @@ static COMP_METHOD zlib_stateful_method = {
     zlib_stateful_expand_block
 };
 
+static COMP_METHOD zlib_oneshot_method = {
+    NID_zlib_compression,
+    LN_zlib_compression,
+    NULL,
+    NULL,
+    zlib_oneshot_compress_block,
+    zlib_oneshot_expand_block
+};
+
 /*
  * When OpenSSL is built on Windows, we do not want to require that
  * the ZLIB.DLL be available in order for the OpenSSL DLLs to
@@ -85,6 +102,8 @@ static COMP_METHOD zlib_stateful_method = {
 /* Function pointers */
 typedef int (*compress_ft) (Bytef *dest, uLongf * destLen,
                             const Bytef *source, uLong sourceLen);
+typedef int (*uncompress_ft) (Bytef *dest, uLongf * destLen,
+                              const Bytef *source, uLong sourceLen);
 typedef int (*inflateEnd_ft) (z_streamp strm);
 typedef int (*inflate_ft) (z_streamp strm, int flush);
 typedef int (*inflateInit__ft) (z_streamp strm,
@@ -95,6 +114,7 @@ typedef int (*deflateInit__ft) (z_streamp strm, int level,
                                 const char *version, int stream_size);
 typedef const char *(*zError__ft) (int err);
 static compress_ft p_compress = NULL;
+static uncompress_ft p_uncompress = NULL;
 static inflateEnd_ft p_inflateEnd = NULL;
 static inflate_ft p_inflate = NULL;
 static inflateInit__ft p_inflateInit_ = NULL;
@@ -106,6 +126,7 @@ static zError__ft p_zError = NULL;
 static DSO *zlib_dso = NULL;
 
 #  define compress                p_compress
+#  define uncompress              p_uncompress
 #  define inflateEnd              p_inflateEnd
 #  define inflate                 p_inflate
 #  define inflateInit_            p_inflateInit_
@@ -204,6 +225,39 @@ static int zlib_stateful_expand_block(COMP_CTX *ctx, unsigned char *out,
     return olen - state->istream.avail_out;
 }
 
+/* Each block is compressed on its own, as a complete zlib stream */
+static int zlib_oneshot_compress_block(COMP_CTX *ctx, unsigned char *out,
+                                       unsigned int olen, unsigned char *in,
+                                       unsigned int ilen)
+{
+    uLongf out_size;
+
+    if (ilen == 0)
+        return 0;
+
+    out_size = olen;
+    if (compress(out, &out_size, in, ilen) != Z_OK || out_size > INT_MAX)
+        return -1;
+
+    return (int)out_size;
+}
+
+static int zlib_oneshot_expand_block(COMP_CTX *ctx, unsigned char *out,
+                                     unsigned int olen, unsigned char *in,
+                                     unsigned int ilen)
+{
+    uLongf out_size;
+
+    if (ilen == 0)
+        return 0;
+
+    out_size = olen;
+    if (uncompress(out, &out_size, in, ilen) != Z_OK || out_size > INT_MAX)
+        return -1;
+
+    return (int)out_size;
+}
+
 static CRYPTO_ONCE zlib_once = CRYPTO_ONCE_STATIC_INIT;
 DEFINE_RUN_ONCE_STATIC(ossl_comp_zlib_init)
 {
@@ -222,6 +276,7 @@ DEFINE_RUN_ONCE_STATIC(ossl_comp_zlib_init)
     zlib_dso = DSO_load(NULL, LIBZ, NULL, 0);
     if (zlib_dso != NULL) {
         p_compress = (compress_ft) DSO_bind_func(zlib_dso, "compress");
+        p_uncompress = (uncompress_ft) DSO_bind_func(zlib_dso, "uncompress");
         p_inflateEnd = (inflateEnd_ft) DSO_bind_func(zlib_dso, "inflateEnd");
         p_inflate = (inflate_ft) DSO_bind_func(zlib_dso, "inflate");
         p_inflateInit_ = (inflateInit__ft) DSO_bind_func(zlib_dso, "inflateInit_");
@@ -229,14 +284,14 @@ DEFINE_RUN_ONCE_STATIC(ossl_comp_zlib_init)
         p_deflate = (deflate_ft) DSO_bind_func(zlib_dso, "deflate");
         p_deflateInit_ = (deflateInit__ft) DSO_bind_func(zlib_dso, "deflateInit_");
         p_zError = (zError__ft) DSO_bind_func(zlib_dso, "zError");
+    }
 
-        if (p_compress == NULL || p_inflateEnd == NULL
-                || p_inflate == NULL || p_inflateInit_ == NULL
-                || p_deflateEnd == NULL || p_deflate == NULL
-                || p_deflateInit_ == NULL || p_zError == NULL) {
-            ossl_comp_zlib_cleanup();
-            return 0;
-        }
+    if (p_compress == NULL || p_uncompress == NULL || p_inflateEnd == NULL
+            || p_inflate == NULL || p_inflateInit_ == NULL
+            || p_deflateEnd == NULL || p_deflate == NULL
+            || p_deflateInit_ == NULL || p_zError == NULL) {
+        ossl_comp_zlib_cleanup();
+        return 0;
     }
 # endif
     return 1;
@@ -255,6 +310,18 @@ COMP_METHOD *COMP_zlib(void)
     return meth;
 }
 
+COMP_METHOD *COMP_zlib_oneshot(void)
+{
+    COMP_METHOD *meth = &zlib_method_nozlib;
+
+#ifdef ZLIB
+    if (RUN_ONCE(&zlib_once, ossl_comp_zlib_init))
+        meth = &zlib_oneshot_method;
+#endif
+
+    return meth;
+}
+
 /* Also called from OPENSSL_cleanup() */
 void ossl_comp_zlib_cleanup(void)
 {
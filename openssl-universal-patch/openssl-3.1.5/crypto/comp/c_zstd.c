@@ -0,0 +1,815 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <openssl/objects.h>
+#include "internal/comp.h"
+#include <openssl/err.h>
+#include "crypto/cryptlib.h"
+#include "internal/bio.h"
+#include "internal/thread_once.h"
+#include "comp_local.h"
+
+#ifdef OPENSSL_NO_ZSTD
+# undef ZSTD_SHARED
+#else
+
+# include <zstd.h>
+
+static COMP_METHOD zstd_method_nozstd = {
+    NID_undef,
+    "(undef)",
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+/*
+ * When OpenSSL is built with ZSTD_SHARED, we do not want to require that
+ * the zstd library be available in order for the OpenSSL libraries to
+ * work.  Therefore, all zstd routines are loaded at run time.
+ */
+# ifdef ZSTD_SHARED
+#  include "internal/dso.h"
+
+/* Function pointers */
+typedef ZSTD_CCtx *(*createCCtx_ft)(void);
+typedef size_t (*freeCCtx_ft)(ZSTD_CCtx *);
+typedef ZSTD_DCtx *(*createDCtx_ft)(void);
+typedef size_t (*freeDCtx_ft)(ZSTD_DCtx *);
+typedef size_t (*CCtx_setParameter_ft)(ZSTD_CCtx *, ZSTD_cParameter, int);
+typedef size_t (*CCtx_loadDictionary_ft)(ZSTD_CCtx *, const void *, size_t);
+typedef size_t (*DCtx_loadDictionary_ft)(ZSTD_DCtx *, const void *, size_t);
+typedef size_t (*compressStream2_ft)(ZSTD_CCtx *, ZSTD_outBuffer *,
+                                     ZSTD_inBuffer *, ZSTD_EndDirective);
+typedef size_t (*decompressStream_ft)(ZSTD_DCtx *, ZSTD_outBuffer *,
+                                      ZSTD_inBuffer *);
+typedef size_t (*compress_ft)(void *, size_t, const void *, size_t, int);
+typedef size_t (*decompress_ft)(void *, size_t, const void *, size_t);
+typedef unsigned (*isError_ft)(size_t);
+typedef const char *(*getErrorName_ft)(size_t);
+typedef size_t (*CStreamOutSize_ft)(void);
+typedef size_t (*DStreamInSize_ft)(void);
+typedef int (*minCLevel_ft)(void);
+typedef int (*maxCLevel_ft)(void);
+
+static createCCtx_ft p_createCCtx = NULL;
+static freeCCtx_ft p_freeCCtx = NULL;
+static createDCtx_ft p_createDCtx = NULL;
+static freeDCtx_ft p_freeDCtx = NULL;
+static CCtx_setParameter_ft p_CCtx_setParameter = NULL;
+static CCtx_loadDictionary_ft p_CCtx_loadDictionary = NULL;
+static DCtx_loadDictionary_ft p_DCtx_loadDictionary = NULL;
+static compressStream2_ft p_compressStream2 = NULL;
+static decompressStream_ft p_decompressStream = NULL;
+static compress_ft p_compress = NULL;
+static decompress_ft p_decompress = NULL;
+static isError_ft p_isError = NULL;
+static getErrorName_ft p_getErrorName = NULL;
+static CStreamOutSize_ft p_CStreamOutSize = NULL;
+static DStreamInSize_ft p_DStreamInSize = NULL;
+static minCLevel_ft p_minCLevel = NULL;
+static maxCLevel_ft p_maxCLevel = NULL;
+
+static DSO *zstd_dso = NULL;
+
+#  define ZSTD_createCCtx               p_createCCtx
+#  define ZSTD_freeCCtx                 p_freeCCtx
+#  define ZSTD_createDCtx               p_createDCtx
+#  define ZSTD_freeDCtx                 p_freeDCtx
+#  define ZSTD_CCtx_setParameter        p_CCtx_setParameter
+#  define ZSTD_CCtx_loadDictionary      p_CCtx_loadDictionary
+#  define ZSTD_DCtx_loadDictionary      p_DCtx_loadDictionary
+#  define ZSTD_compressStream2          p_compressStream2
+#  define ZSTD_decompressStream         p_decompressStream
+#  define ZSTD_compress                 p_compress
+#  define ZSTD_decompress               p_decompress
+#  define ZSTD_isError                  p_isError
+#  define ZSTD_getErrorName             p_getErrorName
+#  define ZSTD_CStreamOutSize           p_CStreamOutSize
+#  define ZSTD_DStreamInSize            p_DStreamInSize
+#  define ZSTD_minCLevel                p_minCLevel
+#  define ZSTD_maxCLevel                p_maxCLevel
+# endif                         /* ZSTD_SHARED */
+
+struct zstd_state {
+    ZSTD_CCtx *compressor;
+    ZSTD_DCtx *decompressor;
+};
+
+static int zstd_stateful_init(COMP_CTX *ctx)
+{
+    struct zstd_state *state = OPENSSL_zalloc(sizeof(*state));
+
+    if (state == NULL)
+        return 0;
+
+    state->compressor = ZSTD_createCCtx();
+    if (state->compressor == NULL)
+        goto err;
+
+    state->decompressor = ZSTD_createDCtx();
+    if (state->decompressor == NULL)
+        goto err;
+
+    ctx->data = state;
+    return 1;
+ err:
+    ZSTD_freeCCtx(state->compressor);
+    OPENSSL_free(state);
+    return 0;
+}
+
+static void zstd_stateful_finish(COMP_CTX *ctx)
+{
+    struct zstd_state *state = ctx->data;
+
+    if (state != NULL) {
+        ZSTD_freeDCtx(state->decompressor);
+        ZSTD_freeCCtx(state->compressor);
+        OPENSSL_free(state);
+        ctx->data = NULL;
+    }
+}
+
+/*
+ * Each block is flushed, so that it can be expanded on its own once the
+ * blocks before it have been.
+ */
+static int zstd_stateful_compress_block(COMP_CTX *ctx, unsigned char *out,
+                                        unsigned int olen, unsigned char *in,
+                                        unsigned int ilen)
+{
+    struct zstd_state *state = ctx->data;
+    ZSTD_inBuffer inbuf;
+    ZSTD_outBuffer outbuf;
+    size_t ret;
+
+    if (state == NULL || olen > INT_MAX)
+        return -1;
+
+    if (ilen == 0)
+        return 0;
+
+    inbuf.src = in;
+    inbuf.size = ilen;
+    inbuf.pos = 0;
+    outbuf.dst = out;
+    outbuf.size = olen;
+    outbuf.pos = 0;
+    do {
+        ret = ZSTD_compressStream2(state->compressor, &outbuf, &inbuf,
+                                   ZSTD_e_flush);
+        if (ZSTD_isError(ret))
+            return -1;
+        /* The output buffer is too small */
+        if (ret > 0 && outbuf.pos == outbuf.size)
+            return -1;
+    } while (ret > 0);
+
+    return (int)outbuf.pos;
+}
+
+static int zstd_stateful_expand_block(COMP_CTX *ctx, unsigned char *out,
+                                      unsigned int olen, unsigned char *in,
+                                      unsigned int ilen)
+{
+    struct zstd_state *state = ctx->data;
+    ZSTD_inBuffer inbuf;
+    ZSTD_outBuffer outbuf;
+    size_t ret;
+
+    if (state == NULL || olen > INT_MAX)
+        return -1;
+
+    if (ilen == 0)
+        return 0;
+
+    inbuf.src = in;
+    inbuf.size = ilen;
+    inbuf.pos = 0;
+    outbuf.dst = out;
+    outbuf.size = olen;
+    outbuf.pos = 0;
+    while (inbuf.pos < inbuf.size) {
+        ret = ZSTD_decompressStream(state->decompressor, &outbuf, &inbuf);
+        if (ZSTD_isError(ret))
+            return -1;
+        /* The output buffer is too small */
+        if (outbuf.pos == outbuf.size && inbuf.pos < inbuf.size)
+            return -1;
+    }
+
+    return (int)outbuf.pos;
+}
+
+static COMP_METHOD zstd_stateful_method = {
+    NID_zstd,
+    LN_zstd,
+    zstd_stateful_init,
+    zstd_stateful_finish,
+    zstd_stateful_compress_block,
+    zstd_stateful_expand_block
+};
+
+/* Each block is compressed on its own, as a complete zstd frame */
+static int zstd_oneshot_compress_block(COMP_CTX *ctx, unsigned char *out,
+                                       unsigned int olen, unsigned char *in,
+                                       unsigned int ilen)
+{
+    size_t out_size;
+
+    if (ilen == 0)
+        return 0;
+
+    out_size = ZSTD_compress(out, olen, in, ilen, ZSTD_CLEVEL_DEFAULT);
+    if (ZSTD_isError(out_size) || out_size > INT_MAX)
+        return -1;
+
+    return (int)out_size;
+}
+
+static int zstd_oneshot_expand_block(COMP_CTX *ctx, unsigned char *out,
+                                     unsigned int olen, unsigned char *in,
+                                     unsigned int ilen)
+{
+    size_t out_size;
+
+    if (ilen == 0)
+        return 0;
+
+    out_size = ZSTD_decompress(out, olen, in, ilen);
+    if (ZSTD_isError(out_size) || out_size > INT_MAX)
+        return -1;
+
+    return (int)out_size;
+}
+
+static COMP_METHOD zstd_oneshot_method = {
+    NID_zstd,
+    LN_zstd,
+    NULL,
+    NULL,
+    zstd_oneshot_compress_block,
+    zstd_oneshot_expand_block
+};
+
+static CRYPTO_ONCE zstd_once = CRYPTO_ONCE_STATIC_INIT;
+DEFINE_RUN_ONCE_STATIC(ossl_comp_zstd_init)
+{
+# ifdef ZSTD_SHARED
+    /* LIBZSTD may be externally defined, and we should respect that value */
+#  ifndef LIBZSTD
+#   if defined(OPENSSL_SYS_WINDOWS) || defined(OPENSSL_SYS_WIN32)
+#    define LIBZSTD "LIBZSTD"
+#   else
+#    define LIBZSTD "zstd"
+#   endif
+#  endif
+
+    zstd_dso = DSO_load(NULL, LIBZSTD, NULL, 0);
+    if (zstd_dso != NULL) {
+        p_createCCtx = (createCCtx_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_createCCtx");
+        p_freeCCtx = (freeCCtx_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_freeCCtx");
+        p_createDCtx = (createDCtx_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_createDCtx");
+        p_freeDCtx = (freeDCtx_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_freeDCtx");
+        p_CCtx_setParameter = (CCtx_setParameter_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_CCtx_setParameter");
+        p_CCtx_loadDictionary = (CCtx_loadDictionary_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_CCtx_loadDictionary");
+        p_DCtx_loadDictionary = (DCtx_loadDictionary_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_DCtx_loadDictionary");
+        p_compressStream2 = (compressStream2_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_compressStream2");
+        p_decompressStream = (decompressStream_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_decompressStream");
+        p_compress = (compress_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_compress");
+        p_decompress = (decompress_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_decompress");
+        p_isError = (isError_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_isError");
+        p_getErrorName = (getErrorName_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_getErrorName");
+        p_CStreamOutSize = (CStreamOutSize_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_CStreamOutSize");
+        p_DStreamInSize = (DStreamInSize_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_DStreamInSize");
+        p_minCLevel = (minCLevel_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_minCLevel");
+        p_maxCLevel = (maxCLevel_ft)
+            DSO_bind_func(zstd_dso, "ZSTD_maxCLevel");
+    }
+
+    if (p_createCCtx == NULL || p_freeCCtx == NULL
+            || p_createDCtx == NULL || p_freeDCtx == NULL
+            || p_CCtx_setParameter == NULL || p_CCtx_loadDictionary == NULL
+            || p_DCtx_loadDictionary == NULL || p_compressStream2 == NULL
+            || p_decompressStream == NULL || p_compress == NULL
+            || p_decompress == NULL || p_isError == NULL
+            || p_getErrorName == NULL || p_CStreamOutSize == NULL
+            || p_DStreamInSize == NULL || p_minCLevel == NULL
+            || p_maxCLevel == NULL) {
+        ossl_comp_zstd_cleanup();
+        return 0;
+    }
+# endif
+    return 1;
+}
+
+/*
+ * The stateful method compresses a sequence of blocks as one stream, like
+ * the zlib method, and the one-shot method each block as a frame of its
+ * own, as needed for TLS certificate compression (RFC 8879).
+ */
+COMP_METHOD *COMP_zstd(void)
+{
+    COMP_METHOD *meth = &zstd_method_nozstd;
+
+    if (RUN_ONCE(&zstd_once, ossl_comp_zstd_init))
+        meth = &zstd_stateful_method;
+
+    return meth;
+}
+
+COMP_METHOD *COMP_zstd_oneshot(void)
+{
+    COMP_METHOD *meth = &zstd_method_nozstd;
+
+    if (RUN_ONCE(&zstd_once, ossl_comp_zstd_init))
+        meth = &zstd_oneshot_method;
+
+    return meth;
+}
+#endif
+
+/* Also called from OPENSSL_cleanup() */
+void ossl_comp_zstd_cleanup(void)
+{
+#ifdef ZSTD_SHARED
+    DSO_free(zstd_dso);
+    zstd_dso = NULL;
+    p_createCCtx = NULL;
+    p_freeCCtx = NULL;
+    p_createDCtx = NULL;
+    p_freeDCtx = NULL;
+    p_CCtx_setParameter = NULL;
+    p_CCtx_loadDictionary = NULL;
+    p_DCtx_loadDictionary = NULL;
+    p_compressStream2 = NULL;
+    p_decompressStream = NULL;
+    p_compress = NULL;
+    p_decompress = NULL;
+    p_isError = NULL;
+    p_getErrorName = NULL;
+    p_CStreamOutSize = NULL;
+    p_DStreamInSize = NULL;
+    p_minCLevel = NULL;
+    p_maxCLevel = NULL;
+#endif
+}
+
+#ifndef OPENSSL_NO_ZSTD
+
+/* Zstd based compression/decompression filter BIO */
+
+typedef struct {
+    struct { /* input structure */
+        ZSTD_DCtx *state;
+        unsigned char *buf;     /* Input buffer */
+        size_t bufsize;         /* Buffer size */
+        ZSTD_inBuffer inbuf;    /* Unconsumed part of the input buffer */
+    } decompress;
+    struct { /* output structure */
+        ZSTD_CCtx *state;
+        unsigned char *buf;     /* Output buffer */
+        size_t bufsize;         /* Output buffer size */
+        unsigned char *ptr;     /* Position in output buffer */
+        size_t count;           /* Amount of data in output buffer */
+        int done;               /* Frame finished */
+        int level;              /* Compression level to use */
+    } compress;
+    unsigned char *dict;        /* Dictionary for both directions */
+    size_t dictlen;
+} BIO_ZSTD_CTX;
+
+static int bio_zstd_new(BIO *bi);
+static int bio_zstd_free(BIO *bi);
+static int bio_zstd_read(BIO *b, char *out, int outl);
+static int bio_zstd_write(BIO *b, const char *in, int inl);
+static long bio_zstd_ctrl(BIO *b, int cmd, long num, void *ptr);
+static long bio_zstd_callback_ctrl(BIO *b, int cmd, BIO_info_cb *fp);
+
+static const BIO_METHOD bio_meth_zstd = {
+    BIO_TYPE_COMP,
+    "zstd",
+    bwrite_conv,
+    bio_zstd_write,
+    bread_conv,
+    bio_zstd_read,
+    NULL,                      /* bio_zstd_puts, */
+    NULL,                      /* bio_zstd_gets, */
+    bio_zstd_ctrl,
+    bio_zstd_new,
+    bio_zstd_free,
+    bio_zstd_callback_ctrl
+};
+
+const BIO_METHOD *BIO_f_zstd(void)
+{
+    return &bio_meth_zstd;
+}
+
+static int bio_zstd_new(BIO *bi)
+{
+    BIO_ZSTD_CTX *ctx;
+
+# ifdef ZSTD_SHARED
+    if (!RUN_ONCE(&zstd_once, ossl_comp_zstd_init)) {
+        ERR_raise(ERR_LIB_COMP, COMP_R_ZSTD_NOT_SUPPORTED);
+        return 0;
+    }
+# endif
+    ctx = OPENSSL_zalloc(sizeof(*ctx));
+    if (ctx == NULL) {
+        ERR_raise(ERR_LIB_COMP, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    /* The sizes the zstd library recommends for streaming */
+    ctx->decompress.bufsize = ZSTD_DStreamInSize();
+    ctx->compress.bufsize = ZSTD_CStreamOutSize();
+    ctx->compress.level = ZSTD_CLEVEL_DEFAULT;
+    BIO_set_init(bi, 1);
+    BIO_set_data(bi, ctx);
+
+    return 1;
+}
+
+static int bio_zstd_free(BIO *bi)
+{
+    BIO_ZSTD_CTX *ctx;
+
+    if (bi == NULL)
+        return 0;
+    ctx = BIO_get_data(bi);
+    if (ctx != NULL) {
+        ZSTD_freeDCtx(ctx->decompress.state);
+        OPENSSL_free(ctx->decompress.buf);
+        ZSTD_freeCCtx(ctx->compress.state);
+        OPENSSL_free(ctx->compress.buf);
+        OPENSSL_clear_free(ctx->dict, ctx->dictlen);
+        OPENSSL_free(ctx);
+    }
+    BIO_set_data(bi, NULL);
+    BIO_set_init(bi, 0);
+
+    return 1;
+}
+
+static int bio_zstd_read(BIO *b, char *out, int outl)
+{
+    BIO_ZSTD_CTX *ctx;
+    size_t zret;
+    int ret;
+    ZSTD_outBuffer outbuf;
+    BIO *next = BIO_next(b);
+
+    if (out == NULL || outl <= 0)
+        return 0;
+    ctx = BIO_get_data(b);
+    BIO_clear_retry_flags(b);
+    if (ctx->decompress.state == NULL) {
+        ctx->decompress.buf = OPENSSL_malloc(ctx->decompress.bufsize);
+        if (ctx->decompress.buf == NULL) {
+            ERR_raise(ERR_LIB_COMP, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+        ctx->decompress.state = ZSTD_createDCtx();
+        if (ctx->decompress.state != NULL && ctx->dict != NULL)
+            zret = ZSTD_DCtx_loadDictionary(ctx->decompress.state, ctx->dict,
+                                            ctx->dictlen);
+        else
+            zret = 0;
+        if (ctx->decompress.state == NULL || ZSTD_isError(zret)) {
+            ZSTD_freeDCtx(ctx->decompress.state);
+            ctx->decompress.state = NULL;
+            OPENSSL_free(ctx->decompress.buf);
+            ctx->decompress.buf = NULL;
+            ERR_raise(ERR_LIB_COMP, COMP_R_ZSTD_DECOMPRESS_ERROR);
+            return 0;
+        }
+        ctx->decompress.inbuf.src = ctx->decompress.buf;
+        ctx->decompress.inbuf.size = 0;
+        ctx->decompress.inbuf.pos = 0;
+    }
+
+    /* Copy output data directly to supplied buffer */
+    outbuf.dst = out;
+    outbuf.size = (size_t)outl;
+    outbuf.pos = 0;
+    for (;;) {
+        /*
+         * Decompress what's available, which also drains what the library
+         * still holds from the previous call when there's no input left
+         */
+        zret = ZSTD_decompressStream(ctx->decompress.state, &outbuf,
+                                     &ctx->decompress.inbuf);
+        if (ZSTD_isError(zret)) {
+            ERR_raise_data(ERR_LIB_COMP, COMP_R_ZSTD_DECOMPRESS_ERROR,
+                           "zstd error: %s", ZSTD_getErrorName(zret));
+            return 0;
+        }
+        /* If we've read anything then return */
+        if (outbuf.pos > 0)
+            return (int)outbuf.pos;
+        if (ctx->decompress.inbuf.pos < ctx->decompress.inbuf.size)
+            continue;
+
+        /*
+         * No data in input buffer try to read some in, if an error then
+         * return it.
+         */
+        ret = BIO_read(next, ctx->decompress.buf,
+                       (int)ctx->decompress.bufsize);
+        if (ret <= 0) {
+            BIO_copy_next_retry(b);
+            return ret;
+        }
+        ctx->decompress.inbuf.size = ret;
+        ctx->decompress.inbuf.pos = 0;
+    }
+}
+
+static int bio_zstd_write(BIO *b, const char *in, int inl)
+{
+    BIO_ZSTD_CTX *ctx;
+    size_t zret;
+    int ret;
+    ZSTD_inBuffer inbuf;
+    ZSTD_outBuffer outbuf;
+    BIO *next = BIO_next(b);
+
+    if (in == NULL || inl <= 0)
+        return 0;
+    ctx = BIO_get_data(b);
+    if (ctx->compress.done)
+        return 0;
+    BIO_clear_retry_flags(b);
+    if (ctx->compress.state == NULL) {
+        ctx->compress.buf = OPENSSL_malloc(ctx->compress.bufsize);
+        if (ctx->compress.buf == NULL) {
+            ERR_raise(ERR_LIB_COMP, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+        ctx->compress.state = ZSTD_createCCtx();
+        if (ctx->compress.state != NULL)
+            zret = ZSTD_CCtx_setParameter(ctx->compress.state,
+                                          ZSTD_c_compressionLevel,
+                                          ctx->compress.level);
+        else
+            zret = 0;
+        if (ctx->compress.state != NULL && !ZSTD_isError(zret)
+                && ctx->dict != NULL)
+            zret = ZSTD_CCtx_loadDictionary(ctx->compress.state, ctx->dict,
+                                            ctx->dictlen);
+        if (ctx->compress.state == NULL || ZSTD_isError(zret)) {
+            ZSTD_freeCCtx(ctx->compress.state);
+            ctx->compress.state = NULL;
+            OPENSSL_free(ctx->compress.buf);
+            ctx->compress.buf = NULL;
+            ERR_raise(ERR_LIB_COMP, COMP_R_ZSTD_COMPRESS_ERROR);
+            return 0;
+        }
+        ctx->compress.ptr = ctx->compress.buf;
+        ctx->compress.count = 0;
+    }
+    /* Obtain input data directly from supplied buffer */
+    inbuf.src = in;
+    inbuf.size = inl;
+    inbuf.pos = 0;
+    for (;;) {
+        /* If data in output buffer write it first */
+        while (ctx->compress.count > 0) {
+            ret = BIO_write(next, ctx->compress.ptr, (int)ctx->compress.count);
+            if (ret <= 0) {
+                /* Total data written */
+                int tot = (int)inbuf.pos;
+
+                BIO_copy_next_retry(b);
+                if (ret < 0)
+                    return (tot > 0) ? tot : ret;
+                return tot;
+            }
+            ctx->compress.ptr += ret;
+            ctx->compress.count -= ret;
+        }
+
+        /* Have we consumed all supplied data? */
+        if (inbuf.pos == inbuf.size)
+            return inl;
+
+        /* Compress some more */
+
+        /* Reset buffer */
+        ctx->compress.ptr = ctx->compress.buf;
+        outbuf.dst = ctx->compress.buf;
+        outbuf.size = ctx->compress.bufsize;
+        outbuf.pos = 0;
+        zret = ZSTD_compressStream2(ctx->compress.state, &outbuf, &inbuf,
+                                    ZSTD_e_continue);
+        if (ZSTD_isError(zret)) {
+            ERR_raise_data(ERR_LIB_COMP, COMP_R_ZSTD_COMPRESS_ERROR,
+                           "zstd error: %s", ZSTD_getErrorName(zret));
+            return 0;
+        }
+        ctx->compress.count = outbuf.pos;
+    }
+}
+
+static int bio_zstd_flush(BIO *b)
+{
+    BIO_ZSTD_CTX *ctx;
+    size_t zret;
+    int ret;
+    ZSTD_inBuffer inbuf;
+    ZSTD_outBuffer outbuf;
+    BIO *next = BIO_next(b);
+
+    ctx = BIO_get_data(b);
+    /* If no data written or already flush show success */
+    if (ctx->compress.state == NULL
+            || (ctx->compress.done && ctx->compress.count == 0))
+        return 1;
+    BIO_clear_retry_flags(b);
+    /* No more input data */
+    inbuf.src = NULL;
+    inbuf.size = 0;
+    inbuf.pos = 0;
+    for (;;) {
+        /* If data in output buffer write it first */
+        while (ctx->compress.count > 0) {
+            ret = BIO_write(next, ctx->compress.ptr, (int)ctx->compress.count);
+            if (ret <= 0) {
+                BIO_copy_next_retry(b);
+                return ret;
+            }
+            ctx->compress.ptr += ret;
+            ctx->compress.count -= ret;
+        }
+        if (ctx->compress.done)
+            return 1;
+
+        /* Compress some more */
+
+        /* Reset buffer */
+        ctx->compress.ptr = ctx->compress.buf;
+        outbuf.dst = ctx->compress.buf;
+        outbuf.size = ctx->compress.bufsize;
+        outbuf.pos = 0;
+        zret = ZSTD_compressStream2(ctx->compress.state, &outbuf, &inbuf,
+                                    ZSTD_e_end);
+        if (ZSTD_isError(zret)) {
+            ERR_raise_data(ERR_LIB_COMP, COMP_R_ZSTD_COMPRESS_ERROR,
+                           "zstd error: %s", ZSTD_getErrorName(zret));
+            return 0;
+        }
+        if (zret == 0)
+            ctx->compress.done = 1;
+        ctx->compress.count = outbuf.pos;
+    }
+}
+
+static long bio_zstd_ctrl(BIO *b, int cmd, long num, void *ptr)
+{
+    BIO_ZSTD_CTX *ctx;
+    int ret, *ip;
+    int ibs, obs;
+    unsigned char *dict;
+    BIO *next = BIO_next(b);
+
+    if (next == NULL)
+        return 0;
+    ctx = BIO_get_data(b);
+    switch (cmd) {
+
+    case BIO_CTRL_RESET:
+        ctx->compress.count = 0;
+        ctx->compress.done = 0;
+        ret = 1;
+        break;
+
+    case BIO_CTRL_FLUSH:
+        ret = bio_zstd_flush(b);
+        if (ret > 0)
+            ret = BIO_flush(next);
+        break;
+
+    case BIO_C_SET_BUFF_SIZE:
+        ibs = -1;
+        obs = -1;
+        if (ptr != NULL) {
+            ip = ptr;
+            if (*ip == 0)
+                ibs = (int)num;
+            else
+                obs = (int)num;
+        } else {
+            ibs = (int)num;
+            obs = ibs;
+        }
+
+        /* The buffers can't be changed once they are in use */
+        if ((ibs != -1 && (ibs <= 0 || ctx->decompress.state != NULL))
+                || (obs != -1 && (obs <= 0 || ctx->compress.state != NULL)))
+            return 0;
+        if (ibs != -1)
+            ctx->decompress.bufsize = ibs;
+        if (obs != -1)
+            ctx->compress.bufsize = obs;
+        ret = 1;
+        break;
+
+    case BIO_C_SET_COMP_LEVEL:
+        if (ctx->compress.state != NULL
+                || num < ZSTD_minCLevel() || num > ZSTD_maxCLevel())
+            return 0;
+        ctx->compress.level = (int)num;
+        ret = 1;
+        break;
+
+    case BIO_C_SET_COMP_DICTIONARY:
+        /* Both directions use the same dictionary, set before either */
+        if (ctx->compress.state != NULL || ctx->decompress.state != NULL
+                || ptr == NULL || num <= 0)
+            return 0;
+        if ((dict = OPENSSL_memdup(ptr, (size_t)num)) == NULL) {
+            ERR_raise(ERR_LIB_COMP, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+        OPENSSL_clear_free(ctx->dict, ctx->dictlen);
+        ctx->dict = dict;
+        ctx->dictlen = (size_t)num;
+        ret = 1;
+        break;
+
+    case BIO_C_DO_STATE_MACHINE:
+        BIO_clear_retry_flags(b);
+        ret = BIO_ctrl(next, cmd, num, ptr);
+        BIO_copy_next_retry(b);
+        break;
+
+    case BIO_CTRL_WPENDING:
+        if (ctx->compress.state == NULL)
+            return 0;
+
+        if (ctx->compress.done) {
+            ret = (int)ctx->compress.count;
+        } else {
+            ret = (int)ctx->compress.count;
+            if (ret == 0)
+                /* Unknown amount pending but we are not finished */
+                ret = 1;
+        }
+        if (ret == 0)
+            ret = BIO_ctrl(next, cmd, num, ptr);
+        break;
+
+    case BIO_CTRL_PENDING:
+        ret = (int)(ctx->decompress.inbuf.size - ctx->decompress.inbuf.pos);
+        if (ret == 0)
+            ret = BIO_ctrl(next, cmd, num, ptr);
+        break;
+
+    default:
+        ret = BIO_ctrl(next, cmd, num, ptr);
+        break;
+
+    }
+
+    return ret;
+}
+
+static long bio_zstd_callback_ctrl(BIO *b, int cmd, BIO_info_cb *fp)
+{
+    BIO *next = BIO_next(b);
+
+    if (next == NULL)
+        return 0;
+    return BIO_callback_ctrl(next, cmd, fp);
+}
+
+#endif
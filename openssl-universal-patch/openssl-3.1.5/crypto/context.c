@@ -14,6 +14,7 @@
 #include "internal/core.h"
 #include "internal/bio.h"
 #include "internal/provider.h"
+#include "internal/thread.h"
 #include "crypto/context.h"
 
 struct ossl_lib_ctx_st {
@@ -36,6 +37,8 @@ struct ossl_lib_ctx_st {
     OSSL_METHOD_STORE *encoder_store;
     OSSL_METHOD_STORE *store_loader_store;
     void *self_test_cb;
+    void *threads;
+    void *decoder_cache;
 #endif
     void *rand_crngt;
 #ifdef FIPS_MODULE
@@ -112,6 +115,11 @@ static int context_init(OSSL_LIB_CTX *ctx)
     if (ctx->decoder_store == NULL)
         goto err;
 
+    /* P2. Freed first, it holds references to decoders and keymgmts */
+    ctx->decoder_cache = ossl_decoder_cache_new(ctx);
+    if (ctx->decoder_cache == NULL)
+        goto err;
+
     /* P2. We want encoder_store to be cleaned up before the provider store */
     ctx->encoder_store = ossl_method_store_new(ctx);
     if (ctx->encoder_store == NULL)
@@ -176,6 +184,10 @@ static int context_init(OSSL_LIB_CTX *ctx)
     ctx->child_provider = ossl_child_prov_ctx_new(ctx);
     if (ctx->child_provider == NULL)
         goto err;
+
+    ctx->threads = ossl_threads_ctx_new(ctx);
+    if (ctx->threads == NULL)
+        goto err;
 #endif
 
     /* Everything depends on properties, so we also pre-initialise that */
@@ -198,6 +210,20 @@ static int context_init(OSSL_LIB_CTX *ctx)
 
 static void context_deinit_objs(OSSL_LIB_CTX *ctx)
 {
+#ifndef FIPS_MODULE
+    /* Join the worker threads first, their tasks may use anything below */
+    if (ctx->threads != NULL) {
+        ossl_threads_ctx_free(ctx->threads);
+        ctx->threads = NULL;
+    }
+
+    /* The cached decoder chains hold methods from several stores */
+    if (ctx->decoder_cache != NULL) {
+        ossl_decoder_cache_free(ctx->decoder_cache);
+        ctx->decoder_cache = NULL;
+    }
+#endif
+
     /* P2. We want evp_method_store to be cleaned up before the provider store */
     if (ctx->evp_method_store != NULL) {
         ossl_method_store_free(ctx->evp_method_store);
@@ -539,6 +565,10 @@ void *ossl_lib_ctx_get_data(OSSL_LIB_CTX *ctx, int index)
         return ctx->provider_conf;
     case OSSL_LIB_CTX_BIO_CORE_INDEX:
         return ctx->bio_core;
+    case OSSL_LIB_CTX_THREAD_INDEX:
+        return ctx->threads;
+    case OSSL_LIB_CTX_DECODER_CACHE_INDEX:
+        return ctx->decoder_cache;
     case OSSL_LIB_CTX_CHILD_PROVIDER_INDEX:
         return ctx->child_provider;
     case OSSL_LIB_CTX_DECODER_STORE_INDEX:
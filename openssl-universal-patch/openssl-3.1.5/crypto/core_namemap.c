@@ -8,8 +8,8 @@
  */
 
 #include "internal/namemap.h"
-#include <openssl/lhash.h>
 #include "crypto/lhash.h"      /* ossl_lh_strcasehash */
+#include "crypto/hashtable.h"
 #include "internal/tsan_assist.h"
 #include "internal/sizes.h"
 #include "crypto/context.h"
@@ -23,7 +23,15 @@ typedef struct {
     int number;
 } NAMENUM_ENTRY;
 
-DEFINE_LHASH_OF_EX(NAMENUM_ENTRY);
+DEFINE_HASHTABLE_OF(NAMENUM_ENTRY);
+
+/*
+ * All the names for one number, in the order they were added.  The strings
+ * are owned by the NAMENUM_ENTRY items.
+ */
+typedef STACK_OF(OPENSSL_CSTRING) NAMES;
+
+DEFINE_STACK_OF(NAMES)
 
 /*-
  * The namemap itself
@@ -35,12 +43,13 @@ struct ossl_namemap_st {
     unsigned int stored:1; /* If 1, it's stored in a library context */
 
     CRYPTO_RWLOCK *lock;
-    LHASH_OF(NAMENUM_ENTRY) *namenum;  /* Name->number mapping */
+    HASHTABLE_OF(NAMENUM_ENTRY) *namenum; /* Name->number mapping */
+    STACK_OF(NAMES) *numnames;         /* Number->names mapping */
 
     TSAN_QUALIFIER int max_number;     /* Current max number */
 };
 
-/* LHASH callbacks */
+/* Hash table callbacks */
 
 static unsigned long namenum_hash(const NAMENUM_ENTRY *n)
 {
@@ -59,6 +68,11 @@ static void namenum_free(NAMENUM_ENTRY *n)
     OPENSSL_free(n);
 }
 
+static void names_free(NAMES *n)
+{
+    sk_OPENSSL_CSTRING_free(n);
+}
+
 /* OSSL_LIB_CTX_METHOD functions for a namemap stored in a library context */
 
 void *ossl_stored_namemap_new(OSSL_LIB_CTX *libctx)
@@ -107,20 +121,6 @@ int ossl_namemap_empty(OSSL_NAMEMAP *namemap)
 #endif
 }
 
-typedef struct doall_names_data_st {
-    int number;
-    const char **names;
-    int found;
-} DOALL_NAMES_DATA;
-
-static void do_name(const NAMENUM_ENTRY *namenum, DOALL_NAMES_DATA *data)
-{
-    if (namenum->number == data->number)
-        data->names[data->found++] = namenum->name;
-}
-
-IMPLEMENT_LHASH_DOALL_ARG_CONST(NAMENUM_ENTRY, DOALL_NAMES_DATA);
-
 /*
  * Call the callback for all names in the namemap with the given number.
  * A return value 1 means that the callback was called for all names. A
@@ -130,12 +130,9 @@ int ossl_namemap_doall_names(const OSSL_NAMEMAP *namemap, int number,
                              void (*fn)(const char *name, void *data),
                              void *data)
 {
-    DOALL_NAMES_DATA cbdata;
-    size_t num_names;
-    int i;
-
-    cbdata.number = number;
-    cbdata.found = 0;
+    NAMES *names;
+    const char **copy;
+    int i, num_names;
 
     if (namemap == NULL)
         return 0;
@@ -148,24 +145,25 @@ int ossl_namemap_doall_names(const OSSL_NAMEMAP *namemap, int number,
     if (!CRYPTO_THREAD_read_lock(namemap->lock))
         return 0;
 
-    num_names = lh_NAMENUM_ENTRY_num_items(namemap->namenum);
-    if (num_names == 0) {
+    names = sk_NAMES_value(namemap->numnames, number - 1);
+    num_names = sk_OPENSSL_CSTRING_num(names);
+    if (num_names <= 0) {
         CRYPTO_THREAD_unlock(namemap->lock);
         return 0;
     }
-    cbdata.names = OPENSSL_malloc(sizeof(*cbdata.names) * num_names);
-    if (cbdata.names == NULL) {
+    copy = OPENSSL_malloc(sizeof(*copy) * num_names);
+    if (copy == NULL) {
         CRYPTO_THREAD_unlock(namemap->lock);
         return 0;
     }
-    lh_NAMENUM_ENTRY_doall_DOALL_NAMES_DATA(namemap->namenum, do_name,
-                                            &cbdata);
+    for (i = 0; i < num_names; i++)
+        copy[i] = sk_OPENSSL_CSTRING_value(names, i);
     CRYPTO_THREAD_unlock(namemap->lock);
 
-    for (i = 0; i < cbdata.found; i++)
-        fn(cbdata.names[i], data);
+    for (i = 0; i < num_names; i++)
+        fn(copy[i], data);
 
-    OPENSSL_free(cbdata.names);
+    OPENSSL_free(copy);
     return 1;
 }
 
@@ -178,7 +176,7 @@ static int namemap_name2num(const OSSL_NAMEMAP *namemap,
     namenum_tmpl.name = (char *)name;
     namenum_tmpl.number = 0;
     namenum_entry =
-        lh_NAMENUM_ENTRY_retrieve(namemap->namenum, &namenum_tmpl);
+        ossl_ht_NAMENUM_ENTRY_retrieve(namemap->namenum, &namenum_tmpl);
     return namenum_entry != NULL ? namenum_entry->number : 0;
 }
 
@@ -205,10 +203,20 @@ int ossl_namemap_name2num(const OSSL_NAMEMAP *namemap, const char *name)
 int ossl_namemap_name2num_n(const OSSL_NAMEMAP *namemap,
                             const char *name, size_t name_len)
 {
-    char *tmp;
+    char buf[OSSL_MAX_NAME_SIZE], *tmp;
     int ret;
 
-    if (name == NULL || (tmp = OPENSSL_strndup(name, name_len)) == NULL)
+    if (name == NULL)
+        return 0;
+
+    /* Most names are short, avoid the allocation for those */
+    if (name_len < sizeof(buf)) {
+        memcpy(buf, name, name_len);
+        buf[name_len] = '\0';
+        return ossl_namemap_name2num(namemap, buf);
+    }
+
+    if ((tmp = OPENSSL_strndup(name, name_len)) == NULL)
         return 0;
 
     ret = ossl_namemap_name2num(namemap, tmp);
@@ -216,31 +224,24 @@ int ossl_namemap_name2num_n(const OSSL_NAMEMAP *namemap,
     return ret;
 }
 
-struct num2name_data_st {
-    size_t idx;                  /* Countdown */
-    const char *name;            /* Result */
-};
-
-static void do_num2name(const char *name, void *vdata)
-{
-    struct num2name_data_st *data = vdata;
-
-    if (data->idx > 0)
-        data->idx--;
-    else if (data->name == NULL)
-        data->name = name;
-}
-
 const char *ossl_namemap_num2name(const OSSL_NAMEMAP *namemap, int number,
                                   size_t idx)
 {
-    struct num2name_data_st data;
+    NAMES *names;
+    const char *ret = NULL;
 
-    data.idx = idx;
-    data.name = NULL;
-    if (!ossl_namemap_doall_names(namemap, number, do_num2name, &data))
+    if (namemap == NULL || number <= 0)
         return NULL;
-    return data.name;
+
+    if (!CRYPTO_THREAD_read_lock(namemap->lock))
+        return NULL;
+
+    names = sk_NAMES_value(namemap->numnames, number - 1);
+    if (names != NULL && idx < (size_t)sk_OPENSSL_CSTRING_num(names))
+        ret = sk_OPENSSL_CSTRING_value(names, (int)idx);
+
+    CRYPTO_THREAD_unlock(namemap->lock);
+    return ret;
 }
 
 /* This function is not thread safe, the namemap must be locked */
@@ -248,25 +249,43 @@ static int namemap_add_name(OSSL_NAMEMAP *namemap, int number,
                             const char *name)
 {
     NAMENUM_ENTRY *namenum = NULL;
+    NAMES *names = NULL;
     int tmp_number;
 
     /* If it already exists, we don't add it */
     if ((tmp_number = namemap_name2num(namemap, name)) != 0)
         return tmp_number;
 
+    if (number == 0) {
+        /* A new number, its names go on the next slot of numnames */
+        if ((names = sk_OPENSSL_CSTRING_new_null()) == NULL)
+            return 0;
+        if (!sk_NAMES_push(namemap->numnames, names)) {
+            sk_OPENSSL_CSTRING_free(names);
+            return 0;
+        }
+        /* The tsan_counter use here is safe since we're under lock */
+        number = 1 + tsan_counter(&namemap->max_number);
+    } else if ((names = sk_NAMES_value(namemap->numnames, number - 1))
+               == NULL) {
+        return 0;
+    }
+
     if ((namenum = OPENSSL_zalloc(sizeof(*namenum))) == NULL)
         return 0;
 
     if ((namenum->name = OPENSSL_strdup(name)) == NULL)
         goto err;
 
-    /* The tsan_counter use here is safe since we're under lock */
-    namenum->number =
-        number != 0 ? number : 1 + tsan_counter(&namemap->max_number);
-    (void)lh_NAMENUM_ENTRY_insert(namemap->namenum, namenum);
+    namenum->number = number;
+    if (!sk_OPENSSL_CSTRING_push(names, namenum->name))
+        goto err;
+    (void)ossl_ht_NAMENUM_ENTRY_insert(namemap->namenum, namenum);
 
-    if (lh_NAMENUM_ENTRY_error(namemap->namenum))
+    if (ossl_ht_NAMENUM_ENTRY_error(namemap->namenum)) {
+        (void)sk_OPENSSL_CSTRING_pop(names);
         goto err;
+    }
     return namenum->number;
 
  err:
@@ -515,7 +534,8 @@ OSSL_NAMEMAP *ossl_namemap_new(void)
     if ((namemap = OPENSSL_zalloc(sizeof(*namemap))) != NULL
         && (namemap->lock = CRYPTO_THREAD_lock_new()) != NULL
         && (namemap->namenum =
-            lh_NAMENUM_ENTRY_new(namenum_hash, namenum_cmp)) != NULL)
+            ossl_ht_NAMENUM_ENTRY_new(namenum_hash, namenum_cmp)) != NULL
+        && (namemap->numnames = sk_NAMES_new_null()) != NULL)
         return namemap;
 
     ossl_namemap_free(namemap);
@@ -527,8 +547,9 @@ void ossl_namemap_free(OSSL_NAMEMAP *namemap)
     if (namemap == NULL || namemap->stored)
         return;
 
-    lh_NAMENUM_ENTRY_doall(namemap->namenum, namenum_free);
-    lh_NAMENUM_ENTRY_free(namemap->namenum);
+    sk_NAMES_pop_free(namemap->numnames, names_free);
+    ossl_ht_NAMENUM_ENTRY_doall(namemap->namenum, namenum_free);
+    ossl_ht_NAMENUM_ENTRY_free(namemap->namenum);
 
     CRYPTO_THREAD_lock_free(namemap->lock);
     OPENSSL_free(namemap);
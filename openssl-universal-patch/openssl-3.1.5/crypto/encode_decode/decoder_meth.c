@@ -434,6 +434,8 @@ int ossl_decoder_store_cache_flush(OSSL_LIB_CTX *libctx)
 {
     OSSL_METHOD_STORE *store = get_decoder_store(libctx);
 
+    if (!ossl_decoder_cache_flush(libctx))
+        return 0;
     if (store != NULL)
         return ossl_method_store_cache_flush_all(store);
     return 1;
@@ -444,6 +446,9 @@ int ossl_decoder_store_remove_all_provided(const OSSL_PROVIDER *prov)
     OSSL_LIB_CTX *libctx = ossl_provider_libctx(prov);
     OSSL_METHOD_STORE *store = get_decoder_store(libctx);
 
+    /* The cached chains may hold decoders and keymgmts from |prov| */
+    if (!ossl_decoder_cache_flush(libctx))
+        return 0;
     if (store != NULL)
         return ossl_method_store_remove_all_provided(store, prov);
     return 1;
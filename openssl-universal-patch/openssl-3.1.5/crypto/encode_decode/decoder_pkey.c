@@ -15,9 +15,12 @@
 #include <openssl/decoder.h>
 #include <openssl/safestack.h>
 #include <openssl/trace.h>
+#include <openssl/lhash.h>
 #include "crypto/evp.h"
 #include "crypto/decoder.h"
 #include "crypto/evp/evp_local.h"
+#include "crypto/lhash.h"
+#include "crypto/context.h"
 #include "encoder_local.h"
 #include "internal/namemap.h"
 
@@ -475,6 +478,306 @@ int ossl_decoder_ctx_setup_for_pkey(OSSL_DECODER_CTX *ctx,
     return ok;
 }
 
+/* Copies |src| for a new caller, with the result going to |pkey| */
+static struct decoder_pkey_data_st *
+decoder_pkey_data_dup(const struct decoder_pkey_data_st *src, EVP_PKEY **pkey)
+{
+    struct decoder_pkey_data_st *dest;
+    EVP_KEYMGMT *keymgmt;
+    int i;
+
+    if ((dest = OPENSSL_zalloc(sizeof(*dest))) == NULL)
+        return NULL;
+
+    dest->libctx = src->libctx;
+    dest->selection = src->selection;
+    dest->object = (void **)pkey;
+    if ((src->propq != NULL
+         && (dest->propq = OPENSSL_strdup(src->propq)) == NULL)
+        || (dest->keymgmts
+            = sk_EVP_KEYMGMT_new_reserve(NULL,
+                  sk_EVP_KEYMGMT_num(src->keymgmts))) == NULL)
+        goto err;
+
+    for (i = 0; i < sk_EVP_KEYMGMT_num(src->keymgmts); i++) {
+        keymgmt = sk_EVP_KEYMGMT_value(src->keymgmts, i);
+        if (!EVP_KEYMGMT_up_ref(keymgmt))
+            goto err;
+        /* Cannot fail, the space was reserved */
+        (void)sk_EVP_KEYMGMT_push(dest->keymgmts, keymgmt);
+    }
+    return dest;
+ err:
+    decoder_clean_pkey_construct_arg(dest);
+    return NULL;
+}
+
+/*
+ * Makes a ready to use copy of a cached decoder chain |src|.  Each decoder
+ * instance gets its own decoder context, everything else is shared with the
+ * cached chain by reference.  The input type and structure are those of the
+ * caller, which are equal to the cached ones but live as long as |*pkey| is
+ * being decoded.
+ */
+static OSSL_DECODER_CTX *
+decoder_ctx_for_pkey_dup(const OSSL_DECODER_CTX *src, EVP_PKEY **pkey,
+                         const char *input_type, const char *input_structure)
+{
+    OSSL_DECODER_CTX *dest;
+    int i;
+
+    if ((dest = OSSL_DECODER_CTX_new()) == NULL)
+        return NULL;
+
+    dest->start_input_type = input_type;
+    dest->input_structure = input_structure;
+    dest->selection = src->selection;
+
+    if (src->decoder_insts != NULL) {
+        dest->decoder_insts
+            = sk_OSSL_DECODER_INSTANCE_new_reserve(NULL,
+                  sk_OSSL_DECODER_INSTANCE_num(src->decoder_insts));
+        if (dest->decoder_insts == NULL) {
+            ERR_raise(ERR_LIB_OSSL_DECODER, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+        for (i = 0; i < sk_OSSL_DECODER_INSTANCE_num(src->decoder_insts); i++) {
+            OSSL_DECODER_INSTANCE *di
+                = sk_OSSL_DECODER_INSTANCE_value(src->decoder_insts, i);
+
+            if ((di = ossl_decoder_instance_dup(di)) == NULL)
+                goto err;
+            /* Cannot fail, the space was reserved */
+            (void)sk_OSSL_DECODER_INSTANCE_push(dest->decoder_insts, di);
+        }
+    }
+
+    if (src->construct_data != NULL) {
+        dest->construct_data = decoder_pkey_data_dup(src->construct_data, pkey);
+        if (dest->construct_data == NULL) {
+            ERR_raise(ERR_LIB_OSSL_DECODER, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+        dest->construct = src->construct;
+        dest->cleanup = src->cleanup;
+    }
+
+    return dest;
+ err:
+    OSSL_DECODER_CTX_free(dest);
+    return NULL;
+}
+
+/*
+ * Cache of decoder chains built by OSSL_DECODER_CTX_new_for_pkey().
+ *
+ * Building a chain means walking every keymgmt and decoder of every provider,
+ * which is far more expensive than decoding a typical key, and the result
+ * only depends on the arguments below and on the set of loaded providers.
+ * The chains are therefore kept per library context and copied for each
+ * caller.  The cache is emptied whenever the providers change.
+ */
+
+typedef struct {
+    char *input_type;
+    char *input_structure;
+    char *keytype;
+    int selection;
+    char *propquery;
+    OSSL_DECODER_CTX *template;
+} DECODER_CACHE_ENTRY;
+
+DEFINE_LHASH_OF_EX(DECODER_CACHE_ENTRY);
+
+typedef struct {
+    CRYPTO_RWLOCK *lock;
+    LHASH_OF(DECODER_CACHE_ENTRY) *hashtable;
+} DECODER_CACHE;
+
+/*
+ * Bounds the memory used by the cache, should the key type names come from
+ * somewhere unusual.  Once reached, the cache is emptied and starts over.
+ */
+#define DECODER_CACHE_MAX_ENTRIES 256
+
+static void decoder_cache_entry_free(DECODER_CACHE_ENTRY *entry)
+{
+    if (entry == NULL)
+        return;
+    OPENSSL_free(entry->input_type);
+    OPENSSL_free(entry->input_structure);
+    OPENSSL_free(entry->keytype);
+    OPENSSL_free(entry->propquery);
+    OSSL_DECODER_CTX_free(entry->template);
+    OPENSSL_free(entry);
+}
+
+static unsigned long decoder_cache_entry_hash(const DECODER_CACHE_ENTRY *cache)
+{
+    unsigned long hash = 17;
+
+    hash = (hash * 23)
+           + (cache->propquery == NULL
+              ? 0 : ossl_lh_strcasehash(cache->propquery));
+    hash = (hash * 23)
+           + (cache->input_structure == NULL
+              ? 0 : ossl_lh_strcasehash(cache->input_structure));
+    hash = (hash * 23)
+           + (cache->input_type == NULL
+              ? 0 : ossl_lh_strcasehash(cache->input_type));
+    hash = (hash * 23)
+           + (cache->keytype == NULL
+              ? 0 : ossl_lh_strcasehash(cache->keytype));
+
+    hash ^= cache->selection;
+
+    return hash;
+}
+
+static int nullstrcmp(const char *a, const char *b, int casecmp)
+{
+    if (a == NULL || b == NULL)
+        return a == NULL ? (b == NULL ? 0 : 1) : -1;
+    return casecmp ? OPENSSL_strcasecmp(a, b) : strcmp(a, b);
+}
+
+static int decoder_cache_entry_cmp(const DECODER_CACHE_ENTRY *a,
+                                   const DECODER_CACHE_ENTRY *b)
+{
+    int cmp;
+
+    if (a->selection != b->selection)
+        return a->selection < b->selection ? -1 : 1;
+
+    cmp = nullstrcmp(a->keytype, b->keytype, 1);
+    if (cmp != 0)
+        return cmp;
+
+    cmp = nullstrcmp(a->input_type, b->input_type, 1);
+    if (cmp != 0)
+        return cmp;
+
+    cmp = nullstrcmp(a->input_structure, b->input_structure, 1);
+    if (cmp != 0)
+        return cmp;
+
+    return nullstrcmp(a->propquery, b->propquery, 0);
+}
+
+void *ossl_decoder_cache_new(OSSL_LIB_CTX *ctx)
+{
+    DECODER_CACHE *cache = OPENSSL_malloc(sizeof(*cache));
+
+    if (cache == NULL)
+        return NULL;
+
+    cache->lock = CRYPTO_THREAD_lock_new();
+    if (cache->lock == NULL) {
+        OPENSSL_free(cache);
+        return NULL;
+    }
+    cache->hashtable = lh_DECODER_CACHE_ENTRY_new(decoder_cache_entry_hash,
+                                                  decoder_cache_entry_cmp);
+    if (cache->hashtable == NULL) {
+        CRYPTO_THREAD_lock_free(cache->lock);
+        OPENSSL_free(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+void ossl_decoder_cache_free(void *vcache)
+{
+    DECODER_CACHE *cache = (DECODER_CACHE *)vcache;
+
+    lh_DECODER_CACHE_ENTRY_doall(cache->hashtable, decoder_cache_entry_free);
+    lh_DECODER_CACHE_ENTRY_free(cache->hashtable);
+    CRYPTO_THREAD_lock_free(cache->lock);
+    OPENSSL_free(cache);
+}
+
+/*
+ * Called whenever a provider gets activated or deactivated: the cached
+ * chains may now be incomplete, or hold decoders from a provider that is
+ * going away.
+ */
+int ossl_decoder_cache_flush(OSSL_LIB_CTX *libctx)
+{
+    DECODER_CACHE *cache
+        = ossl_lib_ctx_get_data(libctx, OSSL_LIB_CTX_DECODER_CACHE_INDEX);
+
+    if (cache == NULL)
+        return 0;
+
+    if (!CRYPTO_THREAD_write_lock(cache->lock))
+        return 0;
+
+    lh_DECODER_CACHE_ENTRY_doall(cache->hashtable, decoder_cache_entry_free);
+    lh_DECODER_CACHE_ENTRY_flush(cache->hashtable);
+
+    CRYPTO_THREAD_unlock(cache->lock);
+    return 1;
+}
+
+/*
+ * Only chains for key types known to the namemap are worth keeping, anything
+ * else is unlikely to be asked for again.
+ */
+static int decoder_cache_keytype_known(OSSL_LIB_CTX *libctx,
+                                       const char *keytype)
+{
+    return keytype == NULL
+        || ossl_namemap_name2num(ossl_namemap_stored(libctx), keytype) != 0;
+}
+
+/* Adds a new template to the cache, unless another thread got there first */
+static void decoder_cache_add(DECODER_CACHE *cache,
+                              const DECODER_CACHE_ENTRY *key,
+                              const OSSL_DECODER_CTX *src)
+{
+    DECODER_CACHE_ENTRY *newcache;
+
+    if ((newcache = OPENSSL_zalloc(sizeof(*newcache))) == NULL)
+        return;
+
+    newcache->selection = key->selection;
+    if ((key->input_type != NULL
+         && (newcache->input_type = OPENSSL_strdup(key->input_type)) == NULL)
+        || (key->input_structure != NULL
+            && (newcache->input_structure
+                = OPENSSL_strdup(key->input_structure)) == NULL)
+        || (key->keytype != NULL
+            && (newcache->keytype = OPENSSL_strdup(key->keytype)) == NULL)
+        || (key->propquery != NULL
+            && (newcache->propquery = OPENSSL_strdup(key->propquery)) == NULL))
+        goto err;
+
+    /* The template refers to the strings owned by the cache entry */
+    newcache->template = decoder_ctx_for_pkey_dup(src, NULL,
+                                                  newcache->input_type,
+                                                  newcache->input_structure);
+    if (newcache->template == NULL)
+        goto err;
+
+    if (!CRYPTO_THREAD_write_lock(cache->lock))
+        goto err;
+    if (lh_DECODER_CACHE_ENTRY_retrieve(cache->hashtable, newcache) == NULL) {
+        if (lh_DECODER_CACHE_ENTRY_num_items(cache->hashtable)
+            >= DECODER_CACHE_MAX_ENTRIES) {
+            lh_DECODER_CACHE_ENTRY_doall(cache->hashtable,
+                                         decoder_cache_entry_free);
+            lh_DECODER_CACHE_ENTRY_flush(cache->hashtable);
+        }
+        (void)lh_DECODER_CACHE_ENTRY_insert(cache->hashtable, newcache);
+        if (lh_DECODER_CACHE_ENTRY_error(cache->hashtable) == 0)
+            newcache = NULL;
+    }
+    CRYPTO_THREAD_unlock(cache->lock);
+ err:
+    decoder_cache_entry_free(newcache);
+}
+
 OSSL_DECODER_CTX *
 OSSL_DECODER_CTX_new_for_pkey(EVP_PKEY **pkey,
                               const char *input_type,
@@ -483,6 +786,40 @@ OSSL_DECODER_CTX_new_for_pkey(EVP_PKEY **pkey,
                               OSSL_LIB_CTX *libctx, const char *propquery)
 {
     OSSL_DECODER_CTX *ctx = NULL;
+    DECODER_CACHE *cache
+        = ossl_lib_ctx_get_data(libctx, OSSL_LIB_CTX_DECODER_CACHE_INDEX);
+    DECODER_CACHE_ENTRY cacheent, *res;
+
+    if (cache == NULL) {
+        ERR_raise(ERR_LIB_OSSL_DECODER, ERR_R_INTERNAL_ERROR);
+        return NULL;
+    }
+
+    /* The key only, the cache entries own copies of these strings */
+    cacheent.input_type = (char *)input_type;
+    cacheent.input_structure = (char *)input_structure;
+    cacheent.keytype = (char *)keytype;
+    cacheent.selection = selection;
+    cacheent.propquery = (char *)propquery;
+
+    if (!CRYPTO_THREAD_read_lock(cache->lock)) {
+        ERR_raise(ERR_LIB_OSSL_DECODER, ERR_R_INTERNAL_ERROR);
+        return NULL;
+    }
+    res = lh_DECODER_CACHE_ENTRY_retrieve(cache->hashtable, &cacheent);
+    if (res != NULL)
+        ctx = decoder_ctx_for_pkey_dup(res->template, pkey,
+                                       input_type, input_structure);
+    CRYPTO_THREAD_unlock(cache->lock);
+
+    if (res != NULL) {
+        OSSL_TRACE_BEGIN(DECODER) {
+            BIO_printf(trc_out,
+                       "(ctx %p) Got %d decoders from the cache\n",
+                       (void *)ctx, OSSL_DECODER_CTX_get_num_decoders(ctx));
+        } OSSL_TRACE_END(DECODER);
+        return ctx;
+    }
 
     if ((ctx = OSSL_DECODER_CTX_new()) == NULL) {
         ERR_raise(ERR_LIB_OSSL_DECODER, ERR_R_MALLOC_FAILURE);
@@ -507,6 +844,13 @@ OSSL_DECODER_CTX_new_for_pkey(EVP_PKEY **pkey,
             BIO_printf(trc_out, "(ctx %p) Got %d decoders\n",
                        (void *)ctx, OSSL_DECODER_CTX_get_num_decoders(ctx));
         } OSSL_TRACE_END(DECODER);
+
+        /* Failing to cache the chain is not an error, it's just slower */
+        if (decoder_cache_keytype_known(libctx, keytype)) {
+            ERR_set_mark();
+            decoder_cache_add(cache, &cacheent, ctx);
+            ERR_pop_to_mark();
+        }
         return ctx;
     }
 
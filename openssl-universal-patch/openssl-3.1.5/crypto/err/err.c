@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -930,6 +930,87 @@ int ERR_clear_last_mark(void)
     return 1;
 }
 
+/*
+ * Move the errors raised since the last ERR_set_mark() into a new ERR_STATE
+ * and pop to that mark.  Returns NULL if there were no such errors.  This is
+ * how errors raised on a worker thread are carried over to another thread.
+ */
+ERR_STATE *ossl_err_state_save_to_mark(void)
+{
+    ERR_STATE *es, *saved;
+    int i;
+
+    es = ossl_err_get_state_int();
+    if (es == NULL)
+        return NULL;
+
+    i = es->top;
+    while (es->bottom != i && es->err_marks[i] == 0)
+        i = i > 0 ? i - 1 : ERR_NUM_ERRORS - 1;
+    if (i == es->top
+            || (saved = OPENSSL_zalloc(sizeof(*saved))) == NULL) {
+        ERR_pop_to_mark();
+        return NULL;
+    }
+
+    do {
+        i = (i + 1) % ERR_NUM_ERRORS;
+        err_get_slot(saved);
+        saved->err_flags[saved->top] = es->err_flags[i];
+        saved->err_buffer[saved->top] = es->err_buffer[i];
+        saved->err_line[saved->top] = es->err_line[i];
+        /* The strings change hands, so that clearing |es| leaves them be */
+        saved->err_file[saved->top] = es->err_file[i];
+        es->err_file[i] = NULL;
+        saved->err_func[saved->top] = es->err_func[i];
+        es->err_func[i] = NULL;
+        saved->err_data[saved->top] = es->err_data[i];
+        saved->err_data_size[saved->top] = es->err_data_size[i];
+        saved->err_data_flags[saved->top] = es->err_data_flags[i];
+        es->err_data[i] = NULL;
+        es->err_data_size[i] = 0;
+        es->err_data_flags[i] = 0;
+    } while (i != es->top);
+
+    ERR_pop_to_mark();
+    return saved;
+}
+
+/* Raise all the errors in |saved| again on the calling thread */
+void ossl_err_state_restore(const ERR_STATE *saved)
+{
+    ERR_STATE *es;
+    char *data;
+    int i, top;
+
+    if (saved == NULL || (es = ossl_err_get_state_int()) == NULL)
+        return;
+
+    for (i = saved->bottom; i != saved->top; ) {
+        i = (i + 1) % ERR_NUM_ERRORS;
+        err_get_slot(es);
+        top = es->top;
+        err_clear(es, top, 0);
+        es->err_flags[top] = saved->err_flags[i];
+        es->err_buffer[top] = saved->err_buffer[i];
+        err_set_debug(es, top, saved->err_file[i], saved->err_line[i],
+                      saved->err_func[i]);
+        data = saved->err_data[i];
+        if ((saved->err_data_flags[i] & ERR_TXT_MALLOCED) != 0
+                && data != NULL
+                && (data = OPENSSL_strdup(data)) == NULL)
+            continue;
+        err_set_data(es, top, data,
+                     data == NULL ? 0 : strlen(data) + 1,
+                     saved->err_data_flags[i]);
+    }
+}
+
+void ossl_err_state_free(ERR_STATE *saved)
+{
+    ERR_STATE_free(saved);
+}
+
 void err_clear_last_constant_time(int clear)
 {
     ERR_STATE *es;
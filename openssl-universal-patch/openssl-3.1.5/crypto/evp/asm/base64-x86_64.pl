@@ -0,0 +1,269 @@
+#! /usr/bin/env perl
+# Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+
+#
+# AVX2 base64 encoding and decoding of whole blocks, standard alphabet
+# only. The encoder turns 24 bytes into 32 characters per iteration,
+# the decoder 32 characters into 24 bytes. Both follow the vectorised
+# approach described by W. Mula and D. Lemire in "Faster Base64
+# Encoding and Decoding using AVX2 Instructions".
+#
+# The decoder stops at the first block that contains anything but the
+# 64 alphabet characters, i.e. padding, white space, line breaks and
+# invalid characters are all left to the caller, which keeps the
+# error semantics of the C code in encode.c intact.
+#
+#	size_t ossl_base64_encode_avx2(unsigned char *out,
+#				       const unsigned char *in,
+#				       size_t blocks);
+#	size_t ossl_base64_decode_avx2(unsigned char *out,
+#				       const unsigned char *in,
+#				       size_t blocks);
+#
+# Both return the number of blocks processed. Neither reads or writes
+# outside of the blocks it processes.
+
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+		=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.19) + ($1>=2.22);
+}
+
+if (!$avx && $win64 && ($flavour =~ /nasm/ || $ENV{ASM} =~ /nasm/) &&
+	    `nasm -v 2>&1` =~ /NASM version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.09) + ($1>=2.10);
+}
+
+if (!$avx && $win64 && ($flavour =~ /masm/ || $ENV{ASM} =~ /ml64/) &&
+	    `ml64 2>&1` =~ /Version ([0-9]+)\./) {
+	$avx = ($1>=10) + ($1>=11);
+}
+
+if (!$avx && `$ENV{CC} -v 2>&1` =~ /((?:clang|LLVM) version|.*based on LLVM) ([0-9]+\.[0-9]+)/) {
+	$avx = ($2>=3.0) + ($2>3.0);
+}
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
+($out,$inp,$blocks)=("%rdi","%rsi","%rdx");
+
+sub bytes { join(',', map { sprintf("0x%02x", $_ & 0xff) } @_) }
+
+if ($avx>1) {{{
+
+$code.=<<___;
+.text
+
+.globl	ossl_base64_encode_avx2
+.type	ossl_base64_encode_avx2,\@function,3
+.align	32
+ossl_base64_encode_avx2:
+.cfi_startproc
+	endbranch
+	xor	%eax,%eax
+	test	$blocks,$blocks
+	jz	.Lenc_ret
+
+	vmovdqa	.Lenc_26(%rip),%ymm4
+	vmovdqa	.Lenc_lut(%rip),%ymm5
+	jmp	.Lenc_loop
+
+.align	32
+.Lenc_loop:
+	# 12 input bytes per 128-bit lane, no over-read
+	vmovq	0($inp),%xmm0
+	vpinsrd	\$2,8($inp),%xmm0,%xmm0
+	vmovq	12($inp),%xmm1
+	vpinsrd	\$2,20($inp),%xmm1,%xmm1
+	vinserti128	\$1,%xmm1,%ymm0,%ymm0
+
+	# split every 3 bytes into 4 6-bit indices
+	vpshufb	.Lenc_shuf(%rip),%ymm0,%ymm0
+	vpand	.Lenc_mask_hi(%rip),%ymm0,%ymm1
+	vpmulhuw	.Lenc_mul_hi(%rip),%ymm1,%ymm1
+	vpand	.Lenc_mask_lo(%rip),%ymm0,%ymm2
+	vpmullw	.Lenc_mul_lo(%rip),%ymm2,%ymm2
+	vpor	%ymm1,%ymm2,%ymm0
+
+	# map indices to ASCII by adding a per-range offset
+	vpsubusb	.Lenc_51(%rip),%ymm0,%ymm1
+	vpcmpgtb	%ymm0,%ymm4,%ymm2
+	vpand	.Lenc_13(%rip),%ymm2,%ymm2
+	vpor	%ymm2,%ymm1,%ymm1
+	vpshufb	%ymm1,%ymm5,%ymm1
+	vpaddb	%ymm1,%ymm0,%ymm0
+
+	vmovdqu	%ymm0,($out)
+	lea	24($inp),$inp
+	lea	32($out),$out
+	inc	%rax
+	cmp	$blocks,%rax
+	jb	.Lenc_loop
+
+	vzeroupper
+.Lenc_ret:
+	ret
+.cfi_endproc
+.size	ossl_base64_encode_avx2,.-ossl_base64_encode_avx2
+
+.globl	ossl_base64_decode_avx2
+.type	ossl_base64_decode_avx2,\@function,3
+.align	32
+ossl_base64_decode_avx2:
+.cfi_startproc
+	endbranch
+	xor	%eax,%eax
+	test	$blocks,$blocks
+	jz	.Ldec_ret
+
+	vmovdqa	.Ldec_nibble(%rip),%ymm4
+	vmovdqa	.Ldec_perm(%rip),%ymm5
+	jmp	.Ldec_loop
+
+.align	32
+.Ldec_loop:
+	vmovdqu	($inp),%ymm0
+	vpsrld	\$4,%ymm0,%ymm1
+	vpand	%ymm4,%ymm1,%ymm1		# high nibbles
+	vpand	%ymm4,%ymm0,%ymm2		# low nibbles
+
+	# classify; any character outside of the alphabet ends the run
+	vmovdqa	.Ldec_lut_lo(%rip),%ymm3
+	vpshufb	%ymm2,%ymm3,%ymm2
+	vmovdqa	.Ldec_lut_hi(%rip),%ymm3
+	vpshufb	%ymm1,%ymm3,%ymm3
+	vptest	%ymm2,%ymm3
+	jnz	.Ldec_done
+
+	# translate to 6-bit values, '/' shares its nibble with '+'
+	vpcmpeqb	.Ldec_slash(%rip),%ymm0,%ymm2
+	vpaddb	%ymm2,%ymm1,%ymm1
+	vmovdqa	.Ldec_lut_roll(%rip),%ymm3
+	vpshufb	%ymm1,%ymm3,%ymm1
+	vpaddb	%ymm1,%ymm0,%ymm0
+
+	# pack 4 6-bit values into 3 bytes
+	vpmaddubsw	.Ldec_merge1(%rip),%ymm0,%ymm0
+	vpmaddwd	.Ldec_merge2(%rip),%ymm0,%ymm0
+	vpshufb	.Ldec_shuf(%rip),%ymm0,%ymm0
+	vpermd	%ymm0,%ymm5,%ymm0
+
+	vmovdqu	%xmm0,($out)
+	vextracti128	\$1,%ymm0,%xmm1
+	vmovq	%xmm1,16($out)
+	lea	32($inp),$inp
+	lea	24($out),$out
+	inc	%rax
+	cmp	$blocks,%rax
+	jb	.Ldec_loop
+
+.Ldec_done:
+	vzeroupper
+.Ldec_ret:
+	ret
+.cfi_endproc
+.size	ossl_base64_decode_avx2,.-ossl_base64_decode_avx2
+
+.align	64
+.Lenc_shuf:
+	.byte	@{[bytes(1,0,2,1,4,3,5,4,7,6,8,7,10,9,11,10)]}
+	.byte	@{[bytes(1,0,2,1,4,3,5,4,7,6,8,7,10,9,11,10)]}
+.Lenc_mask_hi:
+	.long	0x0fc0fc00,0x0fc0fc00,0x0fc0fc00,0x0fc0fc00
+	.long	0x0fc0fc00,0x0fc0fc00,0x0fc0fc00,0x0fc0fc00
+.Lenc_mul_hi:
+	.long	0x04000040,0x04000040,0x04000040,0x04000040
+	.long	0x04000040,0x04000040,0x04000040,0x04000040
+.Lenc_mask_lo:
+	.long	0x003f03f0,0x003f03f0,0x003f03f0,0x003f03f0
+	.long	0x003f03f0,0x003f03f0,0x003f03f0,0x003f03f0
+.Lenc_mul_lo:
+	.long	0x01000010,0x01000010,0x01000010,0x01000010
+	.long	0x01000010,0x01000010,0x01000010,0x01000010
+.Lenc_51:
+	.byte	@{[bytes((51) x 16)]}
+	.byte	@{[bytes((51) x 16)]}
+.Lenc_26:
+	.byte	@{[bytes((26) x 16)]}
+	.byte	@{[bytes((26) x 16)]}
+.Lenc_13:
+	.byte	@{[bytes((13) x 16)]}
+	.byte	@{[bytes((13) x 16)]}
+.Lenc_lut:		# 'a'-26, '0'-52 x 10, '+'-62, '/'-63, 'A', 0, 0
+	.byte	@{[bytes(71,(-4) x 10,-19,-16,65,0,0)]}
+	.byte	@{[bytes(71,(-4) x 10,-19,-16,65,0,0)]}
+.Ldec_nibble:
+	.byte	@{[bytes((0x0f) x 16)]}
+	.byte	@{[bytes((0x0f) x 16)]}
+.Ldec_slash:
+	.byte	@{[bytes((0x2f) x 16)]}
+	.byte	@{[bytes((0x2f) x 16)]}
+.Ldec_lut_lo:
+	.byte	@{[bytes(0x15,(0x11) x 9,0x13,0x1a,0x1b,0x1b,0x1b,0x1a)]}
+	.byte	@{[bytes(0x15,(0x11) x 9,0x13,0x1a,0x1b,0x1b,0x1b,0x1a)]}
+.Ldec_lut_hi:
+	.byte	@{[bytes(0x10,0x10,0x01,0x02,0x04,0x08,0x04,0x08,(0x10) x 8)]}
+	.byte	@{[bytes(0x10,0x10,0x01,0x02,0x04,0x08,0x04,0x08,(0x10) x 8)]}
+.Ldec_lut_roll:
+	.byte	@{[bytes(0,16,19,4,-65,-65,-71,-71,(0) x 8)]}
+	.byte	@{[bytes(0,16,19,4,-65,-65,-71,-71,(0) x 8)]}
+.Ldec_merge1:
+	.long	0x01400140,0x01400140,0x01400140,0x01400140
+	.long	0x01400140,0x01400140,0x01400140,0x01400140
+.Ldec_merge2:
+	.long	0x00011000,0x00011000,0x00011000,0x00011000
+	.long	0x00011000,0x00011000,0x00011000,0x00011000
+.Ldec_shuf:
+	.byte	@{[bytes(2,1,0,6,5,4,10,9,8,14,13,12,(-1) x 4)]}
+	.byte	@{[bytes(2,1,0,6,5,4,10,9,8,14,13,12,(-1) x 4)]}
+.Ldec_perm:
+	.long	0,1,2,4,5,6,3,7
+___
+
+}}} else {{{
+$code=<<___;	# assembler is too old
+.text
+
+.globl	ossl_base64_encode_avx2
+.type	ossl_base64_encode_avx2,\@abi-omnipotent
+ossl_base64_encode_avx2:
+.cfi_startproc
+	xor	%eax,%eax
+	ret
+.cfi_endproc
+.size	ossl_base64_encode_avx2,.-ossl_base64_encode_avx2
+
+.globl	ossl_base64_decode_avx2
+.type	ossl_base64_decode_avx2,\@abi-omnipotent
+ossl_base64_decode_avx2:
+.cfi_startproc
+	xor	%eax,%eax
+	ret
+.cfi_endproc
+.size	ossl_base64_decode_avx2,.-ossl_base64_decode_avx2
+___
+}}}
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+
+print $code;
+
+close STDOUT or die "error closing STDOUT: $!";
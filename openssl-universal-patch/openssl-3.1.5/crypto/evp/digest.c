@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -567,6 +567,22 @@ int EVP_MD_CTX_copy_ex(EVP_MD_CTX *out, const EVP_MD_CTX *in)
             || (in->flags & EVP_MD_CTX_FLAG_NO_INIT) != 0)
         goto legacy;
 
+    /*
+     * If |out| already has a context of the same digest and neither has a
+     * PKEY context, copy the state into it rather than freeing it and
+     * duplicating |in|.  This makes repeated snapshots of a running digest
+     * free of allocations.
+     */
+    if (out->digest == in->digest && out->fetched_digest == in->fetched_digest
+            && in->digest->copyctx != NULL
+            && out->algctx != NULL && in->algctx != NULL
+            && out->pctx == NULL && in->pctx == NULL) {
+        in->digest->copyctx(out->algctx, in->algctx);
+        out->flags = in->flags & ~EVP_MD_CTX_FLAG_KEEP_PKEY_CTX;
+        out->update = in->update;
+        return 1;
+    }
+
     if (in->digest->dupctx == NULL) {
         ERR_raise(ERR_LIB_EVP, EVP_R_NOT_ABLE_TO_COPY_CTX);
         return 0;
@@ -1027,6 +1043,10 @@ static void *evp_md_from_algorithm(int name_id,
             if (md->dupctx == NULL)
                 md->dupctx = OSSL_FUNC_digest_dupctx(fns);
             break;
+        case OSSL_FUNC_DIGEST_COPYCTX:
+            if (md->copyctx == NULL)
+                md->copyctx = OSSL_FUNC_digest_copyctx(fns);
+            break;
         case OSSL_FUNC_DIGEST_GET_PARAMS:
             if (md->get_params == NULL)
                 md->get_params = OSSL_FUNC_digest_get_params(fns);
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2020 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -21,6 +21,21 @@ static int evp_encodeblock_int(EVP_ENCODE_CTX *ctx, unsigned char *t,
 static int evp_decodeblock_int(EVP_ENCODE_CTX *ctx, unsigned char *t,
                                const unsigned char *f, int n);
 
+#if defined(BASE64_ASM) && !defined(CHARSET_EBCDIC) && \
+    (defined(__x86_64) || defined(__x86_64__) || \
+     defined(_M_AMD64) || defined(_M_X64))
+/*
+ * Whole block kernels for the standard alphabet: 24 bytes <-> 32 chars.
+ * Both return the number of blocks processed; the decoder stops at the
+ * first block containing anything but the 64 alphabet characters.
+ */
+# define BASE64_AVX2_CAPABLE     (OPENSSL_ia32cap_P[2] & (1 << 5))
+size_t ossl_base64_encode_avx2(unsigned char *out, const unsigned char *in,
+                               size_t blocks);
+size_t ossl_base64_decode_avx2(unsigned char *out, const unsigned char *in,
+                               size_t blocks);
+#endif
+
 #ifndef CHARSET_EBCDIC
 # define conv_bin2ascii(a, table)       ((table)[(a)&0x3f])
 #else
@@ -240,6 +255,17 @@ static int evp_encodeblock_int(EVP_ENCODE_CTX *ctx, unsigned char *t,
     else
         table = data_bin2ascii;
 
+#ifdef BASE64_AVX2_CAPABLE
+    if (dlen >= 24 && table == data_bin2ascii && BASE64_AVX2_CAPABLE) {
+        size_t blocks = ossl_base64_encode_avx2(t, f, dlen / 24);
+
+        t += blocks * 32;
+        f += blocks * 24;
+        ret += (int)(blocks * 32);
+        dlen -= (int)(blocks * 24);
+    }
+#endif
+
     for (i = dlen; i > 0; i -= 3) {
         if (i >= 3) {
             l = (((unsigned long)f[0]) << 16L) |
@@ -271,6 +297,48 @@ int EVP_EncodeBlock(unsigned char *t, const unsigned char *f, int dlen)
     return evp_encodeblock_int(NULL, t, f, dlen);
 }
 
+#ifndef CHARSET_EBCDIC
+/*
+ * Decode a run of 64 characters into 48 bytes at |out| if, and only if,
+ * every one of them is a base64 alphabet character other than '='. Returns
+ * 1 on success and 0 if the caller must fall back to the character by
+ * character loop, which then also reports any error. Nothing is written to
+ * |out| in the latter case: PEM decodes in place, so |out| may overlap |in|.
+ */
+static int decode_full_line(unsigned char *out, const unsigned char *in,
+                            const unsigned char *table)
+{
+    unsigned char buf[BIN_PER_LINE], *p = buf;
+    int i, a, b, c, d;
+
+# ifdef BASE64_AVX2_CAPABLE
+    if (table == data_ascii2bin && BASE64_AVX2_CAPABLE) {
+        if (ossl_base64_decode_avx2(buf, in, 2) != 2)
+            return 0;
+        memcpy(out, buf, sizeof(buf));
+        return 1;
+    }
+# endif
+    for (i = 0; i < 64; i += 4, in += 4) {
+        if (((in[0] | in[1] | in[2] | in[3]) & 0x80) != 0
+                || in[0] == '=' || in[1] == '='
+                || in[2] == '=' || in[3] == '=')
+            return 0;
+        a = table[in[0]];
+        b = table[in[1]];
+        c = table[in[2]];
+        d = table[in[3]];
+        if (((a | b | c | d) & 0x80) != 0)
+            return 0;
+        *(p++) = (unsigned char)(a << 2 | b >> 4);
+        *(p++) = (unsigned char)(b << 4 | c >> 2);
+        *(p++) = (unsigned char)(c << 6 | d);
+    }
+    memcpy(out, buf, sizeof(buf));
+    return 1;
+}
+#endif
+
 void EVP_DecodeInit(EVP_ENCODE_CTX *ctx)
 {
     /* Only ctx->num and ctx->flags are used during decoding. */
@@ -328,6 +396,21 @@ int EVP_DecodeUpdate(EVP_ENCODE_CTX *ctx, unsigned char *out, int *outl,
         table = data_ascii2bin;
 
     for (i = 0; i < inl; i++) {
+#ifndef CHARSET_EBCDIC
+        /*
+         * Whole lines of plain base64 characters are decoded directly; this
+         * produces exactly what collecting them in |d| first would.
+         */
+        while (n == 0 && eof == 0 && inl - i >= 64
+               && decode_full_line(out, in, table)) {
+            in += 64;
+            i += 64;
+            out += 48;
+            ret += 48;
+        }
+        if (i == inl)
+            break;
+#endif
         tmp = *(in++);
         v = conv_ascii2bin(tmp, table);
         if (v == B64_ERROR) {
@@ -438,6 +521,17 @@ static int evp_decodeblock_int(EVP_ENCODE_CTX *ctx, unsigned char *t,
     if (n % 4 != 0)
         return -1;
 
+#ifdef BASE64_AVX2_CAPABLE
+    if (n >= 32 && table == data_ascii2bin && BASE64_AVX2_CAPABLE) {
+        size_t blocks = ossl_base64_decode_avx2(t, f, n / 32);
+
+        t += blocks * 24;
+        f += blocks * 32;
+        ret += (int)(blocks * 24);
+        n -= (int)(blocks * 32);
+    }
+#endif
+
     for (i = 0; i < n; i += 4) {
         a = conv_ascii2bin(*(f++), table);
         b = conv_ascii2bin(*(f++), table);
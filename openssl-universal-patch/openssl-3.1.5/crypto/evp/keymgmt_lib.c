@@ -26,6 +26,26 @@ static int match_type(const EVP_KEYMGMT *keymgmt1, const EVP_KEYMGMT *keymgmt2)
     return EVP_KEYMGMT_is_a(keymgmt1, name2);
 }
 
+/*
+ * Two keymgmts that are the same implementation running with the same
+ * provider context use the same key representation, so they can use each
+ * other's key objects as they are.  This is the case for the keymgmts of a
+ * child library context and those of its parent, which reach the same
+ * provider instance through different provider objects.
+ */
+static int match_implementation(const EVP_KEYMGMT *keymgmt1,
+                                const EVP_KEYMGMT *keymgmt2)
+{
+    return ossl_provider_ctx(keymgmt1->prov)
+           == ossl_provider_ctx(keymgmt2->prov)
+        && keymgmt1->new == keymgmt2->new
+        && keymgmt1->free == keymgmt2->free
+        && keymgmt1->has == keymgmt2->has
+        && keymgmt1->import == keymgmt2->import
+        && keymgmt1->export == keymgmt2->export
+        && keymgmt1->dup == keymgmt2->dup;
+}
+
 int evp_keymgmt_util_try_import(const OSSL_PARAM params[], void *arg)
 {
     struct evp_keymgmt_util_try_import_data_st *data = arg;
@@ -119,6 +139,14 @@ void *evp_keymgmt_util_export_to_provider(EVP_PKEY *pk, EVP_KEYMGMT *keymgmt,
             && pk->keymgmt->prov == keymgmt->prov))
         return pk->keydata;
 
+    /*
+     * If |keymgmt| is the same implementation as the "origin" one, the key
+     * is shared as it is, there's no need for an exported copy.
+     */
+    if (match_implementation(pk->keymgmt, keymgmt)
+        && match_type(pk->keymgmt, keymgmt))
+        return pk->keydata;
+
     if (!CRYPTO_THREAD_read_lock(pk->lock))
         return NULL;
     /*
@@ -243,10 +271,17 @@ OP_CACHE_ELEM *evp_keymgmt_util_find_operation_cache(EVP_PKEY *pk,
     /*
      * A comparison and sk_P_CACHE_ELEM_find() are avoided to not cause
      * problems when we've only a read lock.
+     *
+     * Like for the "origin", a keymgmt from the same provider with the same
+     * name ID matches as well, so a keymgmt fetched anew after the fetch
+     * cache was flushed finds the exports done for its predecessor.
      */
     for (i = 0; i < end; i++) {
         p = sk_OP_CACHE_ELEM_value(pk->operation_cache, i);
-        if (keymgmt == p->keymgmt && (p->selection & selection) == selection)
+        if ((keymgmt == p->keymgmt
+             || (keymgmt->name_id == p->keymgmt->name_id
+                 && keymgmt->prov == p->keymgmt->prov))
+            && (p->selection & selection) == selection)
             return p;
     }
     return NULL;
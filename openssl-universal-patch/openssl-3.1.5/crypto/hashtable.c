@@ -0,0 +1,228 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <openssl/crypto.h>
+#include "crypto/hashtable.h"
+
+/*
+ * Robin Hood hashing with linear probing.  Each slot holds the item pointer
+ * and its (mixed) hash, so a probe only calls the comparison function when
+ * the full hashes match.  An item's displacement is its distance from the
+ * slot its hash maps to; on insertion an item that is further from home
+ * than the resident of a slot takes that slot and the resident moves on.
+ * This keeps probe sequences short and lets an unsuccessful lookup stop as
+ * soon as it meets an item closer to home than itself.  Deletion shifts the
+ * following displaced items back by one, so no tombstones are needed.
+ *
+ * The table size is always a power of two.  It doubles when the load would
+ * exceed HT_MAX_LOAD_NUM / HT_MAX_LOAD_DEN and halves when it drops below
+ * one eighth.
+ */
+#define HT_MIN_SIZE         16
+#define HT_MAX_LOAD_NUM     3
+#define HT_MAX_LOAD_DEN     4
+
+typedef struct {
+    unsigned long hash;
+    void *data;
+} HT_SLOT;
+
+struct hashtable_st {
+    HT_SLOT *slots;
+    size_t mask;            /* Number of slots - 1, or 0 with no slots */
+    size_t num_items;
+    OPENSSL_HT_HASHFUNC hash;
+    OPENSSL_HT_COMPFUNC comp;
+    int error;
+};
+
+/*
+ * The slot index is taken from the low bits of the hash, so spread the
+ * entropy of caller supplied hashes, which are often weak in those bits.
+ */
+static ossl_inline unsigned long ht_mix(unsigned long h)
+{
+    h ^= (h >> 16) >> 16;
+    h ^= h >> 16;
+    h *= 0x45d9f3bUL;
+    h ^= h >> 16;
+    h *= 0x45d9f3bUL;
+    h ^= h >> 16;
+    return h;
+}
+
+static ossl_inline size_t ht_dist(const OPENSSL_HT *ht, unsigned long h,
+                                  size_t i)
+{
+    return (i - (size_t)h) & ht->mask;
+}
+
+/* Place an item known not to be present, the table must have room */
+static void ht_place(OPENSSL_HT *ht, unsigned long h, void *data)
+{
+    size_t i = (size_t)h & ht->mask, d = 0, sd;
+    HT_SLOT *s, tmp;
+
+    for (;; i = (i + 1) & ht->mask, d++) {
+        s = ht->slots + i;
+        if (s->data == NULL) {
+            s->hash = h;
+            s->data = data;
+            return;
+        }
+        if ((sd = ht_dist(ht, s->hash, i)) < d) {
+            tmp = *s;
+            s->hash = h;
+            s->data = data;
+            h = tmp.hash;
+            data = tmp.data;
+            d = sd;
+        }
+    }
+}
+
+static int ht_resize(OPENSSL_HT *ht, size_t n)
+{
+    HT_SLOT *old = ht->slots;
+    size_t i, oldn = old == NULL ? 0 : ht->mask + 1;
+
+    if ((ht->slots = OPENSSL_zalloc(n * sizeof(*ht->slots))) == NULL) {
+        ht->slots = old;
+        return 0;
+    }
+    ht->mask = n - 1;
+    for (i = 0; i < oldn; i++)
+        if (old[i].data != NULL)
+            ht_place(ht, old[i].hash, old[i].data);
+    OPENSSL_free(old);
+    return 1;
+}
+
+/* Find the slot holding an item equal to |data|, or return -1 */
+static ossl_inline ossl_ssize_t ht_find(const OPENSSL_HT *ht, unsigned long h,
+                                        const void *data)
+{
+    size_t i, d;
+    const HT_SLOT *s;
+
+    if (ht->num_items == 0)
+        return -1;
+    for (i = (size_t)h & ht->mask, d = 0;; i = (i + 1) & ht->mask, d++) {
+        s = ht->slots + i;
+        if (s->data == NULL || ht_dist(ht, s->hash, i) < d)
+            return -1;
+        if (s->hash == h && ht->comp(s->data, data) == 0)
+            return (ossl_ssize_t)i;
+    }
+}
+
+OPENSSL_HT *ossl_ht_new(OPENSSL_HT_HASHFUNC h, OPENSSL_HT_COMPFUNC c)
+{
+    OPENSSL_HT *ht = OPENSSL_zalloc(sizeof(*ht));
+
+    if (ht != NULL) {
+        ht->hash = h;
+        ht->comp = c;
+    }
+    return ht;
+}
+
+void ossl_ht_free(OPENSSL_HT *ht)
+{
+    if (ht == NULL)
+        return;
+    OPENSSL_free(ht->slots);
+    OPENSSL_free(ht);
+}
+
+size_t ossl_ht_num_items(const OPENSSL_HT *ht)
+{
+    return ht == NULL ? 0 : ht->num_items;
+}
+
+int ossl_ht_error(const OPENSSL_HT *ht)
+{
+    return ht->error;
+}
+
+void *ossl_ht_insert(OPENSSL_HT *ht, void *data)
+{
+    unsigned long h = ht_mix(ht->hash(data));
+    ossl_ssize_t i;
+    size_t n = ht->slots == NULL ? 0 : ht->mask + 1;
+    void *ret;
+
+    ht->error = 0;
+    if ((i = ht_find(ht, h, data)) >= 0) {
+        ret = ht->slots[i].data;
+        ht->slots[i].data = data;
+        return ret;
+    }
+    if ((ht->num_items + 1) * HT_MAX_LOAD_DEN > n * HT_MAX_LOAD_NUM
+            && !ht_resize(ht, n == 0 ? HT_MIN_SIZE : n * 2)) {
+        ht->error = 1;
+        return NULL;
+    }
+    ht_place(ht, h, data);
+    ht->num_items++;
+    return NULL;
+}
+
+void *ossl_ht_retrieve(const OPENSSL_HT *ht, const void *data)
+{
+    ossl_ssize_t i = ht_find(ht, ht_mix(ht->hash(data)), data);
+
+    return i < 0 ? NULL : ht->slots[i].data;
+}
+
+void *ossl_ht_delete(OPENSSL_HT *ht, const void *data)
+{
+    ossl_ssize_t f = ht_find(ht, ht_mix(ht->hash(data)), data);
+    size_t i, j;
+    void *ret;
+
+    if (f < 0)
+        return NULL;
+    i = (size_t)f;
+    ret = ht->slots[i].data;
+    for (j = (i + 1) & ht->mask;
+         ht->slots[j].data != NULL && ht_dist(ht, ht->slots[j].hash, j) > 0;
+         i = j, j = (j + 1) & ht->mask)
+        ht->slots[i] = ht->slots[j];
+    ht->slots[i].data = NULL;
+    ht->num_items--;
+
+    /* A failure to shrink leaves a valid, if sparse, table */
+    if (ht->mask + 1 > HT_MIN_SIZE && ht->num_items * 8 < ht->mask + 1)
+        (void)ht_resize(ht, (ht->mask + 1) / 2);
+    return ret;
+}
+
+void ossl_ht_doall(const OPENSSL_HT *ht, void (*fn)(void *))
+{
+    size_t i;
+
+    if (ht == NULL || ht->slots == NULL)
+        return;
+    for (i = 0; i <= ht->mask; i++)
+        if (ht->slots[i].data != NULL)
+            fn(ht->slots[i].data);
+}
+
+void ossl_ht_doall_arg(const OPENSSL_HT *ht, void (*fn)(void *, void *),
+                       void *arg)
+{
+    size_t i;
+
+    if (ht == NULL || ht->slots == NULL)
+        return;
+    for (i = 0; i <= ht->mask; i++)
+        if (ht->slots[i].data != NULL)
+            fn(ht->slots[i].data, arg);
+}
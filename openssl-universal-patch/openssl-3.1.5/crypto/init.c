@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -389,6 +389,10 @@ void OPENSSL_cleanup(void)
 #ifndef OPENSSL_NO_COMP
     OSSL_TRACE(INIT, "OPENSSL_cleanup: ossl_comp_zlib_cleanup()\n");
     ossl_comp_zlib_cleanup();
+    OSSL_TRACE(INIT, "OPENSSL_cleanup: ossl_comp_brotli_cleanup()\n");
+    ossl_comp_brotli_cleanup();
+    OSSL_TRACE(INIT, "OPENSSL_cleanup: ossl_comp_zstd_cleanup()\n");
+    ossl_comp_zstd_cleanup();
 #endif
 
     if (async_inited) {
@@ -448,9 +452,19 @@ void OPENSSL_cleanup(void)
     OSSL_CMP_log_close();
 #endif
 
+#ifndef OPENSSL_NO_CRYPTO_MDEBUG
+    OSSL_TRACE(INIT, "OPENSSL_cleanup: ossl_malloc_profile_report()\n");
+    ossl_malloc_profile_report();
+#endif
+
     OSSL_TRACE(INIT, "OPENSSL_cleanup: ossl_trace_cleanup()\n");
     ossl_trace_cleanup();
 
+#ifndef OPENSSL_NO_MEM_POOL
+    /* Last, as everything above may free pooled memory */
+    ossl_malloc_pool_cleanup();
+#endif
+
     base_inited = 0;
 }
 
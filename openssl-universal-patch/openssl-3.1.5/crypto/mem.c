@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -48,10 +48,214 @@ static int shouldfail(void);
 
 # define FAILTEST() if (shouldfail()) return NULL
 
+/*
+ * Allocation profile, enabled by setting OPENSSL_MALLOC_PROFILE to the name
+ * of the file the report is written to.  Call sites are identified by the
+ * file and line passed to CRYPTO_malloc() and CRYPTO_realloc().
+ */
+typedef struct malloc_site_st {
+    const char *file;
+    int line;
+    size_t count;
+    size_t bytes;
+    size_t max;
+} MALLOC_SITE;
+
+# define PROFILE_SITES 4096
+
+static MALLOC_SITE *profile_sites;
+static size_t profile_lost;
+static CRYPTO_RWLOCK *profile_lock;
+static char *profile_file;
+
+static void profile_record(size_t num, const char *file, int line);
+
+# define PROFILE(num, file, line) \
+    do { \
+        if (profile_sites != NULL) \
+            profile_record(num, file, line); \
+    } while (0)
+
 #else
 
 # define INCREMENT(x) /* empty */
 # define FAILTEST() /* empty */
+# define PROFILE(num, file, line) /* empty */
+#endif
+
+#ifndef OPENSSL_NO_MEM_POOL
+/*
+ * Pooling allocator.  Small blocks are rounded up to one of a few size
+ * classes and, when freed, kept on per-thread free lists for reuse instead
+ * of being returned to the system allocator.  The classes are chosen to
+ * match the many short lived OSSL_PARAM arrays, contexts and ASN.1 objects
+ * the library allocates.  Every block is preceded by a header recording its
+ * class, so larger blocks pass straight through to malloc() and free().
+ *
+ * The per-thread lists are released when the thread exits; on platforms
+ * without thread local destructors they are not, but their size is bounded
+ * by POOL_CACHE_MAX.
+ */
+# define POOL_HDR           16
+# define POOL_LARGE         0xff
+# define POOL_CACHE_MAX     (64 * 1024)
+
+static const size_t pool_sizes[] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024
+};
+# define POOL_CLASSES       OSSL_NELEM(pool_sizes)
+# define POOL_MAX_SIZE      1024
+
+typedef struct pool_block_st {
+    struct pool_block_st *next;
+} POOL_BLOCK;
+
+typedef struct pool_cache_st {
+    POOL_BLOCK *blocks[POOL_CLASSES];
+    size_t held;
+} POOL_CACHE;
+
+static CRYPTO_ONCE pool_once = CRYPTO_ONCE_STATIC_INIT;
+static int pool_inited = 0;
+static CRYPTO_THREAD_LOCAL pool_key;
+
+/* Size class for each multiple of 16 bytes up to POOL_MAX_SIZE */
+static const unsigned char pool_class[POOL_MAX_SIZE / 16 + 1] = {
+     0,  0,  1,  2,  3,  4,  4,  5,  5,  6,  6,  6,  6,  7,  7,  7,
+     7,  8,  8,  8,  8,  8,  8,  8,  8,  9,  9,  9,  9,  9,  9,  9,
+     9, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+    10, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11,
+    11
+};
+
+static void pool_cache_free(void *arg)
+{
+    POOL_CACHE *cache = arg;
+    POOL_BLOCK *block;
+    size_t i;
+
+    for (i = 0; i < POOL_CLASSES; i++) {
+        while ((block = cache->blocks[i]) != NULL) {
+            cache->blocks[i] = block->next;
+            free((unsigned char *)block - POOL_HDR);
+        }
+    }
+    free(cache);
+}
+
+static void pool_init(void)
+{
+    pool_inited = CRYPTO_THREAD_init_local(&pool_key, pool_cache_free);
+}
+
+static POOL_CACHE *pool_get_cache(void)
+{
+    POOL_CACHE *cache;
+
+    if (!CRYPTO_THREAD_run_once(&pool_once, pool_init) || !pool_inited)
+        return NULL;
+    if ((cache = CRYPTO_THREAD_get_local(&pool_key)) == NULL) {
+        if ((cache = calloc(1, sizeof(*cache))) == NULL)
+            return NULL;
+        if (!CRYPTO_THREAD_set_local(&pool_key, cache)) {
+            free(cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+static void *pool_malloc(size_t num)
+{
+    POOL_CACHE *cache;
+    POOL_BLOCK *block;
+    unsigned char *ret;
+    size_t cls;
+
+    if (num > POOL_MAX_SIZE) {
+        if (num > SIZE_MAX - POOL_HDR
+                || (ret = malloc(num + POOL_HDR)) == NULL)
+            return NULL;
+        ret[0] = POOL_LARGE;
+        return ret + POOL_HDR;
+    }
+
+    cls = pool_class[(num + 15) / 16];
+    if ((cache = pool_get_cache()) != NULL
+            && (block = cache->blocks[cls]) != NULL) {
+        cache->blocks[cls] = block->next;
+        cache->held -= pool_sizes[cls];
+        return block;
+    }
+    if ((ret = malloc(pool_sizes[cls] + POOL_HDR)) == NULL)
+        return NULL;
+    ret[0] = (unsigned char)cls;
+    return ret + POOL_HDR;
+}
+
+static void pool_free(void *str)
+{
+    unsigned char *hdr = (unsigned char *)str - POOL_HDR;
+    POOL_CACHE *cache;
+    POOL_BLOCK *block = str;
+
+    if (str == NULL)
+        return;
+    if (hdr[0] == POOL_LARGE
+            || (cache = pool_get_cache()) == NULL
+            || cache->held + pool_sizes[hdr[0]] > POOL_CACHE_MAX) {
+        free(hdr);
+        return;
+    }
+    block->next = cache->blocks[hdr[0]];
+    cache->blocks[hdr[0]] = block;
+    cache->held += pool_sizes[hdr[0]];
+}
+
+static void *pool_realloc(void *str, size_t num)
+{
+    unsigned char *hdr = (unsigned char *)str - POOL_HDR;
+    void *ret;
+
+    if (hdr[0] == POOL_LARGE) {
+        if (num > SIZE_MAX - POOL_HDR
+                || (hdr = realloc(hdr, num + POOL_HDR)) == NULL)
+            return NULL;
+        return hdr + POOL_HDR;
+    }
+    if (num <= pool_sizes[hdr[0]])
+        return str;
+    if ((ret = pool_malloc(num)) != NULL) {
+        memcpy(ret, str, pool_sizes[hdr[0]]);
+        pool_free(str);
+    }
+    return ret;
+}
+
+/*
+ * Release the calling thread's free lists and the thread local key.  Called
+ * from OPENSSL_cleanup(), after which blocks are passed straight to free().
+ */
+void ossl_malloc_pool_cleanup(void)
+{
+    POOL_CACHE *cache;
+
+    if (!pool_inited)
+        return;
+    pool_inited = 0;
+    cache = CRYPTO_THREAD_get_local(&pool_key);
+    CRYPTO_THREAD_cleanup_local(&pool_key);
+    if (cache != NULL)
+        pool_cache_free(cache);
+}
+
+# define SYS_MALLOC(num)         pool_malloc(num)
+# define SYS_REALLOC(str, num)   pool_realloc(str, num)
+# define SYS_FREE(str)           pool_free(str)
+#else
+# define SYS_MALLOC(num)         malloc(num)
+# define SYS_REALLOC(str, num)   realloc(str, num)
+# define SYS_FREE(str)           free(str)
 #endif
 
 int CRYPTO_set_mem_functions(CRYPTO_malloc_fn malloc_fn,
@@ -171,12 +375,101 @@ void ossl_malloc_setup_failures(void)
         md_tracefd = atoi(cp);
     if ((cp = getenv("OPENSSL_MALLOC_SEED")) != NULL)
         srandom(atoi(cp));
+    if ((cp = getenv("OPENSSL_MALLOC_PROFILE")) != NULL
+            && profile_sites == NULL
+            && (profile_file = strdup(cp)) != NULL) {
+        MALLOC_SITE *sites = calloc(PROFILE_SITES, sizeof(*sites));
+
+        /* The lock is allocated before profiling starts */
+        if (sites != NULL
+                && (profile_lock = CRYPTO_THREAD_lock_new()) != NULL) {
+            profile_sites = sites;
+        } else {
+            free(sites);
+            free(profile_file);
+            profile_file = NULL;
+        }
+    }
+}
+
+static void profile_record(size_t num, const char *file, int line)
+{
+    size_t i, h;
+
+    h = ((size_t)file >> 4) * 31 + (size_t)line;
+    if (!CRYPTO_THREAD_write_lock(profile_lock))
+        return;
+    for (i = 0; i < PROFILE_SITES; i++) {
+        MALLOC_SITE *site = &profile_sites[(h + i) % PROFILE_SITES];
+
+        if (site->file == NULL) {
+            site->file = file;
+            site->line = line;
+        } else if (site->file != file || site->line != line) {
+            continue;
+        }
+        site->count++;
+        site->bytes += num;
+        if (num > site->max)
+            site->max = num;
+        break;
+    }
+    if (i == PROFILE_SITES)
+        profile_lost++;
+    CRYPTO_THREAD_unlock(profile_lock);
+}
+
+static int profile_cmp(const void *a, const void *b)
+{
+    const MALLOC_SITE *x = a, *y = b;
+
+    if (x->count != y->count)
+        return x->count < y->count ? 1 : -1;
+    return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+/*
+ * Write the allocation profile, most frequent call sites first, and stop
+ * profiling.  Called from OPENSSL_cleanup().
+ */
+void ossl_malloc_profile_report(void)
+{
+    MALLOC_SITE *sites = profile_sites;
+    size_t i;
+# ifndef OPENSSL_NO_STDIO
+    FILE *fp;
+# endif
+
+    if (sites == NULL)
+        return;
+    profile_sites = NULL;
+    qsort(sites, PROFILE_SITES, sizeof(*sites), profile_cmp);
+# ifndef OPENSSL_NO_STDIO
+    if ((fp = fopen(profile_file, "w")) != NULL) {
+        fprintf(fp, "%10s %12s %8s %8s  %s\n",
+                "count", "bytes", "average", "max", "call site");
+        for (i = 0; i < PROFILE_SITES && sites[i].file != NULL; i++)
+            fprintf(fp, "%10zu %12zu %8zu %8zu  %s:%d\n", sites[i].count,
+                    sites[i].bytes, sites[i].bytes / sites[i].count,
+                    sites[i].max, sites[i].file, sites[i].line);
+        if (profile_lost > 0)
+            fprintf(fp, "%10zu allocations from untracked call sites\n",
+                    profile_lost);
+        fclose(fp);
+    }
+# endif
+    CRYPTO_THREAD_lock_free(profile_lock);
+    profile_lock = NULL;
+    free(sites);
+    free(profile_file);
+    profile_file = NULL;
 }
 #endif
 
 void *CRYPTO_malloc(size_t num, const char *file, int line)
 {
     INCREMENT(malloc_count);
+    PROFILE(num, file, line);
     if (malloc_impl != CRYPTO_malloc)
         return malloc_impl(num, file, line);
 
@@ -193,7 +486,7 @@ void *CRYPTO_malloc(size_t num, const char *file, int line)
         allow_customize = 0;
     }
 
-    return malloc(num);
+    return SYS_MALLOC(num);
 }
 
 void *CRYPTO_zalloc(size_t num, const char *file, int line)
@@ -221,8 +514,9 @@ void *CRYPTO_realloc(void *str, size_t num, const char *file, int line)
         return NULL;
     }
 
+    PROFILE(num, file, line);
     FAILTEST();
-    return realloc(str, num);
+    return SYS_REALLOC(str, num);
 }
 
 void *CRYPTO_clear_realloc(void *str, size_t old_len, size_t num,
@@ -260,7 +554,7 @@ void CRYPTO_free(void *str, const char *file, int line)
         return;
     }
 
-    free(str);
+    SYS_FREE(str);
 }
 
 void CRYPTO_clear_free(void *str, size_t num, const char *file, int line)
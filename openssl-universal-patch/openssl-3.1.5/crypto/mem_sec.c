@@ -90,6 +90,17 @@ static void sh_free(void *ptr);
 static void sh_done(void);
 static size_t sh_actual_size(char *ptr);
 static int sh_allocated(const char *ptr);
+
+/*
+ * Per-thread caches of small chunks, which keep most allocations and frees
+ * away from sec_malloc_lock.
+ */
+static int sh_cache_init(void);
+static void sh_cache_done(void);
+static void *sh_cache_pop(size_t size);
+static int sh_cache_push(char *ptr);
+static void sh_cache_drain_all(void);
+static size_t sh_cache_held(void);
 #endif
 
 int CRYPTO_secure_malloc_init(size_t size, size_t minsize)
@@ -101,9 +112,15 @@ int CRYPTO_secure_malloc_init(size_t size, size_t minsize)
         sec_malloc_lock = CRYPTO_THREAD_lock_new();
         if (sec_malloc_lock == NULL)
             return 0;
+        if (!sh_cache_init()) {
+            CRYPTO_THREAD_lock_free(sec_malloc_lock);
+            sec_malloc_lock = NULL;
+            return 0;
+        }
         if ((ret = sh_init(size, minsize)) != 0) {
             secure_mem_initialized = 1;
         } else {
+            sh_cache_done();
             CRYPTO_THREAD_lock_free(sec_malloc_lock);
             sec_malloc_lock = NULL;
         }
@@ -118,7 +135,16 @@ int CRYPTO_secure_malloc_init(size_t size, size_t minsize)
 int CRYPTO_secure_malloc_done(void)
 {
 #ifndef OPENSSL_NO_SECURE_MEMORY
+    if (secure_mem_initialized) {
+        /* Chunks sitting in the per-thread caches are not in use */
+        if (!CRYPTO_THREAD_write_lock(sec_malloc_lock))
+            return 0;
+        sh_cache_drain_all();
+        CRYPTO_THREAD_unlock(sec_malloc_lock);
+    }
     if (secure_mem_used == 0) {
+        if (secure_mem_initialized)
+            sh_cache_done();
         sh_done();
         secure_mem_initialized = 0;
         CRYPTO_THREAD_lock_free(sec_malloc_lock);
@@ -147,9 +173,16 @@ void *CRYPTO_secure_malloc(size_t num, const char *file, int line)
     if (!secure_mem_initialized) {
         return CRYPTO_malloc(num, file, line);
     }
+    if ((ret = sh_cache_pop(num)) != NULL)
+        return ret;
     if (!CRYPTO_THREAD_write_lock(sec_malloc_lock))
         return NULL;
     ret = sh_malloc(num);
+    if (ret == NULL) {
+        /* Give back what other threads are holding on to and try again */
+        sh_cache_drain_all();
+        ret = sh_malloc(num);
+    }
     actual_size = ret ? sh_actual_size(ret) : 0;
     secure_mem_used += actual_size;
     CRYPTO_THREAD_unlock(sec_malloc_lock);
@@ -180,6 +213,8 @@ void CRYPTO_secure_free(void *ptr, const char *file, int line)
         CRYPTO_free(ptr, file, line);
         return;
     }
+    if (sh_cache_push(ptr))
+        return;
     if (!CRYPTO_THREAD_write_lock(sec_malloc_lock))
         return;
     actual_size = sh_actual_size(ptr);
@@ -205,6 +240,8 @@ void CRYPTO_secure_clear_free(void *ptr, size_t num,
         CRYPTO_free(ptr, file, line);
         return;
     }
+    if (sh_cache_push(ptr))
+        return;
     if (!CRYPTO_THREAD_write_lock(sec_malloc_lock))
         return;
     actual_size = sh_actual_size(ptr);
@@ -244,7 +281,7 @@ size_t CRYPTO_secure_used(void)
     if (!CRYPTO_THREAD_read_lock(sec_malloc_lock))
         return 0;
 
-    ret = secure_mem_used;
+    ret = secure_mem_used - sh_cache_held();
 
     CRYPTO_THREAD_unlock(sec_malloc_lock);
 #endif /* OPENSSL_NO_SECURE_MEMORY */
@@ -317,10 +354,40 @@ typedef struct sh_st
     unsigned char *bittable;
     unsigned char *bitmalloc;
     size_t bittable_size; /* size in bits */
+    unsigned char *sizetab; /* free list of each allocated chunk */
+    size_t cache_limit; /* bytes a single thread cache may hold */
 } SH;
 
 static SH sh;
 
+/*
+ * Each thread keeps a few recently freed chunks of the smallest size
+ * classes, so that the typical pattern of short lived BIGNUMs and key
+ * buffers is served without touching sec_malloc_lock.  Cached chunks are
+ * cleansed and stay marked as allocated in the buddy allocator; they are
+ * not counted by CRYPTO_secure_used().  The caches are linked together so
+ * that they can be drained when the heap runs out of memory and when it is
+ * released.
+ *
+ * The size of each allocated chunk is recorded in sh.sizetab, one byte per
+ * sh.minsize unit, so that it can be looked up without the lock.  For very
+ * large heaps that table is not allocated and the caches are not used.
+ */
+# define SH_CACHE_CLASSES   6
+# define SH_CACHE_DEPTH     8
+# define SH_CACHE_MAX_UNITS (ONE << 24)
+
+typedef struct sh_cache_st {
+    CRYPTO_RWLOCK *lock;
+    struct sh_cache_st *next;
+    size_t held;
+    int count[SH_CACHE_CLASSES];
+    char *chunks[SH_CACHE_CLASSES][SH_CACHE_DEPTH];
+} SH_CACHE;
+
+static CRYPTO_THREAD_LOCAL sh_cache_key;
+static SH_CACHE *sh_caches;
+
 static size_t sh_getlist(char *ptr)
 {
     ossl_ssize_t list = sh.freelist_size - 1;
@@ -475,6 +542,12 @@ static int sh_init(size_t size, size_t minsize)
     if (sh.bitmalloc == NULL)
         goto err;
 
+    /* The per-thread caches are an optimisation, so failure is not fatal */
+    if (sh.arena_size / sh.minsize <= SH_CACHE_MAX_UNITS) {
+        sh.sizetab = OPENSSL_malloc(sh.arena_size / sh.minsize);
+        sh.cache_limit = sh.arena_size >> 6;
+    }
+
     /* Allocate space for heap, and two extra pages as guards */
 #if defined(_SC_PAGE_SIZE) || defined (_SC_PAGESIZE)
     {
@@ -580,6 +653,7 @@ static void sh_done(void)
     OPENSSL_free(sh.freelist);
     OPENSSL_free(sh.bittable);
     OPENSSL_free(sh.bitmalloc);
+    OPENSSL_free(sh.sizetab);
 #if !defined(_WIN32)
     if (sh.map_result != MAP_FAILED && sh.map_size)
         munmap(sh.map_result, sh.map_size);
@@ -671,6 +745,9 @@ static void *sh_malloc(size_t size)
     /* zero the free list header as a precaution against information leakage */
     memset(chunk, 0, sizeof(SH_LIST));
 
+    if (sh.sizetab != NULL)
+        sh.sizetab[(chunk - sh.arena) / sh.minsize] = (unsigned char)list;
+
     return chunk;
 }
 
@@ -726,4 +803,162 @@ static size_t sh_actual_size(char *ptr)
     OPENSSL_assert(sh_testbit(ptr, list, sh.bittable));
     return sh.arena_size / (ONE << list);
 }
+
+/* Called with sec_malloc_lock held */
+static void sh_cache_drain(SH_CACHE *cache)
+{
+    int i;
+
+    if (!CRYPTO_THREAD_write_lock(cache->lock))
+        return;
+    for (i = 0; i < SH_CACHE_CLASSES; i++) {
+        while (cache->count[i] > 0) {
+            sh_free(cache->chunks[i][--cache->count[i]]);
+            secure_mem_used -= sh.minsize << i;
+        }
+    }
+    cache->held = 0;
+    CRYPTO_THREAD_unlock(cache->lock);
+}
+
+/* Called with sec_malloc_lock held */
+static void sh_cache_drain_all(void)
+{
+    SH_CACHE *cache;
+
+    for (cache = sh_caches; cache != NULL; cache = cache->next)
+        sh_cache_drain(cache);
+}
+
+/* Called with sec_malloc_lock held */
+static size_t sh_cache_held(void)
+{
+    SH_CACHE *cache;
+    size_t ret = 0;
+
+    for (cache = sh_caches; cache != NULL; cache = cache->next) {
+        if (!CRYPTO_THREAD_read_lock(cache->lock))
+            continue;
+        ret += cache->held;
+        CRYPTO_THREAD_unlock(cache->lock);
+    }
+    return ret;
+}
+
+static void sh_cache_free(SH_CACHE *cache)
+{
+    CRYPTO_THREAD_lock_free(cache->lock);
+    OPENSSL_free(cache);
+}
+
+/*
+ * Thread exit handler.  It is not run on platforms without thread local
+ * destructors, in which case the cache is reclaimed by sh_cache_drain_all()
+ * and sh_cache_done().
+ */
+static void sh_cache_thread_stop(void *arg)
+{
+    SH_CACHE *cache = arg, **p;
+
+    if (!CRYPTO_THREAD_write_lock(sec_malloc_lock))
+        return;
+    sh_cache_drain(cache);
+    for (p = &sh_caches; *p != NULL; p = &(*p)->next) {
+        if (*p == cache) {
+            *p = cache->next;
+            break;
+        }
+    }
+    CRYPTO_THREAD_unlock(sec_malloc_lock);
+    sh_cache_free(cache);
+}
+
+static int sh_cache_init(void)
+{
+    sh_caches = NULL;
+    return CRYPTO_THREAD_init_local(&sh_cache_key, sh_cache_thread_stop);
+}
+
+/* Only called once all caches have been drained */
+static void sh_cache_done(void)
+{
+    SH_CACHE *cache;
+
+    CRYPTO_THREAD_cleanup_local(&sh_cache_key);
+    while ((cache = sh_caches) != NULL) {
+        sh_caches = cache->next;
+        sh_cache_free(cache);
+    }
+}
+
+static void *sh_cache_pop(size_t size)
+{
+    SH_CACHE *cache;
+    char *ret = NULL;
+    size_t i;
+    int cls = 0;
+
+    if (sh.sizetab == NULL
+            || (cache = CRYPTO_THREAD_get_local(&sh_cache_key)) == NULL)
+        return NULL;
+    for (i = sh.minsize; i < size; i <<= 1)
+        if (++cls == SH_CACHE_CLASSES)
+            return NULL;
+
+    if (!CRYPTO_THREAD_write_lock(cache->lock))
+        return NULL;
+    if (cache->count[cls] > 0) {
+        ret = cache->chunks[cls][--cache->count[cls]];
+        cache->held -= sh.minsize << cls;
+    }
+    CRYPTO_THREAD_unlock(cache->lock);
+    return ret;
+}
+
+static int sh_cache_push(char *ptr)
+{
+    SH_CACHE *cache;
+    size_t size;
+    int cls;
+
+    if (sh.sizetab == NULL)
+        return 0;
+    cls = (int)(sh.freelist_size - 1) - sh.sizetab[(ptr - sh.arena) / sh.minsize];
+    if (cls >= SH_CACHE_CLASSES)
+        return 0;
+    size = sh.minsize << cls;
+    if (size > sh.cache_limit)
+        return 0;
+
+    if ((cache = CRYPTO_THREAD_get_local(&sh_cache_key)) == NULL) {
+        if ((cache = OPENSSL_zalloc(sizeof(*cache))) == NULL)
+            return 0;
+        if ((cache->lock = CRYPTO_THREAD_lock_new()) == NULL
+                || !CRYPTO_THREAD_write_lock(sec_malloc_lock)) {
+            sh_cache_free(cache);
+            return 0;
+        }
+        if (!CRYPTO_THREAD_set_local(&sh_cache_key, cache)) {
+            CRYPTO_THREAD_unlock(sec_malloc_lock);
+            sh_cache_free(cache);
+            return 0;
+        }
+        cache->next = sh_caches;
+        sh_caches = cache;
+        CRYPTO_THREAD_unlock(sec_malloc_lock);
+    }
+
+    if (!CRYPTO_THREAD_write_lock(cache->lock))
+        return 0;
+    if (cache->count[cls] == SH_CACHE_DEPTH
+            || cache->held + size > sh.cache_limit) {
+        CRYPTO_THREAD_unlock(cache->lock);
+        return 0;
+    }
+    CLEAR(ptr, size);
+    cache->chunks[cls][cache->count[cls]++] = ptr;
+    cache->held += size;
+    CRYPTO_THREAD_unlock(cache->lock);
+    return 1;
+}
 #endif /* OPENSSL_NO_SECURE_MEMORY */
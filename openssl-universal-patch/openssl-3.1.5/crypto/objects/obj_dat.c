@@ -16,6 +16,7 @@
 #include <openssl/lhash.h>
 #include <openssl/asn1.h>
 #include "crypto/objects.h"
+#include "crypto/hashtable.h"
 #include <openssl/bn.h>
 #include "crypto/asn1.h"
 #include "obj_local.h"
@@ -45,7 +46,9 @@ struct added_obj_st {
     ASN1_OBJECT *obj;
 };
 
-static LHASH_OF(ADDED_OBJ) *added = NULL;
+DEFINE_HASHTABLE_OF(ADDED_OBJ);
+
+static HASHTABLE_OF(ADDED_OBJ) *added = NULL;
 static CRYPTO_RWLOCK *ossl_obj_lock = NULL;
 #ifdef OBJ_USE_LOCK_FOR_NEW_NID
 static CRYPTO_RWLOCK *ossl_obj_nid_lock = NULL;
@@ -219,11 +222,10 @@ static void cleanup3_doall(ADDED_OBJ *a)
 void ossl_obj_cleanup_int(void)
 {
     if (added != NULL) {
-        lh_ADDED_OBJ_set_down_load(added, 0);
-        lh_ADDED_OBJ_doall(added, cleanup1_doall); /* zero counters */
-        lh_ADDED_OBJ_doall(added, cleanup2_doall); /* set counters */
-        lh_ADDED_OBJ_doall(added, cleanup3_doall); /* free objects */
-        lh_ADDED_OBJ_free(added);
+        ossl_ht_ADDED_OBJ_doall(added, cleanup1_doall); /* zero counters */
+        ossl_ht_ADDED_OBJ_doall(added, cleanup2_doall); /* set counters */
+        ossl_ht_ADDED_OBJ_doall(added, cleanup3_doall); /* free objects */
+        ossl_ht_ADDED_OBJ_free(added);
         added = NULL;
     }
     objs_free_locks();
@@ -295,7 +297,7 @@ static int ossl_obj_add_object(const ASN1_OBJECT *obj, int lock)
         goto err2;
     }
     if (added == NULL) {
-        added = lh_ADDED_OBJ_new(added_obj_hash, added_obj_cmp);
+        added = ossl_ht_ADDED_OBJ_new(added_obj_hash, added_obj_cmp);
         if (added == NULL) {
             ERR_raise(ERR_LIB_OBJ, ERR_R_MALLOC_FAILURE);
             goto err;
@@ -306,7 +308,7 @@ static int ossl_obj_add_object(const ASN1_OBJECT *obj, int lock)
         if (ao[i] != NULL) {
             ao[i]->type = i;
             ao[i]->obj = o;
-            aop = lh_ADDED_OBJ_insert(added, ao[i]);
+            aop = ossl_ht_ADDED_OBJ_insert(added, ao[i]);
             /* memory leak, but should not normally matter */
             OPENSSL_free(aop);
         }
@@ -344,7 +346,7 @@ ASN1_OBJECT *OBJ_nid2obj(int n)
         return NULL;
     }
     if (added != NULL)
-        adp = lh_ADDED_OBJ_retrieve(added, &ad);
+        adp = ossl_ht_ADDED_OBJ_retrieve(added, &ad);
     ossl_obj_unlock(1);
     if (adp != NULL)
         return adp->obj;
@@ -406,7 +408,7 @@ static int ossl_obj_obj2nid(const ASN1_OBJECT *a, const int lock)
     if (added != NULL) {
         ad.type = ADDED_DATA;
         ad.obj = (ASN1_OBJECT *)a; /* casting away const is harmless here */
-        adp = lh_ADDED_OBJ_retrieve(added, &ad);
+        adp = ossl_ht_ADDED_OBJ_retrieve(added, &ad);
         if (adp != NULL)
             nid = adp->obj->nid;
     }
@@ -473,7 +475,7 @@ int OBJ_obj2txt(char *buf, int buf_len, const ASN1_OBJECT *a, int no_name)
     BIGNUM *bl;
     unsigned long l;
     const unsigned char *p;
-    char tbuf[DECIMAL_SIZE(i) + DECIMAL_SIZE(l) + 2];
+    char tbuf[DECIMAL_SIZE(i) + DECIMAL_SIZE(l) + 2], *q;
     const char *s;
 
     /* Ensure that, at every state, |buf| is NUL-terminated. */
@@ -594,10 +596,21 @@ int OBJ_obj2txt(char *buf, int buf_len, const ASN1_OBJECT *a, int no_name)
             n += i;
             OPENSSL_free(bndec);
         } else {
-            BIO_snprintf(tbuf, sizeof(tbuf), ".%lu", l);
-            i = strlen(tbuf);
+            /*
+             * Format ".%lu" by hand, BIO_snprintf() is a large share of the
+             * cost of this function and it's used on every OID in the
+             * namemap when a library context is first used.
+             */
+            q = tbuf + sizeof(tbuf) - 1;
+            *q = '\0';
+            do {
+                *--q = (char)('0' + l % 10);
+                l /= 10;
+            } while (l != 0);
+            *--q = '.';
+            i = (int)(tbuf + sizeof(tbuf) - 1 - q);
             if (buf && (buf_len > 0)) {
-                OPENSSL_strlcpy(buf, tbuf, buf_len);
+                OPENSSL_strlcpy(buf, q, buf_len);
                 if (i > buf_len) {
                     buf += buf_len;
                     buf_len = 0;
@@ -650,7 +663,7 @@ int OBJ_ln2nid(const char *s)
     if (added != NULL) {
         ad.type = ADDED_LNAME;
         ad.obj = &o;
-        adp = lh_ADDED_OBJ_retrieve(added, &ad);
+        adp = ossl_ht_ADDED_OBJ_retrieve(added, &ad);
         if (adp != NULL)
             nid = adp->obj->nid;
     }
@@ -677,7 +690,7 @@ int OBJ_sn2nid(const char *s)
     if (added != NULL) {
         ad.type = ADDED_SNAME;
         ad.obj = &o;
-        adp = lh_ADDED_OBJ_retrieve(added, &ad);
+        adp = ossl_ht_ADDED_OBJ_retrieve(added, &ad);
         if (adp != NULL)
             nid = adp->obj->nid;
     }
@@ -28,6 +28,7 @@
 #include "internal/refcount.h"
 #include "internal/bio.h"
 #include "internal/core.h"
+#include "internal/thread.h"
 #include "provider_local.h"
 #include "crypto/context.h"
 #ifndef FIPS_MODULE
@@ -1887,6 +1888,9 @@ static OSSL_FUNC_provider_up_ref_fn core_provider_up_ref_intern;
 static OSSL_FUNC_provider_free_fn core_provider_free_intern;
 static OSSL_FUNC_core_obj_add_sigid_fn core_obj_add_sigid;
 static OSSL_FUNC_core_obj_create_fn core_obj_create;
+static OSSL_FUNC_core_thread_pool_start_fn core_thread_pool_start;
+static OSSL_FUNC_core_thread_pool_join_fn core_thread_pool_join;
+static OSSL_FUNC_core_thread_pool_avail_fn core_thread_pool_avail;
 #endif
 
 static const OSSL_PARAM *core_gettable_params(const OSSL_CORE_HANDLE *handle)
@@ -2149,6 +2153,27 @@ static int core_obj_create(const OSSL_CORE_HANDLE *prov, const char *oid,
     return OBJ_txt2nid(oid) != NID_undef
            || OBJ_create(oid, sn, ln) != NID_undef;
 }
+
+static void *core_thread_pool_start(const OSSL_CORE_HANDLE *prov,
+                                    CRYPTO_THREAD_ROUTINE routine, void *data)
+{
+    OSSL_LIB_CTX *libctx = ossl_provider_libctx((OSSL_PROVIDER *)prov);
+
+    return ossl_crypto_thread_start(libctx, routine, data);
+}
+
+static int core_thread_pool_join(const OSSL_CORE_HANDLE *prov, void *task,
+                                 uint32_t *retval)
+{
+    return ossl_crypto_thread_join(task, retval);
+}
+
+static uint64_t core_thread_pool_avail(const OSSL_CORE_HANDLE *prov)
+{
+    OSSL_LIB_CTX *libctx = ossl_provider_libctx((OSSL_PROVIDER *)prov);
+
+    return ossl_get_avail_threads(libctx);
+}
 #endif /* FIPS_MODULE */
 
 /*
@@ -2219,6 +2244,11 @@ static const OSSL_DISPATCH core_dispatch_[] = {
         (void (*)(void))core_provider_free_intern },
     { OSSL_FUNC_CORE_OBJ_ADD_SIGID, (void (*)(void))core_obj_add_sigid },
     { OSSL_FUNC_CORE_OBJ_CREATE, (void (*)(void))core_obj_create },
+    { OSSL_FUNC_CORE_THREAD_POOL_START,
+        (void (*)(void))core_thread_pool_start },
+    { OSSL_FUNC_CORE_THREAD_POOL_JOIN, (void (*)(void))core_thread_pool_join },
+    { OSSL_FUNC_CORE_THREAD_POOL_AVAIL,
+        (void (*)(void))core_thread_pool_avail },
 #endif
     { 0, NULL }
 };
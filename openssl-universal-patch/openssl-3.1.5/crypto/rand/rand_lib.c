@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -45,6 +45,27 @@ static CRYPTO_ONCE rand_init = CRYPTO_ONCE_STATIC_INIT;
 
 static int rand_inited = 0;
 
+/*
+ * Small RAND_bytes() requests, typically nonces, are served from a per-thread
+ * buffer of output pre-generated by the thread's <public> DRBG.
+ */
+# define RAND_PUBLIC_CACHE_SIZE          4096
+# define RAND_PUBLIC_CACHE_MAX_REQUEST   64
+
+typedef struct rand_public_cache_st {
+    int fork_id;
+    unsigned int generation;
+    unsigned int strength;
+    time_t filled;
+    time_t interval;            /* Reseed time interval of the DRBG */
+    size_t len;
+    unsigned char buf[RAND_PUBLIC_CACHE_SIZE];
+} RAND_PUBLIC_CACHE;
+
+static int rand_public_cache_bytes(OSSL_LIB_CTX *ctx, unsigned char *buf,
+                                   size_t num, unsigned int strength);
+static void rand_public_cache_flush(OSSL_LIB_CTX *ctx);
+
 DEFINE_RUN_ONCE_STATIC(do_rand_init)
 {
 # ifndef OPENSSL_NO_ENGINE
@@ -190,6 +211,14 @@ const RAND_METHOD *RAND_get_rand_method(void)
     if (!RUN_ONCE(&rand_init, do_rand_init))
         return NULL;
 
+    /* Every RAND_bytes() call gets here, avoid the write lock if possible */
+    if (!CRYPTO_THREAD_read_lock(rand_meth_lock))
+        return NULL;
+    tmp_meth = default_RAND_meth;
+    CRYPTO_THREAD_unlock(rand_meth_lock);
+    if (tmp_meth != NULL)
+        return tmp_meth;
+
     if (!CRYPTO_THREAD_write_lock(rand_meth_lock))
         return NULL;
     if (default_RAND_meth == NULL) {
@@ -257,8 +286,10 @@ void RAND_seed(const void *buf, int num)
 # endif
 
     drbg = RAND_get0_primary(NULL);
-    if (drbg != NULL && num > 0)
+    if (drbg != NULL && num > 0) {
         EVP_RAND_reseed(drbg, 0, NULL, 0, buf, num);
+        rand_public_cache_flush(NULL);
+    }
 }
 
 void RAND_add(const void *buf, int num, double randomness)
@@ -273,7 +304,7 @@ void RAND_add(const void *buf, int num, double randomness)
     }
 # endif
     drbg = RAND_get0_primary(NULL);
-    if (drbg != NULL && num > 0)
+    if (drbg != NULL && num > 0) {
 # ifdef OPENSSL_RAND_SEED_NONE
         /* Without an entropy source, we have to rely on the user */
         EVP_RAND_reseed(drbg, 0, buf, num, NULL, 0);
@@ -281,6 +312,8 @@ void RAND_add(const void *buf, int num, double randomness)
         /* With an entropy source, we downgrade this to additional input */
         EVP_RAND_reseed(drbg, 0, NULL, 0, buf, num);
 # endif
+        rand_public_cache_flush(NULL);
+    }
 }
 
 # if !defined(OPENSSL_NO_DEPRECATED_1_1_0)
@@ -368,6 +401,11 @@ int RAND_bytes_ex(OSSL_LIB_CTX *ctx, unsigned char *buf, size_t num,
     }
 #endif
 
+#ifndef FIPS_MODULE
+    if (num <= RAND_PUBLIC_CACHE_MAX_REQUEST)
+        return rand_public_cache_bytes(ctx, buf, num, strength);
+#endif
+
     rand = RAND_get0_public(ctx);
     if (rand != NULL)
         return EVP_RAND_generate(rand, buf, num, strength, 0, NULL, 0);
@@ -428,6 +466,16 @@ typedef struct rand_global_st {
      */
     CRYPTO_THREAD_LOCAL private;
 
+#ifndef FIPS_MODULE
+    /*
+     * Per-thread buffer of pre-generated <public> DRBG output, see
+     * rand_public_cache_bytes().  The generation is bumped to make all
+     * threads discard their buffers, e.g. after RAND_add().
+     */
+    CRYPTO_THREAD_LOCAL public_cache;
+    TSAN_QUALIFIER unsigned int public_cache_generation;
+#endif
+
     /* Which RNG is being used by default and it's configuration settings */
     char *rng_name;
     char *rng_cipher;
@@ -468,8 +516,17 @@ void *ossl_rand_ctx_new(OSSL_LIB_CTX *libctx)
     if (!CRYPTO_THREAD_init_local(&dgbl->public, NULL))
         goto err2;
 
+#ifndef FIPS_MODULE
+    if (!CRYPTO_THREAD_init_local(&dgbl->public_cache, NULL))
+        goto err3;
+#endif
+
     return dgbl;
 
+#ifndef FIPS_MODULE
+ err3:
+    CRYPTO_THREAD_cleanup_local(&dgbl->public);
+#endif
  err2:
     CRYPTO_THREAD_cleanup_local(&dgbl->private);
  err1:
@@ -488,6 +545,9 @@ void ossl_rand_ctx_free(void *vdgbl)
     CRYPTO_THREAD_lock_free(dgbl->lock);
     CRYPTO_THREAD_cleanup_local(&dgbl->private);
     CRYPTO_THREAD_cleanup_local(&dgbl->public);
+#ifndef FIPS_MODULE
+    CRYPTO_THREAD_cleanup_local(&dgbl->public_cache);
+#endif
     EVP_RAND_CTX_free(dgbl->primary);
     EVP_RAND_CTX_free(dgbl->seed);
     OPENSSL_free(dgbl->rng_name);
@@ -521,6 +581,12 @@ static void rand_delete_thread_state(void *arg)
     rand = CRYPTO_THREAD_get_local(&dgbl->private);
     CRYPTO_THREAD_set_local(&dgbl->private, NULL);
     EVP_RAND_CTX_free(rand);
+
+#ifndef FIPS_MODULE
+    OPENSSL_clear_free(CRYPTO_THREAD_get_local(&dgbl->public_cache),
+                       sizeof(RAND_PUBLIC_CACHE));
+    CRYPTO_THREAD_set_local(&dgbl->public_cache, NULL);
+#endif
 }
 
 #ifndef FIPS_MODULE
@@ -770,6 +836,135 @@ EVP_RAND_CTX *RAND_get0_public(OSSL_LIB_CTX *ctx)
     return rand;
 }
 
+#ifndef FIPS_MODULE
+/*
+ * Whether the output of |rand| may be buffered by rand_public_cache_bytes(),
+ * if so its reseed time interval is stored in |*interval|.
+ */
+static int rand_public_cacheable(EVP_RAND_CTX *rand, time_t *interval)
+{
+    const char *name = EVP_RAND_get0_name(EVP_RAND_CTX_get0_rand(rand));
+    OSSL_PARAM params[2];
+
+    if (name == NULL
+            || (OPENSSL_strcasecmp(name, "CTR-DRBG") != 0
+                && OPENSSL_strcasecmp(name, "HASH-DRBG") != 0
+                && OPENSSL_strcasecmp(name, "HMAC-DRBG") != 0))
+        return 0;
+
+    /* Without a reseed time interval there is no bound on the staleness */
+    params[0] =
+        OSSL_PARAM_construct_time_t(OSSL_DRBG_PARAM_RESEED_TIME_INTERVAL,
+                                    interval);
+    params[1] = OSSL_PARAM_construct_end();
+    return EVP_RAND_CTX_get_params(rand, params) && *interval > 0;
+}
+
+/*
+ * Serve a small request from the calling thread's buffer of <public> DRBG
+ * output, refilling it with a single generate call when it runs low.
+ *
+ * The buffer is discarded after a fork, after RAND_seed() or RAND_add(), and
+ * once it is older than the reseed time interval of the <public> DRBG, so
+ * the output is never staler than what the DRBG itself would produce.  The
+ * interval is read at every refill, a change to it takes effect with the
+ * next one.  Consumed bytes are cleansed from the buffer straight away.
+ */
+static int rand_public_cache_bytes(OSSL_LIB_CTX *ctx, unsigned char *buf,
+                                   size_t num, unsigned int strength)
+{
+    RAND_GLOBAL *dgbl = rand_get_global(ctx);
+    RAND_PUBLIC_CACHE *cache;
+    EVP_RAND_CTX *rand;
+    unsigned int generation;
+    int fork_id;
+    time_t now, interval;
+
+    if (dgbl == NULL)
+        return 0;
+
+    cache = CRYPTO_THREAD_get_local(&dgbl->public_cache);
+    fork_id = openssl_get_fork_id();
+    generation = tsan_load(&dgbl->public_cache_generation);
+    now = time(NULL);
+    if (cache != NULL
+            && cache->len >= num
+            && strength <= cache->strength
+            && cache->fork_id == fork_id
+            && cache->generation == generation
+            && now >= cache->filled
+            && now - cache->filled < cache->interval)
+        goto serve;
+
+    /* This also sets up the thread state that frees the buffer */
+    rand = RAND_get0_public(ctx);
+    if (rand == NULL)
+        return 0;
+
+    /*
+     * Only buffer the output of the standard DRBGs, test and hardware
+     * random sources are expected to see every request as it is made.
+     * The source is checked on every refill because RAND_set0_public() can
+     * replace it at any time.
+     */
+    if (!rand_public_cacheable(rand, &interval)) {
+        if (cache != NULL) {
+            OPENSSL_cleanse(cache->buf, cache->len);
+            cache->len = 0;
+        }
+        goto direct;
+    }
+
+    if (cache == NULL) {
+        cache = OPENSSL_zalloc(sizeof(*cache));
+        if (cache == NULL
+                || !CRYPTO_THREAD_set_local(&dgbl->public_cache, cache)) {
+            OPENSSL_free(cache);
+            goto direct;
+        }
+    } else if (strength > cache->strength) {
+        /* Let the DRBG raise the error for requests it cannot satisfy */
+        goto direct;
+    }
+
+    OPENSSL_cleanse(cache->buf, cache->len);
+    cache->len = 0;
+    ERR_set_mark();
+    if (!EVP_RAND_generate(rand, cache->buf, sizeof(cache->buf), 0, 0,
+                           NULL, 0)) {
+        ERR_pop_to_mark();
+        goto direct;
+    }
+    ERR_clear_last_mark();
+    cache->len = sizeof(cache->buf);
+    cache->strength = EVP_RAND_get_strength(rand);
+    cache->fork_id = fork_id;
+    cache->generation = generation;
+    cache->filled = now;
+    cache->interval = interval;
+    if (strength > cache->strength)
+        goto direct;
+
+ serve:
+    cache->len -= num;
+    memcpy(buf, cache->buf + cache->len, num);
+    OPENSSL_cleanse(cache->buf + cache->len, num);
+    return 1;
+
+ direct:
+    return EVP_RAND_generate(rand, buf, num, strength, 0, NULL, 0);
+}
+
+/* Make all threads discard their buffered <public> DRBG output */
+static void rand_public_cache_flush(OSSL_LIB_CTX *ctx)
+{
+    RAND_GLOBAL *dgbl = rand_get_global(ctx);
+
+    if (dgbl != NULL)
+        tsan_counter(&dgbl->public_cache_generation);
+}
+#endif
+
 /*
  * Get the private random generator.
  * Returns pointer to its EVP_RAND_CTX on success, NULL on failure.
@@ -824,8 +1019,13 @@ int RAND_set0_public(OSSL_LIB_CTX *ctx, EVP_RAND_CTX *rand)
     if (dgbl == NULL)
         return 0;
     old = CRYPTO_THREAD_get_local(&dgbl->public);
-    if ((r = CRYPTO_THREAD_set_local(&dgbl->public, rand)) > 0)
+    if ((r = CRYPTO_THREAD_set_local(&dgbl->public, rand)) > 0) {
         EVP_RAND_CTX_free(old);
+#ifndef FIPS_MODULE
+        /* Drop the output buffered from the old <public> DRBG */
+        rand_public_cache_flush(ctx);
+#endif
+    }
     return r;
 }
 
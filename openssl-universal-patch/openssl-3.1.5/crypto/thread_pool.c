@@ -0,0 +1,339 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <openssl/crypto.h>
+#include <openssl/thread.h>
+#include "internal/cryptlib.h"
+#include "internal/thread.h"
+
+#if defined(OPENSSL_THREADS) && !defined(CRYPTO_TDEBUG) \
+    && !defined(OPENSSL_SYS_WINDOWS)
+
+# include <pthread.h>
+
+/*-
+ * A per library context pool of worker threads.
+ *
+ * Workers are created on demand, up to the configured maximum, when a task
+ * is queued and no worker is idle.  They then stay around waiting for more
+ * work until the maximum is lowered or the library context is freed, at
+ * which point every worker is told to finish its current task and is
+ * joined.  Each worker remembers the pool generation it was created in and
+ * exits as soon as that changes, which is how a stop reaches the workers
+ * without racing against the creation of new ones.
+ */
+
+# define TASK_QUEUED    0
+# define TASK_RUNNING   1
+# define TASK_DONE      2
+
+typedef struct thread_pool_st THREAD_POOL;
+
+typedef struct thread_task_st {
+    CRYPTO_THREAD_ROUTINE routine;
+    void *data;
+    CRYPTO_THREAD_RETVAL retval;
+    int state;
+    THREAD_POOL *pool;
+    struct thread_task_st *next;
+} THREAD_TASK;
+
+typedef struct {
+    pthread_t thread;
+    THREAD_POOL *pool;
+    uint64_t generation;
+} THREAD_WORKER;
+
+struct thread_pool_st {
+    pthread_mutex_t lock;
+    pthread_cond_t work;            /* Signalled when a task is queued */
+    pthread_cond_t done;            /* Broadcast when a task completes */
+    uint64_t max_threads;
+    uint64_t generation;
+    THREAD_WORKER **workers;
+    size_t nworkers, idle, queued;
+    THREAD_TASK *head, *tail;
+};
+
+static void *worker_main(void *arg)
+{
+    THREAD_WORKER *w = arg;
+    THREAD_POOL *pool = w->pool;
+    THREAD_TASK *t;
+
+    pthread_mutex_lock(&pool->lock);
+    while (w->generation == pool->generation) {
+        if ((t = pool->head) == NULL) {
+            pool->idle++;
+            pthread_cond_wait(&pool->work, &pool->lock);
+            pool->idle--;
+            continue;
+        }
+        if ((pool->head = t->next) == NULL)
+            pool->tail = NULL;
+        pool->queued--;
+        t->state = TASK_RUNNING;
+        pthread_mutex_unlock(&pool->lock);
+
+        t->retval = t->routine(t->data);
+
+        pthread_mutex_lock(&pool->lock);
+        t->state = TASK_DONE;
+        pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/* Must be called with the pool locked */
+static int pool_spawn(THREAD_POOL *pool)
+{
+    THREAD_WORKER *w, **tmp;
+
+    tmp = OPENSSL_realloc(pool->workers,
+                          (pool->nworkers + 1) * sizeof(*pool->workers));
+    if (tmp == NULL)
+        return 0;
+    pool->workers = tmp;
+    if ((w = OPENSSL_malloc(sizeof(*w))) == NULL)
+        return 0;
+    w->pool = pool;
+    w->generation = pool->generation;
+    if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+        OPENSSL_free(w);
+        return 0;
+    }
+    pool->workers[pool->nworkers++] = w;
+    return 1;
+}
+
+/* Tell all current workers to exit and wait for them */
+static void pool_stop(THREAD_POOL *pool)
+{
+    THREAD_WORKER **workers;
+    size_t i, n;
+
+    pthread_mutex_lock(&pool->lock);
+    workers = pool->workers;
+    n = pool->nworkers;
+    pool->workers = NULL;
+    pool->nworkers = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < n; i++) {
+        pthread_join(workers[i]->thread, NULL);
+        OPENSSL_free(workers[i]);
+    }
+    OPENSSL_free(workers);
+}
+
+void *ossl_threads_ctx_new(OSSL_LIB_CTX *ctx)
+{
+    THREAD_POOL *pool = OPENSSL_zalloc(sizeof(*pool));
+
+    if (pool == NULL)
+        return NULL;
+    if (pthread_mutex_init(&pool->lock, NULL) != 0)
+        goto err;
+    if (pthread_cond_init(&pool->work, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        goto err;
+    }
+    if (pthread_cond_init(&pool->done, NULL) != 0) {
+        pthread_cond_destroy(&pool->work);
+        pthread_mutex_destroy(&pool->lock);
+        goto err;
+    }
+    return pool;
+ err:
+    OPENSSL_free(pool);
+    return NULL;
+}
+
+void ossl_threads_ctx_free(void *vdata)
+{
+    THREAD_POOL *pool = vdata;
+
+    if (pool == NULL)
+        return;
+    pool_stop(pool);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    OPENSSL_free(pool);
+}
+
+void *ossl_crypto_thread_start(OSSL_LIB_CTX *ctx, CRYPTO_THREAD_ROUTINE routine,
+                               void *data)
+{
+    THREAD_POOL *pool = ossl_lib_ctx_get_data(ctx, OSSL_LIB_CTX_THREAD_INDEX);
+    THREAD_TASK *t;
+
+    if (pool == NULL || (t = OPENSSL_zalloc(sizeof(*t))) == NULL)
+        return NULL;
+    t->routine = routine;
+    t->data = data;
+    t->pool = pool;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->max_threads == 0) {
+        pthread_mutex_unlock(&pool->lock);
+        OPENSSL_free(t);
+        return NULL;
+    }
+    /*
+     * A failure to add a worker is not fatal: the task stays queued and the
+     * thread that joins it will run it.
+     */
+    if (pool->queued >= pool->idle && pool->nworkers < pool->max_threads)
+        (void)pool_spawn(pool);
+    t->state = TASK_QUEUED;
+    if (pool->tail != NULL)
+        pool->tail->next = t;
+    else
+        pool->head = t;
+    pool->tail = t;
+    pool->queued++;
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    return t;
+}
+
+int ossl_crypto_thread_join(void *task, CRYPTO_THREAD_RETVAL *retval)
+{
+    THREAD_TASK *t = task, **pt, *prev = NULL;
+    THREAD_POOL *pool;
+
+    if (t == NULL)
+        return 0;
+    pool = t->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    if (t->state == TASK_QUEUED) {
+        /* Nobody has picked it up, so take it back and run it here */
+        for (pt = &pool->head; *pt != t; pt = &(*pt)->next)
+            prev = *pt;
+        *pt = t->next;
+        if (pool->tail == t)
+            pool->tail = prev;
+        pool->queued--;
+        t->state = TASK_RUNNING;
+        pthread_mutex_unlock(&pool->lock);
+        t->retval = t->routine(t->data);
+    } else {
+        while (t->state != TASK_DONE)
+            pthread_cond_wait(&pool->done, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    if (retval != NULL)
+        *retval = t->retval;
+    OPENSSL_free(t);
+    return 1;
+}
+
+uint64_t ossl_get_avail_threads(OSSL_LIB_CTX *ctx)
+{
+    THREAD_POOL *pool = ossl_lib_ctx_get_data(ctx, OSSL_LIB_CTX_THREAD_INDEX);
+    uint64_t busy, avail = 0;
+
+    if (pool == NULL)
+        return 0;
+    pthread_mutex_lock(&pool->lock);
+    busy = pool->nworkers - pool->idle;
+    if (pool->max_threads > busy)
+        avail = pool->max_threads - busy;
+    pthread_mutex_unlock(&pool->lock);
+    return avail;
+}
+
+uint32_t OSSL_get_thread_support_flags(void)
+{
+    return OSSL_THREAD_SUPPORT_FLAG_THREAD_POOL;
+}
+
+int OSSL_set_max_threads(OSSL_LIB_CTX *ctx, uint64_t max_threads)
+{
+    THREAD_POOL *pool = ossl_lib_ctx_get_data(ctx, OSSL_LIB_CTX_THREAD_INDEX);
+    int shrink;
+
+    if (pool == NULL)
+        return 0;
+    pthread_mutex_lock(&pool->lock);
+    shrink = max_threads < pool->nworkers;
+    pool->max_threads = max_threads;
+    pthread_mutex_unlock(&pool->lock);
+
+    /* Surplus workers are not worth tracking individually: restart them all */
+    if (shrink)
+        pool_stop(pool);
+    return 1;
+}
+
+uint64_t OSSL_get_max_threads(OSSL_LIB_CTX *ctx)
+{
+    THREAD_POOL *pool = ossl_lib_ctx_get_data(ctx, OSSL_LIB_CTX_THREAD_INDEX);
+    uint64_t ret;
+
+    if (pool == NULL)
+        return 0;
+    pthread_mutex_lock(&pool->lock);
+    ret = pool->max_threads;
+    pthread_mutex_unlock(&pool->lock);
+    return ret;
+}
+
+#else
+
+/* Without threads there is no pool and all the work is done by the caller */
+
+void *ossl_threads_ctx_new(OSSL_LIB_CTX *ctx)
+{
+    return OPENSSL_zalloc(1);
+}
+
+void ossl_threads_ctx_free(void *vdata)
+{
+    OPENSSL_free(vdata);
+}
+
+void *ossl_crypto_thread_start(OSSL_LIB_CTX *ctx, CRYPTO_THREAD_ROUTINE routine,
+                               void *data)
+{
+    return NULL;
+}
+
+int ossl_crypto_thread_join(void *task, CRYPTO_THREAD_RETVAL *retval)
+{
+    return 0;
+}
+
+uint64_t ossl_get_avail_threads(OSSL_LIB_CTX *ctx)
+{
+    return 0;
+}
+
+uint32_t OSSL_get_thread_support_flags(void)
+{
+    return 0;
+}
+
+int OSSL_set_max_threads(OSSL_LIB_CTX *ctx, uint64_t max_threads)
+{
+    return max_threads == 0;
+}
+
+uint64_t OSSL_get_max_threads(OSSL_LIB_CTX *ctx)
+{
+    return 0;
+}
+
+#endif
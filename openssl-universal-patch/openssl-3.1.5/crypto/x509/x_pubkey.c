@@ -25,8 +25,11 @@
 #include <openssl/dsa.h>
 #include <openssl/decoder.h>
 #include <openssl/encoder.h>
+#include <openssl/core_names.h>
+#include <openssl/param_build.h>
 #include "internal/provider.h"
 #include "internal/sizes.h"
+#include "crypto/asn1_dsa.h"
 
 struct X509_pubkey_st {
     X509_ALGOR *algor;
@@ -38,11 +41,20 @@ struct X509_pubkey_st {
     OSSL_LIB_CTX *libctx;
     char *propq;
 
+    /*
+     * Protects |pkey| and |flag_decode_pending|, only present in objects
+     * that went through d2i
+     */
+    CRYPTO_RWLOCK *lock;
+
     /* Flag to force legacy keys */
     unsigned int flag_force_legacy : 1;
+    /* |pkey| hasn't been decoded from the d2i'ed data yet */
+    unsigned int flag_decode_pending : 1;
 };
 
 static int x509_pubkey_decode(EVP_PKEY **pk, const X509_PUBKEY *key);
+static EVP_PKEY *x509_pubkey_get0_pkey(const X509_PUBKEY *pubkey);
 
 static int x509_pubkey_set0_libctx(X509_PUBKEY *x, OSSL_LIB_CTX *libctx,
                                    const char *propq)
@@ -60,6 +72,11 @@ static int x509_pubkey_set0_libctx(X509_PUBKEY *x, OSSL_LIB_CTX *libctx,
     return 1;
 }
 
+static int x509_pubkey_set_lock(X509_PUBKEY *x)
+{
+    return x->lock != NULL || (x->lock = CRYPTO_THREAD_lock_new()) != NULL;
+}
+
 ASN1_SEQUENCE(X509_PUBKEY_INTERNAL) = {
         ASN1_SIMPLE(X509_PUBKEY, algor, X509_ALGOR),
         ASN1_SIMPLE(X509_PUBKEY, public_key, ASN1_BIT_STRING)
@@ -91,6 +108,7 @@ static void x509_pubkey_ex_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
         ASN1_BIT_STRING_free(pubkey->public_key);
         EVP_PKEY_free(pubkey->pkey);
         OPENSSL_free(pubkey->propq);
+        CRYPTO_THREAD_lock_free(pubkey->lock);
         OPENSSL_free(pubkey);
         *pval = NULL;
     }
@@ -125,22 +143,24 @@ static int x509_pubkey_ex_new_ex(ASN1_VALUE **pval, const ASN1_ITEM *it,
     return ret != NULL;
 }
 
+/*
+ * The key itself is only decoded when it's first asked for, see
+ * x509_pubkey_get0_pkey(), certificates often get parsed without their
+ * key ever being used.
+ */
 static int x509_pubkey_ex_d2i_ex(ASN1_VALUE **pval,
                                  const unsigned char **in, long len,
                                  const ASN1_ITEM *it, int tag, int aclass,
                                  char opt, ASN1_TLC *ctx, OSSL_LIB_CTX *libctx,
                                  const char *propq)
 {
-    const unsigned char *in_saved = *in;
-    size_t publen;
     X509_PUBKEY *pubkey;
     int ret;
-    OSSL_DECODER_CTX *dctx = NULL;
-    unsigned char *tmpbuf = NULL;
 
     if (*pval == NULL && !x509_pubkey_ex_new_ex(pval, it, libctx, propq))
         return 0;
-    if (!x509_pubkey_ex_populate(pval, NULL)) {
+    if (!x509_pubkey_ex_populate(pval, NULL)
+        || !x509_pubkey_set_lock((X509_PUBKEY *)*pval)) {
         ERR_raise(ERR_LIB_ASN1, ERR_R_MALLOC_FAILURE);
         return 0;
     }
@@ -151,88 +171,216 @@ static int x509_pubkey_ex_d2i_ex(ASN1_VALUE **pval,
                                 tag, aclass, opt, ctx)) <= 0)
         return ret;
 
-    publen = *in - in_saved;
-    if (!ossl_assert(publen > 0)) {
-        ERR_raise(ERR_LIB_ASN1, ERR_R_INTERNAL_ERROR);
-        return 0;
-    }
-
     pubkey = (X509_PUBKEY *)*pval;
     EVP_PKEY_free(pubkey->pkey);
     pubkey->pkey = NULL;
+    pubkey->flag_decode_pending = 1;
+    return 1;
+}
+
+#ifndef OPENSSL_NO_EC
+static const char *ec_point_format(const ASN1_BIT_STRING *pub)
+{
+    if (pub->length < 1)
+        return NULL;
+    switch (pub->data[0] & ~0x01) {
+    case 0x02:
+        return OSSL_PKEY_EC_POINT_CONVERSION_FORMAT_COMPRESSED;
+    case 0x04:
+        return OSSL_PKEY_EC_POINT_CONVERSION_FORMAT_UNCOMPRESSED;
+    case 0x06:
+        return OSSL_PKEY_EC_POINT_CONVERSION_FORMAT_HYBRID;
+    }
+    return NULL;
+}
+#endif
+
+/*
+ * Imports the common key types directly into their keymgmt, taking the key
+ * data from the SubjectPublicKeyInfo fields that are already parsed.  That
+ * skips setting up and running a decoder chain.
+ * Returns 1 on success and 0 if the key is of another type, has a form that
+ * is left to the decoders, or failed to import.  The caller falls back to
+ * the decoders in the latter case, which also gives the proper errors.
+ */
+static int x509_pubkey_import(EVP_PKEY **ppkey, const X509_PUBKEY *key)
+{
+    const char *keytype = NULL;
+    const ASN1_OBJECT *poid;
+    const void *pval;
+    const ASN1_BIT_STRING *pub = key->public_key;
+    OSSL_PARAM_BLD *bld = NULL;
+    OSSL_PARAM *params = NULL;
+    EVP_PKEY_CTX *pctx = NULL;
+    BIGNUM *n = NULL, *e = NULL;
+    int ptype, ret = 0;
+
+    X509_ALGOR_get0(&poid, &ptype, &pval, key->algor);
+    if ((bld = OSSL_PARAM_BLD_new()) == NULL)
+        return 0;
+
+    switch (OBJ_obj2nid(poid)) {
+    case NID_rsaEncryption: {
+        PACKET pkt, seq;
+        unsigned int id;
+
+        /* RSAPublicKey ::= SEQUENCE { modulus INTEGER, exponent INTEGER } */
+        keytype = "RSA";
+        if (!PACKET_buf_init(&pkt, pub->data, pub->length)
+            || !PACKET_get_1(&pkt, &id)
+            || id != (V_ASN1_CONSTRUCTED | V_ASN1_SEQUENCE)
+            || !ossl_decode_der_length(&pkt, &seq)
+            || PACKET_remaining(&pkt) != 0
+            || (n = BN_new()) == NULL
+            || (e = BN_new()) == NULL
+            || !ossl_decode_der_integer(&seq, n)
+            || !ossl_decode_der_integer(&seq, e)
+            || PACKET_remaining(&seq) != 0
+            || !OSSL_PARAM_BLD_push_BN(bld, OSSL_PKEY_PARAM_RSA_N, n)
+            || !OSSL_PARAM_BLD_push_BN(bld, OSSL_PKEY_PARAM_RSA_E, e))
+            goto end;
+        break;
+    }
+#ifndef OPENSSL_NO_EC
+    case NID_X9_62_id_ecPublicKey: {
+        const char *curve, *format;
+        int curve_nid;
+
+        /* Explicit parameters are left to the decoders */
+        keytype = "EC";
+        if (ptype != V_ASN1_OBJECT)
+            goto end;
+        /* The decoders turn keys on the SM2 curve into SM2 keys */
+        curve_nid = OBJ_obj2nid(pval);
+        if (curve_nid == NID_sm2
+            || (curve = OSSL_EC_curve_nid2name(curve_nid)) == NULL
+            || (format = ec_point_format(pub)) == NULL
+            || !OSSL_PARAM_BLD_push_utf8_string(bld,
+                                                OSSL_PKEY_PARAM_GROUP_NAME,
+                                                curve, 0)
+            || !OSSL_PARAM_BLD_push_utf8_string(bld,
+                                 OSSL_PKEY_PARAM_EC_POINT_CONVERSION_FORMAT,
+                                 format, 0)
+            || !OSSL_PARAM_BLD_push_octet_string(bld, OSSL_PKEY_PARAM_PUB_KEY,
+                                                 pub->data, pub->length))
+            goto end;
+        break;
+    }
+    case NID_ED25519:
+        keytype = "ED25519";
+        goto ecx;
+    case NID_ED448:
+        keytype = "ED448";
+        goto ecx;
+    case NID_X25519:
+        keytype = "X25519";
+        goto ecx;
+    case NID_X448:
+        keytype = "X448";
+    ecx:
+        /* RFC 8410 forbids parameters */
+        if (ptype != V_ASN1_UNDEF
+            || !OSSL_PARAM_BLD_push_octet_string(bld, OSSL_PKEY_PARAM_PUB_KEY,
+                                                 pub->data, pub->length))
+            goto end;
+        break;
+#endif
+    default:
+        goto end;
+    }
+
+    if ((params = OSSL_PARAM_BLD_to_param(bld)) == NULL
+        || (pctx = EVP_PKEY_CTX_new_from_name(key->libctx, keytype,
+                                              key->propq)) == NULL
+        || EVP_PKEY_fromdata_init(pctx) <= 0
+        || EVP_PKEY_fromdata(pctx, ppkey, EVP_PKEY_PUBLIC_KEY, params) <= 0)
+        goto end;
+    ret = 1;
+ end:
+    EVP_PKEY_CTX_free(pctx);
+    OSSL_PARAM_free(params);
+    OSSL_PARAM_BLD_free(bld);
+    BN_free(n);
+    BN_free(e);
+    return ret;
+}
+
+/*
+ * Decodes |pubkey->pkey| from the algorithm and key data.  Failure isn't an
+ * error at this point, |pubkey->pkey| remains NULL and whoever asked for the
+ * key gets to report it.
+ */
+static void x509_pubkey_decode_deferred(X509_PUBKEY *pubkey)
+{
+    OSSL_DECODER_CTX *dctx = NULL;
+    unsigned char *der = NULL;
+    char txtoidname[OSSL_MAX_NAME_SIZE];
+    const unsigned char *p;
+    size_t slen;
+    int derlen;
 
-    /*
-     * Opportunistically decode the key but remove any non fatal errors
-     * from the queue. Subsequent explicit attempts to decode/use the key
-     * will return an appropriate error.
-     */
     ERR_set_mark();
 
     /*
      * Try to decode with legacy method first.  This ensures that engines
      * aren't overridden by providers.
      */
-    if ((ret = x509_pubkey_decode(&pubkey->pkey, pubkey)) == -1) {
-        /* -1 indicates a fatal error, like malloc failure */
-        ERR_clear_last_mark();
+    if (x509_pubkey_decode(&pubkey->pkey, pubkey) != 0
+        || pubkey->flag_force_legacy
+        || x509_pubkey_import(&pubkey->pkey, pubkey))
+        goto end;
+
+    /* Fall back to decoding it into an EVP_PKEY with OSSL_DECODER */
+    if (OBJ_obj2txt(txtoidname, sizeof(txtoidname),
+                    pubkey->algor->algorithm, 0) <= 0
+        || (derlen = ASN1_item_i2d((const ASN1_VALUE *)pubkey, &der,
+                                   ASN1_ITEM_rptr(X509_PUBKEY_INTERNAL))) <= 0)
         goto end;
+    p = der;
+    slen = (size_t)derlen;
+    dctx = OSSL_DECODER_CTX_new_for_pkey(&pubkey->pkey,
+                                         "DER", "SubjectPublicKeyInfo",
+                                         txtoidname, EVP_PKEY_PUBLIC_KEY,
+                                         pubkey->libctx, pubkey->propq);
+    /* If we successfully decoded then we *must* consume all the bytes */
+    if (dctx != NULL && OSSL_DECODER_from_data(dctx, &p, &slen) && slen != 0) {
+        EVP_PKEY_free(pubkey->pkey);
+        pubkey->pkey = NULL;
     }
+ end:
+    ERR_pop_to_mark();
+    OSSL_DECODER_CTX_free(dctx);
+    OPENSSL_free(der);
+}
 
-    /* Try to decode it into an EVP_PKEY with OSSL_DECODER */
-    if (ret <= 0 && !pubkey->flag_force_legacy) {
-        const unsigned char *p;
-        char txtoidname[OSSL_MAX_NAME_SIZE];
-        size_t slen = publen;
+/* Returns the key of |pubkey|, decoding it first if needed */
+static EVP_PKEY *x509_pubkey_get0_pkey(const X509_PUBKEY *pubkey)
+{
+    X509_PUBKEY *key = (X509_PUBKEY *)pubkey;
+    EVP_PKEY *pkey;
+    int pending;
 
-        /*
-        * The decoders don't know how to handle anything other than Universal
-        * class so we modify the data accordingly.
-        */
-        if (aclass != V_ASN1_UNIVERSAL) {
-            tmpbuf = OPENSSL_memdup(in_saved, publen);
-            if (tmpbuf == NULL) {
-                ERR_raise(ERR_LIB_ASN1, ERR_R_MALLOC_FAILURE);
-                return 0;
-            }
-            in_saved = tmpbuf;
-            *tmpbuf = V_ASN1_CONSTRUCTED | V_ASN1_SEQUENCE;
-        }
-        p = in_saved;
+    /* Only objects that went through d2i can have a decode pending */
+    if (key->lock == NULL)
+        return key->pkey;
 
-        if (OBJ_obj2txt(txtoidname, sizeof(txtoidname),
-                        pubkey->algor->algorithm, 0) <= 0) {
-            ERR_clear_last_mark();
-            goto end;
-        }
-        if ((dctx =
-             OSSL_DECODER_CTX_new_for_pkey(&pubkey->pkey,
-                                           "DER", "SubjectPublicKeyInfo",
-                                           txtoidname, EVP_PKEY_PUBLIC_KEY,
-                                           pubkey->libctx,
-                                           pubkey->propq)) != NULL)
-            /*
-             * As said higher up, we're being opportunistic.  In other words,
-             * we don't care if we fail.
-             */
-            if (OSSL_DECODER_from_data(dctx, &p, &slen)) {
-                if (slen != 0) {
-                    /*
-                     * If we successfully decoded then we *must* consume all the
-                     * bytes.
-                     */
-                    ERR_clear_last_mark();
-                    ERR_raise(ERR_LIB_ASN1, EVP_R_DECODE_ERROR);
-                    goto end;
-                }
-            }
-    }
+    if (!CRYPTO_THREAD_read_lock(key->lock))
+        return NULL;
+    pkey = key->pkey;
+    pending = key->flag_decode_pending;
+    CRYPTO_THREAD_unlock(key->lock);
+    if (!pending)
+        return pkey;
 
-    ERR_pop_to_mark();
-    ret = 1;
- end:
-    OSSL_DECODER_CTX_free(dctx);
-    OPENSSL_free(tmpbuf);
-    return ret;
+    if (!CRYPTO_THREAD_write_lock(key->lock))
+        return NULL;
+    if (key->flag_decode_pending) {
+        x509_pubkey_decode_deferred(key);
+        key->flag_decode_pending = 0;
+    }
+    pkey = key->pkey;
+    CRYPTO_THREAD_unlock(key->lock);
+    return pkey;
 }
 
 static int x509_pubkey_ex_i2d(const ASN1_VALUE **pval, unsigned char **out,
@@ -283,6 +431,7 @@ X509_PUBKEY *X509_PUBKEY_new_ex(OSSL_LIB_CTX *libctx, const char *propq)
 X509_PUBKEY *X509_PUBKEY_dup(const X509_PUBKEY *a)
 {
     X509_PUBKEY *pubkey = OPENSSL_zalloc(sizeof(*pubkey));
+    EVP_PKEY *apkey;
 
     if (pubkey == NULL
             || !x509_pubkey_set0_libctx(pubkey, a->libctx, a->propq)
@@ -297,9 +446,9 @@ X509_PUBKEY *X509_PUBKEY_dup(const X509_PUBKEY *a)
         return NULL;
     }
 
-    if (a->pkey != NULL) {
+    if ((apkey = x509_pubkey_get0_pkey(a)) != NULL) {
         ERR_set_mark();
-        pubkey->pkey = EVP_PKEY_dup(a->pkey);
+        pubkey->pkey = EVP_PKEY_dup(apkey);
         if (pubkey->pkey == NULL) {
             pubkey->flag_force_legacy = 1;
             if (x509_pubkey_decode(&pubkey->pkey, pubkey) <= 0) {
@@ -381,6 +530,7 @@ int X509_PUBKEY_set(X509_PUBKEY **x, EVP_PKEY *pkey)
         EVP_PKEY_free(pk->pkey);
 
     pk->pkey = pkey;
+    pk->flag_decode_pending = 0;
     return 1;
 
  error:
@@ -448,18 +598,20 @@ static int x509_pubkey_decode(EVP_PKEY **ppkey, const X509_PUBKEY *key)
 
 EVP_PKEY *X509_PUBKEY_get0(const X509_PUBKEY *key)
 {
+    EVP_PKEY *pkey;
+
     if (key == NULL) {
         ERR_raise(ERR_LIB_X509, ERR_R_PASSED_NULL_PARAMETER);
         return NULL;
     }
 
-    if (key->pkey == NULL) {
-        /* We failed to decode the key when we loaded it, or it was never set */
+    if ((pkey = x509_pubkey_get0_pkey(key)) == NULL) {
+        /* We failed to decode the key, or it was never set */
         ERR_raise(ERR_LIB_EVP, EVP_R_DECODE_ERROR);
         return NULL;
     }
 
-    return key->pkey;
+    return pkey;
 }
 
 EVP_PKEY *X509_PUBKEY_get(const X509_PUBKEY *key)
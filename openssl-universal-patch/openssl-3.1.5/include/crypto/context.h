@@ -24,6 +24,7 @@ void *ossl_rand_crng_ctx_new(OSSL_LIB_CTX *);
 int ossl_thread_register_fips(OSSL_LIB_CTX *);
 void *ossl_thread_event_ctx_new(OSSL_LIB_CTX *);
 void *ossl_fips_prov_ossl_ctx_new(OSSL_LIB_CTX *);
+void *ossl_decoder_cache_new(OSSL_LIB_CTX *);
 
 void ossl_provider_store_free(void *);
 void ossl_property_string_data_free(void *);
@@ -39,4 +40,5 @@ void ossl_self_test_set_callback_free(void *);
 void ossl_rand_crng_ctx_free(void *);
 void ossl_thread_event_ctx_free(void *);
 void ossl_fips_prov_ossl_ctx_free(void *);
+void ossl_decoder_cache_free(void *);
 void ossl_release_default_drbg_ctx(void);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -32,6 +32,8 @@ void ossl_ctx_thread_stop(OSSL_LIB_CTX *ctx);
 
 void ossl_trace_cleanup(void);
 void ossl_malloc_setup_failures(void);
+void ossl_malloc_profile_report(void);
+void ossl_malloc_pool_cleanup(void);
 
 int ossl_crypto_alloc_ex_data_intern(int class_index, void *obj,
                                      CRYPTO_EX_DATA *ad, int idx);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -11,10 +11,15 @@
 # define OSSL_CRYPTO_ERR_H
 # pragma once
 
+# include <openssl/types.h>
+
 int ossl_err_load_ERR_strings(void);
 int ossl_err_load_crypto_strings(void);
 void err_cleanup(void);
 int err_shelve_state(void **);
 void err_unshelve_state(void *);
+ERR_STATE *ossl_err_state_save_to_mark(void);
+void ossl_err_state_restore(const ERR_STATE *saved);
+void ossl_err_state_free(ERR_STATE *saved);
 
 #endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#ifndef OSSL_CRYPTO_HASHTABLE_H
+# define OSSL_CRYPTO_HASHTABLE_H
+# pragma once
+
+# include <openssl/e_os2.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/*
+ * An open addressing hash table for internal use.  It has the same
+ * semantics as LHASH (caller supplied hash and comparison functions, items
+ * are pointers owned by the caller) but keeps the items and their hashes
+ * inline in a single array, so there is no per item allocation.
+ *
+ * The table does no locking of its own.  Callbacks passed to the doall
+ * functions must not insert or delete items.
+ */
+
+# define HASHTABLE_OF(type) struct hashtable_st_ ## type
+
+# define DEFINE_HASHTABLE_OF_INTERNAL(type, ctype) \
+    HASHTABLE_OF(type); \
+    static ossl_unused ossl_inline HASHTABLE_OF(type) * \
+        ossl_ht_##type##_new(unsigned long (*hfn)(const type *), \
+                             int (*cfn)(const type *, const type *)) \
+    { \
+        return (HASHTABLE_OF(type) *) \
+            ossl_ht_new((OPENSSL_HT_HASHFUNC)hfn, (OPENSSL_HT_COMPFUNC)cfn); \
+    } \
+    static ossl_unused ossl_inline void \
+    ossl_ht_##type##_free(HASHTABLE_OF(type) *ht) \
+    { \
+        ossl_ht_free((OPENSSL_HT *)ht); \
+    } \
+    static ossl_unused ossl_inline size_t \
+    ossl_ht_##type##_num_items(const HASHTABLE_OF(type) *ht) \
+    { \
+        return ossl_ht_num_items((const OPENSSL_HT *)ht); \
+    } \
+    static ossl_unused ossl_inline int \
+    ossl_ht_##type##_error(const HASHTABLE_OF(type) *ht) \
+    { \
+        return ossl_ht_error((const OPENSSL_HT *)ht); \
+    } \
+    static ossl_unused ossl_inline ctype * \
+    ossl_ht_##type##_insert(HASHTABLE_OF(type) *ht, ctype *d) \
+    { \
+        return (type *)ossl_ht_insert((OPENSSL_HT *)ht, (void *)d); \
+    } \
+    static ossl_unused ossl_inline ctype * \
+    ossl_ht_##type##_retrieve(const HASHTABLE_OF(type) *ht, const type *d) \
+    { \
+        return (type *)ossl_ht_retrieve((const OPENSSL_HT *)ht, d); \
+    } \
+    static ossl_unused ossl_inline ctype * \
+    ossl_ht_##type##_delete(HASHTABLE_OF(type) *ht, const type *d) \
+    { \
+        return (type *)ossl_ht_delete((OPENSSL_HT *)ht, d); \
+    } \
+    static ossl_unused ossl_inline void \
+    ossl_ht_##type##_doall(const HASHTABLE_OF(type) *ht, \
+                           void (*fn)(ctype *)) \
+    { \
+        ossl_ht_doall((const OPENSSL_HT *)ht, (void (*)(void *))fn); \
+    } \
+    static ossl_unused ossl_inline void \
+    ossl_ht_##type##_doall_arg(const HASHTABLE_OF(type) *ht, \
+                               void (*fn)(ctype *, void *), void *arg) \
+    { \
+        ossl_ht_doall_arg((const OPENSSL_HT *)ht, \
+                          (void (*)(void *, void *))fn, arg); \
+    } \
+    HASHTABLE_OF(type)
+
+# define DEFINE_HASHTABLE_OF(type) \
+    DEFINE_HASHTABLE_OF_INTERNAL(type, type)
+# define DEFINE_HASHTABLE_OF_CONST(type) \
+    DEFINE_HASHTABLE_OF_INTERNAL(type, const type)
+
+typedef struct hashtable_st OPENSSL_HT;
+typedef unsigned long (*OPENSSL_HT_HASHFUNC)(const void *);
+typedef int (*OPENSSL_HT_COMPFUNC)(const void *, const void *);
+
+OPENSSL_HT *ossl_ht_new(OPENSSL_HT_HASHFUNC h, OPENSSL_HT_COMPFUNC c);
+void ossl_ht_free(OPENSSL_HT *ht);
+size_t ossl_ht_num_items(const OPENSSL_HT *ht);
+int ossl_ht_error(const OPENSSL_HT *ht);
+void *ossl_ht_insert(OPENSSL_HT *ht, void *data);
+void *ossl_ht_retrieve(const OPENSSL_HT *ht, const void *data);
+void *ossl_ht_delete(OPENSSL_HT *ht, const void *data);
+void ossl_ht_doall(const OPENSSL_HT *ht, void (*fn)(void *));
+void ossl_ht_doall_arg(const OPENSSL_HT *ht, void (*fn)(void *, void *),
+                       void *arg);
+
+# ifdef  __cplusplus
+}
+# endif
+#endif
@@ -10,3 +10,5 @@
 #include <openssl/comp.h>
 
 void ossl_comp_zlib_cleanup(void);
+void ossl_comp_brotli_cleanup(void);
+void ossl_comp_zstd_cleanup(void);
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#ifndef OSSL_INTERNAL_THREAD_H
+# define OSSL_INTERNAL_THREAD_H
+# pragma once
+
+# include <openssl/types.h>
+
+typedef uint32_t CRYPTO_THREAD_RETVAL;
+typedef CRYPTO_THREAD_RETVAL (*CRYPTO_THREAD_ROUTINE)(void *);
+
+void *ossl_threads_ctx_new(OSSL_LIB_CTX *ctx);
+void ossl_threads_ctx_free(void *vdata);
+
+/*
+ * Queue |routine| to run on a worker thread of the library context's pool.
+ * Returns NULL if the pool is disabled (see OSSL_set_max_threads()), in
+ * which case the caller should do the work itself.  Every task that was
+ * started must be passed to ossl_crypto_thread_join(), which frees it.
+ * A task that no worker has picked up yet is run by the joining thread.
+ */
+void *ossl_crypto_thread_start(OSSL_LIB_CTX *ctx, CRYPTO_THREAD_ROUTINE routine,
+                               void *data);
+int ossl_crypto_thread_join(void *task, CRYPTO_THREAD_RETVAL *retval);
+
+/* The number of worker threads not currently running a task */
+uint64_t ossl_get_avail_threads(OSSL_LIB_CTX *ctx);
+
+#endif /* OSSL_INTERNAL_THREAD_H */
@@ -40,6 +40,15 @@ int COMP_expand_block(COMP_CTX *ctx, unsigned char *out, int olen,
                       unsigned char *in, int ilen);
 
 COMP_METHOD *COMP_zlib(void);
+COMP_METHOD *COMP_zlib_oneshot(void);
+# ifndef OPENSSL_NO_BROTLI
+COMP_METHOD *COMP_brotli(void);
+COMP_METHOD *COMP_brotli_oneshot(void);
+# endif
+# ifndef OPENSSL_NO_ZSTD
+COMP_METHOD *COMP_zstd(void);
+COMP_METHOD *COMP_zstd_oneshot(void);
+# endif
 
 #ifndef OPENSSL_NO_DEPRECATED_1_1_0
 # define COMP_zlib_cleanup() while(0) continue
@@ -49,6 +58,17 @@ COMP_METHOD *COMP_zlib(void);
 #  ifdef ZLIB
 const BIO_METHOD *BIO_f_zlib(void);
 #  endif
+#  ifndef OPENSSL_NO_BROTLI
+const BIO_METHOD *BIO_f_brotli(void);
+#  endif
+#  ifndef OPENSSL_NO_ZSTD
+const BIO_METHOD *BIO_f_zstd(void);
+#  endif
+
+#  define BIO_set_comp_level(b, level) \
+        BIO_ctrl(b, BIO_C_SET_COMP_LEVEL, level, NULL)
+#  define BIO_set_comp_dictionary(b, dict, len) \
+        BIO_ctrl(b, BIO_C_SET_COMP_DICTIONARY, (long)(len), (void *)(dict))
 # endif
 
 
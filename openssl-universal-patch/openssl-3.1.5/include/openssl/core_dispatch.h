@@ -1,5 +1,5 @@
 /*
- * Copyright 2019-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2019-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -104,6 +104,21 @@ OSSL_CORE_MAKE_FUNC(int, core_obj_create,
                     (const OSSL_CORE_HANDLE *prov, const char *oid,
                      const char *sn, const char *ln))
 
+/* Functions to use the library context's worker thread pool */
+
+#define OSSL_FUNC_CORE_THREAD_POOL_START      13
+#define OSSL_FUNC_CORE_THREAD_POOL_JOIN       14
+#define OSSL_FUNC_CORE_THREAD_POOL_AVAIL      15
+
+OSSL_CORE_MAKE_FUNC(void *, core_thread_pool_start,
+                    (const OSSL_CORE_HANDLE *prov,
+                     uint32_t (*routine)(void *), void *data))
+OSSL_CORE_MAKE_FUNC(int, core_thread_pool_join,
+                    (const OSSL_CORE_HANDLE *prov, void *task,
+                     uint32_t *retval))
+OSSL_CORE_MAKE_FUNC(uint64_t, core_thread_pool_avail,
+                    (const OSSL_CORE_HANDLE *prov))
+
 /* Memory allocation, freeing, clearing. */
 #define OSSL_FUNC_CRYPTO_MALLOC               20
 OSSL_CORE_MAKE_FUNC(void *,
@@ -300,6 +315,8 @@ OSSL_CORE_MAKE_FUNC(int, provider_self_test, (void *provctx))
 # define OSSL_FUNC_DIGEST_GETTABLE_PARAMS           11
 # define OSSL_FUNC_DIGEST_SETTABLE_CTX_PARAMS       12
 # define OSSL_FUNC_DIGEST_GETTABLE_CTX_PARAMS       13
+/* 14 is reserved for the squeeze function of extendable output digests */
+# define OSSL_FUNC_DIGEST_COPYCTX                   15
 
 OSSL_CORE_MAKE_FUNC(void *, digest_newctx, (void *provctx))
 OSSL_CORE_MAKE_FUNC(int, digest_init, (void *dctx, const OSSL_PARAM params[]))
@@ -314,6 +331,7 @@ OSSL_CORE_MAKE_FUNC(int, digest_digest,
 
 OSSL_CORE_MAKE_FUNC(void, digest_freectx, (void *dctx))
 OSSL_CORE_MAKE_FUNC(void *, digest_dupctx, (void *dctx))
+OSSL_CORE_MAKE_FUNC(void, digest_copyctx, (void *outctx, void *inctx))
 
 OSSL_CORE_MAKE_FUNC(int, digest_get_params, (OSSL_PARAM params[]))
 OSSL_CORE_MAKE_FUNC(int, digest_set_ctx_params,
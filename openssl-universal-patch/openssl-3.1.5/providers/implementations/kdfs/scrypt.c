@@ -17,6 +17,7 @@
 #include <openssl/proverr.h>
 #include "crypto/evp.h"
 #include "internal/numbers.h"
+#include "internal/thread.h"
 #include "prov/implementations.h"
 #include "prov/provider_ctx.h"
 #include "prov/providercommon.h"
@@ -426,6 +427,28 @@ static void scryptROMix(unsigned char *B, uint64_t r, uint64_t N,
     }
 }
 
+/*
+ * The p blocks of B are independent, so they can be mixed in parallel.  Each
+ * lane has its own X, T and V work area and processes every |nlanes|-th
+ * block starting at |lane|.
+ */
+typedef struct {
+    unsigned char *B;
+    uint32_t *XTV;
+    uint64_t r, N, p, lane, nlanes;
+} SCRYPT_LANE;
+
+static CRYPTO_THREAD_RETVAL scrypt_lane(void *arg)
+{
+    SCRYPT_LANE *l = arg;
+    uint32_t *X = l->XTV, *T = X + 32 * l->r, *V = T + 32 * l->r;
+    uint64_t i;
+
+    for (i = l->lane; i < l->p; i += l->nlanes)
+        scryptROMix(l->B + 128 * l->r * i, l->r, l->N, X, T, V);
+    return 1;
+}
+
 #ifndef SIZE_MAX
 # define SIZE_MAX    ((size_t)-1)
 #endif
@@ -446,6 +469,9 @@ static void scryptROMix(unsigned char *B, uint64_t r, uint64_t N,
 
 #define SCRYPT_PR_MAX   ((1 << 30) - 1)
 
+/* Upper bound on the number of threads used for one derivation */
+#define SCRYPT_MAX_LANES        16
+
 static int scrypt_alg(const char *pass, size_t passlen,
                       const unsigned char *salt, size_t saltlen,
                       uint64_t N, uint64_t r, uint64_t p, uint64_t maxmem,
@@ -454,8 +480,9 @@ static int scrypt_alg(const char *pass, size_t passlen,
 {
     int rv = 0;
     unsigned char *B;
-    uint32_t *X, *V, *T;
-    uint64_t i, Blen, Vlen;
+    uint64_t i, Blen, Vlen, nlanes;
+    SCRYPT_LANE lanes[SCRYPT_MAX_LANES];
+    void *tasks[SCRYPT_MAX_LANES];
 
     /* Sanity check parameters */
     /* initial check, r,p must be non zero, N >= 2 and a power of 2 */
@@ -526,20 +553,48 @@ static int scrypt_alg(const char *pass, size_t passlen,
     if (key == NULL)
         return 1;
 
-    B = OPENSSL_malloc((size_t)(Blen + Vlen));
+    /*
+     * Use one lane per idle worker thread, plus the calling thread, as long
+     * as each extra lane's work area still fits within maxmem.
+     */
+    nlanes = 1;
+    if (p > 1) {
+        nlanes = ossl_get_avail_threads(libctx) + 1;
+        if (nlanes > (maxmem - Blen) / Vlen)
+            nlanes = (maxmem - Blen) / Vlen;
+        if (nlanes > p)
+            nlanes = p;
+        if (nlanes > SCRYPT_MAX_LANES)
+            nlanes = SCRYPT_MAX_LANES;
+    }
+
+    B = OPENSSL_malloc((size_t)(Blen + nlanes * Vlen));
     if (B == NULL) {
         ERR_raise(ERR_LIB_EVP, ERR_R_MALLOC_FAILURE);
         return 0;
     }
-    X = (uint32_t *)(B + Blen);
-    T = X + 32 * r;
-    V = T + 32 * r;
     if (ossl_pkcs5_pbkdf2_hmac_ex(pass, passlen, salt, saltlen, 1, sha256,
                                   (int)Blen, B, libctx, propq) == 0)
         goto err;
 
-    for (i = 0; i < p; i++)
-        scryptROMix(B + 128 * r * i, r, N, X, T, V);
+    for (i = 0; i < nlanes; i++) {
+        lanes[i].B = B;
+        lanes[i].XTV = (uint32_t *)(B + Blen + i * Vlen);
+        lanes[i].r = r;
+        lanes[i].N = N;
+        lanes[i].p = p;
+        lanes[i].lane = i;
+        lanes[i].nlanes = nlanes;
+    }
+    /* Lanes that cannot be handed to the pool are run by this thread */
+    for (i = 1; i < nlanes; i++)
+        if ((tasks[i] = ossl_crypto_thread_start(libctx, scrypt_lane,
+                                                 &lanes[i])) == NULL)
+            scrypt_lane(&lanes[i]);
+    scrypt_lane(&lanes[0]);
+    for (i = 1; i < nlanes; i++)
+        if (tasks[i] != NULL)
+            ossl_crypto_thread_join(tasks[i], NULL);
 
     if (ossl_pkcs5_pbkdf2_hmac_ex(pass, passlen, B, (int)Blen, 1, sha256,
                                   keylen, key, libctx, propq) == 0)
@@ -549,7 +604,7 @@ static int scrypt_alg(const char *pass, size_t passlen,
     if (rv == 0)
         ERR_raise(ERR_LIB_EVP, EVP_R_PBKDF2_ERROR);
 
-    OPENSSL_clear_free(B, (size_t)(Blen + Vlen));
+    OPENSSL_clear_free(B, (size_t)(Blen + nlanes * Vlen));
     return rv;
 }
 
@@ -262,23 +262,20 @@ __owur static int ctr_update(PROV_DRBG *drbg,
                              const unsigned char *nonce, size_t noncelen)
 {
     PROV_DRBG_CTR *ctr = (PROV_DRBG_CTR *)drbg->data;
+    static const unsigned char zeroes[48] = { 0 };
     int outlen = AES_BLOCK_SIZE;
-    unsigned char V_tmp[48], out[48];
-    unsigned char len;
+    unsigned char out[48];
+    int len = ctr->keylen == 16 ? 32 : 48;
 
-    /* correct key is already set up. */
-    memcpy(V_tmp, ctr->V, 16);
-    inc_128(ctr);
-    memcpy(V_tmp + 16, ctr->V, 16);
-    if (ctr->keylen == 16) {
-        len = 32;
-    } else {
-        inc_128(ctr);
-        memcpy(V_tmp + 32, ctr->V, 16);
-        len = 48;
-    }
-    if (!EVP_CipherUpdate(ctr->ctx_ecb, out, &outlen, V_tmp, len)
-            || outlen != len)
+    /*
+     * Encrypting V, V + 1 and V + 2 in ECB mode is the same as taking the
+     * CTR mode key stream starting at V, so use the CTR context which
+     * already holds the correct key.  This way the ECB context never needs
+     * to be keyed with K and only one key schedule is run per update.
+     */
+    if (!EVP_CipherInit_ex(ctr->ctx_ctr, NULL, NULL, NULL, ctr->V, -1)
+        || !EVP_CipherUpdate(ctr->ctx_ctr, out, &outlen, zeroes, len)
+        || outlen != len)
         return 0;
     memcpy(ctr->K, out, ctr->keylen);
     memcpy(ctr->V, out + ctr->keylen, 16);
@@ -296,8 +293,7 @@ __owur static int ctr_update(PROV_DRBG *drbg,
         ctr_XOR(ctr, in2, in2len);
     }
 
-    if (!EVP_CipherInit_ex(ctr->ctx_ecb, NULL, NULL, ctr->K, NULL, -1)
-        || !EVP_CipherInit_ex(ctr->ctx_ctr, NULL, NULL, ctr->K, NULL, -1))
+    if (!EVP_CipherInit_ex(ctr->ctx_ctr, NULL, NULL, ctr->K, NULL, -1))
         return 0;
     return 1;
 }
@@ -314,7 +310,7 @@ static int drbg_ctr_instantiate(PROV_DRBG *drbg,
 
     memset(ctr->K, 0, sizeof(ctr->K));
     memset(ctr->V, 0, sizeof(ctr->V));
-    if (!EVP_CipherInit_ex(ctr->ctx_ecb, NULL, NULL, ctr->K, NULL, -1))
+    if (!EVP_CipherInit_ex(ctr->ctx_ctr, NULL, NULL, ctr->K, NULL, -1))
         return 0;
 
     inc_128(ctr);
@@ -29,9 +29,9 @@
 
 void RECORD_LAYER_init(RECORD_LAYER *rl, SSL *s)
 {
+    /* The records of a newly allocated SSL are all zero already */
     rl->s = s;
     RECORD_LAYER_set_first_record(&s->rlayer);
-    SSL3_RECORD_clear(rl->rrec, SSL_MAX_PIPELINES);
 }
 
 void RECORD_LAYER_clear(RECORD_LAYER *rl)
@@ -359,6 +359,11 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, size_t len,
     size_t tmpwrit;
 
     s->rwstate = SSL_NOTHING;
+    if (s->hibernating && !ssl_end_hibernation(s)) {
+        /* SSLfatal() already called */
+        return -1;
+    }
+
     tot = s->rlayer.wnum;
     /*
      * ensure that if we end up with a smaller value of data to write out
@@ -1280,6 +1285,11 @@ int ssl3_read_bytes(SSL *s, int type, int *recvd_type, unsigned char *buf,
 
     rbuf = &s->rlayer.rbuf;
 
+    if (s->hibernating && !ssl_end_hibernation(s)) {
+        /* SSLfatal() already called */
+        return -1;
+    }
+
     if (!SSL3_BUFFER_is_initialised(rbuf)) {
         /* Not initialized yet */
         if (!ssl3_setup_read_buffer(s)) {
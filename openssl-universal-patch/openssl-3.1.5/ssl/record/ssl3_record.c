@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -52,9 +52,12 @@ void SSL3_RECORD_release(SSL3_RECORD *r, size_t num_recs)
 {
     size_t i;
 
+    /* Decompression buffers are rare, don't call free() for each record */
     for (i = 0; i < num_recs; i++) {
-        OPENSSL_free(r[i].comp);
-        r[i].comp = NULL;
+        if (r[i].comp != NULL) {
+            OPENSSL_free(r[i].comp);
+            r[i].comp = NULL;
+        }
     }
 }
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright 2005 Nokia. All rights reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
@@ -318,7 +318,7 @@ void ssl3_cleanup_key_block(SSL *s)
 
 int ssl3_init_finished_mac(SSL *s)
 {
-    BIO *buf = BIO_new(BIO_s_mem());
+    BUF_MEM *buf = BUF_MEM_new();
 
     if (buf == NULL) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
@@ -326,7 +326,6 @@ int ssl3_init_finished_mac(SSL *s)
     }
     ssl3_free_digest_list(s);
     s->s3.handshake_buffer = buf;
-    (void)BIO_set_close(s->s3.handshake_buffer, BIO_CLOSE);
     return 1;
 }
 
@@ -337,27 +336,36 @@ int ssl3_init_finished_mac(SSL *s)
 
 void ssl3_free_digest_list(SSL *s)
 {
-    BIO_free(s->s3.handshake_buffer);
+    BUF_MEM_free(s->s3.handshake_buffer);
     s->s3.handshake_buffer = NULL;
     EVP_MD_CTX_free(s->s3.handshake_dgst);
     s->s3.handshake_dgst = NULL;
+    EVP_MD_CTX_free(s->s3.handshake_snapshot);
+    s->s3.handshake_snapshot = NULL;
 }
 
 int ssl3_finish_mac(SSL *s, const unsigned char *buf, size_t len)
 {
+    BUF_MEM *hbuf = s->s3.handshake_buffer;
+    size_t oldlen;
     int ret;
 
     if (s->s3.handshake_dgst == NULL) {
-        /* Note: this writes to a memory BIO so a failure is a fatal error */
+        /* Note: this writes to a memory buffer so a failure is a fatal error */
+        if (hbuf == NULL) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return 0;
+        }
         if (len > INT_MAX) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, SSL_R_OVERFLOW_ERROR);
             return 0;
         }
-        ret = BIO_write(s->s3.handshake_buffer, (void *)buf, (int)len);
-        if (ret <= 0 || ret != (int)len) {
-            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        oldlen = hbuf->length;
+        if (BUF_MEM_grow(hbuf, oldlen + len) == 0) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
             return 0;
         }
+        memcpy(hbuf->data + oldlen, buf, len);
     } else {
         ret = EVP_DigestUpdate(s->s3.handshake_dgst, buf, len);
         if (!ret) {
@@ -371,12 +379,10 @@ int ssl3_finish_mac(SSL *s, const unsigned char *buf, size_t len)
 int ssl3_digest_cached_records(SSL *s, int keep)
 {
     const EVP_MD *md;
-    long hdatalen;
-    void *hdata;
 
     if (s->s3.handshake_dgst == NULL) {
-        hdatalen = BIO_get_mem_data(s->s3.handshake_buffer, &hdata);
-        if (hdatalen <= 0) {
+        if (s->s3.handshake_buffer == NULL
+                || s->s3.handshake_buffer->length == 0) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, SSL_R_BAD_HANDSHAKE_LENGTH);
             return 0;
         }
@@ -394,13 +400,15 @@ int ssl3_digest_cached_records(SSL *s, int keep)
             return 0;
         }
         if (!EVP_DigestInit_ex(s->s3.handshake_dgst, md, NULL)
-            || !EVP_DigestUpdate(s->s3.handshake_dgst, hdata, hdatalen)) {
+            || !EVP_DigestUpdate(s->s3.handshake_dgst,
+                                 s->s3.handshake_buffer->data,
+                                 s->s3.handshake_buffer->length)) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
             return 0;
         }
     }
     if (keep == 0) {
-        BIO_free(s->s3.handshake_buffer);
+        BUF_MEM_free(s->s3.handshake_buffer);
         s->s3.handshake_buffer = NULL;
     }
 
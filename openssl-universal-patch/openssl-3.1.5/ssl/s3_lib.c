@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2002, Oracle and/or its affiliates. All rights reserved
  * Copyright 2005 Nokia. All rights reserved.
  *
@@ -3419,10 +3419,40 @@ static char *srp_password_from_info_cb(SSL *s, void *arg)
 
 static int ssl3_set_req_cert_type(CERT *c, const unsigned char *p, size_t len);
 
+/*
+ * Whether the control modifies the CERT, which might be shared and then has
+ * to be unshared first.
+ */
+static int ssl3_ctrl_modifies_cert(int cmd, long larg)
+{
+    switch (cmd) {
+    case SSL_CTRL_SET_DH_AUTO:
+    case SSL_CTRL_CHAIN:
+    case SSL_CTRL_CHAIN_CERT:
+    case SSL_CTRL_SELECT_CURRENT_CERT:
+    case SSL_CTRL_SET_SIGALGS:
+    case SSL_CTRL_SET_SIGALGS_LIST:
+    case SSL_CTRL_SET_CLIENT_SIGALGS:
+    case SSL_CTRL_SET_CLIENT_SIGALGS_LIST:
+    case SSL_CTRL_SET_CLIENT_CERT_TYPES:
+    case SSL_CTRL_BUILD_CERT_CHAIN:
+    case SSL_CTRL_SET_VERIFY_CERT_STORE:
+    case SSL_CTRL_SET_CHAIN_CERT_STORE:
+        return 1;
+    case SSL_CTRL_SET_CURRENT_CERT:
+        /* SSL_CERT_SET_SERVER is handled by ssl_cert_set_current_tmp() */
+        return larg != SSL_CERT_SET_SERVER;
+    }
+    return 0;
+}
+
 long ssl3_ctrl(SSL *s, int cmd, long larg, void *parg)
 {
     int ret = 0;
 
+    if (ssl3_ctrl_modifies_cert(cmd, larg) && !ssl_cert_unshare(&s->cert))
+        return 0;
+
     switch (cmd) {
     case SSL_CTRL_GET_CLIENT_CERT_REQUEST:
         break;
@@ -3596,8 +3626,7 @@ long ssl3_ctrl(SSL *s, int cmd, long larg, void *parg)
                 return 2;
             if (s->s3.tmp.cert == NULL)
                 return 0;
-            s->cert->key = s->s3.tmp.cert;
-            return 1;
+            return ssl_cert_set_current_tmp(s);
         }
         return ssl_cert_set_current(s->cert, larg);
 
@@ -3749,6 +3778,8 @@ long ssl3_callback_ctrl(SSL *s, int cmd, void (*fp) (void))
     switch (cmd) {
 #if !defined(OPENSSL_NO_DEPRECATED_3_0)
     case SSL_CTRL_SET_TMP_DH_CB:
+        if (!ssl_cert_unshare(&s->cert))
+            return 0;
         s->cert->dh_tmp_cb = (DH *(*)(SSL *, int, int))fp;
         ret = 1;
         break;
@@ -3771,6 +3802,9 @@ long ssl3_callback_ctrl(SSL *s, int cmd, void (*fp) (void))
 
 long ssl3_ctx_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
 {
+    if (ssl3_ctrl_modifies_cert(cmd, larg) && !ssl_cert_unshare(&ctx->cert))
+        return 0;
+
     switch (cmd) {
 #if !defined(OPENSSL_NO_DEPRECATED_3_0)
     case SSL_CTRL_SET_TMP_DH:
@@ -3819,37 +3853,18 @@ long ssl3_ctx_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
     case SSL_CTRL_GET_TLSEXT_TICKET_KEYS:
         {
             unsigned char *keys = parg;
-            long tick_keylen = (sizeof(ctx->ext.tick_key_name) +
-                                sizeof(ctx->ext.secure->tick_hmac_key) +
-                                sizeof(ctx->ext.secure->tick_aes_key));
+            long tick_keylen = TLSEXT_KEYNAME_LENGTH
+                               + sizeof(SSL_CTX_EXT_SECURE);
+
             if (keys == NULL)
                 return tick_keylen;
             if (larg != tick_keylen) {
                 ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_TICKET_KEYS_LENGTH);
                 return 0;
             }
-            if (cmd == SSL_CTRL_SET_TLSEXT_TICKET_KEYS) {
-                memcpy(ctx->ext.tick_key_name, keys,
-                       sizeof(ctx->ext.tick_key_name));
-                memcpy(ctx->ext.secure->tick_hmac_key,
-                       keys + sizeof(ctx->ext.tick_key_name),
-                       sizeof(ctx->ext.secure->tick_hmac_key));
-                memcpy(ctx->ext.secure->tick_aes_key,
-                       keys + sizeof(ctx->ext.tick_key_name) +
-                       sizeof(ctx->ext.secure->tick_hmac_key),
-                       sizeof(ctx->ext.secure->tick_aes_key));
-            } else {
-                memcpy(keys, ctx->ext.tick_key_name,
-                       sizeof(ctx->ext.tick_key_name));
-                memcpy(keys + sizeof(ctx->ext.tick_key_name),
-                       ctx->ext.secure->tick_hmac_key,
-                       sizeof(ctx->ext.secure->tick_hmac_key));
-                memcpy(keys + sizeof(ctx->ext.tick_key_name) +
-                       sizeof(ctx->ext.secure->tick_hmac_key),
-                       ctx->ext.secure->tick_aes_key,
-                       sizeof(ctx->ext.secure->tick_aes_key));
-            }
-            return 1;
+            if (cmd == SSL_CTRL_SET_TLSEXT_TICKET_KEYS)
+                return ssl_ctx_set_ticket_keys(ctx, keys);
+            return ssl_ctx_get_ticket_keys(ctx, keys);
         }
 
     case SSL_CTRL_GET_TLSEXT_STATUS_REQ_TYPE:
@@ -4007,6 +4022,8 @@ long ssl3_ctx_callback_ctrl(SSL_CTX *ctx, int cmd, void (*fp) (void))
 #if !defined(OPENSSL_NO_DEPRECATED_3_0)
     case SSL_CTRL_SET_TMP_DH_CB:
         {
+            if (!ssl_cert_unshare(&ctx->cert))
+                return 0;
             ctx->cert->dh_tmp_cb = (DH *(*)(SSL *, int, int))fp;
         }
         break;
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2002, Oracle and/or its affiliates. All rights reserved
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
@@ -85,7 +85,7 @@ CERT *ssl_cert_new(void)
 CERT *ssl_cert_dup(CERT *cert)
 {
     CERT *ret = OPENSSL_zalloc(sizeof(*ret));
-    int i;
+    int i, j;
 
     if (ret == NULL) {
         ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
@@ -141,6 +141,21 @@ CERT *ssl_cert_dup(CERT *cert)
             memcpy(ret->pkeys[i].serverinfo,
                    cert->pkeys[i].serverinfo, cert->pkeys[i].serverinfo_length);
         }
+        for (j = 0; j < TLSEXT_comp_cert_limit; j++) {
+            if (cpk->comp_cert[j] != NULL) {
+                if (!ossl_comp_cert_up_ref(cpk->comp_cert[j]))
+                    goto err;
+                rpk->comp_cert[j] = cpk->comp_cert[j];
+            }
+        }
+        if (cpk->msg_cache != NULL) {
+            int refs;
+
+            if (CRYPTO_UP_REF(&cpk->msg_cache->references, &refs,
+                              cpk->msg_cache->lock) <= 0)
+                goto err;
+            rpk->msg_cache = cpk->msg_cache;
+        }
     }
 
     /* Configured sigalgs copied across */
@@ -209,6 +224,27 @@ CERT *ssl_cert_dup(CERT *cert)
     return NULL;
 }
 
+/*
+ * An SSL shares the CERT of the SSL_CTX it was created from until one of
+ * them changes it.  This must be called before modifying anything in |*pc|:
+ * a shared CERT is replaced by a private copy, leaving the other holders
+ * unaffected.  A CERT with a single reference can't gain another one behind
+ * our back, as only its holder can hand it out.  Any pointer into the old
+ * CERT, such as to one of its CERT_PKEYs, has to be recomputed afterwards.
+ */
+int ssl_cert_unshare(CERT **pc)
+{
+    CERT *c = *pc;
+
+    if (c == NULL || c->references == 1)
+        return 1;
+    if ((c = ssl_cert_dup(c)) == NULL)
+        return 0;
+    ssl_cert_free(*pc);
+    *pc = c;
+    return 1;
+}
+
 /* Free up and clear all certificates and chains */
 
 void ssl_cert_clear_certs(CERT *c)
@@ -227,9 +263,54 @@ void ssl_cert_clear_certs(CERT *c)
         OPENSSL_free(cpk->serverinfo);
         cpk->serverinfo = NULL;
         cpk->serverinfo_length = 0;
+        ossl_comp_cert_clear(cpk);
+        ssl_cert_msg_cache_free(cpk->msg_cache);
+        cpk->msg_cache = NULL;
     }
 }
 
+void ssl_cert_msg_cache_free(SSL_CERT_MSG_CACHE *mc)
+{
+    int i;
+
+    if (mc == NULL)
+        return;
+
+    CRYPTO_DOWN_REF(&mc->references, &i, mc->lock);
+    REF_PRINT_COUNT("SSL_CERT_MSG_CACHE", mc);
+    if (i > 0)
+        return;
+    REF_ASSERT_ISNT(i < 0);
+
+    OPENSSL_free(mc->data[0]);
+    OPENSSL_free(mc->data[1]);
+    CRYPTO_THREAD_lock_free(mc->lock);
+    OPENSSL_free(mc);
+}
+
+/*
+ * Called whenever the certificate or chain of |cpk| changes: anything encoded
+ * from them is stale, and the CERTs duplicated from now on share a new cache.
+ * Running out of memory here only means we don't cache.
+ */
+void ssl_cert_pkey_changed(CERT_PKEY *cpk)
+{
+    SSL_CERT_MSG_CACHE *mc;
+
+    ossl_comp_cert_clear(cpk);
+    ssl_cert_msg_cache_free(cpk->msg_cache);
+    cpk->msg_cache = NULL;
+
+    if (cpk->x509 == NULL || (mc = OPENSSL_zalloc(sizeof(*mc))) == NULL)
+        return;
+    if ((mc->lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        OPENSSL_free(mc);
+        return;
+    }
+    mc->references = 1;
+    cpk->msg_cache = mc;
+}
+
 void ssl_cert_free(CERT *c)
 {
     int i;
@@ -276,6 +357,7 @@ int ssl_cert_set0_chain(SSL *s, SSL_CTX *ctx, STACK_OF(X509) *chain)
     }
     sk_X509_pop_free(cpk->chain, X509_free);
     cpk->chain = chain;
+    ssl_cert_pkey_changed(cpk);
     return 1;
 }
 
@@ -309,6 +391,7 @@ int ssl_cert_add0_chain_cert(SSL *s, SSL_CTX *ctx, X509 *x)
         cpk->chain = sk_X509_new_null();
     if (!cpk->chain || !sk_X509_push(cpk->chain, x))
         return 0;
+    ssl_cert_pkey_changed(cpk);
     return 1;
 }
 
@@ -366,6 +449,24 @@ int ssl_cert_set_current(CERT *c, long op)
     return 0;
 }
 
+/*
+ * Make the certificate picked for the handshake, s->s3.tmp.cert, the current
+ * one so that SSL_get_certificate() et al return it.  It usually is already,
+ * which saves unsharing the CERT.
+ */
+int ssl_cert_set_current_tmp(SSL *s)
+{
+    size_t idx = s->s3.tmp.cert - s->cert->pkeys;
+
+    if (s->cert->key == s->s3.tmp.cert)
+        return 1;
+    if (!ssl_cert_unshare(&s->cert))
+        return 0;
+    s->s3.tmp.cert = &s->cert->pkeys[idx];
+    s->cert->key = s->s3.tmp.cert;
+    return 1;
+}
+
 void ssl_cert_set_cert_cb(CERT *c, int (*cb) (SSL *ssl, void *arg), void *arg)
 {
     c->cert_cb = cb;
@@ -969,6 +1070,7 @@ int ssl_build_cert_chain(SSL *s, SSL_CTX *ctx, int flags)
     }
     sk_X509_pop_free(cpk->chain, X509_free);
     cpk->chain = chain;
+    ssl_cert_pkey_changed(cpk);
     if (rv == 0)
         rv = 1;
  err:
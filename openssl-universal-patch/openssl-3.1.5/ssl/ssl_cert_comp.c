@@ -0,0 +1,413 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * TLS Certificate Compression (RFC 8879): the algorithms we support, and the
+ * Certificate messages compressed ahead of time for each certificate.
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <openssl/comp.h>
+#include <openssl/objects.h>
+#include "ssl_local.h"
+#include "internal/nelem.h"
+#include "internal/packet.h"
+
+/* Returns the one-shot method for |alg|, or NULL if there's none */
+static COMP_METHOD *cert_comp_method(int alg)
+{
+#ifndef OPENSSL_NO_COMP
+    COMP_METHOD *method = NULL;
+
+    switch (alg) {
+    case TLSEXT_comp_cert_zlib:
+        method = COMP_zlib_oneshot();
+        break;
+# ifndef OPENSSL_NO_BROTLI
+    case TLSEXT_comp_cert_brotli:
+        method = COMP_brotli_oneshot();
+        break;
+# endif
+# ifndef OPENSSL_NO_ZSTD
+    case TLSEXT_comp_cert_zstd:
+        method = COMP_zstd_oneshot();
+        break;
+# endif
+    }
+    if (method != NULL && COMP_get_type(method) != NID_undef)
+        return method;
+#endif
+    return NULL;
+}
+
+int ossl_comp_has_alg(int alg)
+{
+    return cert_comp_method(alg) != NULL;
+}
+
+/* Fill |prefs| with the algorithms we support, best first */
+void ossl_comp_cert_default_prefs(int *prefs)
+{
+    static const int algs[] = {
+        TLSEXT_comp_cert_brotli, TLSEXT_comp_cert_zlib, TLSEXT_comp_cert_zstd
+    };
+    size_t i, j = 0;
+
+    memset(prefs, 0, sizeof(int) * TLSEXT_comp_cert_limit);
+    for (i = 0; i < OSSL_NELEM(algs); i++)
+        if (ossl_comp_has_alg(algs[i]))
+            prefs[j++] = algs[i];
+}
+
+static int set_prefs(int *prefs, int *algs, size_t len)
+{
+    int tmp[TLSEXT_comp_cert_limit] = { 0 };
+    size_t i, j, n = 0;
+
+    if (len > TLSEXT_comp_cert_limit - 1) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_COMPRESSION_ALGORITHM);
+        return 0;
+    }
+    for (i = 0; i < len; i++) {
+        if (algs[i] <= TLSEXT_comp_cert_none
+                || algs[i] >= TLSEXT_comp_cert_limit) {
+            ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_COMPRESSION_ALGORITHM);
+            return 0;
+        }
+        for (j = 0; j < i; j++) {
+            if (algs[j] == algs[i]) {
+                ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_COMPRESSION_ALGORITHM);
+                return 0;
+            }
+        }
+        /* Algorithms this build can't use are silently left out */
+        if (ossl_comp_has_alg(algs[i]))
+            tmp[n++] = algs[i];
+    }
+    memcpy(prefs, tmp, sizeof(tmp));
+    return 1;
+}
+
+int SSL_CTX_set1_cert_comp_preference(SSL_CTX *ctx, int *algs, size_t len)
+{
+    return set_prefs(ctx->cert_comp_prefs, algs, len);
+}
+
+int SSL_set1_cert_comp_preference(SSL *ssl, int *algs, size_t len)
+{
+    return set_prefs(ssl->cert_comp_prefs, algs, len);
+}
+
+/* Takes ownership of |data| on success */
+static OSSL_COMP_CERT *comp_cert_new(unsigned char *data, size_t len,
+                                     size_t orig_len, int alg)
+{
+    OSSL_COMP_CERT *ret = OPENSSL_zalloc(sizeof(*ret));
+
+    if (ret == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        return NULL;
+    }
+    ret->lock = CRYPTO_THREAD_lock_new();
+    if (ret->lock == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        OPENSSL_free(ret);
+        return NULL;
+    }
+    ret->references = 1;
+    ret->data = data;
+    ret->len = len;
+    ret->orig_len = orig_len;
+    ret->alg = alg;
+    return ret;
+}
+
+void ossl_comp_cert_free(OSSL_COMP_CERT *cc)
+{
+    int i;
+
+    if (cc == NULL)
+        return;
+
+    CRYPTO_DOWN_REF(&cc->references, &i, cc->lock);
+    REF_PRINT_COUNT("OSSL_COMP_CERT", cc);
+    if (i > 0)
+        return;
+    REF_ASSERT_ISNT(i < 0);
+
+    OPENSSL_free(cc->data);
+    CRYPTO_THREAD_lock_free(cc->lock);
+    OPENSSL_free(cc);
+}
+
+int ossl_comp_cert_up_ref(OSSL_COMP_CERT *cc)
+{
+    int i;
+
+    if (CRYPTO_UP_REF(&cc->references, &i, cc->lock) <= 0)
+        return 0;
+
+    REF_PRINT_COUNT("OSSL_COMP_CERT", cc);
+    REF_ASSERT_ISNT(i < 2);
+    return i > 1;
+}
+
+/* Forget the compressed Certificate messages of |cpk| */
+void ossl_comp_cert_clear(CERT_PKEY *cpk)
+{
+    int alg;
+
+    for (alg = 0; alg < TLSEXT_comp_cert_limit; alg++) {
+        ossl_comp_cert_free(cpk->comp_cert[alg]);
+        cpk->comp_cert[alg] = NULL;
+    }
+}
+
+OSSL_COMP_CERT *ossl_comp_cert_from_uncompressed_data(unsigned char *data,
+                                                      size_t len, int alg)
+{
+    OSSL_COMP_CERT *ret = NULL;
+#ifndef OPENSSL_NO_COMP
+    COMP_METHOD *method = cert_comp_method(alg);
+    COMP_CTX *comp_ctx = NULL;
+    unsigned char *comp_data = NULL;
+    size_t bound;
+    int comp_len;
+
+    if (method == NULL) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_COMPRESSION_ALGORITHM);
+        return NULL;
+    }
+    /* Enough for incompressible data with any of the algorithms */
+    if (len > INT_MAX / 2) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_EXCESSIVE_MESSAGE_SIZE);
+        return NULL;
+    }
+    bound = len + (len >> 8) + 64;
+
+    if ((comp_data = OPENSSL_malloc(bound)) == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    if ((comp_ctx = COMP_CTX_new(method)) == NULL) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_COMPRESSION_LIBRARY_ERROR);
+        goto err;
+    }
+    comp_len = COMP_compress_block(comp_ctx, comp_data, (int)bound, data,
+                                   (int)len);
+    if (comp_len <= 0) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_COMPRESSION_FAILURE);
+        goto err;
+    }
+    if ((ret = comp_cert_new(comp_data, comp_len, len, alg)) != NULL)
+        comp_data = NULL;
+ err:
+    COMP_CTX_free(comp_ctx);
+    OPENSSL_free(comp_data);
+#else
+    ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_COMPRESSION_ALGORITHM);
+#endif
+    return ret;
+}
+
+int ossl_comp_cert_expand(int alg, unsigned char *out, size_t outlen,
+                          unsigned char *in, size_t inlen)
+{
+    int ret = 0;
+#ifndef OPENSSL_NO_COMP
+    COMP_METHOD *method = cert_comp_method(alg);
+    COMP_CTX *comp_ctx;
+
+    if (method == NULL || outlen > INT_MAX || inlen > INT_MAX
+            || (comp_ctx = COMP_CTX_new(method)) == NULL)
+        return 0;
+    ret = COMP_expand_block(comp_ctx, out, (int)outlen, in, (int)inlen);
+    ret = ret > 0 && (size_t)ret == outlen;
+    COMP_CTX_free(comp_ctx);
+#endif
+    return ret;
+}
+
+/*
+ * Compress the Certificate message for |cpk|, as sent with an empty context
+ * and no per-certificate extensions, with |alg| or, if it is 0, with each of
+ * the algorithms in |s|'s preferences.  |s| provides the chain building
+ * settings.  Returns the number of messages compressed, or -1 on error.
+ */
+static int compress_one_cert(SSL *s, CERT_PKEY *cpk, int alg)
+{
+    BUF_MEM *buf = NULL;
+    WPACKET pkt;
+    OSSL_COMP_CERT *cc;
+    size_t len;
+    int *algs, one[2] = { 0, 0 };
+    int ret = -1, n = 0;
+
+    if (cpk->x509 == NULL)
+        return 0;
+
+    if ((buf = BUF_MEM_new()) == NULL || !WPACKET_init(&pkt, buf)) {
+        BUF_MEM_free(buf);
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        return -1;
+    }
+    if (!WPACKET_put_bytes_u8(&pkt, 0)
+            || !ssl3_output_cert_chain(s, &pkt, cpk, 1)
+            || !WPACKET_get_total_written(&pkt, &len)
+            || !WPACKET_finish(&pkt)) {
+        WPACKET_cleanup(&pkt);
+        ERR_raise(ERR_LIB_SSL, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+
+    if (alg != TLSEXT_comp_cert_none) {
+        one[0] = alg;
+        algs = one;
+    } else {
+        algs = s->cert_comp_prefs;
+    }
+    for (; *algs != TLSEXT_comp_cert_none; algs++) {
+        cc = ossl_comp_cert_from_uncompressed_data((unsigned char *)buf->data,
+                                                   len, *algs);
+        if (cc == NULL)
+            goto err;
+        ossl_comp_cert_free(cpk->comp_cert[*algs]);
+        cpk->comp_cert[*algs] = cc;
+        n++;
+    }
+    ret = n;
+ err:
+    BUF_MEM_free(buf);
+    return ret;
+}
+
+static int compress_certs(SSL *s, CERT *c, int alg)
+{
+    size_t i;
+    int n, count = 0;
+
+    if (alg != TLSEXT_comp_cert_none && !ossl_comp_has_alg(alg)) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_COMPRESSION_ALGORITHM);
+        return 0;
+    }
+    for (i = 0; i < SSL_PKEY_NUM; i++) {
+        if ((n = compress_one_cert(s, &c->pkeys[i], alg)) < 0)
+            return 0;
+        count += n;
+    }
+    return count > 0;
+}
+
+int SSL_CTX_compress_certs(SSL_CTX *ctx, int alg)
+{
+    SSL *s;
+    int ret;
+
+    if (!ssl_cert_unshare(&ctx->cert))
+        return 0;
+    /*
+     * The chain is built as any connection from |ctx| would build it.  That
+     * |s| shares the CERT being modified doesn't matter, it's thrown away.
+     */
+    if ((s = SSL_new(ctx)) == NULL)
+        return 0;
+    ret = compress_certs(s, ctx->cert, alg);
+    SSL_free(s);
+    return ret;
+}
+
+int SSL_compress_certs(SSL *ssl, int alg)
+{
+    if (!ssl_cert_unshare(&ssl->cert))
+        return 0;
+    return compress_certs(ssl, ssl->cert, alg);
+}
+
+static int set1_compressed_cert(CERT *c, int alg, unsigned char *comp_data,
+                                size_t comp_length, size_t orig_length)
+{
+    OSSL_COMP_CERT *cc;
+    unsigned char *data;
+
+    if (alg <= TLSEXT_comp_cert_none || alg >= TLSEXT_comp_cert_limit) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_COMPRESSION_ALGORITHM);
+        return 0;
+    }
+    if (c->key == NULL || c->key->x509 == NULL) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_NO_CERTIFICATE_ASSIGNED);
+        return 0;
+    }
+    if (comp_data == NULL || comp_length == 0 || orig_length == 0) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+    if ((data = OPENSSL_memdup(comp_data, comp_length)) == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    if ((cc = comp_cert_new(data, comp_length, orig_length, alg)) == NULL) {
+        OPENSSL_free(data);
+        return 0;
+    }
+    ossl_comp_cert_free(c->key->comp_cert[alg]);
+    c->key->comp_cert[alg] = cc;
+    return 1;
+}
+
+int SSL_CTX_set1_compressed_cert(SSL_CTX *ctx, int algorithm,
+                                 unsigned char *comp_data, size_t comp_length,
+                                 size_t orig_length)
+{
+    if (!ssl_cert_unshare(&ctx->cert))
+        return 0;
+    return set1_compressed_cert(ctx->cert, algorithm, comp_data, comp_length,
+                                orig_length);
+}
+
+int SSL_set1_compressed_cert(SSL *ssl, int algorithm, unsigned char *comp_data,
+                             size_t comp_length, size_t orig_length)
+{
+    if (!ssl_cert_unshare(&ssl->cert))
+        return 0;
+    return set1_compressed_cert(ssl->cert, algorithm, comp_data, comp_length,
+                                orig_length);
+}
+
+static size_t get1_compressed_cert(CERT *c, int alg, unsigned char **data,
+                                   size_t *orig_len)
+{
+    OSSL_COMP_CERT *cc;
+
+    if (alg <= TLSEXT_comp_cert_none || alg >= TLSEXT_comp_cert_limit
+            || c->key == NULL || (cc = c->key->comp_cert[alg]) == NULL)
+        return 0;
+
+    if (data != NULL) {
+        if ((*data = OPENSSL_memdup(cc->data, cc->len)) == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+    }
+    if (orig_len != NULL)
+        *orig_len = cc->orig_len;
+    return cc->len;
+}
+
+size_t SSL_CTX_get1_compressed_cert(SSL_CTX *ctx, int alg,
+                                    unsigned char **data, size_t *orig_len)
+{
+    return get1_compressed_cert(ctx->cert, alg, data, orig_len);
+}
+
+size_t SSL_get1_compressed_cert(SSL *ssl, int alg, unsigned char **data,
+                                size_t *orig_len)
+{
+    return get1_compressed_cert(ssl->cert, alg, data, orig_len);
+}
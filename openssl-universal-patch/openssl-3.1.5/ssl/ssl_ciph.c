@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2002, Oracle and/or its affiliates. All rights reserved
  * Copyright 2005 Nokia. All rights reserved.
  *
@@ -1000,7 +1000,8 @@ static int ssl_cipher_strength_sort(CIPHER_ORDER **head_p,
 static int ssl_cipher_process_rulestr(const char *rule_str,
                                       CIPHER_ORDER **head_p,
                                       CIPHER_ORDER **tail_p,
-                                      const SSL_CIPHER **ca_list, CERT *c)
+                                      const SSL_CIPHER **ca_list,
+                                      int *sec_level)
 {
     uint32_t alg_mkey, alg_auth, alg_enc, alg_mac, algo_strength;
     int min_tls;
@@ -1226,7 +1227,7 @@ static int ssl_cipher_process_rulestr(const char *rule_str,
                 if (level < 0 || level > 5) {
                     ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_COMMAND);
                 } else {
-                    c->sec_level = level;
+                    *sec_level = level;
                     ok = 1;
                 }
             } else {
@@ -1444,39 +1445,47 @@ int SSL_set_ciphersuites(SSL *s, const char *str)
     return ret;
 }
 
-STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
-                                             STACK_OF(SSL_CIPHER) *tls13_ciphersuites,
-                                             STACK_OF(SSL_CIPHER) **cipher_list,
-                                             STACK_OF(SSL_CIPHER) **cipher_list_by_id,
-                                             const char *rule_str,
-                                             CERT *c)
+/*
+ * What the result of parsing a cipher rule string depends on besides the
+ * string itself, used as the key of the parsed list cache together with the
+ * string.  It is hashed as a whole, so it has to be zeroed before use.
+ */
+typedef struct {
+    const SSL_CIPHER *(*get_cipher) (unsigned ncipher);
+    int dtls;
+    uint32_t disabled_mkey;
+    uint32_t disabled_auth;
+    uint32_t disabled_enc;
+    uint32_t disabled_mac;
+} CIPHER_RULE_CTX;
+
+/*
+ * Apply |rule_str| to the ciphers of |ssl_method| that are not disabled and
+ * store the selected ones in order of preference in |ciphers|, which has room
+ * for all of the method's ciphers.  Their number is returned in |*num|.  A
+ * @SECLEVEL command sets |*sec_level|.
+ */
+static int ssl_cipher_parse_rules(const SSL_METHOD *ssl_method,
+                                  const CIPHER_RULE_CTX *rctx,
+                                  const char *rule_str,
+                                  const SSL_CIPHER **ciphers, size_t *num,
+                                  int *sec_level)
 {
-    int ok, num_of_ciphers, num_of_alias_max, num_of_group_aliases, i;
+    int ok, num_of_ciphers, num_of_alias_max, num_of_group_aliases;
     uint32_t disabled_mkey, disabled_auth, disabled_enc, disabled_mac;
-    STACK_OF(SSL_CIPHER) *cipherstack;
     const char *rule_p;
     CIPHER_ORDER *co_list = NULL, *head = NULL, *tail = NULL, *curr;
     const SSL_CIPHER **ca_list = NULL;
-    const SSL_METHOD *ssl_method = ctx->method;
-
-    /*
-     * Return with error if nothing to do.
-     */
-    if (rule_str == NULL || cipher_list == NULL || cipher_list_by_id == NULL)
-        return NULL;
-
-    if (!check_suiteb_cipher_list(ssl_method, c, &rule_str))
-        return NULL;
 
     /*
      * To reduce the work to do we only want to process the compiled
      * in algorithms, so we first get the mask of disabled ciphers.
      */
 
-    disabled_mkey = ctx->disabled_mkey_mask;
-    disabled_auth = ctx->disabled_auth_mask;
-    disabled_enc = ctx->disabled_enc_mask;
-    disabled_mac = ctx->disabled_mac_mask;
+    disabled_mkey = rctx->disabled_mkey;
+    disabled_auth = rctx->disabled_auth;
+    disabled_enc = rctx->disabled_enc;
+    disabled_mac = rctx->disabled_mac;
 
     /*
      * Now we have to collect the available ciphers from the compiled
@@ -1488,7 +1497,7 @@ STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
     co_list = OPENSSL_malloc(sizeof(*co_list) * num_of_ciphers);
     if (co_list == NULL) {
         ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
-        return NULL;          /* Failure */
+        return 0;             /* Failure */
     }
 
     ssl_cipher_collect_ciphers(ssl_method, num_of_ciphers,
@@ -1555,7 +1564,7 @@ STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
      */
     if (!ssl_cipher_strength_sort(&head, &tail)) {
         OPENSSL_free(co_list);
-        return NULL;
+        return 0;
     }
 
     /*
@@ -1601,7 +1610,7 @@ STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
     if (ca_list == NULL) {
         OPENSSL_free(co_list);
         ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
-        return NULL;          /* Failure */
+        return 0;             /* Failure */
     }
     ssl_cipher_collect_aliases(ca_list, num_of_group_aliases,
                                disabled_mkey, disabled_auth, disabled_enc,
@@ -1615,28 +1624,96 @@ STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
     rule_p = rule_str;
     if (strncmp(rule_str, "DEFAULT", 7) == 0) {
         ok = ssl_cipher_process_rulestr(OSSL_default_cipher_list(),
-                                        &head, &tail, ca_list, c);
+                                        &head, &tail, ca_list, sec_level);
         rule_p += 7;
         if (*rule_p == ':')
             rule_p++;
     }
 
     if (ok && (rule_p[0] != '\0'))
-        ok = ssl_cipher_process_rulestr(rule_p, &head, &tail, ca_list, c);
+        ok = ssl_cipher_process_rulestr(rule_p, &head, &tail, ca_list,
+                                        sec_level);
 
     OPENSSL_free(ca_list);      /* Not needed anymore */
 
-    if (!ok) {                  /* Rule processing failure */
-        OPENSSL_free(co_list);
+    /* The cipher selection for the list is done. */
+    *num = 0;
+    if (ok) {
+        for (curr = head; curr != NULL; curr = curr->next)
+            if (curr->active)
+                ciphers[(*num)++] = curr->cipher;
+    }
+    OPENSSL_free(co_list);      /* Not needed any longer */
+    return ok;
+}
+
+STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
+                                             STACK_OF(SSL_CIPHER) *tls13_ciphersuites,
+                                             STACK_OF(SSL_CIPHER) **cipher_list,
+                                             STACK_OF(SSL_CIPHER) **cipher_list_by_id,
+                                             const char *rule_str,
+                                             CERT *c)
+{
+    int i, sec_level = -1;
+    size_t num, len;
+    CIPHER_RULE_CTX rctx;
+    STACK_OF(SSL_CIPHER) *cipherstack;
+    const SSL_CIPHER **ciphers;
+    const SSL_METHOD *ssl_method = ctx->method;
+
+    /*
+     * Return with error if nothing to do.
+     */
+    if (rule_str == NULL || cipher_list == NULL || cipher_list_by_id == NULL)
+        return NULL;
+
+    if (!check_suiteb_cipher_list(ssl_method, c, &rule_str))
+        return NULL;
+
+    memset(&rctx, 0, sizeof(rctx));
+    rctx.get_cipher = ssl_method->get_cipher;
+    rctx.dtls = (ssl_method->ssl3_enc->enc_flags & SSL_ENC_FLAG_DTLS) != 0;
+    rctx.disabled_mkey = ctx->disabled_mkey_mask;
+    rctx.disabled_auth = ctx->disabled_auth_mask;
+    rctx.disabled_enc = ctx->disabled_enc_mask;
+    rctx.disabled_mac = ctx->disabled_mac_mask;
+
+    len = sizeof(*ciphers) * ssl_method->num_ciphers();
+    if ((ciphers = OPENSSL_malloc(len)) == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_MALLOC_FAILURE);
         return NULL;
     }
 
+    /*
+     * Only strings that were parsed successfully are cached, along with the
+     * security level they set, if any.
+     */
+    if (ssl_list_cache_get(SSL_LIST_CACHE_CIPHERS, &rctx, sizeof(rctx),
+                           rule_str, ciphers, &len, &sec_level)) {
+        num = len / sizeof(*ciphers);
+        if (sec_level >= 0)
+            c->sec_level = sec_level;
+    } else {
+        i = ssl_cipher_parse_rules(ssl_method, &rctx, rule_str, ciphers, &num,
+                                   &sec_level);
+        if (sec_level >= 0)
+            c->sec_level = sec_level;
+        if (!i) {                /* Rule processing failure */
+            OPENSSL_free(ciphers);
+            return NULL;
+        }
+        ssl_list_cache_put(SSL_LIST_CACHE_CIPHERS, &rctx, sizeof(rctx),
+                           rule_str, ciphers, num * sizeof(*ciphers),
+                           sec_level);
+    }
+
     /*
      * Allocate new "cipherstack" for the result, return with error
      * if we cannot get one.
      */
-    if ((cipherstack = sk_SSL_CIPHER_new_null()) == NULL) {
-        OPENSSL_free(co_list);
+    i = sk_SSL_CIPHER_num(tls13_ciphersuites) + (int)num;
+    if ((cipherstack = sk_SSL_CIPHER_new_reserve(NULL, i)) == NULL) {
+        OPENSSL_free(ciphers);
         return NULL;
     }
 
@@ -1645,7 +1722,7 @@ STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
         const SSL_CIPHER *sslc = sk_SSL_CIPHER_value(tls13_ciphersuites, i);
 
         /* Don't include any TLSv1.3 ciphers that are disabled */
-        if ((sslc->algorithm_enc & disabled_enc) != 0
+        if ((sslc->algorithm_enc & rctx.disabled_enc) != 0
                 || (ssl_cipher_table_mac[sslc->algorithm2
                                          & SSL_HANDSHAKE_MAC_MASK].mask
                     & ctx->disabled_mac_mask) != 0) {
@@ -1655,7 +1732,7 @@ STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
         }
 
         if (!sk_SSL_CIPHER_push(cipherstack, sslc)) {
-            OPENSSL_free(co_list);
+            OPENSSL_free(ciphers);
             sk_SSL_CIPHER_free(cipherstack);
             return NULL;
         }
@@ -1665,22 +1742,20 @@ STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
         BIO_printf(trc_out, "cipher selection:\n");
     }
     /*
-     * The cipher selection for the list is done. The ciphers are added
-     * to the resulting precedence to the STACK_OF(SSL_CIPHER).
+     * The ciphers are added to the resulting precedence to the
+     * STACK_OF(SSL_CIPHER).
      */
-    for (curr = head; curr != NULL; curr = curr->next) {
-        if (curr->active) {
-            if (!sk_SSL_CIPHER_push(cipherstack, curr->cipher)) {
-                OPENSSL_free(co_list);
-                sk_SSL_CIPHER_free(cipherstack);
-                OSSL_TRACE_CANCEL(TLS_CIPHER);
-                return NULL;
-            }
-            if (trc_out != NULL)
-                BIO_printf(trc_out, "<%s>\n", curr->cipher->name);
+    for (i = 0; i < (int)num; i++) {
+        if (!sk_SSL_CIPHER_push(cipherstack, ciphers[i])) {
+            OPENSSL_free(ciphers);
+            sk_SSL_CIPHER_free(cipherstack);
+            OSSL_TRACE_CANCEL(TLS_CIPHER);
+            return NULL;
         }
+        if (trc_out != NULL)
+            BIO_printf(trc_out, "<%s>\n", ciphers[i]->name);
     }
-    OPENSSL_free(co_list);      /* Not needed any longer */
+    OPENSSL_free(ciphers);      /* Not needed any longer */
     OSSL_TRACE_END(TLS_CIPHER);
 
     if (!update_cipher_list_by_id(cipher_list_by_id, cipherstack)) {
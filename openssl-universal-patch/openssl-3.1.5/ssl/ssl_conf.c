@@ -1,5 +1,5 @@
 /*
- * Copyright 2012-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2012-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -87,8 +87,6 @@ struct ssl_conf_ctx_st {
     uint64_t *poptions;
     /* Certificate filenames for each type */
     char *cert_filename[SSL_PKEY_NUM];
-    /* Pointer to SSL or SSL_CTX cert_flags or NULL if none */
-    uint32_t *pcert_flags;
     /* Pointer to SSL or SSL_CTX verify_mode or NULL if none */
     uint32_t *pvfy_flags;
     /* Pointer to SSL or SSL_CTX min_version field or NULL if none */
@@ -107,6 +105,7 @@ static void ssl_set_option(SSL_CONF_CTX *cctx, unsigned int name_flags,
                            uint64_t option_value, int onoff)
 {
     uint32_t *pflags;
+    CERT **pcert;
 
     if (cctx->poptions == NULL)
         return;
@@ -115,7 +114,11 @@ static void ssl_set_option(SSL_CONF_CTX *cctx, unsigned int name_flags,
     switch (name_flags & SSL_TFLAG_TYPE_MASK) {
 
     case SSL_TFLAG_CERT:
-        pflags = cctx->pcert_flags;
+        /* The CERT may be shared, see ssl_cert_unshare() */
+        pcert = cctx->ctx != NULL ? &cctx->ctx->cert : &cctx->ssl->cert;
+        if (!ssl_cert_unshare(pcert))
+            return;
+        pflags = &(*pcert)->cert_flags;
         break;
 
     case SSL_TFLAG_VFY:
@@ -396,7 +399,11 @@ static int cmd_Options(SSL_CONF_CTX *cctx, const char *value)
         SSL_FLAG_TBL_INV("AntiReplay", SSL_OP_NO_ANTI_REPLAY),
         SSL_FLAG_TBL_INV("ExtendedMasterSecret", SSL_OP_NO_EXTENDED_MASTER_SECRET),
         SSL_FLAG_TBL_INV("CANames", SSL_OP_DISABLE_TLSEXT_CA_NAMES),
-        SSL_FLAG_TBL("KTLS", SSL_OP_ENABLE_KTLS)
+        SSL_FLAG_TBL("KTLS", SSL_OP_ENABLE_KTLS),
+        SSL_FLAG_TBL_INV("TxCertificateCompression",
+                         SSL_OP_NO_TX_CERTIFICATE_COMPRESSION),
+        SSL_FLAG_TBL_INV("RxCertificateCompression",
+                         SSL_OP_NO_RX_CERTIFICATE_COMPRESSION)
     };
     if (value == NULL)
         return -3;
@@ -473,26 +480,28 @@ static int do_store(SSL_CONF_CTX *cctx,
                     const char *CAfile, const char *CApath, const char *CAstore,
                     int verify_store)
 {
-    CERT *cert;
+    CERT **pcert;
     X509_STORE **st;
     SSL_CTX *ctx;
     OSSL_LIB_CTX *libctx = NULL;
     const char *propq = NULL;
 
     if (cctx->ctx != NULL) {
-        cert = cctx->ctx->cert;
+        pcert = &cctx->ctx->cert;
         ctx = cctx->ctx;
     } else if (cctx->ssl != NULL) {
-        cert = cctx->ssl->cert;
+        pcert = &cctx->ssl->cert;
         ctx = cctx->ssl->ctx;
     } else {
         return 1;
     }
+    if (!ssl_cert_unshare(pcert))
+        return 0;
     if (ctx != NULL) {
         libctx = ctx->libctx;
         propq = ctx->propq;
     }
-    st = verify_store ? &cert->verify_store : &cert->chain_store;
+    st = verify_store ? &(*pcert)->verify_store : &(*pcert)->chain_store;
     if (*st == NULL) {
         *st = X509_STORE_new();
         if (*st == NULL)
@@ -710,6 +719,8 @@ static const ssl_conf_cmd_tbl ssl_conf_cmds[] = {
     SSL_CONF_CMD_SWITCH("anti_replay", SSL_CONF_FLAG_SERVER),
     SSL_CONF_CMD_SWITCH("no_anti_replay", SSL_CONF_FLAG_SERVER),
     SSL_CONF_CMD_SWITCH("no_etm", 0),
+    SSL_CONF_CMD_SWITCH("no_tx_cert_comp", 0),
+    SSL_CONF_CMD_SWITCH("no_rx_cert_comp", 0),
     SSL_CONF_CMD_STRING(SignatureAlgorithms, "sigalgs", 0),
     SSL_CONF_CMD_STRING(ClientSignatureAlgorithms, "client_sigalgs", 0),
     SSL_CONF_CMD_STRING(Curves, "curves", 0),
@@ -801,6 +812,10 @@ static const ssl_switch_tbl ssl_cmd_switches[] = {
     {SSL_OP_NO_ANTI_REPLAY, 0},
     /* no Encrypt-then-Mac */
     {SSL_OP_NO_ENCRYPT_THEN_MAC, 0},
+    /* no_tx_cert_comp */
+    {SSL_OP_NO_TX_CERTIFICATE_COMPRESSION, 0},
+    /* no_rx_cert_comp */
+    {SSL_OP_NO_RX_CERTIFICATE_COMPRESSION, 0},
 };
 
 static int ssl_conf_cmd_skip_prefix(SSL_CONF_CTX *cctx, const char **pcmd)
@@ -1058,13 +1073,11 @@ void SSL_CONF_CTX_set_ssl(SSL_CONF_CTX *cctx, SSL *ssl)
         cctx->poptions = &ssl->options;
         cctx->min_version = &ssl->min_proto_version;
         cctx->max_version = &ssl->max_proto_version;
-        cctx->pcert_flags = &ssl->cert->cert_flags;
         cctx->pvfy_flags = &ssl->verify_mode;
     } else {
         cctx->poptions = NULL;
         cctx->min_version = NULL;
         cctx->max_version = NULL;
-        cctx->pcert_flags = NULL;
         cctx->pvfy_flags = NULL;
     }
 }
@@ -1077,13 +1090,11 @@ void SSL_CONF_CTX_set_ssl_ctx(SSL_CONF_CTX *cctx, SSL_CTX *ctx)
         cctx->poptions = &ctx->options;
         cctx->min_version = &ctx->min_proto_version;
         cctx->max_version = &ctx->max_proto_version;
-        cctx->pcert_flags = &ctx->cert->cert_flags;
         cctx->pvfy_flags = &ctx->verify_mode;
     } else {
         cctx->poptions = NULL;
         cctx->min_version = NULL;
         cctx->max_version = NULL;
-        cctx->pcert_flags = NULL;
         cctx->pvfy_flags = NULL;
     }
 }
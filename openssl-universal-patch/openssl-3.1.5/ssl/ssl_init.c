@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -35,6 +35,12 @@ DEFINE_RUN_ONCE_STATIC(ossl_init_ssl_base)
     SSL_COMP_get_compression_methods();
 #endif
     ssl_sort_cipher_list();
+    /*
+     * Without the parsed list cache every configuration string is just
+     * parsed again, so failing to set it up is not fatal either.
+     */
+    if (!ssl_list_cache_init())
+        OSSL_TRACE(INIT, "ossl_init_ssl_base: no parsed list cache\n");
     OSSL_TRACE(INIT,"ossl_init_ssl_base: SSL_add_ssl_module()\n");
     /*
      * We ignore an error return here. Not much we can do - but not that bad
@@ -80,6 +86,8 @@ static void ssl_library_stop(void)
                    "ssl_comp_free_compression_methods_int()\n");
         ssl_comp_free_compression_methods_int();
 #endif
+        OSSL_TRACE(INIT, "ssl_library_stop: ssl_list_cache_cleanup()\n");
+        ssl_list_cache_cleanup();
     }
 }
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2002, Oracle and/or its affiliates. All rights reserved
  * Copyright 2005 Nokia. All rights reserved.
  *
@@ -622,6 +622,7 @@ int SSL_clear(SSL *s)
     s->first_packet = 0;
 
     s->key_update = SSL_KEY_UPDATE_NONE;
+    s->hibernating = 0;
 
     EVP_MD_CTX_free(s->pha_dgst);
     s->pha_dgst = NULL;
@@ -688,6 +689,7 @@ int SSL_CTX_set_ssl_version(SSL_CTX *ctx, const SSL_METHOD *meth)
 SSL *SSL_new(SSL_CTX *ctx)
 {
     SSL *s;
+    int i;
 
     if (ctx == NULL) {
         ERR_raise(ERR_LIB_SSL, SSL_R_NULL_SSL_CTX);
@@ -723,23 +725,16 @@ SSL *SSL_new(SSL_CTX *ctx)
     s->num_tickets = ctx->num_tickets;
     s->pha_enabled = ctx->pha_enabled;
 
-    /* Shallow copy of the ciphersuites stack */
-    s->tls13_ciphersuites = sk_SSL_CIPHER_dup(ctx->tls13_ciphersuites);
-    if (s->tls13_ciphersuites == NULL)
-        goto err;
-
     /*
-     * Earlier library versions used to copy the pointer to the CERT, not
-     * its contents; only when setting new parameters for the per-SSL
-     * copy, ssl_cert_new would be called (and the direct reference to
-     * the per-SSL_CTX settings would be lost, but those still were
-     * indirectly accessed for various purposes, and for that reason they
-     * used to be known as s->ctx->default_cert). Now we don't look at the
-     * SSL_CTX's CERT after having duplicated it once.
+     * The CERT of the SSL_CTX is shared until either the SSL_CTX or this
+     * SSL changes it, at which point the writer gets a private copy (see
+     * ssl_cert_unshare()).  So changes made to the SSL_CTX's CERT after
+     * SSL_new() are still not seen here, but most connections never pay for
+     * duplicating it.
      */
-    s->cert = ssl_cert_dup(ctx->cert);
-    if (s->cert == NULL)
+    if (CRYPTO_UP_REF(&ctx->cert->references, &i, ctx->cert->lock) <= 0)
         goto err;
+    s->cert = ctx->cert;
 
     RECORD_LAYER_set_read_ahead(&s->rlayer, ctx->read_ahead);
     s->msg_callback = ctx->msg_callback;
@@ -834,6 +829,9 @@ SSL *SSL_new(SSL_CTX *ctx)
     s->allow_early_data_cb = ctx->allow_early_data_cb;
     s->allow_early_data_cb_data = ctx->allow_early_data_cb_data;
 
+    memcpy(s->cert_comp_prefs, ctx->cert_comp_prefs,
+           sizeof(s->cert_comp_prefs));
+
     if (!s->method->ssl_new(s))
         goto err;
 
@@ -1182,7 +1180,8 @@ X509_VERIFY_PARAM *SSL_get0_param(SSL *ssl)
 
 void SSL_certs_clear(SSL *s)
 {
-    ssl_cert_clear_certs(s->cert);
+    if (ssl_cert_unshare(&s->cert))
+        ssl_cert_clear_certs(s->cert);
 }
 
 void SSL_free(SSL *s)
@@ -2432,8 +2431,12 @@ long SSL_ctrl(SSL *s, int cmd, long larg, void *parg)
         s->rwstate = SSL_RETRY_VERIFY;
         return 1;
     case SSL_CTRL_CERT_FLAGS:
+        if (!ssl_cert_unshare(&s->cert))
+            return 0;
         return (s->cert->cert_flags |= larg);
     case SSL_CTRL_CLEAR_CERT_FLAGS:
+        if (!ssl_cert_unshare(&s->cert))
+            return 0;
         return (s->cert->cert_flags &= ~larg);
 
     case SSL_CTRL_GET_RAW_CIPHERLIST:
@@ -2598,8 +2601,12 @@ long SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
         ctx->max_pipelines = larg;
         return 1;
     case SSL_CTRL_CERT_FLAGS:
+        if (!ssl_cert_unshare(&ctx->cert))
+            return 0;
         return (ctx->cert->cert_flags |= larg);
     case SSL_CTRL_CLEAR_CERT_FLAGS:
+        if (!ssl_cert_unshare(&ctx->cert))
+            return 0;
         return (ctx->cert->cert_flags &= ~larg);
     case SSL_CTRL_SET_MIN_PROTO_VERSION:
         return ssl_check_allowed_versions(larg, ctx->max_proto_version)
@@ -2788,6 +2795,11 @@ int SSL_set_cipher_list(SSL *s, const char *str)
 {
     STACK_OF(SSL_CIPHER) *sk;
 
+    if (s->tls13_ciphersuites == NULL) {
+        s->tls13_ciphersuites = sk_SSL_CIPHER_dup(s->ctx->tls13_ciphersuites);
+        if (s->tls13_ciphersuites == NULL)
+            return 0;
+    }
     sk = ssl_create_cipher_list(s->ctx, s->tls13_ciphersuites,
                                 &s->cipher_list, &s->cipher_list_by_id, str,
                                 s->cert);
@@ -3273,6 +3285,7 @@ SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
     ret->session_timeout = meth->get_timeout();
     ret->max_cert_list = SSL_MAX_CERT_LIST_DEFAULT;
     ret->verify_mode = SSL_VERIFY_NONE;
+    ossl_comp_cert_default_prefs(ret->cert_comp_prefs);
     if ((ret->cert = ssl_cert_new()) == NULL)
         goto err;
 
@@ -3331,9 +3344,6 @@ SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
     if (!CRYPTO_new_ex_data(CRYPTO_EX_INDEX_SSL_CTX, ret, &ret->ex_data))
         goto err;
 
-    if ((ret->ext.secure = OPENSSL_secure_zalloc(sizeof(*ret->ext.secure))) == NULL)
-        goto err;
-
     /* No compression for DTLS */
     if (!(meth->ssl3_enc->enc_flags & SSL_ENC_FLAG_DTLS))
         ret->comp_methods = SSL_COMP_get_compression_methods();
@@ -3342,12 +3352,7 @@ SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
     ret->split_send_fragment = SSL3_RT_MAX_PLAIN_LENGTH;
 
     /* Setup RFC5077 ticket keys */
-    if ((RAND_bytes_ex(libctx, ret->ext.tick_key_name,
-                       sizeof(ret->ext.tick_key_name), 0) <= 0)
-        || (RAND_priv_bytes_ex(libctx, ret->ext.secure->tick_hmac_key,
-                               sizeof(ret->ext.secure->tick_hmac_key), 0) <= 0)
-        || (RAND_priv_bytes_ex(libctx, ret->ext.secure->tick_aes_key,
-                               sizeof(ret->ext.secure->tick_aes_key), 0) <= 0))
+    if (!ssl_ctx_ticket_keys_init(ret))
         ret->options |= SSL_OP_NO_TICKET;
 
     if (RAND_priv_bytes_ex(libctx, ret->ext.cookie_hmac_key,
@@ -3503,7 +3508,7 @@ void SSL_CTX_free(SSL_CTX *a)
     OPENSSL_free(a->ext.supportedgroups);
     OPENSSL_free(a->ext.supported_groups_default);
     OPENSSL_free(a->ext.alpn);
-    OPENSSL_secure_free(a->ext.secure);
+    ssl_ctx_ticket_keys_free(a);
 
     ssl_evp_md_free(a->md5);
     ssl_evp_md_free(a->sha1);
@@ -3593,12 +3598,14 @@ void SSL_CTX_set_verify_depth(SSL_CTX *ctx, int depth)
 
 void SSL_CTX_set_cert_cb(SSL_CTX *c, int (*cb) (SSL *ssl, void *arg), void *arg)
 {
-    ssl_cert_set_cert_cb(c->cert, cb, arg);
+    if (ssl_cert_unshare(&c->cert))
+        ssl_cert_set_cert_cb(c->cert, cb, arg);
 }
 
 void SSL_set_cert_cb(SSL *s, int (*cb) (SSL *ssl, void *arg), void *arg)
 {
-    ssl_cert_set_cert_cb(s->cert, cb, arg);
+    if (ssl_cert_unshare(&s->cert))
+        ssl_cert_set_cert_cb(s->cert, cb, arg);
 }
 
 void ssl_set_masks(SSL *s)
@@ -4129,6 +4136,8 @@ SSL *SSL_dup(SSL *s)
     SSL_set_verify(ret, SSL_get_verify_mode(s), SSL_get_verify_callback(s));
     SSL_set_verify_depth(ret, SSL_get_verify_depth(s));
     ret->generate_session_id = s->generate_session_id;
+    memcpy(ret->cert_comp_prefs, s->cert_comp_prefs,
+           sizeof(ret->cert_comp_prefs));
 
     SSL_set_info_callback(ret, SSL_get_info_callback(s));
 
@@ -4335,18 +4344,26 @@ SSL_CTX *SSL_get_SSL_CTX(const SSL *ssl)
 SSL_CTX *SSL_set_SSL_CTX(SSL *ssl, SSL_CTX *ctx)
 {
     CERT *new_cert;
+    int i;
+
     if (ssl->ctx == ctx)
         return ssl->ctx;
     if (ctx == NULL)
         ctx = ssl->session_ctx;
-    new_cert = ssl_cert_dup(ctx->cert);
-    if (new_cert == NULL) {
-        return NULL;
-    }
-
-    if (!custom_exts_copy_flags(&new_cert->custext, &ssl->cert->custext)) {
-        ssl_cert_free(new_cert);
-        return NULL;
+    if (ctx->cert->custext.meths_count == 0) {
+        /* No custom extension flags to carry over, so share the CERT */
+        if (CRYPTO_UP_REF(&ctx->cert->references, &i, ctx->cert->lock) <= 0)
+            return NULL;
+        new_cert = ctx->cert;
+    } else {
+        new_cert = ssl_cert_dup(ctx->cert);
+        if (new_cert == NULL)
+            return NULL;
+        if (!custom_exts_copy_flags(&new_cert->custext,
+                                    &ssl->cert->custext)) {
+            ssl_cert_free(new_cert);
+            return NULL;
+        }
     }
 
     ssl_cert_free(ssl->cert);
@@ -4588,6 +4605,8 @@ int SSL_CTX_use_psk_identity_hint(SSL_CTX *ctx, const char *identity_hint)
         ERR_raise(ERR_LIB_SSL, SSL_R_DATA_LENGTH_TOO_LONG);
         return 0;
     }
+    if (!ssl_cert_unshare(&ctx->cert))
+        return 0;
     OPENSSL_free(ctx->cert->psk_identity_hint);
     if (identity_hint != NULL) {
         ctx->cert->psk_identity_hint = OPENSSL_strdup(identity_hint);
@@ -4607,6 +4626,8 @@ int SSL_use_psk_identity_hint(SSL *s, const char *identity_hint)
         ERR_raise(ERR_LIB_SSL, SSL_R_DATA_LENGTH_TOO_LONG);
         return 0;
     }
+    if (!ssl_cert_unshare(&s->cert))
+        return 0;
     OPENSSL_free(s->cert->psk_identity_hint);
     if (identity_hint != NULL) {
         s->cert->psk_identity_hint = OPENSSL_strdup(identity_hint);
@@ -4822,38 +4843,39 @@ void ssl_clear_hash_ctx(EVP_MD_CTX **hash)
     *hash = NULL;
 }
 
-/* Retrieve handshake hashes */
+/*
+ * Retrieve handshake hashes.  The running digest is copied into a scratch
+ * context that is kept for the next call, so that after the first call this
+ * takes no allocations.
+ */
 int ssl_handshake_hash(SSL *s, unsigned char *out, size_t outlen,
                        size_t *hashlen)
 {
-    EVP_MD_CTX *ctx = NULL;
     EVP_MD_CTX *hdgst = s->s3.handshake_dgst;
     int hashleni = EVP_MD_CTX_get_size(hdgst);
-    int ret = 0;
 
     if (hashleni < 0 || (size_t)hashleni > outlen) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
-        goto err;
+        return 0;
     }
 
-    ctx = EVP_MD_CTX_new();
-    if (ctx == NULL) {
-        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
-        goto err;
+    if (s->s3.handshake_snapshot == NULL) {
+        s->s3.handshake_snapshot = EVP_MD_CTX_new();
+        if (s->s3.handshake_snapshot == NULL) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return 0;
+        }
     }
 
-    if (!EVP_MD_CTX_copy_ex(ctx, hdgst)
-        || EVP_DigestFinal_ex(ctx, out, NULL) <= 0) {
+    if (!EVP_MD_CTX_copy_ex(s->s3.handshake_snapshot, hdgst)
+        || EVP_DigestFinal_ex(s->s3.handshake_snapshot, out, NULL) <= 0) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
-        goto err;
+        return 0;
     }
 
     *hashlen = hashleni;
 
-    ret = 1;
- err:
-    EVP_MD_CTX_free(ctx);
-    return ret;
+    return 1;
 }
 
 int SSL_session_reused(const SSL *s)
@@ -4877,7 +4899,8 @@ void SSL_set_debug(SSL *s, int debug)
 
 void SSL_set_security_level(SSL *s, int level)
 {
-    s->cert->sec_level = level;
+    if (ssl_cert_unshare(&s->cert))
+        s->cert->sec_level = level;
 }
 
 int SSL_get_security_level(const SSL *s)
@@ -4890,7 +4913,8 @@ void SSL_set_security_callback(SSL *s,
                                           int op, int bits, int nid,
                                           void *other, void *ex))
 {
-    s->cert->sec_cb = cb;
+    if (ssl_cert_unshare(&s->cert))
+        s->cert->sec_cb = cb;
 }
 
 int (*SSL_get_security_callback(const SSL *s)) (const SSL *s,
@@ -4902,7 +4926,8 @@ int (*SSL_get_security_callback(const SSL *s)) (const SSL *s,
 
 void SSL_set0_security_ex_data(SSL *s, void *ex)
 {
-    s->cert->sec_ex = ex;
+    if (ssl_cert_unshare(&s->cert))
+        s->cert->sec_ex = ex;
 }
 
 void *SSL_get0_security_ex_data(const SSL *s)
@@ -4912,7 +4937,8 @@ void *SSL_get0_security_ex_data(const SSL *s)
 
 void SSL_CTX_set_security_level(SSL_CTX *ctx, int level)
 {
-    ctx->cert->sec_level = level;
+    if (ssl_cert_unshare(&ctx->cert))
+        ctx->cert->sec_level = level;
 }
 
 int SSL_CTX_get_security_level(const SSL_CTX *ctx)
@@ -4925,7 +4951,8 @@ void SSL_CTX_set_security_callback(SSL_CTX *ctx,
                                               int op, int bits, int nid,
                                               void *other, void *ex))
 {
-    ctx->cert->sec_cb = cb;
+    if (ssl_cert_unshare(&ctx->cert))
+        ctx->cert->sec_cb = cb;
 }
 
 int (*SSL_CTX_get_security_callback(const SSL_CTX *ctx)) (const SSL *s,
@@ -4939,7 +4966,8 @@ int (*SSL_CTX_get_security_callback(const SSL_CTX *ctx)) (const SSL *s,
 
 void SSL_CTX_set0_security_ex_data(SSL_CTX *ctx, void *ex)
 {
-    ctx->cert->sec_ex = ex;
+    if (ssl_cert_unshare(&ctx->cert))
+        ctx->cert->sec_ex = ex;
 }
 
 void *SSL_CTX_get0_security_ex_data(const SSL_CTX *ctx)
@@ -5501,6 +5529,77 @@ int SSL_alloc_buffers(SSL *ssl)
     return ssl3_setup_buffers(ssl);
 }
 
+int SSL_hibernate(SSL *s)
+{
+    if (s->hibernating)
+        return 1;
+
+    if (!SSL_IS_TLS13(s)) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_WRONG_SSL_VERSION);
+        return 0;
+    }
+    if (!SSL_is_init_finished(s)) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_STILL_IN_INIT);
+        return 0;
+    }
+
+    /* Like SSL_free_buffers(), only while nothing is buffered */
+    if (SSL_has_pending(s) || RECORD_LAYER_write_pending(&s->rlayer)
+            || s->s3.alert_dispatch)
+        return 0;
+
+    RECORD_LAYER_release(&s->rlayer);
+    BUF_MEM_free(s->init_buf);
+    s->init_buf = NULL;
+
+    /*
+     * The traffic secrets, ivs and sequence numbers stay in |s|, which is
+     * all that is needed to rebuild the cipher contexts later.
+     */
+    EVP_CIPHER_CTX_free(s->enc_read_ctx);
+    s->enc_read_ctx = NULL;
+    EVP_CIPHER_CTX_free(s->enc_write_ctx);
+    s->enc_write_ctx = NULL;
+
+    /* Leftovers of the key exchange */
+    EVP_PKEY_free(s->s3.tmp.pkey);
+    s->s3.tmp.pkey = NULL;
+    EVP_PKEY_free(s->s3.peer_tmp);
+    s->s3.peer_tmp = NULL;
+
+    /*
+     * The transcript and the signature algorithms are only needed again if
+     * post-handshake authentication may still happen.
+     */
+    if (s->post_handshake_auth == SSL_PHA_NONE) {
+        ssl3_free_digest_list(s);
+        OPENSSL_free(s->s3.tmp.peer_sigalgs);
+        s->s3.tmp.peer_sigalgs = NULL;
+        s->s3.tmp.peer_sigalgslen = 0;
+        OPENSSL_free(s->s3.tmp.peer_cert_sigalgs);
+        s->s3.tmp.peer_cert_sigalgs = NULL;
+        s->s3.tmp.peer_cert_sigalgslen = 0;
+        OPENSSL_free(s->shared_sigalgs);
+        s->shared_sigalgs = NULL;
+        s->shared_sigalgslen = 0;
+    }
+
+    s->hibernating = 1;
+    return 1;
+}
+
+/*
+ * Called by the record layer before a record is read or written on a
+ * connection that SSL_hibernate() was called on.
+ */
+int ssl_end_hibernation(SSL *s)
+{
+    if (!tls13_restore_cipher_state(s))
+        return 0;
+    s->hibernating = 0;
+    return 1;
+}
+
 void SSL_CTX_set_keylog_callback(SSL_CTX *ctx, SSL_CTX_keylog_cb_func cb)
 {
     ctx->keylog_callback = cb;
@@ -6040,6 +6139,8 @@ int SSL_set0_tmp_dh_pkey(SSL *s, EVP_PKEY *dhpkey)
         ERR_raise(ERR_LIB_SSL, SSL_R_DH_KEY_TOO_SMALL);
         return 0;
     }
+    if (!ssl_cert_unshare(&s->cert))
+        return 0;
     EVP_PKEY_free(s->cert->dh_tmp);
     s->cert->dh_tmp = dhpkey;
     return 1;
@@ -6052,6 +6153,8 @@ int SSL_CTX_set0_tmp_dh_pkey(SSL_CTX *ctx, EVP_PKEY *dhpkey)
         ERR_raise(ERR_LIB_SSL, SSL_R_DH_KEY_TOO_SMALL);
         return 0;
     }
+    if (!ssl_cert_unshare(&ctx->cert))
+        return 0;
     EVP_PKEY_free(ctx->cert->dh_tmp);
     ctx->cert->dh_tmp = dhpkey;
     return 1;
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * A process wide cache of parsed configuration strings: cipher lists, group
+ * lists and signature algorithm lists.  Parsing these again for every
+ * SSL_CTX or SSL that is configured the same way is wasted work, so the
+ * result of each successful parse is kept, keyed by the list type, the string
+ * and whatever else the result depends on (|param|).  Entries never change
+ * once added.  A lookup copies the result out under the read lock, so no
+ * reference to an entry ever leaves this file and the whole cache can simply
+ * be flushed once it is full.
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/lhash.h>
+#include "ssl_local.h"
+
+/* Flush the cache once it holds this many entries */
+#define SSL_LIST_CACHE_MAX  512
+
+typedef struct {
+    unsigned long hash;
+    int type;
+    int extra;
+    const unsigned char *param;
+    size_t paramlen;
+    const char *str;
+    size_t str_len;
+    const unsigned char *data;
+    size_t datalen;
+} SSL_LIST_CACHE_ENTRY;
+
+DEFINE_LHASH_OF_EX(SSL_LIST_CACHE_ENTRY);
+
+static CRYPTO_RWLOCK *list_cache_lock = NULL;
+static LHASH_OF(SSL_LIST_CACHE_ENTRY) *list_cache = NULL;
+
+/* 64-bit FNV-1a, continuing from |h| */
+uint64_t ssl_list_cache_hash(uint64_t h, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+
+    if (h == 0)
+        h = 0xcbf29ce484222325ULL;
+    while (len-- > 0) {
+        h ^= *p++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static unsigned long list_cache_entry_hash(const SSL_LIST_CACHE_ENTRY *a)
+{
+    return a->hash;
+}
+
+static int list_cache_entry_cmp(const SSL_LIST_CACHE_ENTRY *a,
+                                const SSL_LIST_CACHE_ENTRY *b)
+{
+    if (a->hash != b->hash || a->type != b->type
+        || a->paramlen != b->paramlen || a->str_len != b->str_len)
+        return 1;
+    if (a->paramlen > 0 && memcmp(a->param, b->param, a->paramlen) != 0)
+        return 1;
+    return memcmp(a->str, b->str, a->str_len);
+}
+
+static void list_cache_entry_free(SSL_LIST_CACHE_ENTRY *e)
+{
+    OPENSSL_free(e);
+}
+
+static void list_cache_key(SSL_LIST_CACHE_ENTRY *e, int type,
+                           const void *param, size_t paramlen,
+                           const char *str)
+{
+    uint64_t h;
+
+    e->type = type;
+    e->param = param;
+    e->paramlen = paramlen;
+    e->str = str;
+    e->str_len = strlen(str);
+    h = ssl_list_cache_hash(0, &type, sizeof(type));
+    h = ssl_list_cache_hash(h, param, paramlen);
+    h = ssl_list_cache_hash(h, str, e->str_len);
+    e->hash = (unsigned long)(h ^ (h >> 32));
+}
+
+int ssl_list_cache_init(void)
+{
+    if ((list_cache_lock = CRYPTO_THREAD_lock_new()) == NULL)
+        return 0;
+    list_cache = lh_SSL_LIST_CACHE_ENTRY_new(&list_cache_entry_hash,
+                                             &list_cache_entry_cmp);
+    if (list_cache == NULL) {
+        CRYPTO_THREAD_lock_free(list_cache_lock);
+        list_cache_lock = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+void ssl_list_cache_cleanup(void)
+{
+    if (list_cache != NULL) {
+        lh_SSL_LIST_CACHE_ENTRY_doall(list_cache, &list_cache_entry_free);
+        lh_SSL_LIST_CACHE_ENTRY_free(list_cache);
+        list_cache = NULL;
+    }
+    CRYPTO_THREAD_lock_free(list_cache_lock);
+    list_cache_lock = NULL;
+}
+
+/*
+ * Look up the result of parsing |str| as a list of |type| in the context
+ * described by |param|.  On a hit the cached data is copied to |data|, which
+ * has room for |*datalen| bytes, |*datalen| is set to the number of bytes
+ * copied, and |*extra| to the value stored along with it.  |data| may be NULL
+ * to only find out whether |str| is known to be valid.  Returns 1 on a hit and
+ * 0 otherwise, without raising any error.
+ */
+int ssl_list_cache_get(int type, const void *param, size_t paramlen,
+                       const char *str, void *data, size_t *datalen,
+                       int *extra)
+{
+    SSL_LIST_CACHE_ENTRY tmpl, *e;
+    int ret = 0;
+
+    if (list_cache == NULL || str == NULL)
+        return 0;
+    list_cache_key(&tmpl, type, param, paramlen, str);
+    if (!CRYPTO_THREAD_read_lock(list_cache_lock))
+        return 0;
+    e = lh_SSL_LIST_CACHE_ENTRY_retrieve(list_cache, &tmpl);
+    if (e != NULL && (data == NULL || e->datalen <= *datalen)) {
+        if (data != NULL) {
+            memcpy(data, e->data, e->datalen);
+            *datalen = e->datalen;
+        }
+        if (extra != NULL)
+            *extra = e->extra;
+        ret = 1;
+    }
+    CRYPTO_THREAD_unlock(list_cache_lock);
+    return ret;
+}
+
+/*
+ * Remember that parsing |str| as a list of |type| in the context described
+ * by |param| gave |data| and |extra|.  Failing to do so is not an error, the
+ * string will just be parsed again next time.
+ */
+void ssl_list_cache_put(int type, const void *param, size_t paramlen,
+                        const char *str, const void *data, size_t datalen,
+                        int extra)
+{
+    SSL_LIST_CACHE_ENTRY tmpl, *e, *old;
+    unsigned char *p;
+
+    if (list_cache == NULL || str == NULL)
+        return;
+    list_cache_key(&tmpl, type, param, paramlen, str);
+
+    /* The entry, the data, the parameters and the string in one block */
+    e = OPENSSL_malloc(sizeof(*e) + datalen + paramlen + tmpl.str_len);
+    if (e == NULL)
+        return;
+    *e = tmpl;
+    e->extra = extra;
+    p = (unsigned char *)(e + 1);
+    if (datalen > 0)
+        memcpy(p, data, datalen);
+    e->data = p;
+    e->datalen = datalen;
+    p += datalen;
+    if (paramlen > 0)
+        memcpy(p, param, paramlen);
+    e->param = p;
+    p += paramlen;
+    memcpy(p, str, tmpl.str_len);
+    e->str = (const char *)p;
+
+    if (!CRYPTO_THREAD_write_lock(list_cache_lock)) {
+        OPENSSL_free(e);
+        return;
+    }
+    if (lh_SSL_LIST_CACHE_ENTRY_retrieve(list_cache, &tmpl) != NULL) {
+        /* Another thread got there first */
+        CRYPTO_THREAD_unlock(list_cache_lock);
+        OPENSSL_free(e);
+        return;
+    }
+    if (lh_SSL_LIST_CACHE_ENTRY_num_items(list_cache) >= SSL_LIST_CACHE_MAX) {
+        lh_SSL_LIST_CACHE_ENTRY_doall(list_cache, &list_cache_entry_free);
+        lh_SSL_LIST_CACHE_ENTRY_flush(list_cache);
+    }
+    old = lh_SSL_LIST_CACHE_ENTRY_insert(list_cache, e);
+    if (old == NULL && lh_SSL_LIST_CACHE_ENTRY_error(list_cache))
+        OPENSSL_free(e);
+    CRYPTO_THREAD_unlock(list_cache_lock);
+}
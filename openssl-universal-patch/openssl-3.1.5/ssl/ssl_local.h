@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2002, Oracle and/or its affiliates. All rights reserved
  * Copyright 2005 Nokia. All rights reserved.
  *
@@ -766,6 +766,7 @@ typedef enum tlsext_index_en {
     TLSEXT_IDX_cryptopro_bug,
     TLSEXT_IDX_early_data,
     TLSEXT_IDX_certificate_authorities,
+    TLSEXT_IDX_compress_certificate,
     TLSEXT_IDX_padding,
     TLSEXT_IDX_psk,
     /* Dummy index - must always be the last entry */
@@ -810,6 +811,32 @@ int ssl_hmac_final(SSL_HMAC *ctx, unsigned char *md, size_t *len,
                    size_t max_size);
 size_t ssl_hmac_size(const SSL_HMAC *ctx);
 
+/* The most session ticket keys an SSL_CTX keeps around at the same time */
+# define SSL_MAX_TICKET_KEYS    16
+
+/*
+ * A cipher and HMAC context pair keyed with one of the session ticket keys,
+ * ready to seal (|enc| is 1) or open tickets after setting the IV.
+ */
+typedef struct ssl_ticket_crypto_st SSL_TICKET_CRYPTO;
+struct ssl_ticket_crypto_st {
+    SSL_TICKET_CRYPTO *next;
+    uint64_t key_id;
+    int enc;
+    EVP_CIPHER_CTX *cipher;
+    SSL_HMAC *hmac;
+};
+
+/* A session ticket key and the idle contexts keyed with it */
+typedef struct ssl_ticket_key_st {
+    uint64_t id;
+    time_t created;
+    unsigned char name[TLSEXT_KEYNAME_LENGTH];
+    SSL_CTX_EXT_SECURE *secure;
+    SSL_TICKET_CRYPTO *free_enc;
+    SSL_TICKET_CRYPTO *free_dec;
+} SSL_TICKET_KEY;
+
 int ssl_get_EC_curve_nid(const EVP_PKEY *pkey);
 __owur int tls13_set_encoded_pub_key(EVP_PKEY *pkey,
                                      const unsigned char *enckey,
@@ -1037,9 +1064,17 @@ struct ssl_ctx_st {
         /* TLS extensions servername callback */
         int (*servername_cb) (SSL *, int *, void *);
         void *servername_arg;
-        /* RFC 4507 session ticket keys */
-        unsigned char tick_key_name[TLSEXT_KEYNAME_LENGTH];
-        SSL_CTX_EXT_SECURE *secure;
+        /*
+         * RFC 4507 session ticket keys, newest first.  New tickets use the
+         * first key; the others are still accepted.  Unless
+         * |tick_key_interval| is 0 a new key is made when the first one is
+         * older than that many seconds.
+         */
+        SSL_TICKET_KEY *tick_keys[SSL_MAX_TICKET_KEYS];
+        size_t num_tick_keys;
+        size_t max_tick_keys;
+        long tick_key_interval;
+        uint64_t next_tick_key_id;
 # ifndef OPENSSL_NO_DEPRECATED_3_0
         /* Callback to support customisation of ticket key setting */
         int (*ticket_key_cb) (SSL *ssl,
@@ -1186,6 +1221,12 @@ struct ssl_ctx_st {
     SSL_async_callback_fn async_cb;
     void *async_cb_arg;
 
+    /*
+     * Certificate compression algorithms in order of preference, terminated
+     * by TLSEXT_comp_cert_none (RFC 8879)
+     */
+    int cert_comp_prefs[TLSEXT_comp_cert_limit];
+
     char *propq;
 
     int ssl_mac_pkey_id[SSL_MD_NUM_IDX];
@@ -1199,6 +1240,8 @@ struct ssl_ctx_st {
     TLS_GROUP_INFO *group_list;
     size_t group_list_len;
     size_t group_list_max_len;
+    /* Fingerprint of group_list for the parsed list cache */
+    uint64_t group_list_hash;
 
     /* masks of disabled algorithms */
     uint32_t disabled_enc_mask;
@@ -1275,12 +1318,17 @@ struct ssl_st {
         int need_empty_fragments;
         int empty_fragment_done;
         /* used during startup, digest all incoming/outgoing packets */
-        BIO *handshake_buffer;
+        BUF_MEM *handshake_buffer;
         /*
          * When handshake digest is determined, buffer is hashed and
          * freed and MD_CTX for the required digest is stored here.
          */
         EVP_MD_CTX *handshake_dgst;
+        /*
+         * Scratch context that ssl_handshake_hash() copies handshake_dgst
+         * into, kept so that its digest state is reused by later copies.
+         */
+        EVP_MD_CTX *handshake_snapshot;
         /*
          * Set whenever an expected ChangeCipherSpec message is processed.
          * Unset when the peer's Finished message is received.
@@ -1448,7 +1496,7 @@ struct ssl_st {
     STACK_OF(SSL_CIPHER) *peer_ciphers;
     STACK_OF(SSL_CIPHER) *cipher_list;
     STACK_OF(SSL_CIPHER) *cipher_list_by_id;
-    /* TLSv1.3 specific ciphersuites */
+    /* TLSv1.3 specific ciphersuites, NULL until set: those of the SSL_CTX */
     STACK_OF(SSL_CIPHER) *tls13_ciphersuites;
     /*
      * These are the ones being used, the ones in SSL_SESSION are the ones to
@@ -1680,6 +1728,14 @@ struct ssl_st {
          * selected.
          */
         int tick_identity;
+
+        /*
+         * The certificate compression algorithms the peer can receive and
+         * that we support, in the peer's order of preference
+         */
+        int compress_certificate_from_peer[TLSEXT_comp_cert_limit];
+        /* Did we send the compress_certificate extension? */
+        int compress_certificate_sent;
     } ext;
 
     /*
@@ -1726,6 +1782,8 @@ struct ssl_st {
     int renegotiate;
     /* If sending a KeyUpdate is pending */
     int key_update;
+    /* Set by SSL_hibernate() until the next record is read or written */
+    int hibernating;
     /* Post-handshake authentication state */
     SSL_PHA_STATE post_handshake_auth;
     int pha_enabled;
@@ -1793,6 +1851,9 @@ struct ssl_st {
     SSL_async_callback_fn async_cb;
     void *async_cb_arg;
 
+    /* Certificate compression algorithms in order of preference */
+    int cert_comp_prefs[TLSEXT_comp_cert_limit];
+
     /*
      * Signature algorithms shared by client and server: cached because these
      * are used most often.
@@ -1938,6 +1999,29 @@ typedef struct dtls1_state_st {
 #  define EXPLICIT_CHAR2_CURVE_TYPE  2
 #  define NAMED_CURVE_TYPE           3
 
+/* A compressed Certificate message, shared between CERTs that contain it */
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t orig_len;
+    int alg;
+    CRYPTO_REF_COUNT references;
+    CRYPTO_RWLOCK *lock;
+} OSSL_COMP_CERT;
+
+/*
+ * The encoded certificate_list of the Certificate message for a CERT_PKEY,
+ * shared between CERTs duplicated from the one it was created in so that all
+ * connections using it encode it only once. |data[0]| is the form used before
+ * TLSv1.3, |data[1]| the TLSv1.3 one with empty certificate extensions.
+ */
+typedef struct {
+    unsigned char *data[2];
+    size_t len[2];
+    CRYPTO_REF_COUNT references;
+    CRYPTO_RWLOCK *lock;
+} SSL_CERT_MSG_CACHE;
+
 struct cert_pkey_st {
     X509 *x509;
     EVP_PKEY *privatekey;
@@ -1952,6 +2036,14 @@ struct cert_pkey_st {
      */
     unsigned char *serverinfo;
     size_t serverinfo_length;
+    /*
+     * The Certificate message for this certificate, with an empty context
+     * and no per-certificate extensions, compressed with each of the
+     * TLSEXT_comp_cert_* algorithms it is indexed by (RFC 8879).
+     */
+    OSSL_COMP_CERT *comp_cert[TLSEXT_comp_cert_limit];
+    /* The encoded certificate_list, if it doesn't depend on the connection */
+    SSL_CERT_MSG_CACHE *msg_cache;
 };
 /* Retrieve Suite B flags */
 # define tls1_suiteb(s)  (s->cert->cert_flags & SSL_CERT_FLAG_SUITEB_128_LOS)
@@ -2377,12 +2469,26 @@ static ossl_inline void tls1_get_peer_groups(SSL *s, const uint16_t **pgroups,
 
 __owur int ssl_read_internal(SSL *s, void *buf, size_t num, size_t *readbytes);
 __owur int ssl_write_internal(SSL *s, const void *buf, size_t num, size_t *written);
+__owur int ssl_end_hibernation(SSL *s);
 void ssl_clear_cipher_ctx(SSL *s);
 int ssl_clear_bad_session(SSL *s);
 __owur CERT *ssl_cert_new(void);
 __owur CERT *ssl_cert_dup(CERT *cert);
+__owur int ssl_cert_unshare(CERT **pc);
 void ssl_cert_clear_certs(CERT *c);
 void ssl_cert_free(CERT *c);
+void ssl_cert_pkey_changed(CERT_PKEY *cpk);
+void ssl_cert_msg_cache_free(SSL_CERT_MSG_CACHE *mc);
+int ossl_comp_has_alg(int alg);
+void ossl_comp_cert_default_prefs(int *prefs);
+void ossl_comp_cert_free(OSSL_COMP_CERT *cc);
+__owur int ossl_comp_cert_up_ref(OSSL_COMP_CERT *cc);
+void ossl_comp_cert_clear(CERT_PKEY *cpk);
+__owur OSSL_COMP_CERT *ossl_comp_cert_from_uncompressed_data(unsigned char *data,
+                                                             size_t len,
+                                                             int alg);
+__owur int ossl_comp_cert_expand(int alg, unsigned char *out, size_t outlen,
+                                 unsigned char *in, size_t inlen);
 __owur int ssl_generate_session_id(SSL *s, SSL_SESSION *ss);
 __owur int ssl_get_new_session(SSL *s, int session);
 __owur SSL_SESSION *lookup_sess_in_cache(SSL *s, const unsigned char *sess_id,
@@ -2424,6 +2530,7 @@ __owur int ssl_cert_add0_chain_cert(SSL *s, SSL_CTX *ctx, X509 *x);
 __owur int ssl_cert_add1_chain_cert(SSL *s, SSL_CTX *ctx, X509 *x);
 __owur int ssl_cert_select_current(CERT *c, X509 *x);
 __owur int ssl_cert_set_current(CERT *c, long arg);
+__owur int ssl_cert_set_current_tmp(SSL *s);
 void ssl_cert_set_cert_cb(CERT *c, int (*cb) (SSL *ssl, void *arg), void *arg);
 
 __owur int ssl_verify_cert_chain(SSL *s, STACK_OF(X509) *sk);
@@ -2502,7 +2609,7 @@ __owur size_t ssl3_final_finish_mac(SSL *s, const char *sender, size_t slen,
 __owur int ssl3_finish_mac(SSL *s, const unsigned char *buf, size_t len);
 void ssl3_free_digest_list(SSL *s);
 __owur unsigned long ssl3_output_cert_chain(SSL *s, WPACKET *pkt,
-                                            CERT_PKEY *cpk);
+                                            CERT_PKEY *cpk, int for_comp);
 __owur const SSL_CIPHER *ssl3_choose_cipher(SSL *ssl,
                                             STACK_OF(SSL_CIPHER) *clnt,
                                             STACK_OF(SSL_CIPHER) *srvr);
@@ -2603,6 +2710,7 @@ __owur size_t tls13_final_finish_mac(SSL *s, const char *str, size_t slen,
                                      unsigned char *p);
 __owur int tls13_change_cipher_state(SSL *s, int which);
 __owur int tls13_update_key(SSL *s, int send);
+__owur int tls13_restore_cipher_state(SSL *s);
 __owur int tls13_hkdf_expand(SSL *s, const EVP_MD *md,
                              const unsigned char *secret,
                              const unsigned char *label, size_t labellen,
@@ -2795,7 +2903,7 @@ custom_ext_method *custom_ext_find(const custom_ext_methods *exts,
                                    ENDPOINT role, unsigned int ext_type,
                                    size_t *idx);
 
-void custom_ext_init(custom_ext_methods *meths);
+__owur int custom_ext_init(SSL *s);
 
 __owur int custom_ext_parse(SSL *s, unsigned int context, unsigned int ext_type,
                             const unsigned char *ext_data, size_t ext_size,
@@ -2814,6 +2922,32 @@ void ssl_comp_free_compression_methods_int(void);
 /* ssl_mcnf.c */
 void ssl_ctx_system_config(SSL_CTX *ctx);
 
+/* ssl_ticket.c */
+__owur int ssl_ctx_ticket_keys_init(SSL_CTX *ctx);
+void ssl_ctx_ticket_keys_free(SSL_CTX *ctx);
+__owur int ssl_ctx_set_ticket_keys(SSL_CTX *ctx, const unsigned char *keys);
+__owur int ssl_ctx_get_ticket_keys(SSL_CTX *ctx, unsigned char *keys);
+__owur SSL_TICKET_CRYPTO *ssl_ticket_crypto_seal(SSL_CTX *ctx,
+                                                 unsigned char *name);
+__owur int ssl_ticket_crypto_open(SSL_CTX *ctx, const unsigned char *name,
+                                  SSL_TICKET_CRYPTO **ptc, int *renew);
+void ssl_ticket_crypto_release(SSL_CTX *ctx, SSL_TICKET_CRYPTO *tc,
+                               int reuse);
+
+/* ssl_list_cache.c */
+# define SSL_LIST_CACHE_CIPHERS 1
+# define SSL_LIST_CACHE_GROUPS  2
+# define SSL_LIST_CACHE_SIGALGS 3
+__owur int ssl_list_cache_init(void);
+void ssl_list_cache_cleanup(void);
+uint64_t ssl_list_cache_hash(uint64_t h, const void *data, size_t len);
+__owur int ssl_list_cache_get(int type, const void *param, size_t paramlen,
+                              const char *str, void *data, size_t *datalen,
+                              int *extra);
+void ssl_list_cache_put(int type, const void *param, size_t paramlen,
+                        const char *str, const void *data, size_t datalen,
+                        int extra);
+
 const EVP_CIPHER *ssl_evp_cipher_fetch(OSSL_LIB_CTX *libctx,
                                        int nid,
                                        const char *properties);
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -39,6 +39,8 @@ int SSL_use_certificate(SSL *ssl, X509 *x)
         return 0;
     }
 
+    if (!ssl_cert_unshare(&ssl->cert))
+        return 0;
     return ssl_set_cert(ssl->cert, x);
 }
 
@@ -143,6 +145,8 @@ int SSL_use_PrivateKey(SSL *ssl, EVP_PKEY *pkey)
         ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_NULL_PARAMETER);
         return 0;
     }
+    if (!ssl_cert_unshare(&ssl->cert))
+        return 0;
     ret = ssl_set_pkey(ssl->cert, pkey);
     return ret;
 }
@@ -221,6 +225,8 @@ int SSL_CTX_use_certificate(SSL_CTX *ctx, X509 *x)
         ERR_raise(ERR_LIB_SSL, rv);
         return 0;
     }
+    if (!ssl_cert_unshare(&ctx->cert))
+        return 0;
     return ssl_set_cert(ctx->cert, x);
 }
 
@@ -269,6 +275,7 @@ static int ssl_set_cert(CERT *c, X509 *x)
     X509_free(c->pkeys[i].x509);
     X509_up_ref(x);
     c->pkeys[i].x509 = x;
+    ssl_cert_pkey_changed(&c->pkeys[i]);
     c->key = &(c->pkeys[i]);
 
     return 1;
@@ -348,6 +355,8 @@ int SSL_CTX_use_PrivateKey(SSL_CTX *ctx, EVP_PKEY *pkey)
         ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_NULL_PARAMETER);
         return 0;
     }
+    if (!ssl_cert_unshare(&ctx->cert))
+        return 0;
     return ssl_set_pkey(ctx->cert, pkey);
 }
 
@@ -770,6 +779,8 @@ int SSL_CTX_use_serverinfo_ex(SSL_CTX *ctx, unsigned int version,
         ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_SERVERINFO_DATA);
         return 0;
     }
+    if (!ssl_cert_unshare(&ctx->cert))
+        return 0;
     if (ctx->cert->key == NULL) {
         ERR_raise(ERR_LIB_SSL, ERR_R_INTERNAL_ERROR);
         return 0;
@@ -927,7 +938,7 @@ static int ssl_set_cert_and_key(SSL *ssl, SSL_CTX *ctx, X509 *x509, EVP_PKEY *pr
     size_t i;
     int j;
     int rv;
-    CERT *c = ssl != NULL ? ssl->cert : ctx->cert;
+    CERT *c;
     STACK_OF(X509) *dup_chain = NULL;
     EVP_PKEY *pubkey = NULL;
 
@@ -983,6 +994,9 @@ static int ssl_set_cert_and_key(SSL *ssl, SSL_CTX *ctx, X509 *x509, EVP_PKEY *pr
         goto out;
     }
 
+    if (!ssl_cert_unshare(ssl != NULL ? &ssl->cert : &ctx->cert))
+        goto out;
+    c = ssl != NULL ? ssl->cert : ctx->cert;
     if (!override && (c->pkeys[i].x509 != NULL
                       || c->pkeys[i].privatekey != NULL
                       || c->pkeys[i].chain != NULL)) {
@@ -1005,6 +1019,7 @@ static int ssl_set_cert_and_key(SSL *ssl, SSL_CTX *ctx, X509 *x509, EVP_PKEY *pr
     X509_free(c->pkeys[i].x509);
     X509_up_ref(x509);
     c->pkeys[i].x509 = x509;
+    ssl_cert_pkey_changed(&c->pkeys[i]);
 
     EVP_PKEY_free(c->pkeys[i].privatekey);
     EVP_PKEY_up_ref(privatekey);
@@ -0,0 +1,322 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * The built-in session ticket keys of an SSL_CTX: the ring of current and
+ * previous keys, their rotation, and the cipher and HMAC contexts keyed with
+ * them.  Keying AES and HMAC costs more than sealing or opening a ticket, so
+ * contexts are kept with their key once used and only get a fresh IV the next
+ * time round.  All of this is protected by the SSL_CTX lock.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <openssl/rand.h>
+#include "ssl_local.h"
+
+static void ticket_crypto_free(SSL_TICKET_CRYPTO *tc)
+{
+    if (tc == NULL)
+        return;
+    EVP_CIPHER_CTX_free(tc->cipher);
+    ssl_hmac_free(tc->hmac);
+    OPENSSL_free(tc);
+}
+
+static void ticket_crypto_free_list(SSL_TICKET_CRYPTO *tc)
+{
+    SSL_TICKET_CRYPTO *next;
+
+    for (; tc != NULL; tc = next) {
+        next = tc->next;
+        ticket_crypto_free(tc);
+    }
+}
+
+static void ticket_key_free(SSL_TICKET_KEY *key)
+{
+    if (key == NULL)
+        return;
+    ticket_crypto_free_list(key->free_enc);
+    ticket_crypto_free_list(key->free_dec);
+    OPENSSL_secure_clear_free(key->secure, sizeof(*key->secure));
+    OPENSSL_free(key);
+}
+
+/*
+ * Make a new key from |keys| in the SSL_CTX_set_tlsext_ticket_keys() layout,
+ * or a random one if |keys| is NULL.
+ */
+static SSL_TICKET_KEY *ticket_key_new(SSL_CTX *ctx, const unsigned char *keys)
+{
+    SSL_TICKET_KEY *key = OPENSSL_zalloc(sizeof(*key));
+
+    if (key == NULL)
+        return NULL;
+    if ((key->secure = OPENSSL_secure_zalloc(sizeof(*key->secure))) == NULL)
+        goto err;
+
+    if (keys != NULL) {
+        memcpy(key->name, keys, sizeof(key->name));
+        keys += sizeof(key->name);
+        memcpy(key->secure->tick_hmac_key, keys,
+               sizeof(key->secure->tick_hmac_key));
+        keys += sizeof(key->secure->tick_hmac_key);
+        memcpy(key->secure->tick_aes_key, keys,
+               sizeof(key->secure->tick_aes_key));
+    } else if (RAND_bytes_ex(ctx->libctx, key->name, sizeof(key->name), 0) <= 0
+               || RAND_priv_bytes_ex(ctx->libctx, key->secure->tick_hmac_key,
+                                     sizeof(key->secure->tick_hmac_key),
+                                     0) <= 0
+               || RAND_priv_bytes_ex(ctx->libctx, key->secure->tick_aes_key,
+                                     sizeof(key->secure->tick_aes_key),
+                                     0) <= 0) {
+        goto err;
+    }
+    key->id = ctx->ext.next_tick_key_id++;
+    key->created = time(NULL);
+    return key;
+ err:
+    ticket_key_free(key);
+    return NULL;
+}
+
+static void ticket_keys_remove(SSL_CTX *ctx, size_t idx)
+{
+    ticket_key_free(ctx->ext.tick_keys[idx]);
+    ctx->ext.num_tick_keys--;
+    memmove(&ctx->ext.tick_keys[idx], &ctx->ext.tick_keys[idx + 1],
+            (ctx->ext.num_tick_keys - idx) * sizeof(ctx->ext.tick_keys[0]));
+}
+
+/* Make |key| the one for new tickets, retiring the oldest keys if needed */
+static void ticket_keys_push(SSL_CTX *ctx, SSL_TICKET_KEY *key)
+{
+    size_t i;
+
+    for (i = 0; i < ctx->ext.num_tick_keys; i++) {
+        if (memcmp(ctx->ext.tick_keys[i]->name, key->name,
+                   sizeof(key->name)) == 0) {
+            ticket_keys_remove(ctx, i);
+            break;
+        }
+    }
+    while (ctx->ext.num_tick_keys >= ctx->ext.max_tick_keys)
+        ticket_keys_remove(ctx, ctx->ext.num_tick_keys - 1);
+    memmove(&ctx->ext.tick_keys[1], &ctx->ext.tick_keys[0],
+            ctx->ext.num_tick_keys * sizeof(ctx->ext.tick_keys[0]));
+    ctx->ext.tick_keys[0] = key;
+    ctx->ext.num_tick_keys++;
+}
+
+static int ticket_key_due(const SSL_CTX *ctx, const SSL_TICKET_KEY *key,
+                          time_t now)
+{
+    return ctx->ext.tick_key_interval > 0
+           && now - key->created >= ctx->ext.tick_key_interval;
+}
+
+/* A key is accepted for as long as it takes to rotate through all of them */
+static int ticket_key_expired(const SSL_CTX *ctx, const SSL_TICKET_KEY *key,
+                              time_t now)
+{
+    return ctx->ext.tick_key_interval > 0
+           && now > key->created
+           && (now - key->created) / (time_t)ctx->ext.max_tick_keys
+              >= ctx->ext.tick_key_interval;
+}
+
+/* Returns an idle context keyed with |key|, making one if there's none */
+static SSL_TICKET_CRYPTO *ticket_crypto_take(SSL_CTX *ctx, SSL_TICKET_KEY *key,
+                                             int enc)
+{
+    SSL_TICKET_CRYPTO **list = enc ? &key->free_enc : &key->free_dec;
+    SSL_TICKET_CRYPTO *tc = *list;
+    EVP_CIPHER *cipher = NULL;
+
+    if (tc != NULL) {
+        *list = tc->next;
+        tc->next = NULL;
+        return tc;
+    }
+
+    if ((tc = OPENSSL_zalloc(sizeof(*tc))) == NULL)
+        return NULL;
+    tc->key_id = key->id;
+    tc->enc = enc;
+    if ((tc->cipher = EVP_CIPHER_CTX_new()) == NULL
+            || (tc->hmac = ssl_hmac_new(ctx)) == NULL
+            || (cipher = EVP_CIPHER_fetch(ctx->libctx, "AES-256-CBC",
+                                          ctx->propq)) == NULL
+            || !EVP_CipherInit_ex(tc->cipher, cipher, NULL,
+                                  key->secure->tick_aes_key, NULL, enc)
+            || !ssl_hmac_init(tc->hmac, key->secure->tick_hmac_key,
+                              sizeof(key->secure->tick_hmac_key), "SHA256")) {
+        ticket_crypto_free(tc);
+        tc = NULL;
+    }
+    EVP_CIPHER_free(cipher);
+    return tc;
+}
+
+int ssl_ctx_ticket_keys_init(SSL_CTX *ctx)
+{
+    SSL_TICKET_KEY *key;
+
+    ctx->ext.max_tick_keys = 1;
+    ctx->ext.tick_key_interval = 0;
+    if ((key = ticket_key_new(ctx, NULL)) == NULL)
+        return 0;
+    ticket_keys_push(ctx, key);
+    return 1;
+}
+
+void ssl_ctx_ticket_keys_free(SSL_CTX *ctx)
+{
+    while (ctx->ext.num_tick_keys > 0)
+        ticket_keys_remove(ctx, ctx->ext.num_tick_keys - 1);
+}
+
+int ssl_ctx_set_ticket_keys(SSL_CTX *ctx, const unsigned char *keys)
+{
+    SSL_TICKET_KEY *key;
+
+    if (!CRYPTO_THREAD_write_lock(ctx->lock))
+        return 0;
+    if ((key = ticket_key_new(ctx, keys)) != NULL)
+        ticket_keys_push(ctx, key);
+    CRYPTO_THREAD_unlock(ctx->lock);
+    return key != NULL;
+}
+
+int ssl_ctx_get_ticket_keys(SSL_CTX *ctx, unsigned char *keys)
+{
+    SSL_TICKET_KEY *key;
+    int ret = 0;
+
+    if (!CRYPTO_THREAD_read_lock(ctx->lock))
+        return 0;
+    if (ctx->ext.num_tick_keys > 0) {
+        key = ctx->ext.tick_keys[0];
+        memcpy(keys, key->name, sizeof(key->name));
+        keys += sizeof(key->name);
+        memcpy(keys, key->secure->tick_hmac_key,
+               sizeof(key->secure->tick_hmac_key));
+        keys += sizeof(key->secure->tick_hmac_key);
+        memcpy(keys, key->secure->tick_aes_key,
+               sizeof(key->secure->tick_aes_key));
+        ret = 1;
+    }
+    CRYPTO_THREAD_unlock(ctx->lock);
+    return ret;
+}
+
+int SSL_CTX_set_ticket_key_rotation(SSL_CTX *ctx, long interval,
+                                    size_t num_keys)
+{
+    if (interval < 0 || num_keys == 0 || num_keys > SSL_MAX_TICKET_KEYS) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+    if (!CRYPTO_THREAD_write_lock(ctx->lock))
+        return 0;
+    ctx->ext.tick_key_interval = interval;
+    ctx->ext.max_tick_keys = num_keys;
+    while (ctx->ext.num_tick_keys > num_keys)
+        ticket_keys_remove(ctx, ctx->ext.num_tick_keys - 1);
+    CRYPTO_THREAD_unlock(ctx->lock);
+    return 1;
+}
+
+/*
+ * Returns a context for sealing a new ticket, rotating the keys first if it
+ * is time, and the name of the key it uses in |name|.  Returns NULL on error.
+ */
+SSL_TICKET_CRYPTO *ssl_ticket_crypto_seal(SSL_CTX *ctx, unsigned char *name)
+{
+    SSL_TICKET_CRYPTO *tc = NULL;
+    SSL_TICKET_KEY *key;
+
+    if (!CRYPTO_THREAD_write_lock(ctx->lock))
+        return NULL;
+    if (ctx->ext.num_tick_keys > 0
+            && ticket_key_due(ctx, ctx->ext.tick_keys[0], time(NULL))) {
+        /* Carry on with the old key if we can't make a new one */
+        if ((key = ticket_key_new(ctx, NULL)) != NULL)
+            ticket_keys_push(ctx, key);
+    }
+    if (ctx->ext.num_tick_keys > 0) {
+        key = ctx->ext.tick_keys[0];
+        if ((tc = ticket_crypto_take(ctx, key, 1)) != NULL)
+            memcpy(name, key->name, sizeof(key->name));
+    }
+    CRYPTO_THREAD_unlock(ctx->lock);
+    return tc;
+}
+
+/*
+ * Looks up the key called |name| for opening a ticket.  Returns 1 and sets
+ * |*ptc| if we have the key, in which case |*renew| is set if a ticket with a
+ * newer key should be issued.  Returns 0 if we don't know the key, or -1 on
+ * error.
+ */
+int ssl_ticket_crypto_open(SSL_CTX *ctx, const unsigned char *name,
+                           SSL_TICKET_CRYPTO **ptc, int *renew)
+{
+    SSL_TICKET_KEY *key;
+    time_t now = time(NULL);
+    size_t i;
+    int ret = 0;
+
+    *ptc = NULL;
+    if (!CRYPTO_THREAD_write_lock(ctx->lock))
+        return -1;
+    for (i = 0; i < ctx->ext.num_tick_keys; i++) {
+        key = ctx->ext.tick_keys[i];
+        if (memcmp(key->name, name, sizeof(key->name)) != 0)
+            continue;
+        if (ticket_key_expired(ctx, key, now))
+            break;
+        *renew = i > 0 || ticket_key_due(ctx, key, now);
+        *ptc = ticket_crypto_take(ctx, key, 0);
+        ret = *ptc != NULL ? 1 : -1;
+        break;
+    }
+    CRYPTO_THREAD_unlock(ctx->lock);
+    return ret;
+}
+
+/*
+ * Gives back a context from ssl_ticket_crypto_seal() or
+ * ssl_ticket_crypto_open().  It is kept for the next ticket if |reuse| is set
+ * and its key is still around, and freed otherwise.
+ */
+void ssl_ticket_crypto_release(SSL_CTX *ctx, SSL_TICKET_CRYPTO *tc, int reuse)
+{
+    SSL_TICKET_CRYPTO **list;
+    SSL_TICKET_KEY *key;
+    size_t i;
+
+    if (tc == NULL)
+        return;
+    if (reuse && CRYPTO_THREAD_write_lock(ctx->lock)) {
+        for (i = 0; i < ctx->ext.num_tick_keys; i++) {
+            key = ctx->ext.tick_keys[i];
+            if (key->id != tc->key_id)
+                continue;
+            list = tc->enc ? &key->free_enc : &key->free_dec;
+            tc->next = *list;
+            *list = tc;
+            tc = NULL;
+            break;
+        }
+        CRYPTO_THREAD_unlock(ctx->lock);
+    }
+    ticket_crypto_free(tc);
+}
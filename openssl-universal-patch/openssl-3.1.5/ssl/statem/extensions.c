@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -41,6 +41,14 @@ static EXT_RETURN tls_construct_certificate_authorities(SSL *s, WPACKET *pkt,
 static int tls_parse_certificate_authorities(SSL *s, PACKET *pkt,
                                              unsigned int context, X509 *x,
                                              size_t chainidx);
+static int init_compress_certificate(SSL *s, unsigned int context);
+static EXT_RETURN tls_construct_compress_certificate(SSL *s, WPACKET *pkt,
+                                                     unsigned int context,
+                                                     X509 *x,
+                                                     size_t chainidx);
+static int tls_parse_compress_certificate(SSL *s, PACKET *pkt,
+                                          unsigned int context, X509 *x,
+                                          size_t chainidx);
 #ifndef OPENSSL_NO_SRP
 static int init_srp(SSL *s, unsigned int context);
 #endif
@@ -369,6 +377,15 @@ static const EXTENSION_DEFINITION ext_defs[] = {
         tls_construct_certificate_authorities,
         tls_construct_certificate_authorities, NULL,
     },
+    {
+        TLSEXT_TYPE_compress_certificate,
+        SSL_EXT_CLIENT_HELLO | SSL_EXT_TLS1_3_CERTIFICATE_REQUEST
+        | SSL_EXT_TLS_IMPLEMENTATION_ONLY | SSL_EXT_TLS1_3_ONLY,
+        init_compress_certificate,
+        tls_parse_compress_certificate, tls_parse_compress_certificate,
+        tls_construct_compress_certificate,
+        tls_construct_compress_certificate, NULL
+    },
     {
         /* Must be immediately before pre_shared_key */
         TLSEXT_TYPE_padding,
@@ -563,7 +580,7 @@ int tls_collect_extensions(SSL *s, PACKET *packet, unsigned int context,
     PACKET extensions = *packet;
     size_t i = 0;
     size_t num_exts;
-    custom_ext_methods *exts = &s->cert->custext;
+    custom_ext_methods *exts;
     RAW_EXTENSION *raw_extensions = NULL;
     const EXTENSION_DEFINITION *thisexd;
 
@@ -573,9 +590,12 @@ int tls_collect_extensions(SSL *s, PACKET *packet, unsigned int context,
      * Initialise server side custom extensions. Client side is done during
      * construction of extensions for the ClientHello.
      */
-    if ((context & SSL_EXT_CLIENT_HELLO) != 0)
-        custom_ext_init(&s->cert->custext);
+    if ((context & SSL_EXT_CLIENT_HELLO) != 0 && !custom_ext_init(s)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
 
+    exts = &s->cert->custext;
     num_exts = OSSL_NELEM(ext_defs) + (exts != NULL ? exts->meths_count : 0);
     raw_extensions = OPENSSL_zalloc(num_exts * sizeof(*raw_extensions));
     if (raw_extensions == NULL) {
@@ -830,7 +850,10 @@ int tls_construct_extensions(SSL *s, WPACKET *pkt, unsigned int context,
     /* Add custom extensions first */
     if ((context & SSL_EXT_CLIENT_HELLO) != 0) {
         /* On the server side with initialise during ClientHello parsing */
-        custom_ext_init(&s->cert->custext);
+        if (!custom_ext_init(s)) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
     }
     if (!custom_ext_add(s, context, pkt, x, chainidx, max_version)) {
         /* SSLfatal() already called */
@@ -1267,6 +1290,89 @@ static int tls_parse_certificate_authorities(SSL *s, PACKET *pkt,
     return 1;
 }
 
+static int init_compress_certificate(SSL *s, unsigned int context)
+{
+    memset(s->ext.compress_certificate_from_peer, 0,
+           sizeof(s->ext.compress_certificate_from_peer));
+    if (s->server)
+        s->ext.compress_certificate_sent = 0;
+    return 1;
+}
+
+/* The algorithms we can decompress certificates with, best first */
+static EXT_RETURN tls_construct_compress_certificate(SSL *s, WPACKET *pkt,
+                                                     unsigned int context,
+                                                     X509 *x,
+                                                     size_t chainidx)
+{
+    int *alg = s->cert_comp_prefs;
+
+    s->ext.compress_certificate_sent = 0;
+    if ((s->options & SSL_OP_NO_RX_CERTIFICATE_COMPRESSION) != 0
+            || *alg == TLSEXT_comp_cert_none)
+        return EXT_RETURN_NOT_SENT;
+
+    if (!WPACKET_put_bytes_u16(pkt, TLSEXT_TYPE_compress_certificate)
+            || !WPACKET_start_sub_packet_u16(pkt)
+            || !WPACKET_start_sub_packet_u8(pkt)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return EXT_RETURN_FAIL;
+    }
+    for (; *alg != TLSEXT_comp_cert_none; alg++) {
+        if (!WPACKET_put_bytes_u16(pkt, *alg)) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return EXT_RETURN_FAIL;
+        }
+    }
+    if (!WPACKET_close(pkt) || !WPACKET_close(pkt)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return EXT_RETURN_FAIL;
+    }
+
+    s->ext.compress_certificate_sent = 1;
+    return EXT_RETURN_SENT;
+}
+
+/*
+ * Record the algorithms the peer can decompress certificates with that we
+ * can compress them with, in the peer's order of preference
+ */
+static int tls_parse_compress_certificate(SSL *s, PACKET *pkt,
+                                          unsigned int context, X509 *x,
+                                          size_t chainidx)
+{
+    PACKET algs;
+    unsigned int alg;
+    size_t i, n = 0;
+    int *from_peer = s->ext.compress_certificate_from_peer;
+
+    if (!PACKET_as_length_prefixed_1(pkt, &algs)
+            || PACKET_remaining(&algs) == 0
+            || (PACKET_remaining(&algs) & 1) != 0) {
+        SSLfatal(s, SSL_AD_DECODE_ERROR, SSL_R_BAD_EXTENSION);
+        return 0;
+    }
+
+    /* Nothing to record if we're not going to compress our certificates */
+    if ((s->options & SSL_OP_NO_TX_CERTIFICATE_COMPRESSION) != 0)
+        return 1;
+
+    while (PACKET_get_net_2(&algs, &alg)) {
+        for (i = 0; s->cert_comp_prefs[i] != TLSEXT_comp_cert_none; i++)
+            if ((unsigned int)s->cert_comp_prefs[i] == alg)
+                break;
+        if (s->cert_comp_prefs[i] == TLSEXT_comp_cert_none)
+            continue;
+        /* Ignore duplicates */
+        for (i = 0; i < n; i++)
+            if ((unsigned int)from_peer[i] == alg)
+                break;
+        if (i == n)
+            from_peer[n++] = (int)alg;
+    }
+    return 1;
+}
+
 #ifndef OPENSSL_NO_SRTP
 static int init_srtp(SSL *s, unsigned int context)
 {
@@ -1555,15 +1661,15 @@ int tls_psk_do_binder(SSL *s, const EVP_MD *md, const unsigned char *msgstart,
      */
     if (s->hello_retry_request == SSL_HRR_PENDING) {
         size_t hdatalen;
-        long hdatalen_l;
         void *hdata;
 
-        hdatalen = hdatalen_l =
-            BIO_get_mem_data(s->s3.handshake_buffer, &hdata);
-        if (hdatalen_l <= 0) {
+        if (s->s3.handshake_buffer == NULL
+                || s->s3.handshake_buffer->length == 0) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, SSL_R_BAD_HANDSHAKE_LENGTH);
             goto err;
         }
+        hdata = s->s3.handshake_buffer->data;
+        hdatalen = s->s3.handshake_buffer->length;
 
         /*
          * For servers the handshake buffer data will include the second
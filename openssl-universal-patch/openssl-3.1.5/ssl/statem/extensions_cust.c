@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2014-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -99,14 +99,22 @@ custom_ext_method *custom_ext_find(const custom_ext_methods *exts,
 
 /*
  * Initialise custom extensions flags to indicate neither sent nor received.
+ * The flags are per connection state, so a CERT shared with the SSL_CTX has
+ * to be unshared first.
  */
-void custom_ext_init(custom_ext_methods *exts)
+int custom_ext_init(SSL *s)
 {
     size_t i;
-    custom_ext_method *meth = exts->meths;
+    custom_ext_method *meth;
 
-    for (i = 0; i < exts->meths_count; i++, meth++)
+    if (s->cert->custext.meths_count == 0)
+        return 1;
+    if (!ssl_cert_unshare(&s->cert))
+        return 0;
+    meth = s->cert->custext.meths;
+    for (i = 0; i < s->cert->custext.meths_count; i++, meth++)
         meth->ext_flags = 0;
+    return 1;
 }
 
 /* Pass received custom extension data to the application for parsing. */
@@ -389,6 +397,9 @@ static int add_custom_ext_intern(SSL_CTX *ctx, ENDPOINT role,
     /* Search for duplicate */
     if (custom_ext_find(exts, role, ext_type, NULL))
         return 0;
+    if (!ssl_cert_unshare(&ctx->cert))
+        return 0;
+    exts = &ctx->cert->custext;
     tmp = OPENSSL_realloc(exts->meths,
                           (exts->meths_count + 1) * sizeof(custom_ext_method));
     if (tmp == NULL)
@@ -133,6 +133,11 @@ static int ossl_statem_client13_read_transition(SSL *s, int mt)
                 st->hand_state = TLS_ST_CR_CERT;
                 return 1;
             }
+            if (mt == SSL3_MT_COMPRESSED_CERTIFICATE
+                    && s->ext.compress_certificate_sent) {
+                st->hand_state = TLS_ST_CR_COMP_CERT;
+                return 1;
+            }
         }
         break;
 
@@ -141,9 +146,15 @@ static int ossl_statem_client13_read_transition(SSL *s, int mt)
             st->hand_state = TLS_ST_CR_CERT;
             return 1;
         }
+        if (mt == SSL3_MT_COMPRESSED_CERTIFICATE
+                && s->ext.compress_certificate_sent) {
+            st->hand_state = TLS_ST_CR_COMP_CERT;
+            return 1;
+        }
         break;
 
     case TLS_ST_CR_CERT:
+    case TLS_ST_CR_COMP_CERT:
         if (mt == SSL3_MT_CERTIFICATE_VERIFY) {
             st->hand_state = TLS_ST_CR_CERT_VRFY;
             return 1;
@@ -399,6 +410,19 @@ int ossl_statem_client_read_transition(SSL *s, int mt)
     return 0;
 }
 
+/*
+ * The state to send our TLSv1.3 Certificate in: compressed if it isn't empty
+ * and the server can decompress it (RFC 8879).
+ */
+static OSSL_HANDSHAKE_STATE client13_cert_state(SSL *s)
+{
+    if (s->s3.tmp.cert_req == 1
+            && s->ext.compress_certificate_from_peer[0]
+               != TLSEXT_comp_cert_none)
+        return TLS_ST_CW_COMP_CERT;
+    return TLS_ST_CW_CERT;
+}
+
 /*
  * ossl_statem_client13_write_transition() works out what handshake state to
  * move to next when the TLSv1.3 client is writing messages to be sent to the
@@ -421,7 +445,7 @@ static WRITE_TRAN ossl_statem_client13_write_transition(SSL *s)
 
     case TLS_ST_CR_CERT_REQ:
         if (s->post_handshake_auth == SSL_PHA_REQUESTED) {
-            st->hand_state = TLS_ST_CW_CERT;
+            st->hand_state = client13_cert_state(s);
             return WRITE_TRAN_CONTINUE;
         }
         /*
@@ -444,7 +468,7 @@ static WRITE_TRAN ossl_statem_client13_write_transition(SSL *s)
                  && s->hello_retry_request == SSL_HRR_NONE)
             st->hand_state = TLS_ST_CW_CHANGE;
         else
-            st->hand_state = (s->s3.tmp.cert_req != 0) ? TLS_ST_CW_CERT
+            st->hand_state = (s->s3.tmp.cert_req != 0) ? client13_cert_state(s)
                                                         : TLS_ST_CW_FINISHED;
         return WRITE_TRAN_CONTINUE;
 
@@ -457,7 +481,7 @@ static WRITE_TRAN ossl_statem_client13_write_transition(SSL *s)
 
     case TLS_ST_CW_END_OF_EARLY_DATA:
     case TLS_ST_CW_CHANGE:
-        st->hand_state = (s->s3.tmp.cert_req != 0) ? TLS_ST_CW_CERT
+        st->hand_state = (s->s3.tmp.cert_req != 0) ? client13_cert_state(s)
                                                     : TLS_ST_CW_FINISHED;
         return WRITE_TRAN_CONTINUE;
 
@@ -467,6 +491,10 @@ static WRITE_TRAN ossl_statem_client13_write_transition(SSL *s)
                                                     : TLS_ST_CW_FINISHED;
         return WRITE_TRAN_CONTINUE;
 
+    case TLS_ST_CW_COMP_CERT:
+        st->hand_state = TLS_ST_CW_CERT_VRFY;
+        return WRITE_TRAN_CONTINUE;
+
     case TLS_ST_CW_CERT_VRFY:
         st->hand_state = TLS_ST_CW_FINISHED;
         return WRITE_TRAN_CONTINUE;
@@ -918,6 +946,11 @@ int ossl_statem_client_construct_message(SSL *s, WPACKET *pkt,
         *mt = SSL3_MT_CERTIFICATE;
         break;
 
+    case TLS_ST_CW_COMP_CERT:
+        *confunc = tls_construct_client_compressed_certificate;
+        *mt = SSL3_MT_COMPRESSED_CERTIFICATE;
+        break;
+
     case TLS_ST_CW_KEY_EXCH:
         *confunc = tls_construct_client_key_exchange;
         *mt = SSL3_MT_CLIENT_KEY_EXCHANGE;
@@ -968,6 +1001,7 @@ size_t ossl_statem_client_max_message_size(SSL *s)
         return HELLO_VERIFY_REQUEST_MAX_LENGTH;
 
     case TLS_ST_CR_CERT:
+    case TLS_ST_CR_COMP_CERT:
         return s->max_cert_list;
 
     case TLS_ST_CR_CERT_VRFY:
@@ -1032,6 +1066,9 @@ MSG_PROCESS_RETURN ossl_statem_client_process_message(SSL *s, PACKET *pkt)
     case TLS_ST_CR_CERT:
         return tls_process_server_certificate(s, pkt);
 
+    case TLS_ST_CR_COMP_CERT:
+        return tls_process_server_compressed_certificate(s, pkt);
+
     case TLS_ST_CR_CERT_VRFY:
         return tls_process_cert_verify(s, pkt);
 
@@ -1082,6 +1119,7 @@ WORK_STATE ossl_statem_client_post_process_message(SSL *s, WORK_STATE wst)
         return WORK_ERROR;
 
     case TLS_ST_CR_CERT:
+    case TLS_ST_CR_COMP_CERT:
         return tls_post_process_server_certificate(s, wst);
 
     case TLS_ST_CR_CERT_VRFY:
@@ -1770,6 +1808,20 @@ static MSG_PROCESS_RETURN tls_process_as_hello_retry_request(SSL *s,
 }
 
 /* prepare server cert verification by setting s->session->peer_chain from pkt */
+MSG_PROCESS_RETURN tls_process_server_compressed_certificate(SSL *s,
+                                                             PACKET *pkt)
+{
+    MSG_PROCESS_RETURN ret = MSG_PROCESS_ERROR;
+    BUF_MEM *buf = BUF_MEM_new();
+    PACKET tmppkt;
+
+    if (tls13_process_compressed_certificate(s, pkt, &tmppkt, buf))
+        ret = tls_process_server_certificate(s, &tmppkt);
+
+    BUF_MEM_free(buf);
+    return ret;
+}
+
 MSG_PROCESS_RETURN tls_process_server_certificate(SSL *s, PACKET *pkt)
 {
     unsigned long cert_list_len, cert_len;
@@ -3499,6 +3551,27 @@ WORK_STATE tls_prepare_client_certificate(SSL *s, WORK_STATE wst)
     return WORK_ERROR;
 }
 
+/*
+ * In the first TLSv1.3 handshake we switch to the handshake write keys once
+ * our Certificate has been constructed.
+ */
+static int client_certificate_change_cipher_state(SSL *s)
+{
+    if (SSL_IS_TLS13(s)
+            && SSL_IS_FIRST_HANDSHAKE(s)
+            && (!s->method->ssl3_enc->change_cipher_state(s,
+                    SSL3_CC_HANDSHAKE | SSL3_CHANGE_CIPHER_CLIENT_WRITE))) {
+        /*
+         * This is a fatal error, which leaves enc_write_ctx in an inconsistent
+         * state and thus ssl3_send_alert may crash.
+         */
+        SSLfatal(s, SSL_AD_NO_ALERT, SSL_R_CANNOT_CHANGE_CIPHER);
+        return 0;
+    }
+
+    return 1;
+}
+
 int tls_construct_client_certificate(SSL *s, WPACKET *pkt)
 {
     if (SSL_IS_TLS13(s)) {
@@ -3515,24 +3588,34 @@ int tls_construct_client_certificate(SSL *s, WPACKET *pkt)
     }
     if (!ssl3_output_cert_chain(s, pkt,
                                 (s->s3.tmp.cert_req == 2) ? NULL
-                                                           : s->cert->key)) {
+                                                           : s->cert->key,
+                                0)) {
         /* SSLfatal() already called */
         return 0;
     }
 
-    if (SSL_IS_TLS13(s)
-            && SSL_IS_FIRST_HANDSHAKE(s)
-            && (!s->method->ssl3_enc->change_cipher_state(s,
-                    SSL3_CC_HANDSHAKE | SSL3_CHANGE_CIPHER_CLIENT_WRITE))) {
-        /*
-         * This is a fatal error, which leaves enc_write_ctx in an inconsistent
-         * state and thus ssl3_send_alert may crash.
-         */
-        SSLfatal(s, SSL_AD_NO_ALERT, SSL_R_CANNOT_CHANGE_CIPHER);
+    return client_certificate_change_cipher_state(s);
+}
+
+int tls_construct_client_compressed_certificate(SSL *s, WPACKET *pkt)
+{
+    CERT_PKEY *cpk = s->cert->key;
+    int *alg = s->ext.compress_certificate_from_peer;
+    int i;
+
+    /* Prefer an algorithm we already have our Certificate compressed with */
+    for (i = 0; alg[i] != TLSEXT_comp_cert_none; i++)
+        if (cpk->comp_cert[alg[i]] != NULL)
+            break;
+    if (alg[i] == TLSEXT_comp_cert_none)
+        i = 0;
+
+    if (!tls13_construct_compressed_certificate(s, pkt, cpk, alg[i])) {
+        /* SSLfatal() already called */
         return 0;
     }
 
-    return 1;
+    return client_certificate_change_cipher_state(s);
 }
 
 int ssl3_check_cert_and_algorithm(SSL *s)
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2002, Oracle and/or its affiliates. All rights reserved
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
@@ -250,15 +250,13 @@ static int get_cert_verify_tbs_data(SSL *s, unsigned char *tls13tbs,
         *hdata = tls13tbs;
         *hdatalen = TLS13_TBS_PREAMBLE_SIZE + hashlen;
     } else {
-        size_t retlen;
-        long retlen_l;
-
-        retlen = retlen_l = BIO_get_mem_data(s->s3.handshake_buffer, hdata);
-        if (retlen_l <= 0) {
+        if (s->s3.handshake_buffer == NULL
+                || s->s3.handshake_buffer->length == 0) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
             return 0;
         }
-        *hdatalen = retlen;
+        *hdata = s->s3.handshake_buffer->data;
+        *hdatalen = s->s3.handshake_buffer->length;
     }
 
     return 1;
@@ -547,7 +545,7 @@ MSG_PROCESS_RETURN tls_process_cert_verify(SSL *s, PACKET *pkt)
     else
         ret = MSG_PROCESS_CONTINUE_READING;
  err:
-    BIO_free(s->s3.handshake_buffer);
+    BUF_MEM_free(s->s3.handshake_buffer);
     s->s3.handshake_buffer = NULL;
     EVP_MD_CTX_free(mctx);
 #ifndef OPENSSL_NO_GOST
@@ -887,24 +885,40 @@ int tls_construct_change_cipher_spec(SSL *s, WPACKET *pkt)
     return 1;
 }
 
-/* Add a certificate to the WPACKET */
-static int ssl_add_cert_to_wpacket(SSL *s, WPACKET *pkt, X509 *x, int chain)
+/*
+ * Report an error while writing a certificate chain: fatal for the handshake
+ * unless the chain is only being written out to be compressed.
+ */
+static void ssl_cert_chain_error(SSL *s, int for_comp, int reason)
+{
+    if (for_comp)
+        ERR_raise(ERR_LIB_SSL, reason);
+    else
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, reason);
+}
+
+/*
+ * Add a certificate to the WPACKET. Chains written out to be compressed are
+ * always in the TLSv1.3 format, which is the only one they can be sent in.
+ */
+static int ssl_add_cert_to_wpacket(SSL *s, WPACKET *pkt, X509 *x, int chain,
+                                   int for_comp)
 {
     int len;
     unsigned char *outbytes;
 
     len = i2d_X509(x, NULL);
     if (len < 0) {
-        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_BUF_LIB);
+        ssl_cert_chain_error(s, for_comp, ERR_R_BUF_LIB);
         return 0;
     }
     if (!WPACKET_sub_allocate_bytes_u24(pkt, len, &outbytes)
             || i2d_X509(x, &outbytes) != len) {
-        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        ssl_cert_chain_error(s, for_comp, ERR_R_INTERNAL_ERROR);
         return 0;
     }
 
-    if (SSL_IS_TLS13(s)
+    if ((SSL_IS_TLS13(s) || for_comp)
             && !tls_construct_extensions(s, pkt, SSL_EXT_TLS1_3_CERTIFICATE, x,
                                          chain)) {
         /* SSLfatal() already called */
@@ -915,7 +929,8 @@ static int ssl_add_cert_to_wpacket(SSL *s, WPACKET *pkt, X509 *x, int chain)
 }
 
 /* Add certificate chain to provided WPACKET */
-static int ssl_add_cert_chain(SSL *s, WPACKET *pkt, CERT_PKEY *cpk)
+static int ssl_add_cert_chain(SSL *s, WPACKET *pkt, CERT_PKEY *cpk,
+                              int for_comp)
 {
     int i, chain_count;
     X509 *x;
@@ -948,12 +963,12 @@ static int ssl_add_cert_chain(SSL *s, WPACKET *pkt, CERT_PKEY *cpk)
                                                        s->ctx->propq);
 
         if (xs_ctx == NULL) {
-            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+            ssl_cert_chain_error(s, for_comp, ERR_R_MALLOC_FAILURE);
             return 0;
         }
         if (!X509_STORE_CTX_init(xs_ctx, chain_store, x, NULL)) {
             X509_STORE_CTX_free(xs_ctx);
-            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_X509_LIB);
+            ssl_cert_chain_error(s, for_comp, ERR_R_X509_LIB);
             return 0;
         }
         /*
@@ -975,14 +990,14 @@ static int ssl_add_cert_chain(SSL *s, WPACKET *pkt, CERT_PKEY *cpk)
             ERR_raise(ERR_LIB_SSL, SSL_R_CA_MD_TOO_WEAK);
 #endif
             X509_STORE_CTX_free(xs_ctx);
-            SSLfatal(s, SSL_AD_INTERNAL_ERROR, i);
+            ssl_cert_chain_error(s, for_comp, i);
             return 0;
         }
         chain_count = sk_X509_num(chain);
         for (i = 0; i < chain_count; i++) {
             x = sk_X509_value(chain, i);
 
-            if (!ssl_add_cert_to_wpacket(s, pkt, x, i)) {
+            if (!ssl_add_cert_to_wpacket(s, pkt, x, i, for_comp)) {
                 /* SSLfatal() already called */
                 X509_STORE_CTX_free(xs_ctx);
                 return 0;
@@ -992,16 +1007,16 @@ static int ssl_add_cert_chain(SSL *s, WPACKET *pkt, CERT_PKEY *cpk)
     } else {
         i = ssl_security_cert_chain(s, extra_certs, x, 0);
         if (i != 1) {
-            SSLfatal(s, SSL_AD_INTERNAL_ERROR, i);
+            ssl_cert_chain_error(s, for_comp, i);
             return 0;
         }
-        if (!ssl_add_cert_to_wpacket(s, pkt, x, 0)) {
+        if (!ssl_add_cert_to_wpacket(s, pkt, x, 0, for_comp)) {
             /* SSLfatal() already called */
             return 0;
         }
         for (i = 0; i < sk_X509_num(extra_certs); i++) {
             x = sk_X509_value(extra_certs, i);
-            if (!ssl_add_cert_to_wpacket(s, pkt, x, i + 1)) {
+            if (!ssl_add_cert_to_wpacket(s, pkt, x, i + 1, for_comp)) {
                 /* SSLfatal() already called */
                 return 0;
             }
@@ -1010,24 +1025,255 @@ static int ssl_add_cert_chain(SSL *s, WPACKET *pkt, CERT_PKEY *cpk)
     return 1;
 }
 
-unsigned long ssl3_output_cert_chain(SSL *s, WPACKET *pkt, CERT_PKEY *cpk)
+/*
+ * Whether we'd add any TLSv1.3 certificate extensions to our Certificate
+ * message, which then can't be encoded ahead of time.
+ */
+static int cert_has_extensions(SSL *s)
+{
+    custom_ext_methods *exts = &s->cert->custext;
+    size_t i;
+
+    /* An OCSP response to staple to the end-entity certificate */
+    if (s->server && s->ext.status_expected)
+        return 1;
+    /* Custom extensions are only added to certificates when solicited */
+    for (i = 0; i < exts->meths_count; i++) {
+        if ((exts->meths[i].context & SSL_EXT_TLS1_3_CERTIFICATE) != 0
+                && (exts->meths[i].ext_flags & SSL_EXT_FLAG_RECEIVED) != 0)
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ * Add the certificate_list for |cpk| from its shared cache, encoding it and
+ * filling the cache first if this is the first connection to need it.
+ * Returns 1 on success, 0 on failure and -1 if the cache can't be used.
+ */
+static int ssl_output_cached_cert_chain(SSL *s, WPACKET *pkt, CERT_PKEY *cpk)
+{
+    SSL_CERT_MSG_CACHE *mc = cpk->msg_cache;
+    int tls13 = SSL_IS_TLS13(s) ? 1 : 0;
+    unsigned char *data;
+    size_t start, end;
+    int i, done;
+
+    /*
+     * Only a chain of the certificate's own, or none at all, is the same for
+     * every connection: one built from a store could change with the store.
+     */
+    if (mc == NULL
+            || (cpk->chain == NULL
+                && ((s->mode & SSL_MODE_NO_AUTO_CHAIN) == 0
+                    || s->ctx->extra_certs != NULL))
+            || (tls13 && cert_has_extensions(s)))
+        return -1;
+
+    /* The chain is encoded once, but its security is checked every time */
+    i = ssl_security_cert_chain(s, cpk->chain, cpk->x509, 0);
+    if (i != 1) {
+        ssl_cert_chain_error(s, 0, i);
+        return 0;
+    }
+
+    if (!CRYPTO_THREAD_read_lock(mc->lock))
+        return -1;
+    done = mc->data[tls13] != NULL
+           && WPACKET_memcpy(pkt, mc->data[tls13], mc->len[tls13]);
+    CRYPTO_THREAD_unlock(mc->lock);
+    if (done)
+        return 1;
+
+    if (!WPACKET_get_total_written(pkt, &start)
+            || !WPACKET_start_sub_packet_u24(pkt)) {
+        ssl_cert_chain_error(s, 0, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+    if (!ssl_add_cert_chain(s, pkt, cpk, 0))
+        return 0;
+    if (!WPACKET_close(pkt) || !WPACKET_get_total_written(pkt, &end)) {
+        ssl_cert_chain_error(s, 0, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    /* Nothing to cache if |pkt| is only counting bytes */
+    if ((data = WPACKET_get_curr(pkt)) == NULL
+            || (data = OPENSSL_memdup(data - (end - start), end - start))
+               == NULL)
+        return 1;
+    if (!CRYPTO_THREAD_write_lock(mc->lock)) {
+        OPENSSL_free(data);
+        return 1;
+    }
+    if (mc->data[tls13] == NULL) {
+        mc->data[tls13] = data;
+        mc->len[tls13] = end - start;
+        data = NULL;
+    }
+    CRYPTO_THREAD_unlock(mc->lock);
+    OPENSSL_free(data);
+    return 1;
+}
+
+/*
+ * Output the certificate chain of |cpk|. If |for_comp| is set the chain is
+ * being written out to be compressed rather than sent, possibly outside of
+ * any handshake: errors are then raised rather than fatal.
+ */
+unsigned long ssl3_output_cert_chain(SSL *s, WPACKET *pkt, CERT_PKEY *cpk,
+                                     int for_comp)
 {
+    int ret;
+
+    if (!for_comp && cpk != NULL && cpk->x509 != NULL
+            && (ret = ssl_output_cached_cert_chain(s, pkt, cpk)) >= 0)
+        return ret;
+
     if (!WPACKET_start_sub_packet_u24(pkt)) {
-        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        ssl_cert_chain_error(s, for_comp, ERR_R_INTERNAL_ERROR);
         return 0;
     }
 
-    if (!ssl_add_cert_chain(s, pkt, cpk))
+    if (!ssl_add_cert_chain(s, pkt, cpk, for_comp))
         return 0;
 
     if (!WPACKET_close(pkt)) {
-        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        ssl_cert_chain_error(s, for_comp, ERR_R_INTERNAL_ERROR);
         return 0;
     }
 
     return 1;
 }
 
+/*
+ * Whether the Certificate message compressed ahead of time for |cpk| with
+ * |alg| is the one we'd send, i.e. we wouldn't add any extensions to it.
+ */
+static int comp_cert_usable(SSL *s, CERT_PKEY *cpk, int alg)
+{
+    return cpk->comp_cert[alg] != NULL && !cert_has_extensions(s);
+}
+
+/*
+ * Construct a CompressedCertificate message (RFC 8879) for |cpk| with |alg|.
+ * The message compressed ahead of time is used where possible, otherwise the
+ * Certificate message is written out and compressed now.
+ */
+int tls13_construct_compressed_certificate(SSL *s, WPACKET *pkt,
+                                           CERT_PKEY *cpk, int alg)
+{
+    OSSL_COMP_CERT *cc, *tmp = NULL;
+    BUF_MEM *buf = NULL;
+    WPACKET tmppkt;
+    /* Only a client's Certificate has a context, in post-handshake auth */
+    size_t ctxlen = s->server ? 0 : s->pha_context_len;
+    size_t len;
+    int ret = 0;
+
+    if (ctxlen == 0 && comp_cert_usable(s, cpk, alg)) {
+        cc = cpk->comp_cert[alg];
+    } else {
+        if ((buf = BUF_MEM_new()) == NULL || !WPACKET_init(&tmppkt, buf)) {
+            BUF_MEM_free(buf);
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+        if (!WPACKET_sub_memcpy_u8(&tmppkt, s->pha_context, ctxlen)) {
+            WPACKET_cleanup(&tmppkt);
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            goto err;
+        }
+        if (!ssl3_output_cert_chain(s, &tmppkt, cpk, 0)) {
+            /* SSLfatal() already called */
+            WPACKET_cleanup(&tmppkt);
+            goto err;
+        }
+        if (!WPACKET_get_total_written(&tmppkt, &len)
+                || !WPACKET_finish(&tmppkt)) {
+            WPACKET_cleanup(&tmppkt);
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            goto err;
+        }
+        cc = tmp = ossl_comp_cert_from_uncompressed_data(
+                       (unsigned char *)buf->data, len, alg);
+        if (cc == NULL) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, SSL_R_COMPRESSION_FAILURE);
+            goto err;
+        }
+    }
+
+    if (!WPACKET_put_bytes_u16(pkt, alg)
+            || !WPACKET_put_bytes_u24(pkt, cc->orig_len)
+            || !WPACKET_sub_memcpy_u24(pkt, cc->data, cc->len)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    ret = 1;
+ err:
+    ossl_comp_cert_free(tmp);
+    BUF_MEM_free(buf);
+    return ret;
+}
+
+/*
+ * Decompress the CompressedCertificate message (RFC 8879) in |pkt| into
+ * |buf|, and point |tmppkt| at the Certificate message it holds.
+ */
+int tls13_process_compressed_certificate(SSL *s, PACKET *pkt, PACKET *tmppkt,
+                                         BUF_MEM *buf)
+{
+    unsigned int alg;
+    size_t expected_length, comp_length, i;
+
+    if (buf == NULL) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    if (!PACKET_get_net_2(pkt, &alg)) {
+        SSLfatal(s, SSL_AD_DECODE_ERROR, SSL_R_LENGTH_MISMATCH);
+        return 0;
+    }
+    /* It must be one of the algorithms we offered */
+    for (i = 0; s->cert_comp_prefs[i] != TLSEXT_comp_cert_none; i++)
+        if ((unsigned int)s->cert_comp_prefs[i] == alg)
+            break;
+    if (s->cert_comp_prefs[i] == TLSEXT_comp_cert_none) {
+        SSLfatal(s, SSL_AD_ILLEGAL_PARAMETER,
+                 SSL_R_INVALID_COMPRESSION_ALGORITHM);
+        return 0;
+    }
+    if (!PACKET_get_net_3_len(pkt, &expected_length)
+            || !PACKET_get_net_3_len(pkt, &comp_length)
+            || PACKET_remaining(pkt) != comp_length
+            || comp_length == 0) {
+        SSLfatal(s, SSL_AD_DECODE_ERROR, SSL_R_LENGTH_MISMATCH);
+        return 0;
+    }
+    /* Don't let a small message expand to more than we'd accept */
+    if (expected_length == 0 || expected_length > s->max_cert_list) {
+        SSLfatal(s, SSL_AD_BAD_CERTIFICATE, SSL_R_EXCESSIVE_MESSAGE_SIZE);
+        return 0;
+    }
+    if (!BUF_MEM_grow(buf, expected_length)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    if (!ossl_comp_cert_expand(alg, (unsigned char *)buf->data,
+                               expected_length,
+                               (unsigned char *)PACKET_data(pkt),
+                               comp_length)) {
+        SSLfatal(s, SSL_AD_BAD_CERTIFICATE, SSL_R_BAD_DECOMPRESSION);
+        return 0;
+    }
+    if (!PACKET_buf_init(tmppkt, (unsigned char *)buf->data,
+                         expected_length)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+    return 1;
+}
+
 /*
  * Tidy up after the end of a handshake. In the case of SCTP this may result
  * in NBIO events. If |clearbufs| is set then init_buf and the wbio buffer is
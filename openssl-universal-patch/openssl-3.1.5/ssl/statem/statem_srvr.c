@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2002, Oracle and/or its affiliates. All rights reserved
  * Copyright 2005 Nokia. All rights reserved.
  *
@@ -90,6 +90,11 @@ static int ossl_statem_server13_read_transition(SSL *s, int mt)
                 st->hand_state = TLS_ST_SR_CERT;
                 return 1;
             }
+            if (mt == SSL3_MT_COMPRESSED_CERTIFICATE
+                    && s->ext.compress_certificate_sent) {
+                st->hand_state = TLS_ST_SR_COMP_CERT;
+                return 1;
+            }
         } else {
             if (mt == SSL3_MT_FINISHED) {
                 st->hand_state = TLS_ST_SR_FINISHED;
@@ -99,6 +104,7 @@ static int ossl_statem_server13_read_transition(SSL *s, int mt)
         break;
 
     case TLS_ST_SR_CERT:
+    case TLS_ST_SR_COMP_CERT:
         if (s->session->peer == NULL) {
             if (mt == SSL3_MT_FINISHED) {
                 st->hand_state = TLS_ST_SR_FINISHED;
@@ -132,6 +138,12 @@ static int ossl_statem_server13_read_transition(SSL *s, int mt)
             st->hand_state = TLS_ST_SR_CERT;
             return 1;
         }
+        if (mt == SSL3_MT_COMPRESSED_CERTIFICATE
+                && s->post_handshake_auth == SSL_PHA_REQUESTED
+                && s->ext.compress_certificate_sent) {
+            st->hand_state = TLS_ST_SR_COMP_CERT;
+            return 1;
+        }
 
         if (mt == SSL3_MT_KEY_UPDATE) {
             st->hand_state = TLS_ST_SR_KEY_UPDATE;
@@ -404,6 +416,25 @@ int send_certificate_request(SSL *s)
     return 0;
 }
 
+/*
+ * Returns the algorithm to compress our Certificate with, or
+ * TLSEXT_comp_cert_none to send it uncompressed.  We only compress with an
+ * algorithm the client can decompress that our certificate chain has been
+ * compressed with ahead of time (RFC 8879).
+ */
+static int get_compressed_certificate_alg(SSL *s)
+{
+    CERT_PKEY *cpk = s->s3.tmp.cert;
+    int *alg = s->ext.compress_certificate_from_peer;
+
+    if (cpk == NULL)
+        return TLSEXT_comp_cert_none;
+    for (; *alg != TLSEXT_comp_cert_none; alg++)
+        if (cpk->comp_cert[*alg] != NULL)
+            break;
+    return *alg;
+}
+
 /*
  * ossl_statem_server13_write_transition() works out what handshake state to
  * move to next when a TLSv1.3 server is writing messages to be sent to the
@@ -466,6 +497,8 @@ static WRITE_TRAN ossl_statem_server13_write_transition(SSL *s)
             st->hand_state = TLS_ST_SW_FINISHED;
         else if (send_certificate_request(s))
             st->hand_state = TLS_ST_SW_CERT_REQ;
+        else if (get_compressed_certificate_alg(s) != TLSEXT_comp_cert_none)
+            st->hand_state = TLS_ST_SW_COMP_CERT;
         else
             st->hand_state = TLS_ST_SW_CERT;
 
@@ -475,12 +508,16 @@ static WRITE_TRAN ossl_statem_server13_write_transition(SSL *s)
         if (s->post_handshake_auth == SSL_PHA_REQUEST_PENDING) {
             s->post_handshake_auth = SSL_PHA_REQUESTED;
             st->hand_state = TLS_ST_OK;
+        } else if (get_compressed_certificate_alg(s)
+                   != TLSEXT_comp_cert_none) {
+            st->hand_state = TLS_ST_SW_COMP_CERT;
         } else {
             st->hand_state = TLS_ST_SW_CERT;
         }
         return WRITE_TRAN_CONTINUE;
 
     case TLS_ST_SW_CERT:
+    case TLS_ST_SW_COMP_CERT:
         st->hand_state = TLS_ST_SW_CERT_VRFY;
         return WRITE_TRAN_CONTINUE;
 
@@ -1054,6 +1091,11 @@ int ossl_statem_server_construct_message(SSL *s, WPACKET *pkt,
         *mt = SSL3_MT_CERTIFICATE;
         break;
 
+    case TLS_ST_SW_COMP_CERT:
+        *confunc = tls_construct_server_compressed_certificate;
+        *mt = SSL3_MT_COMPRESSED_CERTIFICATE;
+        break;
+
     case TLS_ST_SW_CERT_VRFY:
         *confunc = tls_construct_cert_verify;
         *mt = SSL3_MT_CERTIFICATE_VERIFY;
@@ -1149,6 +1191,7 @@ size_t ossl_statem_server_max_message_size(SSL *s)
         return END_OF_EARLY_DATA_MAX_LENGTH;
 
     case TLS_ST_SR_CERT:
+    case TLS_ST_SR_COMP_CERT:
         return s->max_cert_list;
 
     case TLS_ST_SR_KEY_EXCH:
@@ -1195,6 +1238,9 @@ MSG_PROCESS_RETURN ossl_statem_server_process_message(SSL *s, PACKET *pkt)
     case TLS_ST_SR_CERT:
         return tls_process_client_certificate(s, pkt);
 
+    case TLS_ST_SR_COMP_CERT:
+        return tls_process_client_compressed_certificate(s, pkt);
+
     case TLS_ST_SR_KEY_EXCH:
         return tls_process_client_key_exchange(s, pkt);
 
@@ -2077,7 +2123,10 @@ static int tls_handle_status_request(SSL *s)
              * Set current certificate to one we will use so SSL_get_certificate
              * et al can pick it up.
              */
-            s->cert->key = s->s3.tmp.cert;
+            if (!ssl_cert_set_current_tmp(s)) {
+                SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+                return 0;
+            }
             ret = s->ctx->ext.status_cb(s, s->ctx->ext.status_arg);
             switch (ret) {
                 /* We don't want to send a status request response */
@@ -3409,6 +3458,20 @@ WORK_STATE tls_post_process_client_key_exchange(SSL *s, WORK_STATE wst)
     return WORK_FINISHED_CONTINUE;
 }
 
+MSG_PROCESS_RETURN tls_process_client_compressed_certificate(SSL *s,
+                                                             PACKET *pkt)
+{
+    MSG_PROCESS_RETURN ret = MSG_PROCESS_ERROR;
+    BUF_MEM *buf = BUF_MEM_new();
+    PACKET tmppkt;
+
+    if (tls13_process_compressed_certificate(s, pkt, &tmppkt, buf))
+        ret = tls_process_client_certificate(s, &tmppkt);
+
+    BUF_MEM_free(buf);
+    return ret;
+}
+
 MSG_PROCESS_RETURN tls_process_client_certificate(SSL *s, PACKET *pkt)
 {
     int i;
@@ -3610,7 +3673,7 @@ int tls_construct_server_certificate(SSL *s, WPACKET *pkt)
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
         return 0;
     }
-    if (!ssl3_output_cert_chain(s, pkt, cpk)) {
+    if (!ssl3_output_cert_chain(s, pkt, cpk, 0)) {
         /* SSLfatal() already called */
         return 0;
     }
@@ -3618,6 +3681,18 @@ int tls_construct_server_certificate(SSL *s, WPACKET *pkt)
     return 1;
 }
 
+int tls_construct_server_compressed_certificate(SSL *s, WPACKET *pkt)
+{
+    int alg = get_compressed_certificate_alg(s);
+
+    if (alg == TLSEXT_comp_cert_none) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    return tls13_construct_compressed_certificate(s, pkt, s->s3.tmp.cert, alg);
+}
+
 static int create_ticket_prequel(SSL *s, WPACKET *pkt, uint32_t age_add,
                                  unsigned char *tick_nonce)
 {
@@ -3670,6 +3745,7 @@ static int construct_stateless_ticket(SSL *s, WPACKET *pkt, uint32_t age_add,
     unsigned char *senc = NULL;
     EVP_CIPHER_CTX *ctx = NULL;
     SSL_HMAC *hctx = NULL;
+    SSL_TICKET_CRYPTO *tc = NULL;
     unsigned char *p, *encdata1, *encdata2, *macdata1, *macdata2;
     const unsigned char *const_p;
     int len, slen_full, slen, lenfinal;
@@ -3697,13 +3773,6 @@ static int construct_stateless_ticket(SSL *s, WPACKET *pkt, uint32_t age_add,
         goto err;
     }
 
-    ctx = EVP_CIPHER_CTX_new();
-    hctx = ssl_hmac_new(tctx);
-    if (ctx == NULL || hctx == NULL) {
-        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
-        goto err;
-    }
-
     p = senc;
     if (!i2d_SSL_SESSION(s->session, &p)) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
@@ -3747,6 +3816,13 @@ static int construct_stateless_ticket(SSL *s, WPACKET *pkt, uint32_t age_add,
     {
         int ret = 0;
 
+        ctx = EVP_CIPHER_CTX_new();
+        hctx = ssl_hmac_new(tctx);
+        if (ctx == NULL || hctx == NULL) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+
         if (tctx->ext.ticket_key_evp_cb != NULL)
             ret = tctx->ext.ticket_key_evp_cb(s, key_name, iv, ctx,
                                               ssl_hmac_get0_EVP_MAC_CTX(hctx),
@@ -3789,30 +3865,23 @@ static int construct_stateless_ticket(SSL *s, WPACKET *pkt, uint32_t age_add,
             goto err;
         }
     } else {
-        EVP_CIPHER *cipher = EVP_CIPHER_fetch(s->ctx->libctx, "AES-256-CBC",
-                                              s->ctx->propq);
-
-        if (cipher == NULL) {
-            /* Error is already recorded */
-            SSLfatal_alert(s, SSL_AD_INTERNAL_ERROR);
+        /* The contexts come keyed already, they only need a fresh IV */
+        tc = ssl_ticket_crypto_seal(tctx, key_name);
+        if (tc == NULL) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
             goto err;
         }
+        ctx = tc->cipher;
+        hctx = tc->hmac;
 
-        iv_len = EVP_CIPHER_get_iv_length(cipher);
+        iv_len = EVP_CIPHER_CTX_get_iv_length(ctx);
         if (iv_len < 0
                 || RAND_bytes_ex(s->ctx->libctx, iv, iv_len, 0) <= 0
-                || !EVP_EncryptInit_ex(ctx, cipher, NULL,
-                                       tctx->ext.secure->tick_aes_key, iv)
-                || !ssl_hmac_init(hctx, tctx->ext.secure->tick_hmac_key,
-                                  sizeof(tctx->ext.secure->tick_hmac_key),
-                                  "SHA256")) {
-            EVP_CIPHER_free(cipher);
+                || !EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv)
+                || !ssl_hmac_init(hctx, NULL, 0, NULL)) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
             goto err;
         }
-        EVP_CIPHER_free(cipher);
-        memcpy(key_name, tctx->ext.tick_key_name,
-               sizeof(tctx->ext.tick_key_name));
     }
 
     if (!create_ticket_prequel(s, pkt, age_add, tick_nonce)) {
@@ -3857,8 +3926,12 @@ static int construct_stateless_ticket(SSL *s, WPACKET *pkt, uint32_t age_add,
     ok = 1;
  err:
     OPENSSL_free(senc);
-    EVP_CIPHER_CTX_free(ctx);
-    ssl_hmac_free(hctx);
+    if (tc != NULL) {
+        ssl_ticket_crypto_release(tctx, tc, ok == 1);
+    } else {
+        EVP_CIPHER_CTX_free(ctx);
+        ssl_hmac_free(hctx);
+    }
     return ok;
 }
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -110,12 +110,8 @@ long tls1_default_timeout(void)
 
 int tls1_new(SSL *s)
 {
-    if (!ssl3_new(s))
-        return 0;
-    if (!s->method->ssl_clear(s))
-        return 0;
-
-    return 1;
+    /* ssl3_new() leaves |s| cleared */
+    return ssl3_new(s);
 }
 
 void tls1_free(SSL *s)
@@ -395,6 +391,26 @@ int ssl_load_groups(SSL_CTX *ctx)
     if (!OSSL_PROVIDER_do_all(ctx->libctx, discover_provider_groups, ctx))
         return 0;
 
+    /*
+     * The group names a list can refer to depend on the providers, so
+     * parsed group lists are only shared between SSL_CTXs with the same
+     * groups.
+     */
+    ctx->group_list_hash = 0;
+    for (i = 0; i < ctx->group_list_len; i++) {
+        const TLS_GROUP_INFO *ginf = &ctx->group_list[i];
+
+        ctx->group_list_hash =
+            ssl_list_cache_hash(ctx->group_list_hash, ginf->tlsname,
+                                strlen(ginf->tlsname) + 1);
+        ctx->group_list_hash =
+            ssl_list_cache_hash(ctx->group_list_hash, ginf->realname,
+                                strlen(ginf->realname) + 1);
+        ctx->group_list_hash =
+            ssl_list_cache_hash(ctx->group_list_hash, &ginf->group_id,
+                                sizeof(ginf->group_id));
+    }
+
     for (i = 0; i < OSSL_NELEM(supported_groups_default); i++) {
         for (j = 0; j < ctx->group_list_len; j++) {
             if (ctx->group_list[j].group_id == supported_groups_default[i]) {
@@ -764,8 +780,30 @@ int tls1_set_groups_list(SSL_CTX *ctx, uint16_t **pext, size_t *pextlen,
 {
     gid_cb_st gcb;
     uint16_t *tmparr;
+    size_t len;
     int ret = 0;
 
+    if (pext == NULL) {
+        if (ssl_list_cache_get(SSL_LIST_CACHE_GROUPS, &ctx->group_list_hash,
+                               sizeof(ctx->group_list_hash), str, NULL, NULL,
+                               NULL))
+            return 1;
+    } else if (ctx->group_list_len > 0) {
+        /* A valid list has no duplicates, so it cannot have more groups */
+        len = ctx->group_list_len * sizeof(*tmparr);
+        if ((tmparr = OPENSSL_malloc(len)) == NULL)
+            return 0;
+        if (ssl_list_cache_get(SSL_LIST_CACHE_GROUPS, &ctx->group_list_hash,
+                               sizeof(ctx->group_list_hash), str, tmparr,
+                               &len, NULL)) {
+            OPENSSL_free(*pext);
+            *pext = tmparr;
+            *pextlen = len / sizeof(*tmparr);
+            return 1;
+        }
+        OPENSSL_free(tmparr);
+    }
+
     gcb.gidcnt = 0;
     gcb.gidmax = GROUPLIST_INCREMENT;
     gcb.gid_arr = OPENSSL_malloc(gcb.gidmax * sizeof(*gcb.gid_arr));
@@ -774,6 +812,9 @@ int tls1_set_groups_list(SSL_CTX *ctx, uint16_t **pext, size_t *pextlen,
     gcb.ctx = ctx;
     if (!CONF_parse_list(str, ':', 1, gid_cb, &gcb))
         goto end;
+    ssl_list_cache_put(SSL_LIST_CACHE_GROUPS, &ctx->group_list_hash,
+                       sizeof(ctx->group_list_hash), str, gcb.gid_arr,
+                       gcb.gidcnt * sizeof(*gcb.gid_arr), 0);
     if (pext == NULL) {
         ret = 1;
         goto end;
@@ -1813,6 +1854,7 @@ SSL_TICKET_STATUS tls_decrypt_ticket(SSL *s, const unsigned char *etick,
     unsigned char tick_hmac[EVP_MAX_MD_SIZE];
     SSL_HMAC *hctx = NULL;
     EVP_CIPHER_CTX *ctx = NULL;
+    SSL_TICKET_CRYPTO *tc = NULL;
     SSL_CTX *tctx = s->session_ctx;
 
     if (eticklen == 0) {
@@ -1841,16 +1883,6 @@ SSL_TICKET_STATUS tls_decrypt_ticket(SSL *s, const unsigned char *etick,
     }
 
     /* Initialize session ticket encryption and HMAC contexts */
-    hctx = ssl_hmac_new(tctx);
-    if (hctx == NULL) {
-        ret = SSL_TICKET_FATAL_ERR_MALLOC;
-        goto end;
-    }
-    ctx = EVP_CIPHER_CTX_new();
-    if (ctx == NULL) {
-        ret = SSL_TICKET_FATAL_ERR_MALLOC;
-        goto end;
-    }
 #ifndef OPENSSL_NO_DEPRECATED_3_0
     if (tctx->ext.ticket_key_evp_cb != NULL || tctx->ext.ticket_key_cb != NULL)
 #else
@@ -1860,6 +1892,17 @@ SSL_TICKET_STATUS tls_decrypt_ticket(SSL *s, const unsigned char *etick,
         unsigned char *nctick = (unsigned char *)etick;
         int rv = 0;
 
+        hctx = ssl_hmac_new(tctx);
+        if (hctx == NULL) {
+            ret = SSL_TICKET_FATAL_ERR_MALLOC;
+            goto end;
+        }
+        ctx = EVP_CIPHER_CTX_new();
+        if (ctx == NULL) {
+            ret = SSL_TICKET_FATAL_ERR_MALLOC;
+            goto end;
+        }
+
         if (tctx->ext.ticket_key_evp_cb != NULL)
             rv = tctx->ext.ticket_key_evp_cb(s, nctick,
                                              nctick + TLSEXT_KEYNAME_LENGTH,
@@ -1884,29 +1927,25 @@ SSL_TICKET_STATUS tls_decrypt_ticket(SSL *s, const unsigned char *etick,
         if (rv == 2)
             renew_ticket = 1;
     } else {
-        EVP_CIPHER *aes256cbc = NULL;
-
-        /* Check key name matches */
-        if (memcmp(etick, tctx->ext.tick_key_name,
-                   TLSEXT_KEYNAME_LENGTH) != 0) {
+        /* Look up the key by name, its contexts only need the IV */
+        switch (ssl_ticket_crypto_open(tctx, etick, &tc, &renew_ticket)) {
+        case 0:
             ret = SSL_TICKET_NO_DECRYPT;
             goto end;
+        case 1:
+            break;
+        default:
+            ret = SSL_TICKET_FATAL_ERR_OTHER;
+            goto end;
         }
-
-        aes256cbc = EVP_CIPHER_fetch(s->ctx->libctx, "AES-256-CBC",
-                                     s->ctx->propq);
-        if (aes256cbc == NULL
-            || ssl_hmac_init(hctx, tctx->ext.secure->tick_hmac_key,
-                             sizeof(tctx->ext.secure->tick_hmac_key),
-                             "SHA256") <= 0
-            || EVP_DecryptInit_ex(ctx, aes256cbc, NULL,
-                                  tctx->ext.secure->tick_aes_key,
+        ctx = tc->cipher;
+        hctx = tc->hmac;
+        if (ssl_hmac_init(hctx, NULL, 0, NULL) <= 0
+            || EVP_DecryptInit_ex(ctx, NULL, NULL, NULL,
                                   etick + TLSEXT_KEYNAME_LENGTH) <= 0) {
-            EVP_CIPHER_free(aes256cbc);
             ret = SSL_TICKET_FATAL_ERR_OTHER;
             goto end;
         }
-        EVP_CIPHER_free(aes256cbc);
         if (SSL_IS_TLS13(s))
             renew_ticket = 1;
     }
@@ -1996,8 +2035,13 @@ SSL_TICKET_STATUS tls_decrypt_ticket(SSL *s, const unsigned char *etick,
     ret = SSL_TICKET_NO_DECRYPT;
 
  end:
-    EVP_CIPHER_CTX_free(ctx);
-    ssl_hmac_free(hctx);
+    if (tc != NULL) {
+        ssl_ticket_crypto_release(tctx, tc,
+                                  ret != SSL_TICKET_FATAL_ERR_OTHER);
+    } else {
+        EVP_CIPHER_CTX_free(ctx);
+        ssl_hmac_free(hctx);
+    }
 
     /*
      * If set, the decrypt_ticket_cb() is called unless a fatal error was
@@ -2506,9 +2550,19 @@ static int sig_cb(const char *elem, int len, void *arg)
 int tls1_set_sigalgs_list(CERT *c, const char *str, int client)
 {
     sig_cb_st sig;
-    sig.sigalgcnt = 0;
-    if (!CONF_parse_list(str, ':', 1, sig_cb, &sig))
-        return 0;
+    size_t len = sizeof(sig.sigalgs);
+
+    /* Signature algorithm names are fixed, so the string is the whole key */
+    if (ssl_list_cache_get(SSL_LIST_CACHE_SIGALGS, NULL, 0, str,
+                           c != NULL ? sig.sigalgs : NULL, &len, NULL)) {
+        sig.sigalgcnt = len / sizeof(sig.sigalgs[0]);
+    } else {
+        sig.sigalgcnt = 0;
+        if (!CONF_parse_list(str, ':', 1, sig_cb, &sig))
+            return 0;
+        ssl_list_cache_put(SSL_LIST_CACHE_SIGALGS, NULL, 0, str, sig.sigalgs,
+                           sig.sigalgcnt * sizeof(sig.sigalgs[0]), 0);
+    }
     if (c == NULL)
         return 1;
     return tls1_set_raw_sigalgs(c, sig.sigalgs, sig.sigalgcnt, client);
@@ -3369,7 +3423,11 @@ int tls_choose_sigalg(SSL *s, int fatalerrs)
     if (sig_idx == -1)
         sig_idx = lu->sig_idx;
     s->s3.tmp.cert = &s->cert->pkeys[sig_idx];
-    s->cert->key = s->s3.tmp.cert;
+    if (!ssl_cert_set_current_tmp(s)) {
+        if (fatalerrs)
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
     s->s3.tmp.sigalg = lu;
     return 1;
 }
@@ -3449,12 +3507,18 @@ EVP_MAC_CTX *ssl_hmac_get0_EVP_MAC_CTX(SSL_HMAC *ctx)
     return ctx->ctx;
 }
 
+/*
+ * With a NULL |key| and |md| the context is reset for a new MAC with the key
+ * and digest it already has.
+ */
 int ssl_hmac_init(SSL_HMAC *ctx, void *key, size_t len, char *md)
 {
     OSSL_PARAM params[2], *p = params;
 
     if (ctx->ctx != NULL) {
-        *p++ = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, md, 0);
+        if (md != NULL)
+            *p++ = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+                                                    md, 0);
         *p = OSSL_PARAM_construct_end();
         if (EVP_MAC_init(ctx->ctx, key, len, params))
             return 1;
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -315,31 +315,17 @@ int tls13_setup_key_block(SSL *s)
     return 1;
 }
 
-static int derive_secret_key_and_iv(SSL *s, int sending, const EVP_MD *md,
-                                    const EVP_CIPHER *ciph,
-                                    const unsigned char *insecret,
-                                    const unsigned char *hash,
-                                    const unsigned char *label,
-                                    size_t labellen, unsigned char *secret,
-                                    unsigned char *key, unsigned char *iv,
-                                    EVP_CIPHER_CTX *ciph_ctx)
+/*
+ * Derive the key and iv from a traffic secret and set up |ciph_ctx| with
+ * them.
+ */
+static int derive_key_and_iv(SSL *s, int sending, const EVP_MD *md,
+                             const EVP_CIPHER *ciph,
+                             const unsigned char *secret,
+                             unsigned char *key, unsigned char *iv,
+                             EVP_CIPHER_CTX *ciph_ctx)
 {
     size_t ivlen, keylen, taglen;
-    int hashleni = EVP_MD_get_size(md);
-    size_t hashlen;
-
-    /* Ensure cast to size_t is safe */
-    if (!ossl_assert(hashleni >= 0)) {
-        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_EVP_LIB);
-        return 0;
-    }
-    hashlen = (size_t)hashleni;
-
-    if (!tls13_hkdf_expand(s, md, insecret, label, labellen, hash, hashlen,
-                           secret, hashlen, 1)) {
-        /* SSLfatal() already called */
-        return 0;
-    }
 
     keylen = EVP_CIPHER_get_key_length(ciph);
     if (EVP_CIPHER_get_mode(ciph) == EVP_CIPH_CCM_MODE) {
@@ -385,6 +371,34 @@ static int derive_secret_key_and_iv(SSL *s, int sending, const EVP_MD *md,
     return 1;
 }
 
+static int derive_secret_key_and_iv(SSL *s, int sending, const EVP_MD *md,
+                                    const EVP_CIPHER *ciph,
+                                    const unsigned char *insecret,
+                                    const unsigned char *hash,
+                                    const unsigned char *label,
+                                    size_t labellen, unsigned char *secret,
+                                    unsigned char *key, unsigned char *iv,
+                                    EVP_CIPHER_CTX *ciph_ctx)
+{
+    int hashleni = EVP_MD_get_size(md);
+    size_t hashlen;
+
+    /* Ensure cast to size_t is safe */
+    if (!ossl_assert(hashleni >= 0)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_EVP_LIB);
+        return 0;
+    }
+    hashlen = (size_t)hashleni;
+
+    if (!tls13_hkdf_expand(s, md, insecret, label, labellen, hash, hashlen,
+                           secret, hashlen, 1)) {
+        /* SSLfatal() already called */
+        return 0;
+    }
+
+    return derive_key_and_iv(s, sending, md, ciph, secret, key, iv, ciph_ctx);
+}
+
 int tls13_change_cipher_state(SSL *s, int which)
 {
     /* ASCII: "c e traffic", in hex for EBCDIC compatibility */
@@ -457,9 +471,7 @@ int tls13_change_cipher_state(SSL *s, int which)
     if (((which & SSL3_CC_CLIENT) && (which & SSL3_CC_WRITE))
             || ((which & SSL3_CC_SERVER) && (which & SSL3_CC_READ))) {
         if (which & SSL3_CC_EARLY) {
-            EVP_MD_CTX *mdctx = NULL;
-            long handlen;
-            void *hdata;
+            EVP_MD_CTX *mdctx;
             unsigned int hashlenui;
             const SSL_CIPHER *sslcipher = SSL_SESSION_get0_cipher(s->session);
 
@@ -468,8 +480,8 @@ int tls13_change_cipher_state(SSL *s, int which)
             labellen = sizeof(client_early_traffic) - 1;
             log_label = CLIENT_EARLY_LABEL;
 
-            handlen = BIO_get_mem_data(s->s3.handshake_buffer, &hdata);
-            if (handlen <= 0) {
+            if (s->s3.handshake_buffer == NULL
+                    || s->s3.handshake_buffer->length == 0) {
                 SSLfatal(s, SSL_AD_INTERNAL_ERROR, SSL_R_BAD_HANDSHAKE_LENGTH);
                 goto err;
             }
@@ -498,9 +510,12 @@ int tls13_change_cipher_state(SSL *s, int which)
             /*
              * We need to calculate the handshake digest using the digest from
              * the session. We haven't yet selected our ciphersuite so we can't
-             * use ssl_handshake_md().
+             * use ssl_handshake_md(). The scratch context of
+             * ssl_handshake_hash() is free for this.
              */
-            mdctx = EVP_MD_CTX_new();
+            if (s->s3.handshake_snapshot == NULL)
+                s->s3.handshake_snapshot = EVP_MD_CTX_new();
+            mdctx = s->s3.handshake_snapshot;
             if (mdctx == NULL) {
                 SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
                 goto err;
@@ -513,20 +528,18 @@ int tls13_change_cipher_state(SSL *s, int which)
             if (!ssl_cipher_get_evp_cipher(s->ctx, sslcipher, &cipher)) {
                 /* Error is already recorded */
                 SSLfatal_alert(s, SSL_AD_INTERNAL_ERROR);
-                EVP_MD_CTX_free(mdctx);
                 goto err;
             }
 
             md = ssl_md(s->ctx, sslcipher->algorithm2);
             if (md == NULL || !EVP_DigestInit_ex(mdctx, md, NULL)
-                    || !EVP_DigestUpdate(mdctx, hdata, handlen)
+                    || !EVP_DigestUpdate(mdctx, s->s3.handshake_buffer->data,
+                                         s->s3.handshake_buffer->length)
                     || !EVP_DigestFinal_ex(mdctx, hashval, &hashlenui)) {
                 SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
-                EVP_MD_CTX_free(mdctx);
                 goto err;
             }
             hashlen = hashlenui;
-            EVP_MD_CTX_free(mdctx);
 
             if (!tls13_hkdf_expand(s, md, insecret,
                                    early_exporter_master_secret,
@@ -786,6 +799,55 @@ int tls13_update_key(SSL *s, int sending)
     return ret;
 }
 
+/*
+ * Recreate the application traffic cipher contexts released by
+ * SSL_hibernate(). The current traffic secrets, ivs and record sequence
+ * numbers are all still held in |s|, so unlike tls13_update_key() nothing is
+ * advanced or reset here.
+ */
+int tls13_restore_cipher_state(SSL *s)
+{
+    const EVP_MD *md = ssl_handshake_md(s);
+    const EVP_CIPHER *cipher = s->s3.tmp.new_sym_enc;
+    unsigned char key[EVP_MAX_KEY_LENGTH];
+    unsigned char *rsecret, *wsecret;
+    int ret = 0;
+
+    if (!ossl_assert(md != NULL && cipher != NULL)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    if (s->server) {
+        rsecret = s->client_app_traffic_secret;
+        wsecret = s->server_app_traffic_secret;
+    } else {
+        rsecret = s->server_app_traffic_secret;
+        wsecret = s->client_app_traffic_secret;
+    }
+
+    if ((s->enc_read_ctx == NULL
+         && (s->enc_read_ctx = EVP_CIPHER_CTX_new()) == NULL)
+        || (s->enc_write_ctx == NULL
+            && (s->enc_write_ctx = EVP_CIPHER_CTX_new()) == NULL)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+
+    if (!derive_key_and_iv(s, 0, md, cipher, rsecret, key, s->read_iv,
+                           s->enc_read_ctx)
+        || !derive_key_and_iv(s, 1, md, cipher, wsecret, key, s->write_iv,
+                              s->enc_write_ctx)) {
+        /* SSLfatal() already called */
+        goto err;
+    }
+
+    ret = 1;
+ err:
+    OPENSSL_cleanse(key, sizeof(key));
+    return ret;
+}
+
 int tls13_alert_code(int code)
 {
     /* There are 2 additional alerts in TLSv1.3 compared to TLSv1.2 */
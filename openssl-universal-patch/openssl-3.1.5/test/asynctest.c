@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2015-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -12,6 +12,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <openssl/async.h>
 #include <openssl/crypto.h>
@@ -120,6 +121,121 @@ static int blockpause(void *args)
     return 1;
 }
 
+/* Values that live in callee-saved registers across the pauses */
+static int interleave(void *args)
+{
+    int i, n = *(int *)args;
+    double d = n;
+    long l = n;
+
+    for (i = 0; i < 10; i++) {
+        d = d * 1.5 + 0.25;
+        l = l * 3 + 1;
+        ASYNC_pause_job();
+    }
+    /* Both are exact: 1.5^10 = 59049 / 1024 */
+    return d == n * 57.6650390625 + 28.33251953125
+           && l == n * 59049L + 29524;
+}
+
+static int stack_allocs = 0, stack_frees = 0;
+
+static void *test_alloc_stack(size_t *num)
+{
+    stack_allocs++;
+    *num = 65536;
+    return malloc(*num);
+}
+
+static void test_free_stack(void *addr)
+{
+    stack_frees++;
+    free(addr);
+}
+
+static int test_ASYNC_set_mem_functions(void)
+{
+    ASYNC_stack_alloc_fn alloc_fn;
+    ASYNC_stack_free_fn free_fn;
+    ASYNC_JOB *job = NULL;
+    ASYNC_WAIT_CTX *waitctx = NULL;
+    int funcret, ret = 0, arg = 7;
+
+    /* Not all platforms support this */
+    if (!ASYNC_set_mem_functions(test_alloc_stack, test_free_stack))
+        return 1;
+
+    ASYNC_get_mem_functions(&alloc_fn, &free_fn);
+    if (alloc_fn != test_alloc_stack || free_fn != test_free_stack
+            || (waitctx = ASYNC_WAIT_CTX_new()) == NULL) {
+        fprintf(stderr, "test_ASYNC_set_mem_functions() failed\n");
+        goto err;
+    }
+
+    while (ASYNC_start_job(&job, waitctx, &funcret, interleave, &arg,
+                           sizeof(arg)) == ASYNC_PAUSE)
+        continue;
+    if (job != NULL || funcret != 1 || stack_allocs != 1) {
+        fprintf(stderr, "test_ASYNC_set_mem_functions() - job failed\n");
+        goto err;
+    }
+
+    /* Too late once jobs exist */
+    if (ASYNC_set_mem_functions(test_alloc_stack, test_free_stack)) {
+        fprintf(stderr,
+                "test_ASYNC_set_mem_functions() - second set succeeded\n");
+        goto err;
+    }
+    ret = 1;
+ err:
+    ASYNC_WAIT_CTX_free(waitctx);
+    ASYNC_cleanup_thread();
+    if (ret && stack_frees != stack_allocs) {
+        fprintf(stderr, "test_ASYNC_set_mem_functions() - stack leaked\n");
+        ret = 0;
+    }
+    return ret;
+}
+
+#define NUM_INTERLEAVED 16
+
+static int test_ASYNC_interleave(void)
+{
+    ASYNC_JOB *jobs[NUM_INTERLEAVED];
+    ASYNC_WAIT_CTX *waitctx = NULL;
+    int funcret, i, r, running, ret = 0;
+
+    memset(jobs, 0, sizeof(jobs));
+    if (!ASYNC_init_thread(NUM_INTERLEAVED, NUM_INTERLEAVED)
+            || (waitctx = ASYNC_WAIT_CTX_new()) == NULL)
+        goto err;
+
+    for (i = 0; i < NUM_INTERLEAVED; i++)
+        if (ASYNC_start_job(&jobs[i], waitctx, &funcret, interleave, &i,
+                            sizeof(i)) != ASYNC_PAUSE)
+            goto err;
+    do {
+        running = 0;
+        for (i = 0; i < NUM_INTERLEAVED; i++) {
+            if (jobs[i] == NULL)
+                continue;
+            r = ASYNC_start_job(&jobs[i], waitctx, &funcret, interleave, &i,
+                                sizeof(i));
+            if (r == ASYNC_PAUSE)
+                running = 1;
+            else if (r != ASYNC_FINISH || funcret != 1)
+                goto err;
+        }
+    } while (running);
+    ret = 1;
+ err:
+    if (!ret)
+        fprintf(stderr, "test_ASYNC_interleave() failed\n");
+    ASYNC_WAIT_CTX_free(waitctx);
+    ASYNC_cleanup_thread();
+    return ret;
+}
+
 static int test_ASYNC_init_thread(void)
 {
     ASYNC_JOB *job1 = NULL, *job2 = NULL, *job3 = NULL;
@@ -420,13 +536,15 @@ int main(int argc, char **argv)
         fprintf(stderr,
                 "OpenSSL build is not ASYNC capable - skipping async tests\n");
     } else {
-        if (!test_ASYNC_init_thread()
+        if (!test_ASYNC_set_mem_functions()
+                || !test_ASYNC_init_thread()
                 || !test_ASYNC_callback_status()
                 || !test_ASYNC_start_job()
                 || !test_ASYNC_get_current_job()
                 || !test_ASYNC_WAIT_CTX_get_all_fds()
                 || !test_ASYNC_block_pause()
-                || !test_ASYNC_start_job_ex()) {
+                || !test_ASYNC_start_job_ex()
+                || !test_ASYNC_interleave()) {
             return 1;
         }
     }
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+#include <stdio.h>
+#include <string.h>
+#include <openssl/bio.h>
+#include <openssl/comp.h>
+#include <openssl/objects.h>
+#include <openssl/rand.h>
+
+#include "testutil.h"
+
+#define BUFFER_SIZE    (32 * 1024)
+#define NUM_SIZES      4
+static int sizes[NUM_SIZES] = { 64, 512, 2048, 16 * 1024 };
+
+static unsigned char *original = NULL;
+static unsigned char *result = NULL;
+
+/* Which data to feed: all zeroes, random bytes or repetitive text */
+#define TYPE_ZERO      0
+#define TYPE_RANDOM    1
+#define TYPE_TEXT      2
+#define NUM_TYPES      3
+
+static const char text[] =
+    "The quick brown fox jumps over the lazy dog, again and again. ";
+
+static void fill(int type, int size)
+{
+    int i;
+
+    switch (type) {
+    case TYPE_ZERO:
+        memset(original, 0, size);
+        break;
+    case TYPE_RANDOM:
+        RAND_bytes(original, size);
+        break;
+    default:
+        for (i = 0; i < size; i++)
+            original[i] = text[i % (sizeof(text) - 1)];
+        break;
+    }
+}
+
+#if !defined(OPENSSL_NO_BROTLI) || !defined(OPENSSL_NO_ZSTD)
+/*
+ * Compress |size| bytes of |original| through a BIO of type |meth| in small
+ * writes, then read them back through another one, also in small reads.
+ */
+static int do_bio_comp_test(const BIO_METHOD *meth, int type, int size,
+                            int level, const unsigned char *dict,
+                            size_t dictlen)
+{
+    BIO *bcomp = NULL, *bexp = NULL, *mem = NULL;
+    int osize = 0, n, ret = 0;
+
+    fill(type, size);
+
+    if (!TEST_ptr(bcomp = BIO_new(meth))
+        || !TEST_ptr(mem = BIO_new(BIO_s_mem())))
+        goto err;
+    BIO_push(bcomp, mem);
+    if (level >= 0 && !TEST_long_gt(BIO_set_comp_level(bcomp, level), 0))
+        goto err;
+    if (dict != NULL
+        && !TEST_long_gt(BIO_set_comp_dictionary(bcomp, dict, dictlen), 0))
+        goto err;
+    for (osize = 0; osize < size; osize += n) {
+        n = size - osize < 100 ? size - osize : 100;
+        if (!TEST_int_eq(BIO_write(bcomp, original + osize, n), n))
+            goto err;
+    }
+    if (!TEST_int_gt(BIO_flush(bcomp), 0))
+        goto err;
+    BIO_pop(bcomp);
+
+    if (!TEST_ptr(bexp = BIO_new(meth)))
+        goto err;
+    BIO_push(bexp, mem);
+    if (dict != NULL
+        && !TEST_long_gt(BIO_set_comp_dictionary(bexp, dict, dictlen), 0))
+        goto err;
+    for (osize = 0; osize < BUFFER_SIZE; osize += n) {
+        n = BIO_read(bexp, result + osize, 100);
+        if (n <= 0)
+            break;
+    }
+    if (!TEST_mem_eq(original, size, result, osize))
+        goto err;
+    ret = 1;
+ err:
+    BIO_free(bcomp);
+    BIO_free(bexp);
+    BIO_free(mem);
+    return ret;
+}
+#endif
+
+/* Compress and expand |size| bytes of |original| one block at a time */
+static int do_comp_test(COMP_METHOD *meth, int type, int size)
+{
+    COMP_CTX *c = NULL, *e = NULL;
+    unsigned char *comp = NULL;
+    int clen, elen, ret = 0;
+
+    fill(type, size);
+
+    if (!TEST_ptr(comp = OPENSSL_malloc(BUFFER_SIZE))
+        || !TEST_ptr(c = COMP_CTX_new(meth))
+        || !TEST_ptr(e = COMP_CTX_new(meth)))
+        goto err;
+    clen = COMP_compress_block(c, comp, BUFFER_SIZE, original, size);
+    if (!TEST_int_gt(clen, 0))
+        goto err;
+    elen = COMP_expand_block(e, result, BUFFER_SIZE, comp, clen);
+    if (!TEST_mem_eq(original, size, result, elen))
+        goto err;
+    ret = 1;
+ err:
+    COMP_CTX_free(c);
+    COMP_CTX_free(e);
+    OPENSSL_free(comp);
+    return ret;
+}
+
+static int test_zlib_oneshot(int n)
+{
+    COMP_METHOD *meth = COMP_zlib_oneshot();
+
+    if (COMP_get_type(meth) == NID_undef)
+        return TEST_skip("zlib is not available");
+    return do_comp_test(meth, n / NUM_SIZES, sizes[n % NUM_SIZES]);
+}
+
+#ifndef OPENSSL_NO_BROTLI
+static int test_brotli_bio(int n)
+{
+    return do_bio_comp_test(BIO_f_brotli(), n / NUM_SIZES,
+                            sizes[n % NUM_SIZES], -1, NULL, 0);
+}
+
+static int test_brotli_bio_level(void)
+{
+    return do_bio_comp_test(BIO_f_brotli(), TYPE_TEXT, 2048, 5, NULL, 0);
+}
+
+static int test_brotli(int n)
+{
+    return do_comp_test(COMP_brotli(), n / NUM_SIZES, sizes[n % NUM_SIZES]);
+}
+
+static int test_brotli_oneshot(int n)
+{
+    return do_comp_test(COMP_brotli_oneshot(), n / NUM_SIZES,
+                        sizes[n % NUM_SIZES]);
+}
+#endif
+
+#ifndef OPENSSL_NO_ZSTD
+static int test_zstd_bio(int n)
+{
+    return do_bio_comp_test(BIO_f_zstd(), n / NUM_SIZES,
+                            sizes[n % NUM_SIZES], -1, NULL, 0);
+}
+
+static int test_zstd_bio_level(void)
+{
+    return do_bio_comp_test(BIO_f_zstd(), TYPE_TEXT, 2048, 19, NULL, 0);
+}
+
+static int test_zstd_bio_dictionary(void)
+{
+    return do_bio_comp_test(BIO_f_zstd(), TYPE_TEXT, 2048, -1,
+                            (const unsigned char *)text, sizeof(text) - 1);
+}
+
+static int test_zstd(int n)
+{
+    return do_comp_test(COMP_zstd(), n / NUM_SIZES, sizes[n % NUM_SIZES]);
+}
+
+static int test_zstd_oneshot(int n)
+{
+    return do_comp_test(COMP_zstd_oneshot(), n / NUM_SIZES,
+                        sizes[n % NUM_SIZES]);
+}
+#endif
+
+int setup_tests(void)
+{
+    if (!TEST_ptr(original = OPENSSL_malloc(BUFFER_SIZE))
+        || !TEST_ptr(result = OPENSSL_zalloc(BUFFER_SIZE)))
+        return 0;
+    ADD_ALL_TESTS(test_zlib_oneshot, NUM_TYPES * NUM_SIZES);
+#ifndef OPENSSL_NO_BROTLI
+    ADD_ALL_TESTS(test_brotli_bio, NUM_TYPES * NUM_SIZES);
+    ADD_TEST(test_brotli_bio_level);
+    ADD_ALL_TESTS(test_brotli, NUM_TYPES * NUM_SIZES);
+    ADD_ALL_TESTS(test_brotli_oneshot, NUM_TYPES * NUM_SIZES);
+#endif
+#ifndef OPENSSL_NO_ZSTD
+    ADD_ALL_TESTS(test_zstd_bio, NUM_TYPES * NUM_SIZES);
+    ADD_TEST(test_zstd_bio_level);
+    ADD_TEST(test_zstd_bio_dictionary);
+    ADD_ALL_TESTS(test_zstd, NUM_TYPES * NUM_SIZES);
+    ADD_ALL_TESTS(test_zstd_oneshot, NUM_TYPES * NUM_SIZES);
+#endif
+    return 1;
+}
+
+void cleanup_tests(void)
+{
+    OPENSSL_free(original);
+    OPENSSL_free(result);
+}
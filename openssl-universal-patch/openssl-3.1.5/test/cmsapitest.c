@@ -1,5 +1,5 @@
 /*
- * Copyright 2018-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2018-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -13,6 +13,7 @@
 #include <openssl/bio.h>
 #include <openssl/x509.h>
 #include <openssl/pem.h>
+#include <openssl/thread.h>
 
 #include "testutil.h"
 
@@ -356,6 +357,314 @@ end:
     return ret;
 }
 
+/* Content big enough to be read in many pieces, and split in many chunks */
+#define STREAM_CONTENT_LEN  100000
+
+static unsigned char *stream_content(void)
+{
+    unsigned char *content = OPENSSL_malloc(STREAM_CONTENT_LEN);
+    size_t i;
+
+    if (content != NULL)
+        for (i = 0; i < STREAM_CONTENT_LEN; i++)
+            content[i] = (unsigned char)(i * 7 + (i >> 8));
+    return content;
+}
+
+/*
+ * Encode |cms| in DER, or with indefinite lengths and the content split in
+ * chunks as streaming produces it.
+ */
+static BIO *stream_encode(CMS_ContentInfo *cms, BIO *in, int ber)
+{
+    BIO *out = BIO_new(BIO_s_mem());
+
+    if (!TEST_ptr(out))
+        return NULL;
+    if (ber ? !TEST_true(i2d_CMS_bio_stream(out, cms, in, CMS_STREAM
+                                                            | CMS_BINARY))
+            : !TEST_true(i2d_CMS_bio(out, cms))) {
+        BIO_free(out);
+        return NULL;
+    }
+    return out;
+}
+
+static int check_stream_output(BIO *out, const unsigned char *content)
+{
+    char *data;
+    long len = BIO_get_mem_data(out, &data);
+
+    return TEST_mem_eq(data, len, content, STREAM_CONTENT_LEN);
+}
+
+static int test_stream_decrypt(int idx)
+{
+    int ber = idx == 1, testresult = 0;
+    STACK_OF(X509) *certstack = sk_X509_new_null();
+    unsigned char *content = stream_content();
+    BIO *msgbio = NULL, *encbio = NULL, *contbio = NULL;
+    BIO *outbio = BIO_new(BIO_s_mem());
+    CMS_ContentInfo *cms = NULL;
+
+    if (!TEST_ptr(certstack) || !TEST_ptr(content) || !TEST_ptr(outbio)
+            || !TEST_int_gt(sk_X509_push(certstack, cert), 0)
+            || !TEST_ptr(msgbio = BIO_new_mem_buf(content,
+                                                  STREAM_CONTENT_LEN))
+            || !TEST_ptr(cms = CMS_encrypt(certstack, msgbio,
+                                           EVP_aes_128_cbc(),
+                                           CMS_BINARY
+                                           | (ber ? CMS_STREAM : 0)))
+            || !TEST_ptr(encbio = stream_encode(cms, msgbio, ber)))
+        goto end;
+    CMS_ContentInfo_free(cms);
+
+    if (!TEST_ptr(cms = d2i_CMS_bio_stream(encbio, &contbio, NULL, NULL))
+            || !TEST_true(CMS_decrypt(cms, privkey, cert, contbio, outbio,
+                                      CMS_BINARY))
+            || !check_stream_output(outbio, content))
+        goto end;
+
+    testresult = 1;
+ end:
+    sk_X509_free(certstack);
+    OPENSSL_free(content);
+    BIO_free(msgbio);
+    BIO_free(encbio);
+    BIO_free(contbio);
+    BIO_free(outbio);
+    CMS_ContentInfo_free(cms);
+    return testresult && TEST_int_eq(ERR_peek_error(), 0);
+}
+
+/*
+ * Verify signed data whose signer certificate comes after the content, with
+ * the content intact or with one of its bytes changed.
+ */
+static int test_stream_verify(int idx)
+{
+    int ber = idx % 2 == 1, tamper = idx >= 2, testresult = 0;
+    unsigned char *content = stream_content();
+    BIO *msgbio = NULL, *encbio = NULL, *contbio = NULL;
+    BIO *outbio = BIO_new(BIO_s_mem());
+    CMS_ContentInfo *cms = NULL;
+    char *data;
+    long len;
+    int ret;
+
+    if (!TEST_ptr(content) || !TEST_ptr(outbio)
+            || !TEST_ptr(msgbio = BIO_new_mem_buf(content,
+                                                  STREAM_CONTENT_LEN))
+            || !TEST_ptr(cms = CMS_sign(cert, privkey, NULL, msgbio,
+                                        CMS_BINARY
+                                        | (ber ? CMS_STREAM : 0)))
+            || !TEST_ptr(encbio = stream_encode(cms, msgbio, ber)))
+        goto end;
+    CMS_ContentInfo_free(cms);
+
+    if (tamper) {
+        /* The content is at the middle of the encoding */
+        len = BIO_get_mem_data(encbio, &data);
+        if (!TEST_long_gt(len, STREAM_CONTENT_LEN))
+            goto end;
+        data[STREAM_CONTENT_LEN / 2] ^= 1;
+    }
+
+    if (!TEST_ptr(cms = d2i_CMS_bio_stream(encbio, &contbio, NULL, NULL)))
+        goto end;
+    ret = CMS_verify(cms, NULL, NULL, contbio, outbio,
+                     CMS_BINARY | CMS_NO_SIGNER_CERT_VERIFY);
+    if (tamper) {
+        if (!TEST_false(ret))
+            goto end;
+        ERR_clear_error();
+    } else if (!TEST_true(ret)
+               || !check_stream_output(outbio, content)
+               || !TEST_int_eq(sk_X509_num(CMS_get0_signers(cms)), 1)) {
+        goto end;
+    }
+
+    testresult = 1;
+ end:
+    OPENSSL_free(content);
+    BIO_free(msgbio);
+    BIO_free(encbio);
+    BIO_free(contbio);
+    BIO_free(outbio);
+    CMS_ContentInfo_free(cms);
+    return testresult && TEST_int_eq(ERR_peek_error(), 0);
+}
+
+static int test_stream_data(int idx)
+{
+    int ber = idx == 1, testresult = 0;
+    unsigned char *content = stream_content();
+    BIO *msgbio = NULL, *encbio = NULL, *contbio = NULL;
+    BIO *outbio = BIO_new(BIO_s_mem());
+    CMS_ContentInfo *cms = NULL;
+    char buf[1000];
+    int n;
+
+    if (!TEST_ptr(content) || !TEST_ptr(outbio)
+            || !TEST_ptr(msgbio = BIO_new_mem_buf(content,
+                                                  STREAM_CONTENT_LEN))
+            || !TEST_ptr(cms = CMS_data_create(msgbio,
+                                               CMS_BINARY
+                                               | (ber ? CMS_STREAM : 0)))
+            || !TEST_ptr(encbio = stream_encode(cms, msgbio, ber)))
+        goto end;
+    CMS_ContentInfo_free(cms);
+
+    if (!TEST_ptr(cms = d2i_CMS_bio_stream(encbio, &contbio, NULL, NULL))
+            || !TEST_int_eq(OBJ_obj2nid(CMS_get0_type(cms)), NID_pkcs7_data))
+        goto end;
+    while ((n = BIO_read(contbio, buf, sizeof(buf))) > 0)
+        if (!TEST_int_eq(BIO_write(outbio, buf, n), n))
+            goto end;
+    if (!TEST_int_eq(n, 0)
+            || !TEST_true(BIO_eof(contbio))
+            || !check_stream_output(outbio, content))
+        goto end;
+
+    testresult = 1;
+ end:
+    OPENSSL_free(content);
+    BIO_free(msgbio);
+    BIO_free(encbio);
+    BIO_free(contbio);
+    BIO_free(outbio);
+    CMS_ContentInfo_free(cms);
+    return testresult && TEST_int_eq(ERR_peek_error(), 0);
+}
+
+/* Content that is cut short must not be mistaken for the end */
+static int test_stream_truncated(void)
+{
+    int testresult = 0;
+    unsigned char *content = stream_content();
+    BIO *msgbio = NULL, *encbio = NULL, *truncbio = NULL, *contbio = NULL;
+    BIO *outbio = BIO_new(BIO_s_mem());
+    CMS_ContentInfo *cms = NULL;
+    char *data;
+    long len;
+
+    if (!TEST_ptr(content) || !TEST_ptr(outbio)
+            || !TEST_ptr(msgbio = BIO_new_mem_buf(content,
+                                                  STREAM_CONTENT_LEN))
+            || !TEST_ptr(cms = CMS_sign(cert, privkey, NULL, msgbio,
+                                        CMS_BINARY | CMS_STREAM))
+            || !TEST_ptr(encbio = stream_encode(cms, msgbio, 1)))
+        goto end;
+    CMS_ContentInfo_free(cms);
+
+    len = BIO_get_mem_data(encbio, &data);
+    if (!TEST_ptr(truncbio = BIO_new_mem_buf(data, len / 2))
+            || !TEST_ptr(cms = d2i_CMS_bio_stream(truncbio, &contbio,
+                                                  NULL, NULL))
+            || !TEST_false(CMS_verify(cms, NULL, NULL, contbio, outbio,
+                                      CMS_BINARY
+                                      | CMS_NO_SIGNER_CERT_VERIFY)))
+        goto end;
+    ERR_clear_error();
+
+    testresult = 1;
+ end:
+    OPENSSL_free(content);
+    BIO_free(msgbio);
+    BIO_free(encbio);
+    BIO_free(truncbio);
+    BIO_free(contbio);
+    BIO_free(outbio);
+    CMS_ContentInfo_free(cms);
+    return testresult;
+}
+
+/*
+ * Sign with several signers and digests, in |libctx|, and return the DER
+ * encoding.  Without signed attributes, the RSA signatures and so the whole
+ * encoding are the same every time.
+ */
+static BIO *sign_multiple(OSSL_LIB_CTX *libctx, const unsigned char *content,
+                          int stream)
+{
+    const unsigned int flags = CMS_BINARY | CMS_NOATTR | CMS_PARTIAL;
+    CMS_ContentInfo *cms = NULL;
+    BIO *msgbio = NULL, *out = NULL;
+    int ok = 0;
+
+    if (!TEST_ptr(msgbio = BIO_new_mem_buf(content, STREAM_CONTENT_LEN))
+            || !TEST_ptr(cms = CMS_sign_ex(NULL, NULL, NULL, NULL,
+                                           flags | (stream ? CMS_STREAM : 0),
+                                           libctx, NULL))
+            || !TEST_ptr(CMS_add1_signer(cms, cert, privkey, EVP_sha256(),
+                                         flags))
+            || !TEST_ptr(CMS_add1_signer(cms, cert, privkey, EVP_sha384(),
+                                         flags | CMS_NOCERTS))
+            || !TEST_ptr(CMS_add1_signer(cms, cert, privkey, EVP_sha512(),
+                                         flags | CMS_NOCERTS)))
+        goto end;
+    if (!stream && !TEST_true(CMS_final(cms, msgbio, NULL, CMS_BINARY)))
+        goto end;
+    if (!TEST_ptr(out = stream_encode(cms, msgbio, stream)))
+        goto end;
+    ok = 1;
+ end:
+    if (!ok) {
+        BIO_free(out);
+        out = NULL;
+    }
+    BIO_free(msgbio);
+    CMS_ContentInfo_free(cms);
+    return out;
+}
+
+/* Signing and verifying on worker threads changes nothing in the result */
+static int test_sign_threads(int stream)
+{
+    int testresult = 0;
+    OSSL_LIB_CTX *libctx = NULL;
+    unsigned char *content = NULL;
+    BIO *threaded = NULL, *unthreaded = NULL, *outbio = NULL;
+    CMS_ContentInfo *cms = NULL;
+    char *data1, *data2;
+    long len1, len2;
+
+    if ((OSSL_get_thread_support_flags()
+         & OSSL_THREAD_SUPPORT_FLAG_THREAD_POOL) == 0)
+        return TEST_skip("no thread pool support");
+
+    if (!TEST_ptr(content = stream_content())
+            || !TEST_ptr(libctx = OSSL_LIB_CTX_new())
+            || !TEST_true(OSSL_set_max_threads(libctx, 4)))
+        goto end;
+
+    if (!TEST_ptr(threaded = sign_multiple(libctx, content, stream))
+            || !TEST_ptr(unthreaded = sign_multiple(NULL, content, stream)))
+        goto end;
+    len1 = BIO_get_mem_data(threaded, &data1);
+    len2 = BIO_get_mem_data(unthreaded, &data2);
+    if (!TEST_mem_eq(data1, len1, data2, len2))
+        goto end;
+
+    if (!TEST_ptr(outbio = BIO_new(BIO_s_mem()))
+            || !TEST_ptr(cms = CMS_ContentInfo_new_ex(libctx, NULL))
+            || !TEST_ptr(d2i_CMS_bio(threaded, &cms))
+            || !TEST_true(CMS_verify(cms, NULL, NULL, NULL, outbio,
+                                     CMS_BINARY | CMS_NO_SIGNER_CERT_VERIFY))
+            || !check_stream_output(outbio, content))
+        goto end;
+
+    testresult = 1;
+ end:
+    OPENSSL_free(content);
+    BIO_free(threaded);
+    BIO_free(unthreaded);
+    BIO_free(outbio);
+    CMS_ContentInfo_free(cms);
+    OSSL_LIB_CTX_free(libctx);
+    return testresult && TEST_int_eq(ERR_peek_error(), 0);
+}
+
 OPT_TEST_DECLARE_USAGE("certfile privkeyfile derfile\n")
 
 int setup_tests(void)
@@ -402,6 +711,11 @@ int setup_tests(void)
     ADD_TEST(test_encrypt_decrypt_aes_256_gcm);
     ADD_TEST(test_d2i_CMS_bio_NULL);
     ADD_ALL_TESTS(test_d2i_CMS_decode, 2);
+    ADD_ALL_TESTS(test_stream_decrypt, 2);
+    ADD_ALL_TESTS(test_stream_verify, 4);
+    ADD_ALL_TESTS(test_stream_data, 2);
+    ADD_TEST(test_stream_truncated);
+    ADD_ALL_TESTS(test_sign_threads, 2);
     return 1;
 }
 
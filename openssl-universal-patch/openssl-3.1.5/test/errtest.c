@@ -1,5 +1,5 @@
 /*
- * Copyright 2018-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2018-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -12,6 +12,7 @@
 #include <openssl/err.h>
 #include <openssl/macros.h>
 
+#include "crypto/err.h"
 #include "testutil.h"
 
 #if defined(OPENSSL_SYS_WINDOWS)
@@ -334,6 +335,65 @@ static int test_clear_error(void)
     return res;
 }
 
+/* Errors moved out with ossl_err_state_save_to_mark() must come back intact */
+static int test_save_restore(void)
+{
+    ERR_STATE *saved = NULL;
+    const char *f, *fn, *data;
+    int l, flags, res = 0;
+    unsigned long e;
+#if !defined(OPENSSL_NO_FILENAMES) && !defined(OPENSSL_NO_ERR)
+    const char *file = __FILE__;
+    int line;
+#endif
+
+    ERR_clear_error();
+    ERR_raise(ERR_LIB_NONE, ERR_R_INTERNAL_ERROR);
+    ERR_set_mark();
+#if !defined(OPENSSL_NO_FILENAMES) && !defined(OPENSSL_NO_ERR)
+    line = __LINE__ + 2; /* The error is generated on the ERR_raise_data line */
+#endif
+    ERR_raise_data(ERR_LIB_NONE, ERR_R_MALLOC_FAILURE, "first %d", 1);
+    ERR_raise_data(ERR_LIB_NONE, ERR_R_PASSED_NULL_PARAMETER, "second");
+
+    /* Only the error below the mark is left behind */
+    if (!TEST_ptr(saved = ossl_err_state_save_to_mark())
+            || !TEST_int_eq(ERR_GET_REASON(ERR_get_error()),
+                            ERR_R_INTERNAL_ERROR)
+            || !TEST_ulong_eq(ERR_get_error(), 0))
+        goto err;
+
+    ossl_err_state_restore(saved);
+    if (!TEST_ulong_ne(e = ERR_get_error_all(&f, &l, &fn, &data, &flags), 0)
+            || !TEST_int_eq(ERR_GET_REASON(e), ERR_R_MALLOC_FAILURE)
+#if !defined(OPENSSL_NO_FILENAMES) && !defined(OPENSSL_NO_ERR)
+            || !TEST_int_eq(l, line)
+            || !TEST_str_eq(f, file)
+            || !TEST_str_eq(fn, __func__)
+#endif
+            || !TEST_str_eq(data, "first 1")
+            || !TEST_int_eq(flags, ERR_TXT_STRING | ERR_TXT_MALLOCED)
+            || !TEST_ulong_ne(e = ERR_get_error_all(NULL, NULL, NULL, &data,
+                                                    NULL), 0)
+            || !TEST_int_eq(ERR_GET_REASON(e), ERR_R_PASSED_NULL_PARAMETER)
+            || !TEST_str_eq(data, "second")
+            || !TEST_ulong_eq(ERR_get_error(), 0))
+        goto err;
+
+    /* Nothing to save above the mark */
+    ERR_raise(ERR_LIB_NONE, ERR_R_INTERNAL_ERROR);
+    ERR_set_mark();
+    if (!TEST_ptr_null(ossl_err_state_save_to_mark())
+            || !TEST_ulong_ne(ERR_get_error(), 0))
+        goto err;
+
+    res = 1;
+ err:
+    ossl_err_state_free(saved);
+    ERR_clear_error();
+    return res;
+}
+
 int setup_tests(void)
 {
     ADD_TEST(preserves_system_error);
@@ -344,5 +404,6 @@ int setup_tests(void)
 #endif
     ADD_TEST(test_marks);
     ADD_TEST(test_clear_error);
+    ADD_TEST(test_save_restore);
     return 1;
 }
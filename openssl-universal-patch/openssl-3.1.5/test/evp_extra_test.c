@@ -1684,6 +1684,58 @@ static int test_EVP_md_null(void)
     return ret;
 }
 
+/*
+ * Copying into a context that already holds the same digest reuses it.
+ * Check that the copy carries the state over and leaves the source intact.
+ */
+static int test_EVP_MD_CTX_copy_reuse(void)
+{
+    int ret = 0;
+    EVP_MD *sha256 = NULL;
+    EVP_MD_CTX *in = NULL, *out = NULL, *ref = NULL;
+    unsigned char md_in[EVP_MAX_MD_SIZE], md_out[EVP_MAX_MD_SIZE];
+    unsigned char md_ref[EVP_MAX_MD_SIZE];
+    unsigned int len_in, len_out, len_ref;
+
+    if (!TEST_ptr(sha256 = EVP_MD_fetch(testctx, "SHA256", testpropq))
+        || !TEST_ptr(in = EVP_MD_CTX_new())
+        || !TEST_ptr(out = EVP_MD_CTX_new())
+        || !TEST_ptr(ref = EVP_MD_CTX_new()))
+        goto out;
+
+    if (!TEST_true(EVP_DigestInit_ex(in, sha256, NULL))
+        || !TEST_true(EVP_DigestUpdate(in, "transcript", 10))
+        || !TEST_true(EVP_DigestInit_ex(out, sha256, NULL))
+        || !TEST_true(EVP_DigestUpdate(out, "something else", 14))
+        || !TEST_true(EVP_DigestInit_ex(ref, sha256, NULL))
+        || !TEST_true(EVP_DigestUpdate(ref, "transcript", 10)))
+        goto out;
+
+    /* Take a snapshot, finalise it, and do it again after more input */
+    if (!TEST_true(EVP_MD_CTX_copy_ex(out, in))
+        || !TEST_true(EVP_DigestFinal_ex(out, md_out, &len_out))
+        || !TEST_true(EVP_MD_CTX_copy_ex(out, in))
+        || !TEST_true(EVP_DigestUpdate(out, " hash", 5))
+        || !TEST_true(EVP_DigestFinal_ex(out, md_out, &len_out))
+        || !TEST_true(EVP_DigestUpdate(in, " hash", 5))
+        || !TEST_true(EVP_DigestFinal_ex(in, md_in, &len_in))
+        || !TEST_true(EVP_DigestUpdate(ref, " hash", 5))
+        || !TEST_true(EVP_DigestFinal_ex(ref, md_ref, &len_ref)))
+        goto out;
+
+    if (!TEST_mem_eq(md_out, len_out, md_ref, len_ref)
+        || !TEST_mem_eq(md_in, len_in, md_ref, len_ref))
+        goto out;
+
+    ret = 1;
+ out:
+    EVP_MD_CTX_free(in);
+    EVP_MD_CTX_free(out);
+    EVP_MD_CTX_free(ref);
+    EVP_MD_free(sha256);
+    return ret;
+}
+
 static int test_d2i_AutoPrivateKey(int i)
 {
     int ret = 0;
@@ -1707,7 +1759,119 @@ static int test_d2i_AutoPrivateKey(int i)
     return ret;
 }
 
+static int decode_example_rsa_key(OSSL_DECODER_CTX *dctx)
+{
+    const unsigned char *p = kExampleRSAKeyDER;
+    size_t len = sizeof(kExampleRSAKeyDER);
+
+    return OSSL_DECODER_from_data(dctx, &p, &len);
+}
+
+/*
+ * OSSL_DECODER_CTX_new_for_pkey() caches the decoder chains it builds.  The
+ * contexts handed out must be independent of each other, and the cache must
+ * follow the providers being unloaded and loaded again.
+ */
+static int test_decoder_ctx_cache(void)
+{
+    OSSL_LIB_CTX *ctx = NULL;
+    OSSL_PROVIDER *prov = NULL;
+    OSSL_DECODER_CTX *dctx1 = NULL, *dctx2 = NULL;
+    EVP_PKEY *pkey1 = NULL, *pkey2 = NULL;
+    int ret = 0;
+
+    if (!TEST_ptr(ctx = OSSL_LIB_CTX_new())
+        || !TEST_ptr(prov = OSSL_PROVIDER_load(ctx, "default")))
+        goto err;
+
+    /* The second context is copied from the cached chain */
+    if (!TEST_ptr(dctx1 = OSSL_DECODER_CTX_new_for_pkey(&pkey1, "DER", NULL,
+                                                        "RSA",
+                                                        EVP_PKEY_KEYPAIR,
+                                                        ctx, NULL))
+        || !TEST_ptr(dctx2 = OSSL_DECODER_CTX_new_for_pkey(&pkey2, "DER", NULL,
+                                                           "RSA",
+                                                           EVP_PKEY_KEYPAIR,
+                                                           ctx, NULL))
+        || !TEST_int_gt(OSSL_DECODER_CTX_get_num_decoders(dctx1), 0)
+        || !TEST_int_eq(OSSL_DECODER_CTX_get_num_decoders(dctx1),
+                        OSSL_DECODER_CTX_get_num_decoders(dctx2))
+        || !TEST_true(decode_example_rsa_key(dctx2))
+        || !TEST_ptr(pkey2)
+        || !TEST_ptr_null(pkey1)
+        || !TEST_true(decode_example_rsa_key(dctx1))
+        || !TEST_ptr(pkey1)
+        || !TEST_int_eq(EVP_PKEY_eq(pkey1, pkey2), 1))
+        goto err;
+    OSSL_DECODER_CTX_free(dctx1);
+    OSSL_DECODER_CTX_free(dctx2);
+    dctx1 = dctx2 = NULL;
+    EVP_PKEY_free(pkey1);
+    EVP_PKEY_free(pkey2);
+    pkey1 = pkey2 = NULL;
+
+    /* With the provider gone, there is nothing left to decode with */
+    OSSL_PROVIDER_unload(prov);
+    prov = NULL;
+    if (!TEST_ptr(dctx1 = OSSL_DECODER_CTX_new_for_pkey(&pkey1, "DER", NULL,
+                                                        "RSA",
+                                                        EVP_PKEY_KEYPAIR,
+                                                        ctx, NULL))
+        || !TEST_int_eq(OSSL_DECODER_CTX_get_num_decoders(dctx1), 0))
+        goto err;
+    OSSL_DECODER_CTX_free(dctx1);
+    dctx1 = NULL;
+
+    if (!TEST_ptr(prov = OSSL_PROVIDER_load(ctx, "default"))
+        || !TEST_ptr(dctx1 = OSSL_DECODER_CTX_new_for_pkey(&pkey1, "DER", NULL,
+                                                           "RSA",
+                                                           EVP_PKEY_KEYPAIR,
+                                                           ctx, NULL))
+        || !TEST_true(decode_example_rsa_key(dctx1))
+        || !TEST_ptr(pkey1))
+        goto err;
+
+    ret = 1;
+ err:
+    OSSL_DECODER_CTX_free(dctx1);
+    OSSL_DECODER_CTX_free(dctx2);
+    EVP_PKEY_free(pkey1);
+    EVP_PKEY_free(pkey2);
+    OSSL_PROVIDER_unload(prov);
+    OSSL_LIB_CTX_free(ctx);
+    return ret;
+}
+
 #ifndef OPENSSL_NO_EC
+/* Decoding an EC SubjectPublicKeyInfo must keep the point format */
+static int test_d2i_PUBKEY_ec_point_format(void)
+{
+    EVP_PKEY *pkey = NULL, *pub = NULL;
+    unsigned char *der = NULL, *der2 = NULL;
+    const unsigned char *p;
+    int derlen, der2len, ret = 0;
+
+    if (!TEST_ptr(pkey = load_example_ec_key())
+        || !TEST_true(EVP_PKEY_set_utf8_string_param(pkey,
+                          OSSL_PKEY_PARAM_EC_POINT_CONVERSION_FORMAT,
+                          OSSL_PKEY_EC_POINT_CONVERSION_FORMAT_COMPRESSED))
+        || !TEST_int_gt(derlen = i2d_PUBKEY(pkey, &der), 0))
+        goto err;
+    p = der;
+    if (!TEST_ptr(pub = d2i_PUBKEY_ex(NULL, &p, derlen, testctx, testpropq))
+        || !TEST_int_eq(EVP_PKEY_eq(pkey, pub), 1)
+        || !TEST_int_gt(der2len = i2d_PUBKEY(pub, &der2), 0)
+        || !TEST_mem_eq(der, derlen, der2, der2len))
+        goto err;
+
+    ret = 1;
+ err:
+    OPENSSL_free(der);
+    OPENSSL_free(der2);
+    EVP_PKEY_free(pkey);
+    EVP_PKEY_free(pub);
+    return ret;
+}
 
 static const unsigned char ec_public_sect163k1_validxy[] = {
     0x30, 0x40, 0x30, 0x10, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02,
@@ -5348,12 +5512,17 @@ int setup_tests(void)
 #endif
     ADD_TEST(test_EVP_Digest);
     ADD_TEST(test_EVP_md_null);
+    ADD_TEST(test_EVP_MD_CTX_copy_reuse);
     ADD_ALL_TESTS(test_EVP_PKEY_sign, 3);
 #ifndef OPENSSL_NO_DEPRECATED_3_0
     ADD_ALL_TESTS(test_EVP_PKEY_sign_with_app_method, 2);
 #endif
     ADD_ALL_TESTS(test_EVP_Enveloped, 2);
     ADD_ALL_TESTS(test_d2i_AutoPrivateKey, OSSL_NELEM(keydata));
+    ADD_TEST(test_decoder_ctx_cache);
+#ifndef OPENSSL_NO_EC
+    ADD_TEST(test_d2i_PUBKEY_ec_point_format);
+#endif
     ADD_TEST(test_privatekey_to_pkcs8);
     ADD_TEST(test_EVP_PKCS82PKEY_wrong_tag);
 #ifndef OPENSSL_NO_EC
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/crypto.h>
+#include <openssl/lhash.h>
+#include "internal/nelem.h"
+#include "crypto/hashtable.h"
+#include "testutil.h"
+
+/* The macros below generate unused functions which error out one of the clang
+ * builds.  We disable this check here.
+ */
+#ifdef __clang__
+#pragma clang diagnostic ignored "-Wunused-function"
+#endif
+
+typedef struct {
+    int key;
+    int value;
+} ENTRY;
+
+DEFINE_HASHTABLE_OF(ENTRY);
+
+static unsigned long entry_hash(const ENTRY *e)
+{
+    return (unsigned long)e->key;
+}
+
+/* Forces every item onto one probe sequence */
+static unsigned long entry_hash_bad(const ENTRY *e)
+{
+    return 42;
+}
+
+static int entry_cmp(const ENTRY *a, const ENTRY *b)
+{
+    return a->key - b->key;
+}
+
+static int test_hashtable_basic(void)
+{
+    static const char *const names[] = {
+        "SHA256", "sha256", "AES-128-GCM", "id-aes128-GCM", "RSA", "X25519"
+    };
+    HASHTABLE_OF(ENTRY) *ht;
+    ENTRY e[OSSL_NELEM(names)], dup, tmpl;
+    size_t i;
+    int res = 0;
+
+    if (!TEST_ptr(ht = ossl_ht_ENTRY_new(entry_hash, entry_cmp)))
+        return 0;
+
+    tmpl.key = 1;
+    if (!TEST_size_t_eq(ossl_ht_ENTRY_num_items(ht), 0)
+            || !TEST_ptr_null(ossl_ht_ENTRY_retrieve(ht, &tmpl))
+            || !TEST_ptr_null(ossl_ht_ENTRY_delete(ht, &tmpl)))
+        goto err;
+
+    for (i = 0; i < OSSL_NELEM(names); i++) {
+        e[i].key = (int)OPENSSL_LH_strhash(names[i]);
+        e[i].value = (int)i;
+        if (!TEST_ptr_null(ossl_ht_ENTRY_insert(ht, &e[i]))
+                || !TEST_false(ossl_ht_ENTRY_error(ht)))
+            goto err;
+    }
+    if (!TEST_size_t_eq(ossl_ht_ENTRY_num_items(ht), OSSL_NELEM(names)))
+        goto err;
+
+    for (i = 0; i < OSSL_NELEM(names); i++) {
+        tmpl.key = e[i].key;
+        if (!TEST_ptr_eq(ossl_ht_ENTRY_retrieve(ht, &tmpl), &e[i]))
+            goto err;
+    }
+
+    /* Inserting an equal item replaces and returns the old one */
+    dup = e[2];
+    if (!TEST_ptr_eq(ossl_ht_ENTRY_insert(ht, &dup), &e[2])
+            || !TEST_size_t_eq(ossl_ht_ENTRY_num_items(ht), OSSL_NELEM(names))
+            || !TEST_ptr_eq(ossl_ht_ENTRY_retrieve(ht, &e[2]), &dup))
+        goto err;
+
+    if (!TEST_ptr_eq(ossl_ht_ENTRY_delete(ht, &e[0]), &e[0])
+            || !TEST_ptr_null(ossl_ht_ENTRY_retrieve(ht, &e[0]))
+            || !TEST_ptr_null(ossl_ht_ENTRY_delete(ht, &e[0]))
+            || !TEST_size_t_eq(ossl_ht_ENTRY_num_items(ht),
+                               OSSL_NELEM(names) - 1))
+        goto err;
+
+    res = 1;
+ err:
+    ossl_ht_ENTRY_free(ht);
+    return res;
+}
+
+#define STRESS_KEYS     2000
+#define STRESS_ROUNDS   20000
+
+/*
+ * Random inserts and deletes checked against a plain array, with a table
+ * that grows and shrinks several times.
+ */
+static int test_hashtable_stress(int idx)
+{
+    HASHTABLE_OF(ENTRY) *ht;
+    ENTRY *e = NULL;
+    unsigned char *present = NULL;
+    size_t i, n = 0;
+    int k, res = 0;
+    int keys = idx == 0 ? STRESS_KEYS : STRESS_KEYS / 20;
+
+    if (!TEST_ptr(ht = ossl_ht_ENTRY_new(idx == 0 ? entry_hash
+                                                  : entry_hash_bad,
+                                         entry_cmp))
+            || !TEST_ptr(e = OPENSSL_malloc(sizeof(*e) * keys))
+            || !TEST_ptr(present = OPENSSL_zalloc(keys)))
+        goto err;
+    for (k = 0; k < keys; k++) {
+        e[k].key = k * 7919;
+        e[k].value = k;
+    }
+
+    for (i = 0; i < STRESS_ROUNDS; i++) {
+        k = test_random() % keys;
+        /* Bias towards insertion for the first half, deletion after */
+        if ((test_random() % 4 != 0) == (i < STRESS_ROUNDS / 2)) {
+            if (!TEST_ptr_eq(ossl_ht_ENTRY_insert(ht, &e[k]),
+                             present[k] ? &e[k] : NULL))
+                goto err;
+            n += !present[k];
+            present[k] = 1;
+        } else {
+            if (!TEST_ptr_eq(ossl_ht_ENTRY_delete(ht, &e[k]),
+                             present[k] ? &e[k] : NULL))
+                goto err;
+            n -= present[k];
+            present[k] = 0;
+        }
+        if (!TEST_size_t_eq(ossl_ht_ENTRY_num_items(ht), n))
+            goto err;
+        if (i % 1000 == 0)
+            for (k = 0; k < keys; k++)
+                if (!TEST_ptr_eq(ossl_ht_ENTRY_retrieve(ht, &e[k]),
+                                 present[k] ? &e[k] : NULL)) {
+                    TEST_note("round %zu, key %d", i, k);
+                    goto err;
+                }
+    }
+
+    res = 1;
+ err:
+    ossl_ht_ENTRY_free(ht);
+    OPENSSL_free(e);
+    OPENSSL_free(present);
+    return res;
+}
+
+static void sum_values(ENTRY *e, void *arg)
+{
+    *(int *)arg += e->value;
+}
+
+static int test_hashtable_doall(void)
+{
+    HASHTABLE_OF(ENTRY) *ht;
+    ENTRY e[100];
+    int i, sum = 0, res = 0;
+
+    if (!TEST_ptr(ht = ossl_ht_ENTRY_new(entry_hash, entry_cmp)))
+        return 0;
+    ossl_ht_ENTRY_doall_arg(ht, sum_values, &sum);
+    if (!TEST_int_eq(sum, 0))
+        goto err;
+    for (i = 0; i < (int)OSSL_NELEM(e); i++) {
+        e[i].key = i;
+        e[i].value = i + 1;
+        if (!TEST_ptr_null(ossl_ht_ENTRY_insert(ht, &e[i])))
+            goto err;
+    }
+    ossl_ht_ENTRY_doall_arg(ht, sum_values, &sum);
+    if (!TEST_int_eq(sum, 100 * 101 / 2))
+        goto err;
+
+    res = 1;
+ err:
+    ossl_ht_ENTRY_free(ht);
+    return res;
+}
+
+int setup_tests(void)
+{
+    ADD_TEST(test_hashtable_basic);
+    ADD_ALL_TESTS(test_hashtable_stress, 2);
+    ADD_TEST(test_hashtable_doall);
+    return 1;
+}
@@ -70,6 +70,37 @@ static int test_namemap_stored(void)
         && test_namemap(nm);
 }
 
+static void count_name(const char *name, void *data)
+{
+    (*(int *)data)++;
+}
+
+/* Test that the names of a number come back in the order they were added */
+static int test_namemap_num2name(void)
+{
+    OSSL_NAMEMAP *nm = ossl_namemap_new();
+    int num1, num2, count = 0, ok = 0;
+
+    if (!TEST_ptr(nm)
+        || !TEST_int_ne(num1 = ossl_namemap_add_name(nm, 0, NAME1), 0)
+        || !TEST_int_ne(num2 = ossl_namemap_add_name(nm, 0, NAME2), 0)
+        || !TEST_int_eq(ossl_namemap_add_name(nm, num1, ALIAS1), num1)
+        || !TEST_str_eq(ossl_namemap_num2name(nm, num1, 0), NAME1)
+        || !TEST_str_eq(ossl_namemap_num2name(nm, num1, 1), ALIAS1)
+        || !TEST_ptr_null(ossl_namemap_num2name(nm, num1, 2))
+        || !TEST_str_eq(ossl_namemap_num2name(nm, num2, 0), NAME2)
+        || !TEST_ptr_null(ossl_namemap_num2name(nm, num2 + 1, 0))
+        || !TEST_true(ossl_namemap_doall_names(nm, num1, count_name, &count))
+        || !TEST_int_eq(count, 2)
+        || !TEST_false(ossl_namemap_doall_names(nm, num2 + 1, count_name,
+                                                &count)))
+        goto err;
+    ok = 1;
+ err:
+    ossl_namemap_free(nm);
+    return ok;
+}
+
 /*
  * Test that EVP_get_digestbyname() will use the namemap when it can't find
  * entries in the legacy method database.
@@ -175,6 +206,7 @@ int setup_tests(void)
     ADD_TEST(test_namemap_empty);
     ADD_TEST(test_namemap_independent);
     ADD_TEST(test_namemap_stored);
+    ADD_TEST(test_namemap_num2name);
     ADD_TEST(test_digestbyname);
     ADD_TEST(test_cipherbyname);
     ADD_TEST(test_digest_is_a);
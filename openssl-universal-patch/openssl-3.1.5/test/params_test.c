@@ -17,7 +17,9 @@
 #include <openssl/core.h>
 #include <openssl/err.h>
 #include <openssl/params.h>
+#include <openssl/core_names.h>
 #include "internal/numbers.h"
+#include "internal/param_names.h"
 #include "internal/nelem.h"
 #include "testutil.h"
 
@@ -703,10 +705,36 @@ static int test_more_allocate_from_text(void)
     return check_octetstr_from_hexstr();
 }
 
+static const struct {
+    const char *name;
+    int pidx;
+} param_names[] = {
+    { OSSL_CIPHER_PARAM_IVLEN, PIDX_CIPHER_PARAM_IVLEN },
+    { OSSL_CIPHER_PARAM_AEAD_IVLEN, PIDX_CIPHER_PARAM_IVLEN },
+    { OSSL_CIPHER_PARAM_IV, PIDX_CIPHER_PARAM_IV },
+    { OSSL_CIPHER_PARAM_KEYLEN, PIDX_CIPHER_PARAM_KEYLEN },
+    { OSSL_KDF_PARAM_DIGEST, PIDX_ALG_PARAM_DIGEST },
+    { OSSL_PKEY_PARAM_EC_A, PIDX_PKEY_PARAM_EC_A },
+    { OSSL_PKEY_PARAM_RSA_COEFFICIENT9, PIDX_PKEY_PARAM_RSA_COEFFICIENT9 },
+    { "", -1 },
+    { "i", -1 },
+    { "ivle", -1 },
+    { "ivlen2", -1 },
+    { "IVLEN", -1 },
+    { "no such parameter", -1 }
+};
+
+static int test_param_find_pidx(int i)
+{
+    return TEST_int_eq(ossl_param_find_pidx(param_names[i].name),
+                       param_names[i].pidx);
+}
+
 int setup_tests(void)
 {
     ADD_ALL_TESTS(test_case, OSSL_NELEM(test_cases));
     ADD_ALL_TESTS(test_allocate_from_text, OSSL_NELEM(int_from_text_test_cases));
     ADD_TEST(test_more_allocate_from_text);
+    ADD_ALL_TESTS(test_param_find_pidx, OSSL_NELEM(param_names));
     return 1;
 }
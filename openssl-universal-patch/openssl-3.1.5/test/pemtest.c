@@ -1,5 +1,5 @@
 /*
- * Copyright 2017-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2017-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -23,7 +23,9 @@ static TESTDATA b64_pem_data[] = {
     { "hello world",
       "aGVsbG8gd29ybGQ=" },
     { "a very ooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooong input",
-      "YSB2ZXJ5IG9vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29uZyBpbnB1dA==" }
+      "YSB2ZXJ5IG9vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29vb29uZyBpbnB1dA==" },
+    { "PEM data is decoded in place, so short lines must not corrupt the input.",
+      "UEVNIGRhdGEgaXMgZGVjb2RlZCBpbiBwbGFjZSwg\nc28gc2hvcnQgbGluZXMgbXVzdCBub3QgY29ycnVw\ndCB0aGUgaW5wdXQu" }
 };
 
 static const char *pemtype = "PEMTESTDATA";
@@ -14,6 +14,7 @@
 #include <openssl/store.h>
 #include <openssl/rand.h>
 #include <openssl/core_names.h>
+#include <openssl/evp.h>
 #include "testutil.h"
 
 static int dummy_decoder_decode(void *ctx, OSSL_CORE_BIO *cin, int selection,
@@ -289,9 +290,73 @@ static int fetch_test(int tst)
     return testresult;
 }
 
+static int sign_verify(OSSL_LIB_CTX *signctx, OSSL_LIB_CTX *verifyctx,
+                       EVP_PKEY *pkey)
+{
+    static const unsigned char tbs[32] = { 1 };
+    unsigned char sig[256];
+    size_t siglen = sizeof(sig);
+    EVP_PKEY_CTX *pctx = NULL;
+    int ret = 0;
+
+    if (!TEST_ptr(pctx = EVP_PKEY_CTX_new_from_pkey(signctx, pkey, NULL))
+            || !TEST_int_gt(EVP_PKEY_sign_init(pctx), 0)
+            || !TEST_int_gt(EVP_PKEY_sign(pctx, sig, &siglen, tbs,
+                                          sizeof(tbs)), 0))
+        goto err;
+    EVP_PKEY_CTX_free(pctx);
+    if (!TEST_ptr(pctx = EVP_PKEY_CTX_new_from_pkey(verifyctx, pkey, NULL))
+            || !TEST_int_gt(EVP_PKEY_verify_init(pctx), 0)
+            || !TEST_int_gt(EVP_PKEY_verify(pctx, sig, siglen, tbs,
+                                            sizeof(tbs)), 0))
+        goto err;
+    ret = 1;
+ err:
+    EVP_PKEY_CTX_free(pctx);
+    return ret;
+}
+
+/*
+ * The keys of a library context are used as they are in its children, and
+ * the other way around.  Make sure that works in both directions.
+ */
+static int child_key_test(void)
+{
+    OSSL_LIB_CTX *libctx = OSSL_LIB_CTX_new(), *childctx;
+    OSSL_PROVIDER *dummyprov = NULL;
+    OSSL_PROVIDER *defltprov = NULL;
+    EVP_PKEY *pkey = NULL, *childkey = NULL;
+    int testresult = 0;
+
+    if (!TEST_ptr(libctx)
+            || !TEST_true(OSSL_PROVIDER_add_builtin(libctx, "dummy-prov",
+                                                    dummy_provider_init))
+            || !TEST_ptr(defltprov = OSSL_PROVIDER_load(libctx, "default"))
+            || !TEST_ptr(dummyprov = OSSL_PROVIDER_load(libctx, "dummy-prov"))
+            || !TEST_ptr(childctx = OSSL_PROVIDER_get0_provider_ctx(dummyprov))
+            || !TEST_ptr(pkey = EVP_PKEY_Q_keygen(libctx, NULL, "EC",
+                                                  "P-256"))
+            || !TEST_ptr(childkey = EVP_PKEY_Q_keygen(childctx, NULL, "EC",
+                                                      "P-256"))
+            || !TEST_true(sign_verify(childctx, libctx, pkey))
+            || !TEST_true(sign_verify(libctx, childctx, childkey))
+            || !TEST_int_eq(EVP_PKEY_eq(pkey, childkey), 0))
+        goto err;
+
+    testresult = 1;
+ err:
+    EVP_PKEY_free(pkey);
+    EVP_PKEY_free(childkey);
+    OSSL_PROVIDER_unload(dummyprov);
+    OSSL_PROVIDER_unload(defltprov);
+    OSSL_LIB_CTX_free(libctx);
+    return testresult;
+}
+
 int setup_tests(void)
 {
     ADD_ALL_TESTS(fetch_test, 8);
+    ADD_TEST(child_key_test);
 
     return 1;
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright 2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2021-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the >License>).  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -7,10 +7,12 @@
  * https://www.openssl.org/source/license.html
  */
 
+#include <string.h>
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 #include <openssl/bio.h>
 #include <openssl/core_names.h>
+#include "internal/e_os.h"
 #include "testutil.h"
 
 static int test_rand(void)
@@ -44,10 +46,182 @@ static int test_rand(void)
     return 1;
 }
 
+/* Small requests to a non-standard generator must not be buffered */
+static int test_rand_public_unbuffered(void)
+{
+    EVP_RAND_CTX *pubctx;
+    OSSL_PARAM params[2];
+    unsigned char entropy[] = { 0x10, 0x11, 0x12, 0x13, 0x14, 0x15 };
+    unsigned char outbuf[3];
+
+    params[0] = OSSL_PARAM_construct_octet_string(OSSL_RAND_PARAM_TEST_ENTROPY,
+                                                  entropy, sizeof(entropy));
+    params[1] = OSSL_PARAM_construct_end();
+
+    return TEST_ptr(pubctx = RAND_get0_public(NULL))
+           && TEST_true(EVP_RAND_CTX_set_params(pubctx, params))
+           && TEST_int_gt(RAND_bytes(outbuf, sizeof(outbuf)), 0)
+           && TEST_mem_eq(outbuf, sizeof(outbuf), entropy, sizeof(outbuf))
+           && TEST_int_gt(RAND_bytes(outbuf, sizeof(outbuf)), 0)
+           && TEST_mem_eq(outbuf, sizeof(outbuf),
+                          entropy + sizeof(outbuf), sizeof(outbuf));
+}
+
+/*
+ * Small requests to the standard DRBG are served from a per-thread buffer,
+ * make sure that consecutive requests, also across refills, do not repeat.
+ */
+static int test_rand_public_buffered(void)
+{
+    OSSL_LIB_CTX *libctx = OSSL_LIB_CTX_new();
+    unsigned char prev[16], cur[16], big[65];
+    int i, ret = 0;
+
+    if (!TEST_ptr(libctx)
+            || !TEST_int_gt(RAND_bytes_ex(libctx, prev, sizeof(prev), 0), 0))
+        goto err;
+    for (i = 0; i < 1000; i++) {
+        if (!TEST_int_gt(RAND_bytes_ex(libctx, cur, sizeof(cur), 0), 0)
+                || !TEST_mem_ne(prev, sizeof(prev), cur, sizeof(cur)))
+            goto err;
+        memcpy(prev, cur, sizeof(cur));
+    }
+    /* Requests above the buffering limit and with too high strength */
+    if (!TEST_int_gt(RAND_bytes_ex(libctx, big, sizeof(big), 0), 0)
+            || !TEST_int_le(RAND_bytes_ex(libctx, cur, sizeof(cur), 1024), 0))
+        goto err;
+    ret = 1;
+ err:
+    OSSL_LIB_CTX_free(libctx);
+    return ret;
+}
+
+static int set_uint_param(EVP_RAND_CTX *drbg, const char *name,
+                          unsigned int n)
+{
+    OSSL_PARAM params[2];
+
+    params[0] = OSSL_PARAM_construct_uint(name, &n);
+    params[1] = OSSL_PARAM_construct_end();
+    return EVP_RAND_CTX_set_params(drbg, params);
+}
+
+static unsigned int reseed_counter(EVP_RAND_CTX *drbg)
+{
+    OSSL_PARAM params[2];
+    unsigned int n = 0;
+
+    params[0] = OSSL_PARAM_construct_uint(OSSL_DRBG_PARAM_RESEED_COUNTER, &n);
+    params[1] = OSSL_PARAM_construct_end();
+    if (!EVP_RAND_CTX_get_params(drbg, params))
+        return 0;
+    return n;
+}
+
+/*
+ * The buffered output of the <public> DRBG must not outlive the reseed time
+ * interval configured on it, nor be used at all without one.  Whether a
+ * request reached the DRBG shows in its reseed counter: with the interval
+ * elapsed, or with a reseed after every request, a generate reseeds first.
+ */
+static int test_rand_public_reseed_interval(void)
+{
+    OSSL_LIB_CTX *libctx = OSSL_LIB_CTX_new();
+    EVP_RAND_CTX *pubctx;
+    unsigned char outbuf[16];
+    unsigned int count;
+    int ret = 0;
+
+    if (!TEST_ptr(libctx)
+            || !TEST_ptr(pubctx = RAND_get0_public(libctx))
+            || !TEST_true(set_uint_param(pubctx,
+                                         OSSL_DRBG_PARAM_RESEED_TIME_INTERVAL,
+                                         0))
+            || !TEST_true(set_uint_param(pubctx,
+                                         OSSL_DRBG_PARAM_RESEED_REQUESTS, 1))
+            || !TEST_int_gt(RAND_bytes_ex(libctx, outbuf, sizeof(outbuf), 0),
+                            0))
+        goto err;
+    count = reseed_counter(pubctx);
+    if (!TEST_int_gt(RAND_bytes_ex(libctx, outbuf, sizeof(outbuf), 0), 0)
+            || !TEST_uint_gt(reseed_counter(pubctx), count))
+        goto err;
+
+    if (!TEST_true(set_uint_param(pubctx,
+                                  OSSL_DRBG_PARAM_RESEED_TIME_INTERVAL, 1))
+            || !TEST_int_gt(RAND_bytes_ex(libctx, outbuf, sizeof(outbuf), 0),
+                            0))
+        goto err;
+    ossl_sleep(1500);
+    count = reseed_counter(pubctx);
+    if (!TEST_int_gt(RAND_bytes_ex(libctx, outbuf, sizeof(outbuf), 0), 0)
+            || !TEST_uint_gt(reseed_counter(pubctx), count))
+        goto err;
+    ret = 1;
+ err:
+    OSSL_LIB_CTX_free(libctx);
+    return ret;
+}
+
+/*
+ * A test generator installed with RAND_set0_public() must replace the
+ * buffered output of the old <public> DRBG and must not be buffered itself,
+ * even when it has enough entropy to fill the buffer.
+ */
+static int test_rand_public_set0(void)
+{
+    OSSL_LIB_CTX *libctx = OSSL_LIB_CTX_new();
+    EVP_RAND *rand = NULL;
+    EVP_RAND_CTX *pubctx = NULL;
+    OSSL_PARAM params[3];
+    unsigned int strength = 256;
+    unsigned char *entropy = NULL;
+    unsigned char outbuf[3];
+    size_t i, entropylen = 8192;
+    int ret = 0;
+
+    if (!TEST_ptr(libctx)
+            || !TEST_ptr(entropy = OPENSSL_malloc(entropylen))
+            || !TEST_int_gt(RAND_bytes_ex(libctx, outbuf, sizeof(outbuf), 0),
+                            0))
+        goto err;
+    for (i = 0; i < entropylen; i++)
+        entropy[i] = (unsigned char)i;
+
+    params[0] = OSSL_PARAM_construct_octet_string(OSSL_RAND_PARAM_TEST_ENTROPY,
+                                                  entropy, entropylen);
+    params[1] = OSSL_PARAM_construct_uint(OSSL_RAND_PARAM_STRENGTH, &strength);
+    params[2] = OSSL_PARAM_construct_end();
+    if (!TEST_ptr(rand = EVP_RAND_fetch(libctx, "TEST-RAND", NULL))
+            || !TEST_ptr(pubctx = EVP_RAND_CTX_new(rand, NULL))
+            || !TEST_true(EVP_RAND_instantiate(pubctx, 0, 0, NULL, 0, params))
+            || !TEST_true(RAND_set0_public(libctx, pubctx)))
+        goto err;
+    pubctx = NULL;
+
+    if (!TEST_int_gt(RAND_bytes_ex(libctx, outbuf, sizeof(outbuf), 0), 0)
+            || !TEST_mem_eq(outbuf, sizeof(outbuf), entropy, sizeof(outbuf))
+            || !TEST_int_gt(RAND_bytes_ex(libctx, outbuf, sizeof(outbuf), 0), 0)
+            || !TEST_mem_eq(outbuf, sizeof(outbuf),
+                            entropy + sizeof(outbuf), sizeof(outbuf)))
+        goto err;
+    ret = 1;
+ err:
+    EVP_RAND_CTX_free(pubctx);
+    EVP_RAND_free(rand);
+    OPENSSL_free(entropy);
+    OSSL_LIB_CTX_free(libctx);
+    return ret;
+}
+
 int setup_tests(void)
 {
+    ADD_TEST(test_rand_public_buffered);
+    ADD_TEST(test_rand_public_reseed_interval);
+    ADD_TEST(test_rand_public_set0);
     if (!TEST_true(RAND_set_DRBG_type(NULL, "TEST-RAND", NULL, NULL, NULL)))
         return 0;
     ADD_TEST(test_rand);
+    ADD_TEST(test_rand_public_unbuffered);
     return 1;
 }
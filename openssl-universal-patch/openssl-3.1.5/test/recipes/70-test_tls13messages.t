@@ -1,5 +1,5 @@
 #! /usr/bin/env perl
-# Copyright 2015-2020 The OpenSSL Project Authors. All Rights Reserved.
+# Copyright 2015-2024 The OpenSSL Project Authors. All Rights Reserved.
 #
 # Licensed under the Apache License 2.0 (the "License").  You may not use
 # this file except in compliance with the License.  You can obtain a copy
@@ -33,6 +33,11 @@ plan skip_all => "$test_name needs EC enabled"
 
 $ENV{OPENSSL_ia32cap} = '~0x200000200000000';
 
+#The client compresses its certificate if the server says it can take that
+my $client_cert_mt = disabled("zlib") && disabled("brotli") && disabled("zstd")
+                     ? TLSProxy::Message::MT_CERTIFICATE
+                     : TLSProxy::Message::MT_COMPRESSED_CERTIFICATE;
+
 @handmessages = (
     [TLSProxy::Message::MT_CLIENT_HELLO,
         checkhandshake::ALL_HANDSHAKES],
@@ -52,7 +57,7 @@ $ENV{OPENSSL_ia32cap} = '~0x200000200000000';
         checkhandshake::ALL_HANDSHAKES & ~(checkhandshake::RESUME_HANDSHAKE | checkhandshake::HRR_RESUME_HANDSHAKE)],
     [TLSProxy::Message::MT_FINISHED,
         checkhandshake::ALL_HANDSHAKES],
-    [TLSProxy::Message::MT_CERTIFICATE,
+    [$client_cert_mt,
         checkhandshake::CLIENT_AUTH_HANDSHAKE],
     [TLSProxy::Message::MT_CERTIFICATE_VERIFY,
         checkhandshake::CLIENT_AUTH_HANDSHAKE],
@@ -107,6 +112,9 @@ $ENV{OPENSSL_ia32cap} = '~0x200000200000000';
     [TLSProxy::Message::MT_CLIENT_HELLO, TLSProxy::Message::EXT_POST_HANDSHAKE_AUTH,
         TLSProxy::Message::CLIENT,
         checkhandshake::POST_HANDSHAKE_AUTH_CLI_EXTENSION],
+    [TLSProxy::Message::MT_CLIENT_HELLO, TLSProxy::Message::EXT_COMPRESS_CERTIFICATE,
+        TLSProxy::Message::CLIENT,
+        checkhandshake::CERT_COMP_CLI_EXTENSION],
 
     [TLSProxy::Message::MT_SERVER_HELLO, TLSProxy::Message::EXT_SUPPORTED_VERSIONS,
         TLSProxy::Message::SERVER,
@@ -160,6 +168,9 @@ $ENV{OPENSSL_ia32cap} = '~0x200000200000000';
     [TLSProxy::Message::MT_CLIENT_HELLO, TLSProxy::Message::EXT_POST_HANDSHAKE_AUTH,
         TLSProxy::Message::CLIENT,
         checkhandshake::POST_HANDSHAKE_AUTH_CLI_EXTENSION],
+    [TLSProxy::Message::MT_CLIENT_HELLO, TLSProxy::Message::EXT_COMPRESS_CERTIFICATE,
+        TLSProxy::Message::CLIENT,
+        checkhandshake::CERT_COMP_CLI_EXTENSION],
 
     [TLSProxy::Message::MT_SERVER_HELLO, TLSProxy::Message::EXT_SUPPORTED_VERSIONS,
         TLSProxy::Message::SERVER,
@@ -184,6 +195,9 @@ $ENV{OPENSSL_ia32cap} = '~0x200000200000000';
     [TLSProxy::Message::MT_CERTIFICATE_REQUEST, TLSProxy::Message::EXT_SIG_ALGS,
         TLSProxy::Message::SERVER,
         checkhandshake::DEFAULT_EXTENSIONS],
+    [TLSProxy::Message::MT_CERTIFICATE_REQUEST, TLSProxy::Message::EXT_COMPRESS_CERTIFICATE,
+        TLSProxy::Message::SERVER,
+        checkhandshake::CERT_COMP_SRV_EXTENSION],
 
     [TLSProxy::Message::MT_CERTIFICATE, TLSProxy::Message::EXT_STATUS_REQUEST,
         TLSProxy::Message::SERVER,
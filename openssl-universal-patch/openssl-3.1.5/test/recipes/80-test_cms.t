@@ -159,6 +159,25 @@ my @smime_pkcs7_tests = (
       \&final_compare
     ],
 
+    [ "signed content test streaming BER format, streamed verification",
+      [ "{cmd1}", @prov, "-sign", "-in", $smcont, "-outform", "DER",
+        "-nodetach", "-stream",
+        "-signer", $smrsa1,
+        "-signer", catfile($smdir, "smdsa1.pem"),
+        "-out", "{output}.cms" ],
+      [ "{cmd2}", @prov, "-verify", "-in", "{output}.cms", "-inform", "DER",
+        "-stream", "-CAfile", $smroot, "-out", "{output}.txt" ],
+      \&final_compare
+    ],
+
+    [ "signed content DER format, streamed verification",
+      [ "{cmd1}", @prov, "-sign", "-in", $smcont, "-outform", "DER",
+        "-nodetach", "-signer", $smrsa1, "-out", "{output}.cms" ],
+      [ "{cmd2}", @prov, "-verify", "-in", "{output}.cms", "-inform", "DER",
+        "-stream", "-CAfile", $smroot, "-out", "{output}.txt" ],
+      \&final_compare
+    ],
+
     [ "signed content S/MIME format, RSA key SHA1",
       [ "{cmd1}", @defaultprov, "-sign", "-in", $smcont, "-md", "sha1",
         "-certfile", $smroot,
@@ -200,6 +219,16 @@ my @smime_pkcs7_tests = (
       \&final_compare
     ],
 
+    [ "enveloped content test streaming BER format, streamed decryption",
+      [ "{cmd1}", @defaultprov, "-encrypt", "-in", $smcont,
+        "-outform", "DER", "-aes256", "-stream", "-out", "{output}.cms",
+        $smrsa1 ],
+      [ "{cmd2}", @defaultprov, "-decrypt", "-recip", $smrsa1,
+        "-in", "{output}.cms", "-inform", "DER", "-stream",
+        "-out", "{output}.txt" ],
+      \&final_compare
+    ],
+
     [ "enveloped content test streaming S/MIME format, DES, 3 recipients",
       [ "{cmd1}", @defaultprov, "-encrypt", "-in", $smcont,
         "-stream", "-out", "{output}.cms",
@@ -7,10 +7,12 @@
  * https://www.openssl.org/source/license.html
  */
 
+#include <string.h>
 #include <openssl/crypto.h>
 
 #include "testutil.h"
 #include "internal/e_os.h"
+#include "internal/nelem.h"
 
 static int test_sec_mem(void)
 {
@@ -175,9 +177,70 @@ err:
 #endif
 }
 
+static int test_sec_mem_cache(void)
+{
+#ifndef OPENSSL_NO_SECURE_MEMORY
+    unsigned char *p = NULL, *q = NULL, *chunks[4096 / 32];
+    size_t i, n = 0;
+    int res = 0;
+
+    if (!TEST_true(CRYPTO_secure_malloc_init(4096, 32))
+            || !TEST_ptr(p = OPENSSL_secure_malloc(20)))
+        goto err;
+    memset(p, 0xa5, 20);
+    OPENSSL_secure_free(p);
+
+    /* A freed small chunk is handed back to the same thread, cleared */
+    if (!TEST_size_t_eq(CRYPTO_secure_used(), 0)
+            || !TEST_ptr_eq(q = OPENSSL_secure_malloc(20), p)
+            || !TEST_size_t_eq(CRYPTO_secure_used(), 32))
+        goto err;
+    for (i = 0; i < 20; i++)
+        if (!TEST_uchar_eq(q[i], 0))
+            goto err;
+    OPENSSL_secure_free(q);
+    q = NULL;
+
+    /* Exhaust the heap, release it and check the cached chunks come back */
+    while (n < OSSL_NELEM(chunks)
+           && (chunks[n] = OPENSSL_secure_malloc(32)) != NULL)
+        n++;
+    if (!TEST_size_t_eq(n, OSSL_NELEM(chunks))
+            || !TEST_ptr_null(OPENSSL_secure_malloc(32)))
+        goto err;
+    while (n > 0)
+        OPENSSL_secure_free(chunks[--n]);
+    if (!TEST_size_t_eq(CRYPTO_secure_used(), 0)
+            || !TEST_ptr(q = OPENSSL_secure_malloc(4096))
+            || !TEST_size_t_eq(CRYPTO_secure_used(), 4096))
+        goto err;
+    OPENSSL_secure_free(q);
+    q = NULL;
+
+    /* Memory held in a cache does not keep the heap alive */
+    if (!TEST_ptr(p = OPENSSL_secure_malloc(20)))
+        goto err;
+    OPENSSL_secure_free(p);
+    p = NULL;
+    if (!TEST_true(CRYPTO_secure_malloc_done())
+            || !TEST_false(CRYPTO_secure_malloc_initialized()))
+        goto err;
+    res = 1;
+err:
+    while (n > 0)
+        OPENSSL_secure_free(chunks[--n]);
+    OPENSSL_secure_free(q);
+    CRYPTO_secure_malloc_done();
+    return res;
+#else
+    return 1;
+#endif
+}
+
 int setup_tests(void)
 {
     ADD_TEST(test_sec_mem);
     ADD_TEST(test_sec_mem_clear);
+    ADD_TEST(test_sec_mem_cache);
     return 1;
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2023 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2024 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -20,6 +20,7 @@
 
 #include <openssl/opensslconf.h>
 #include <openssl/bio.h>
+#include <openssl/comp.h>
 #include <openssl/crypto.h>
 #include <openssl/ssl.h>
 #include <openssl/ocsp.h>
@@ -40,6 +41,7 @@
 #include "testutil/output.h"
 #include "internal/nelem.h"
 #include "internal/ktls.h"
+#include "internal/tlsgroups.h"
 #include "../ssl/ssl_local.h"
 #include "filterprov.h"
 
@@ -10637,6 +10639,713 @@ end:
     return testresult;
 }
 
+#ifndef OSSL_NO_USABLE_TLS1_3
+static int comp_cert_rcvd[2], plain_cert_rcvd[2];
+
+static void comp_cert_msg_cb(int write_p, int version, int content_type,
+                             const void *buf, size_t len, SSL *ssl, void *arg)
+{
+    const unsigned char *msg = buf;
+    int server = SSL_is_server(ssl);
+
+    if (write_p || content_type != SSL3_RT_HANDSHAKE || len == 0)
+        return;
+    if (msg[0] == SSL3_MT_COMPRESSED_CERTIFICATE)
+        comp_cert_rcvd[server]++;
+    else if (msg[0] == SSL3_MT_CERTIFICATE)
+        plain_cert_rcvd[server]++;
+}
+
+static int comp_cert_alg_available(int alg)
+{
+# ifndef OPENSSL_NO_COMP
+    switch (alg) {
+    case TLSEXT_comp_cert_zlib:
+        return COMP_get_type(COMP_zlib_oneshot()) != NID_undef;
+#  ifndef OPENSSL_NO_BROTLI
+    case TLSEXT_comp_cert_brotli:
+        return 1;
+#  endif
+#  ifndef OPENSSL_NO_ZSTD
+    case TLSEXT_comp_cert_zstd:
+        return 1;
+#  endif
+    }
+# endif
+    return 0;
+}
+
+/*
+ * Test TLSv1.3 certificate compression (RFC 8879).
+ * Test 0: Server sends a precompressed certificate
+ * Test 1: As test 0, but the server sets SSL_OP_NO_TX_CERTIFICATE_COMPRESSION
+ * Test 2: As test 0, but the client sets SSL_OP_NO_RX_CERTIFICATE_COMPRESSION
+ * Test 3: Server has no precompressed certificate
+ * Test 4: Client authentication, both sides send compressed certificates
+ * Test 5: Post-handshake authentication with a compressed client certificate
+ * Test 6-8: As test 0 with only zlib, brotli or zstd enabled
+ */
+static int test_cert_comp(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    unsigned char *data = NULL;
+    size_t datalen, origlen;
+    int alg, testresult = 0, expected = 1, clientauth = idx == 4 || idx == 5;
+
+    if (idx >= 6) {
+        alg = idx - 5;
+        if (!comp_cert_alg_available(alg))
+            return TEST_skip("Compression algorithm %d not available", alg);
+    } else {
+        for (alg = 1; alg < TLSEXT_comp_cert_limit; alg++)
+            if (comp_cert_alg_available(alg))
+                break;
+        if (alg == TLSEXT_comp_cert_limit)
+            return TEST_skip("No certificate compression algorithms");
+    }
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+                                       TLS_client_method(), TLS1_3_VERSION, 0,
+                                       &sctx, &cctx, cert, privkey)))
+        goto end;
+
+    if (idx >= 6
+            && (!TEST_true(SSL_CTX_set1_cert_comp_preference(sctx, &alg, 1))
+                || !TEST_true(SSL_CTX_set1_cert_comp_preference(cctx, &alg,
+                                                                1))))
+        goto end;
+
+    if (clientauth) {
+        if (!TEST_int_eq(SSL_CTX_use_certificate_file(cctx, cert,
+                                                      SSL_FILETYPE_PEM), 1)
+                || !TEST_int_eq(SSL_CTX_use_PrivateKey_file(cctx, privkey,
+                                                            SSL_FILETYPE_PEM),
+                                1))
+            goto end;
+        if (idx == 4)
+            SSL_CTX_set_verify(sctx, SSL_VERIFY_PEER, verify_cb);
+        else
+            SSL_CTX_set_post_handshake_auth(cctx, 1);
+    }
+
+    if (idx != 3) {
+        if (!TEST_true(SSL_CTX_compress_certs(sctx, idx >= 6 ? alg : 0)))
+            goto end;
+
+        /* Replacing the cached encoding with a copy of itself must work */
+        datalen = SSL_CTX_get1_compressed_cert(sctx, alg, &data, &origlen);
+        if (!TEST_size_t_gt(datalen, 0)
+                || !TEST_size_t_gt(origlen, datalen)
+                || !TEST_true(SSL_CTX_set1_compressed_cert(sctx, alg, data,
+                                                           datalen, origlen)))
+            goto end;
+    } else {
+        expected = 0;
+    }
+
+    if (idx == 1) {
+        SSL_CTX_set_options(sctx, SSL_OP_NO_TX_CERTIFICATE_COMPRESSION);
+        expected = 0;
+    } else if (idx == 2) {
+        SSL_CTX_set_options(cctx, SSL_OP_NO_RX_CERTIFICATE_COMPRESSION);
+        expected = 0;
+    }
+
+    memset(comp_cert_rcvd, 0, sizeof(comp_cert_rcvd));
+    memset(plain_cert_rcvd, 0, sizeof(plain_cert_rcvd));
+    SSL_CTX_set_msg_callback(sctx, comp_cert_msg_cb);
+    SSL_CTX_set_msg_callback(cctx, comp_cert_msg_cb);
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                      NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE)))
+        goto end;
+
+    if (idx == 5) {
+        SSL_set_verify(serverssl, SSL_VERIFY_PEER, verify_cb);
+        if (!TEST_true(SSL_verify_client_post_handshake(serverssl))
+                || !TEST_int_eq(SSL_do_handshake(serverssl), 1)
+                || !TEST_int_le(SSL_read(clientssl, NULL, 0), 0)
+                || !TEST_int_le(SSL_read(serverssl, NULL, 0), 0)
+                || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                    SSL_ERROR_NONE)))
+            goto end;
+    }
+
+    /* What the client received from the server */
+    if (!TEST_int_eq(comp_cert_rcvd[0], expected)
+            || !TEST_int_eq(plain_cert_rcvd[0], !expected))
+        goto end;
+
+    /* What the server received from the client */
+    if (!TEST_int_eq(comp_cert_rcvd[1], clientauth)
+            || !TEST_int_eq(plain_cert_rcvd[1], 0)
+            || (clientauth
+                && !TEST_ptr(SSL_get0_peer_certificate(serverssl))))
+        goto end;
+
+    testresult = 1;
+ end:
+    OPENSSL_free(data);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+#endif /* OSSL_NO_USABLE_TLS1_3 */
+
+/*
+ * Test that the Certificate message of an SSL_CTX certificate is encoded once
+ * and shared between its connections.
+ * Test 0: TLSv1.3, certificate with a chain of its own
+ * Test 1: TLSv1.2, certificate with a chain of its own
+ * Test 2: TLSv1.3, no chain with SSL_MODE_NO_AUTO_CHAIN
+ * Test 3: TLSv1.3, chain built from the store, which isn't cached
+ */
+static int test_cert_msg_cache(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    SSL_CERT_MSG_CACHE *mc;
+    BIO *in = NULL;
+    X509 *rootx = NULL;
+    char *rootfile = NULL;
+    int i, testresult = 0, tls13 = idx != 1, chainlen = idx < 2 ? 2 : 1;
+
+#ifdef OPENSSL_NO_TLS1_2
+    if (idx == 1)
+        return TEST_skip("No TLSv1.2");
+#endif
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (idx != 1)
+        return TEST_skip("No usable TLSv1.3");
+#endif
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+                                       TLS_client_method(), TLS1_VERSION,
+                                       tls13 ? 0 : TLS1_2_VERSION,
+                                       &sctx, &cctx, cert, privkey)))
+        goto end;
+
+    if (idx < 2) {
+        if (!TEST_ptr(rootfile = test_mk_file_path(certsdir, "rootcert.pem"))
+                || !TEST_ptr(in = BIO_new_file(rootfile, "r"))
+                || !TEST_ptr(rootx = X509_new_ex(libctx, NULL))
+                || !TEST_ptr(PEM_read_bio_X509(in, &rootx, NULL, NULL))
+                || !TEST_true(SSL_CTX_add0_chain_cert(sctx, rootx)))
+            goto end;
+        rootx = NULL;
+    } else if (idx == 2) {
+        SSL_CTX_set_mode(sctx, SSL_MODE_NO_AUTO_CHAIN);
+    }
+
+    if (!TEST_ptr(mc = sctx->cert->key->msg_cache))
+        goto end;
+
+    /* The first connection fills the cache, the second one uses it */
+    for (i = 0; i < 2; i++) {
+        if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                          NULL, NULL))
+                || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                    SSL_ERROR_NONE))
+                || !TEST_int_eq(SSL_version(clientssl),
+                                tls13 ? TLS1_3_VERSION : TLS1_2_VERSION)
+                || !TEST_int_eq(sk_X509_num(SSL_get_peer_cert_chain(clientssl)),
+                                chainlen))
+            goto end;
+        if (idx == 3) {
+            if (!TEST_ptr_null(mc->data[tls13]))
+                goto end;
+        } else if (!TEST_ptr(mc->data[tls13])
+                   || !TEST_ptr_null(mc->data[!tls13])) {
+            goto end;
+        }
+        SSL_shutdown(clientssl);
+        SSL_shutdown(serverssl);
+        SSL_free(serverssl);
+        SSL_free(clientssl);
+        serverssl = clientssl = NULL;
+    }
+
+    /* Changing the chain gives later connections a new, empty cache */
+    if (!TEST_true(SSL_CTX_clear_chain_certs(sctx))
+            || !TEST_ptr(sctx->cert->key->msg_cache)
+            || !TEST_ptr_ne(sctx->cert->key->msg_cache, mc)
+            || !TEST_ptr_null(sctx->cert->key->msg_cache->data[tls13]))
+        goto end;
+
+    testresult = 1;
+ end:
+    X509_free(rootx);
+    BIO_free(in);
+    OPENSSL_free(rootfile);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/*
+ * SSL objects share the CERT of their SSL_CTX until either side changes it.
+ * Test 0: Changing the SSL's CERT doesn't affect the SSL_CTX
+ * Test 1: Changing the SSL_CTX's CERT doesn't affect existing SSL objects
+ * Test 2: A handshake with a single certificate keeps the CERTs shared
+ * Test 3: A handshake with custom extensions unshares the CERTs
+ */
+static int test_cert_sharing(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    int level, testresult = 0;
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+                                       TLS_client_method(), TLS1_VERSION, 0,
+                                       &sctx, &cctx, cert, privkey)))
+        goto end;
+    if (idx == 3
+            && !TEST_true(SSL_CTX_add_custom_ext(sctx, TEST_EXT_TYPE1,
+                                                 SSL_EXT_CLIENT_HELLO,
+                                                 NULL, NULL, NULL, NULL,
+                                                 NULL)))
+        goto end;
+    level = SSL_CTX_get_security_level(sctx);
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                      NULL, NULL))
+            || !TEST_ptr_eq(serverssl->cert, sctx->cert)
+            || !TEST_ptr_eq(clientssl->cert, cctx->cert))
+        goto end;
+
+    switch (idx) {
+    case 0:
+        SSL_set_security_level(serverssl, level + 1);
+        if (!TEST_ptr_ne(serverssl->cert, sctx->cert)
+                || !TEST_int_eq(SSL_get_security_level(serverssl), level + 1)
+                || !TEST_int_eq(SSL_CTX_get_security_level(sctx), level)
+                || !TEST_ptr_eq(SSL_get_certificate(serverssl),
+                                SSL_CTX_get0_certificate(sctx)))
+            goto end;
+        break;
+    case 1:
+        SSL_CTX_set_security_level(sctx, level + 1);
+        if (!TEST_ptr_ne(serverssl->cert, sctx->cert)
+                || !TEST_int_eq(SSL_get_security_level(serverssl), level)
+                || !TEST_int_eq(SSL_CTX_get_security_level(sctx), level + 1))
+            goto end;
+        SSL_free(serverssl);
+        serverssl = SSL_new(sctx);
+        if (!TEST_ptr(serverssl)
+                || !TEST_ptr_eq(serverssl->cert, sctx->cert)
+                || !TEST_int_eq(SSL_get_security_level(serverssl), level + 1))
+            goto end;
+        break;
+    case 2:
+    case 3:
+        if (!TEST_true(create_ssl_connection(serverssl, clientssl,
+                                             SSL_ERROR_NONE))
+                || !TEST_ptr_eq(SSL_get_certificate(serverssl),
+                                SSL_CTX_get0_certificate(sctx)))
+            goto end;
+        if (idx == 2) {
+            if (!TEST_ptr_eq(serverssl->cert, sctx->cert)
+                    || !TEST_ptr_eq(clientssl->cert, cctx->cert))
+                goto end;
+        } else if (!TEST_ptr_ne(serverssl->cert, sctx->cert)
+                   || !TEST_ptr_eq(clientssl->cert, cctx->cert)) {
+            goto end;
+        }
+        break;
+    }
+
+    testresult = 1;
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+#ifndef OSSL_NO_USABLE_TLS1_3
+static int hibernate_and_echo(SSL *serverssl, SSL *clientssl)
+{
+    static const char mess[] = "A test message";
+    char buf[sizeof(mess)];
+    size_t written, readbytes;
+
+    return TEST_true(SSL_hibernate(serverssl))
+        && TEST_true(SSL_hibernate(clientssl))
+        && TEST_ptr_null(serverssl->enc_read_ctx)
+        && TEST_ptr_null(clientssl->enc_write_ctx)
+        && TEST_true(SSL_write_ex(clientssl, mess, sizeof(mess), &written))
+        && TEST_true(SSL_read_ex(serverssl, buf, sizeof(buf), &readbytes))
+        && TEST_mem_eq(buf, readbytes, mess, sizeof(mess))
+        && TEST_true(SSL_write_ex(serverssl, mess, sizeof(mess), &written))
+        && TEST_true(SSL_read_ex(clientssl, buf, sizeof(buf), &readbytes))
+        && TEST_mem_eq(buf, readbytes, mess, sizeof(mess));
+}
+
+/*
+ * Test SSL_hibernate() and waking up again.
+ * Test 0: Hibernate and exchange data, twice
+ * Test 1: Key update after hibernating
+ * Test 2: Hibernating fails while application data is unread
+ * Test 3: Post-handshake authentication after hibernating
+ * Test 4: New session ticket and shutdown after hibernating
+ * Test 5: Hibernating fails for TLSv1.2
+ */
+static int test_hibernate(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    int testresult = 0;
+    char buf[20];
+    size_t written, readbytes;
+    EVP_PKEY *pkey = NULL;
+
+#ifdef OPENSSL_NO_TLS1_2
+    if (idx == 5)
+        return TEST_skip("TLSv1.2 is disabled");
+#endif
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+                                       TLS_client_method(), TLS1_VERSION,
+                                       idx == 5 ? TLS1_2_VERSION : 0,
+                                       &sctx, &cctx, cert, privkey)))
+        goto end;
+    if (idx == 3)
+        SSL_CTX_set_post_handshake_auth(cctx, 1);
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                      NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE)))
+        goto end;
+
+    switch (idx) {
+    case 0:
+        if (!TEST_true(hibernate_and_echo(serverssl, clientssl))
+                || !TEST_true(hibernate_and_echo(serverssl, clientssl)))
+            goto end;
+        break;
+    case 1:
+        if (!TEST_true(SSL_hibernate(serverssl))
+                || !TEST_true(SSL_hibernate(clientssl))
+                || !TEST_true(SSL_key_update(clientssl,
+                                             SSL_KEY_UPDATE_REQUESTED))
+                || !TEST_true(SSL_do_handshake(clientssl))
+                || !TEST_true(hibernate_and_echo(serverssl, clientssl)))
+            goto end;
+        break;
+    case 2:
+        if (!TEST_true(SSL_write_ex(clientssl, "0123456789", 10, &written))
+                || !TEST_true(SSL_read_ex(serverssl, buf, 4, &readbytes))
+                || !TEST_false(SSL_hibernate(serverssl))
+                || !TEST_true(SSL_read_ex(serverssl, buf, sizeof(buf),
+                                          &readbytes))
+                || !TEST_size_t_eq(readbytes, 6)
+                || !TEST_true(hibernate_and_echo(serverssl, clientssl)))
+            goto end;
+        break;
+    case 3:
+        if (!TEST_true(SSL_hibernate(serverssl))
+                || !TEST_true(SSL_hibernate(clientssl))
+                || !TEST_ptr(serverssl->s3.handshake_dgst))
+            goto end;
+        SSL_set_verify(serverssl, SSL_VERIFY_PEER, NULL);
+        if (!TEST_true(SSL_verify_client_post_handshake(serverssl))
+                || !TEST_int_eq(SSL_do_handshake(serverssl), 1)
+                || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                    SSL_ERROR_NONE))
+                || !TEST_true(hibernate_and_echo(serverssl, clientssl)))
+            goto end;
+        break;
+    case 4:
+        if (!TEST_true(SSL_hibernate(serverssl))
+                || !TEST_true(SSL_hibernate(clientssl))
+                || !TEST_ptr_null(serverssl->s3.handshake_dgst)
+                || !TEST_false(SSL_get_peer_tmp_key(serverssl, &pkey))
+                || !TEST_true(SSL_new_session_ticket(serverssl))
+                || !TEST_int_eq(SSL_do_handshake(serverssl), 1)
+                || !TEST_true(hibernate_and_echo(serverssl, clientssl))
+                || !TEST_true(SSL_hibernate(serverssl))
+                || !TEST_true(SSL_hibernate(clientssl))
+                || !TEST_int_eq(SSL_shutdown(clientssl), 0)
+                || !TEST_false(SSL_read_ex(serverssl, buf, sizeof(buf),
+                                           &readbytes))
+                || !TEST_int_eq(SSL_get_error(serverssl, 0),
+                                SSL_ERROR_ZERO_RETURN)
+                || !TEST_int_eq(SSL_shutdown(serverssl), 1)
+                || !TEST_int_eq(SSL_shutdown(clientssl), 1))
+            goto end;
+        break;
+    case 5:
+        if (!TEST_false(SSL_hibernate(serverssl))
+                || !TEST_false(SSL_hibernate(clientssl)))
+            goto end;
+        ERR_clear_error();
+        break;
+    }
+
+    testresult = 1;
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+#endif
+
+/*
+ * Resume |sess| against |sctx| and return the session the client ends up with
+ * in |*newsess|, or NULL if the server did not resume it.
+ */
+static int ticket_resume(SSL_CTX *sctx, SSL_CTX *cctx, SSL_SESSION *sess,
+                         SSL_SESSION **newsess)
+{
+    SSL *clientssl = NULL, *serverssl = NULL;
+    int ok = 0;
+
+    *newsess = NULL;
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                      NULL, NULL))
+            || !TEST_true(SSL_set_session(clientssl, sess))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE)))
+        goto end;
+    if (SSL_session_reused(clientssl))
+        *newsess = SSL_get1_session(clientssl);
+    ok = 1;
+ end:
+    shutdown_ssl_connection(serverssl, clientssl);
+    return ok;
+}
+
+/* Check that |sess| has a ticket sealed with the key called |name| */
+static int ticket_key_is(SSL_SESSION *sess, const unsigned char *name)
+{
+    const unsigned char *tick;
+    size_t ticklen;
+
+    SSL_SESSION_get0_ticket(sess, &tick, &ticklen);
+    return TEST_size_t_gt(ticklen, TLSEXT_KEYNAME_LENGTH)
+           && TEST_mem_eq(tick, TLSEXT_KEYNAME_LENGTH,
+                          name, TLSEXT_KEYNAME_LENGTH);
+}
+
+/*
+ * Test the built-in session ticket keys and their rotation
+ * Test 0: TLSv1.2, keys set by the application
+ * Test 1: TLSv1.3, keys set by the application
+ * Test 2: TLSv1.2, keys rotated after an interval
+ * Test 3: TLSv1.3, keys rotated after an interval
+ */
+static int test_ticket_key_rotation(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    SSL_SESSION *sess1 = NULL, *sess2 = NULL, *sess3 = NULL;
+    unsigned char keys[80], keys2[80], name[TLSEXT_KEYNAME_LENGTH];
+    int testresult = 0, version = TLS1_3_VERSION;
+    size_t i;
+
+    if (idx % 2 == 0) {
+#ifdef OPENSSL_NO_TLS1_2
+        return TEST_skip("TLS 1.2 is disabled.");
+#else
+        version = TLS1_2_VERSION;
+#endif
+    }
+#ifdef OSSL_NO_USABLE_TLS1_3
+    else {
+        return TEST_skip("No usable TLS 1.3.");
+    }
+#endif
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+                                       TLS_client_method(), version, version,
+                                       &sctx, &cctx, cert, privkey))
+            || !TEST_long_eq(SSL_CTX_get_tlsext_ticket_keys(sctx, NULL, 0),
+                             sizeof(keys))
+            || !TEST_false(SSL_CTX_set_ticket_key_rotation(sctx, -1, 2))
+            || !TEST_false(SSL_CTX_set_ticket_key_rotation(sctx, 0, 0))
+            || !TEST_false(SSL_CTX_set_ticket_key_rotation(sctx, 0, 17)))
+        goto end;
+    ERR_clear_error();
+
+    if (!TEST_true(SSL_CTX_set_ticket_key_rotation(sctx, idx < 2 ? 0 : 60, 2))
+            || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl,
+                                             &clientssl, NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE))
+            || !TEST_ptr(sess1 = SSL_get1_session(clientssl))
+            || !TEST_true(SSL_CTX_get_tlsext_ticket_keys(sctx, keys,
+                                                        sizeof(keys)))
+            || !ticket_key_is(sess1, keys))
+        goto end;
+    shutdown_ssl_connection(serverssl, clientssl);
+    serverssl = clientssl = NULL;
+
+    /* A ticket sealed with the current key only gets renewed in TLSv1.3 */
+    if (!TEST_true(ticket_resume(sctx, cctx, sess1, &sess2))
+            || !TEST_ptr(sess2)
+            || !ticket_key_is(sess2, keys))
+        goto end;
+    if (version == TLS1_2_VERSION && !TEST_ptr_eq(sess1, sess2))
+        goto end;
+    SSL_SESSION_free(sess2);
+    sess2 = NULL;
+
+    if (idx < 2) {
+        /* A new key is used for new tickets, the old one is still accepted */
+        if (!TEST_int_gt(RAND_bytes_ex(libctx, keys2, sizeof(keys2), 0), 0)
+                || !TEST_true(SSL_CTX_set_tlsext_ticket_keys(sctx, keys2,
+                                                            sizeof(keys2)))
+                || !TEST_true(SSL_CTX_get_tlsext_ticket_keys(sctx, keys,
+                                                            sizeof(keys)))
+                || !TEST_mem_eq(keys, sizeof(keys), keys2, sizeof(keys2)))
+            goto end;
+    } else {
+        /* The key is due for rotation, but is still accepted */
+        memcpy(name, sctx->ext.tick_keys[0]->name, sizeof(name));
+        sctx->ext.tick_keys[0]->created -= 61;
+    }
+    if (!TEST_true(ticket_resume(sctx, cctx, sess1, &sess2))
+            || !TEST_ptr(sess2)
+            || !TEST_ptr_ne(sess1, sess2)
+            || !TEST_size_t_eq(sctx->ext.num_tick_keys, 2)
+            || !ticket_key_is(sess2, sctx->ext.tick_keys[0]->name)
+            || !ticket_key_is(sess1, sctx->ext.tick_keys[1]->name))
+        goto end;
+
+    if (idx < 2) {
+        /* The first key falls out when a third one is set */
+        keys2[0] ^= 1;
+        if (!TEST_true(SSL_CTX_set_tlsext_ticket_keys(sctx, keys2,
+                                                     sizeof(keys2))))
+            goto end;
+    } else {
+        /* The first key expires after two intervals */
+        for (i = 0; i < sctx->ext.num_tick_keys; i++)
+            sctx->ext.tick_keys[i]->created -= 60;
+    }
+    if (!TEST_true(ticket_resume(sctx, cctx, sess1, &sess3))
+            || !TEST_ptr_null(sess3)
+            || !TEST_true(ticket_resume(sctx, cctx, sess2, &sess3))
+            || !TEST_ptr(sess3)
+            || !ticket_key_is(sess3, sctx->ext.tick_keys[0]->name))
+        goto end;
+    if (idx >= 2
+            && !TEST_mem_ne(sctx->ext.tick_keys[0]->name, sizeof(name),
+                            name, sizeof(name)))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_SESSION_free(sess1);
+    SSL_SESSION_free(sess2);
+    SSL_SESSION_free(sess3);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/*
+ * Test that configuration strings give the same result the second time round,
+ * when the parsed lists come from the cache.  That includes the security level
+ * set by a cipher string, and failures, which are not cached.
+ */
+static int test_list_cache(void)
+{
+    static const char *ciphers[] = {
+        "ECDHE-RSA-AES128-GCM-SHA256", "AES128-SHA"
+    };
+    SSL_CTX *ctx = NULL;
+    SSL *s = NULL;
+    STACK_OF(SSL_CIPHER) *sk;
+    int i, j, testresult = 0;
+#ifndef OPENSSL_NO_EC
+    static const uint16_t groups[] = {
+        OSSL_TLS_GROUP_ID_secp384r1, OSSL_TLS_GROUP_ID_secp256r1
+    };
+#endif
+
+    for (i = 0; i < 2; i++) {
+        if (!TEST_ptr(ctx = SSL_CTX_new_ex(libctx, NULL, TLS_server_method()))
+                || !TEST_true(SSL_CTX_set_ciphersuites(ctx, "")))
+            goto end;
+
+        /* @SECLEVEL is applied on every use of the string */
+        SSL_CTX_set_security_level(ctx, 3);
+        if (!TEST_true(SSL_CTX_set_cipher_list(ctx,
+                           "ECDHE-RSA-AES128-GCM-SHA256:AES128-SHA:"
+                           "@SECLEVEL=0"))
+                || !TEST_int_eq(SSL_CTX_get_security_level(ctx), 0))
+            goto end;
+        SSL_CTX_set_security_level(ctx, 4);
+        if (!TEST_true(SSL_CTX_set_cipher_list(ctx,
+                           "ECDHE-RSA-AES128-GCM-SHA256:AES128-SHA"))
+                || !TEST_int_eq(SSL_CTX_get_security_level(ctx), 4)
+                || !TEST_ptr(sk = SSL_CTX_get_ciphers(ctx))
+                || !TEST_int_eq(sk_SSL_CIPHER_num(sk), OSSL_NELEM(ciphers)))
+            goto end;
+        for (j = 0; j < (int)OSSL_NELEM(ciphers); j++)
+            if (!TEST_str_eq(SSL_CIPHER_get_name(sk_SSL_CIPHER_value(sk, j)),
+                             ciphers[j]))
+                goto end;
+        if (!TEST_false(SSL_CTX_set_cipher_list(ctx, "AES128-SHA:@SECLEVEL=9"))
+                || !TEST_int_eq(sk_SSL_CIPHER_num(SSL_CTX_get_ciphers(ctx)),
+                                OSSL_NELEM(ciphers)))
+            goto end;
+
+        if (!TEST_true(SSL_CTX_set1_sigalgs_list(ctx,
+                           "RSA+SHA256:rsa_pss_rsae_sha256"))
+                || !TEST_size_t_eq(ctx->cert->conf_sigalgslen, 2)
+                || !TEST_uint_eq(ctx->cert->conf_sigalgs[0],
+                                 TLSEXT_SIGALG_rsa_pkcs1_sha256)
+                || !TEST_uint_eq(ctx->cert->conf_sigalgs[1],
+                                 TLSEXT_SIGALG_rsa_pss_rsae_sha256)
+                || !TEST_false(SSL_CTX_set1_sigalgs_list(ctx,
+                                   "RSA+SHA256:RSA+SHA256"))
+                || !TEST_false(SSL_CTX_set1_sigalgs_list(ctx, "RSA+NOHASH")))
+            goto end;
+
+#ifndef OPENSSL_NO_EC
+        if (!TEST_true(SSL_CTX_set1_groups_list(ctx, "P-384:P-256"))
+                || !TEST_ptr(s = SSL_new(ctx))
+                || !TEST_mem_eq(s->ext.supportedgroups,
+                                s->ext.supportedgroups_len * sizeof(uint16_t),
+                                groups, sizeof(groups))
+                || !TEST_false(SSL_set1_groups_list(s, "P-256:P-256"))
+                || !TEST_false(SSL_set1_groups_list(s, "P-256:nosuchgroup"))
+                || !TEST_true(SSL_set1_groups_list(s, "P-256"))
+                || !TEST_mem_eq(s->ext.supportedgroups,
+                                s->ext.supportedgroups_len * sizeof(uint16_t),
+                                &groups[1], sizeof(groups[1])))
+            goto end;
+#endif
+        ERR_clear_error();
+
+        SSL_free(s);
+        s = NULL;
+        SSL_CTX_free(ctx);
+        ctx = NULL;
+    }
+
+    testresult = 1;
+ end:
+    SSL_free(s);
+    SSL_CTX_free(ctx);
+    return testresult;
+}
+
 OPT_TEST_DECLARE_USAGE("certfile privkeyfile srpvfile tmpfile provider config dhfile\n")
 
 int setup_tests(void)
@@ -10934,6 +11643,16 @@ int setup_tests(void)
     ADD_ALL_TESTS(test_pipelining, 7);
 #endif
     ADD_ALL_TESTS(test_handshake_retry, 16);
+#ifndef OSSL_NO_USABLE_TLS1_3
+    ADD_ALL_TESTS(test_cert_comp, 9);
+#endif
+    ADD_ALL_TESTS(test_cert_msg_cache, 4);
+    ADD_ALL_TESTS(test_cert_sharing, 4);
+#ifndef OSSL_NO_USABLE_TLS1_3
+    ADD_ALL_TESTS(test_hibernate, 6);
+#endif
+    ADD_ALL_TESTS(test_ticket_key_rotation, 4);
+    ADD_TEST(test_list_cache);
     return 1;
 
  err:
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Per-connection memory accounting of idle TLSv1.3 connections.  All heap
+ * allocations are tracked through CRYPTO_set_mem_functions(), which has to
+ * happen before the first allocation, so this test does not use the test
+ * framework.  A number of connected client and server pairs are set up, and
+ * the heap they hold is compared before and after SSL_hibernate() and after
+ * waking up again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/crypto.h>
+#include <openssl/ssl.h>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+
+#define NUM_CONNS   16
+
+/* Enough to keep the payload of every allocation suitably aligned */
+#define HDR_SIZE    16
+
+static size_t live_bytes = 0;
+
+static void *mem_malloc(size_t num, const char *file, int line)
+{
+    unsigned char *p = malloc(num + HDR_SIZE);
+
+    if (p == NULL)
+        return NULL;
+    memcpy(p, &num, sizeof(num));
+    live_bytes += num;
+    return p + HDR_SIZE;
+}
+
+static void mem_free(void *addr, const char *file, int line)
+{
+    unsigned char *p = addr;
+    size_t num;
+
+    if (p == NULL)
+        return;
+    p -= HDR_SIZE;
+    memcpy(&num, p, sizeof(num));
+    live_bytes -= num;
+    free(p);
+}
+
+static void *mem_realloc(void *addr, size_t num, const char *file, int line)
+{
+    unsigned char *p = addr;
+    size_t old;
+
+    if (p == NULL)
+        return mem_malloc(num, file, line);
+    p -= HDR_SIZE;
+    memcpy(&old, p, sizeof(old));
+    if ((p = realloc(p, num + HDR_SIZE)) == NULL)
+        return NULL;
+    memcpy(p, &num, sizeof(num));
+    live_bytes += num - old;
+    return p + HDR_SIZE;
+}
+
+struct conn {
+    BIO *cbio;
+    BIO *sbio;
+    SSL *client;
+    SSL *server;
+};
+
+static int handshake(struct conn *c)
+{
+    int i, cret = 0, sret = 0;
+
+    for (i = 0; i < 100 && (cret != 1 || sret != 1); i++) {
+        if (cret != 1)
+            cret = SSL_do_handshake(c->client);
+        if (sret != 1)
+            sret = SSL_do_handshake(c->server);
+    }
+    return cret == 1 && sret == 1;
+}
+
+static int echo(SSL *from, SSL *to)
+{
+    static const char mess[] = "Idle connections are cheap";
+    char buf[sizeof(mess)];
+    size_t written, readbytes;
+
+    return SSL_write_ex(from, mess, sizeof(mess), &written)
+        && SSL_read_ex(to, buf, sizeof(buf), &readbytes)
+        && readbytes == sizeof(mess)
+        && memcmp(buf, mess, sizeof(mess)) == 0;
+}
+
+/*
+ * The BIO pair stands in for the sockets, so it is not part of what the
+ * connection costs and is created separately.
+ */
+static int new_transport(struct conn *c)
+{
+    return BIO_new_bio_pair(&c->cbio, 0, &c->sbio, 0);
+}
+
+static int connect_pair(SSL_CTX *sctx, SSL_CTX *cctx, struct conn *c)
+{
+    if ((c->client = SSL_new(cctx)) == NULL
+        || (c->server = SSL_new(sctx)) == NULL)
+        return 0;
+    SSL_set_bio(c->client, c->cbio, c->cbio);
+    SSL_set_bio(c->server, c->sbio, c->sbio);
+    c->cbio = c->sbio = NULL;
+    SSL_set_connect_state(c->client);
+    SSL_set_accept_state(c->server);
+
+    /* The client reads the session tickets together with the echo */
+    return handshake(c)
+        && echo(c->client, c->server)
+        && echo(c->server, c->client);
+}
+
+static void free_pair(struct conn *c)
+{
+    BIO_free(c->cbio);
+    BIO_free(c->sbio);
+    SSL_free(c->client);
+    SSL_free(c->server);
+    memset(c, 0, sizeof(*c));
+}
+
+int main(int argc, char *argv[])
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    struct conn conns[NUM_CONNS], warmup;
+    size_t before, transport, base, established, hibernated, rehibernated;
+    int i, ret = EXIT_FAILURE;
+
+    if (!CRYPTO_set_mem_functions(mem_malloc, mem_realloc, mem_free)) {
+        fprintf(stderr, "Cannot install the allocation functions\n");
+        return EXIT_FAILURE;
+    }
+    memset(conns, 0, sizeof(conns));
+    memset(&warmup, 0, sizeof(warmup));
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s certfile privkeyfile\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if ((sctx = SSL_CTX_new(TLS_server_method())) == NULL
+        || (cctx = SSL_CTX_new(TLS_client_method())) == NULL
+        || !SSL_CTX_set_min_proto_version(sctx, TLS1_3_VERSION)
+        || !SSL_CTX_set_min_proto_version(cctx, TLS1_3_VERSION)
+        || SSL_CTX_use_certificate_file(sctx, argv[1], SSL_FILETYPE_PEM) <= 0
+        || SSL_CTX_use_PrivateKey_file(sctx, argv[2], SSL_FILETYPE_PEM) <= 0)
+        goto err;
+
+    /* One-off initialisation and caches must not be attributed to the pairs */
+    if (!new_transport(&warmup) || !connect_pair(sctx, cctx, &warmup))
+        goto err;
+    free_pair(&warmup);
+
+    before = live_bytes;
+    for (i = 0; i < NUM_CONNS; i++)
+        if (!new_transport(&conns[i]))
+            goto err;
+    base = live_bytes;
+    transport = (base - before) / NUM_CONNS;
+    for (i = 0; i < NUM_CONNS; i++)
+        if (!connect_pair(sctx, cctx, &conns[i]))
+            goto err;
+    established = (live_bytes - base) / NUM_CONNS;
+
+    for (i = 0; i < NUM_CONNS; i++)
+        if (!SSL_hibernate(conns[i].client) || !SSL_hibernate(conns[i].server))
+            goto err;
+    hibernated = (live_bytes - base) / NUM_CONNS;
+
+    /* Wake up in both directions and go back to sleep */
+    for (i = 0; i < NUM_CONNS; i++)
+        if (!echo(conns[i].client, conns[i].server)
+            || !echo(conns[i].server, conns[i].client)
+            || !SSL_hibernate(conns[i].client)
+            || !SSL_hibernate(conns[i].server))
+            goto err;
+    rehibernated = (live_bytes - base) / NUM_CONNS;
+
+    printf("Bytes per connection pair: established %zu, hibernating %zu, "
+           "hibernating again %zu (transport %zu)\n",
+           established, hibernated, rehibernated, transport);
+
+    if (hibernated * 2 > established) {
+        fprintf(stderr, "Hibernating released too little memory\n");
+        goto end;
+    }
+    if (rehibernated > hibernated) {
+        fprintf(stderr, "Waking up and hibernating again grew the memory\n");
+        goto end;
+    }
+
+    /* Freeing the SSL objects also frees the transport */
+    for (i = 0; i < NUM_CONNS; i++)
+        free_pair(&conns[i]);
+    if (live_bytes != before) {
+        fprintf(stderr, "Freeing the connections leaked memory\n");
+        goto end;
+    }
+
+    ret = EXIT_SUCCESS;
+    goto end;
+ err:
+    fprintf(stderr, "Setting up the connections failed\n");
+    ERR_print_errors_fp(stderr);
+ end:
+    for (i = 0; i < NUM_CONNS; i++)
+        free_pair(&conns[i]);
+    free_pair(&warmup);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return ret;
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/thread.h>
+#include <openssl/kdf.h>
+#include <openssl/core_names.h>
+#include "internal/thread.h"
+#include "internal/nelem.h"
+#include "testutil.h"
+
+static int pool_supported(void)
+{
+    return (OSSL_get_thread_support_flags()
+            & OSSL_THREAD_SUPPORT_FLAG_THREAD_POOL) != 0;
+}
+
+static CRYPTO_THREAD_RETVAL square(void *arg)
+{
+    uint32_t *v = arg;
+
+    return *v * *v;
+}
+
+static int test_pool_disabled(void)
+{
+    OSSL_LIB_CTX *ctx = NULL;
+    uint32_t v = 3;
+    int ret = 0;
+
+    if (!TEST_ptr(ctx = OSSL_LIB_CTX_new())
+            || !TEST_true(OSSL_get_max_threads(ctx) == 0)
+            || !TEST_ptr_null(ossl_crypto_thread_start(ctx, square, &v))
+            || !TEST_true(ossl_get_avail_threads(ctx) == 0)
+            || !TEST_true(OSSL_set_max_threads(ctx, 0)))
+        goto err;
+    if (!pool_supported()) {
+        ret = TEST_false(OSSL_set_max_threads(ctx, 4));
+        goto err;
+    }
+    ret = 1;
+ err:
+    OSSL_LIB_CTX_free(ctx);
+    return ret;
+}
+
+static int test_pool_tasks(void)
+{
+    OSSL_LIB_CTX *ctx = NULL;
+    void *tasks[16];
+    uint32_t v[OSSL_NELEM(tasks)];
+    CRYPTO_THREAD_RETVAL r;
+    size_t i;
+    int ret = 0;
+
+    if (!pool_supported())
+        return TEST_skip("no thread pool support");
+
+    memset(tasks, 0, sizeof(tasks));
+    if (!TEST_ptr(ctx = OSSL_LIB_CTX_new())
+            || !TEST_true(OSSL_set_max_threads(ctx, 4))
+            || !TEST_true(OSSL_get_max_threads(ctx) == 4)
+            || !TEST_true(ossl_get_avail_threads(ctx) == 4))
+        goto err;
+
+    for (i = 0; i < OSSL_NELEM(tasks); i++) {
+        v[i] = (uint32_t)i;
+        if (!TEST_ptr(tasks[i] = ossl_crypto_thread_start(ctx, square, &v[i])))
+            goto err;
+    }
+    for (i = 0; i < OSSL_NELEM(tasks); i++) {
+        r = 0;
+        if (!TEST_true(ossl_crypto_thread_join(tasks[i], &r)))
+            goto err;
+        tasks[i] = NULL;
+        if (!TEST_uint_eq(r, i * i))
+            goto err;
+    }
+    ret = 1;
+ err:
+    for (i = 0; i < OSSL_NELEM(tasks); i++)
+        if (tasks[i] != NULL)
+            ossl_crypto_thread_join(tasks[i], NULL);
+    /* Freeing the context must join the idle workers */
+    OSSL_LIB_CTX_free(ctx);
+    return ret;
+}
+
+static int test_pool_shrink(void)
+{
+    OSSL_LIB_CTX *ctx = NULL;
+    void *task = NULL;
+    uint32_t v = 7;
+    CRYPTO_THREAD_RETVAL r = 0;
+    int ret = 0;
+
+    if (!pool_supported())
+        return TEST_skip("no thread pool support");
+
+    if (!TEST_ptr(ctx = OSSL_LIB_CTX_new())
+            || !TEST_true(OSSL_set_max_threads(ctx, 2))
+            || !TEST_ptr(task = ossl_crypto_thread_start(ctx, square, &v))
+            || !TEST_true(ossl_crypto_thread_join(task, &r))
+            || !TEST_uint_eq(r, 49)
+            || !TEST_true(OSSL_set_max_threads(ctx, 0))
+            || !TEST_ptr_null(ossl_crypto_thread_start(ctx, square, &v))
+            || !TEST_true(OSSL_set_max_threads(ctx, 1))
+            || !TEST_ptr(task = ossl_crypto_thread_start(ctx, square, &v))
+            || !TEST_true(ossl_crypto_thread_join(task, &r))
+            || !TEST_uint_eq(r, 49))
+        goto err;
+    ret = 1;
+ err:
+    OSSL_LIB_CTX_free(ctx);
+    return ret;
+}
+
+static int scrypt_derive(OSSL_LIB_CTX *ctx, unsigned char *out, size_t outlen)
+{
+    EVP_KDF *kdf = NULL;
+    EVP_KDF_CTX *kctx = NULL;
+    OSSL_PARAM params[6], *p = params;
+    uint64_t N = 1024;
+    uint32_t r = 8, par = 4;
+    int ret = 0;
+
+    *p++ = OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_PASSWORD,
+                                             "password", 8);
+    *p++ = OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SALT, "NaCl", 4);
+    *p++ = OSSL_PARAM_construct_uint64(OSSL_KDF_PARAM_SCRYPT_N, &N);
+    *p++ = OSSL_PARAM_construct_uint32(OSSL_KDF_PARAM_SCRYPT_R, &r);
+    *p++ = OSSL_PARAM_construct_uint32(OSSL_KDF_PARAM_SCRYPT_P, &par);
+    *p = OSSL_PARAM_construct_end();
+
+    if (TEST_ptr(kdf = EVP_KDF_fetch(ctx, "SCRYPT", NULL))
+            && TEST_ptr(kctx = EVP_KDF_CTX_new(kdf))
+            && TEST_int_gt(EVP_KDF_derive(kctx, out, outlen, params), 0))
+        ret = 1;
+    EVP_KDF_CTX_free(kctx);
+    EVP_KDF_free(kdf);
+    return ret;
+}
+
+/* Splitting scrypt's p lanes over worker threads must not change the result */
+static int test_pool_scrypt(void)
+{
+    OSSL_LIB_CTX *ctx = NULL;
+    unsigned char serial[64], parallel[64];
+    int ret = 0;
+
+    if (!TEST_ptr(ctx = OSSL_LIB_CTX_new())
+            || !scrypt_derive(ctx, serial, sizeof(serial)))
+        goto err;
+    if (pool_supported() && !TEST_true(OSSL_set_max_threads(ctx, 4)))
+        goto err;
+    if (!scrypt_derive(ctx, parallel, sizeof(parallel))
+            || !TEST_mem_eq(serial, sizeof(serial), parallel, sizeof(parallel)))
+        goto err;
+    ret = 1;
+ err:
+    OSSL_LIB_CTX_free(ctx);
+    return ret;
+}
+
+int setup_tests(void)
+{
+    ADD_TEST(test_pool_disabled);
+    ADD_TEST(test_pool_tasks);
+    ADD_TEST(test_pool_shrink);
+    ADD_TEST(test_pool_scrypt);
+    return 1;
+}
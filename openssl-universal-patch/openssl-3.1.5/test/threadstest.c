@@ -23,6 +23,7 @@
 #include <openssl/crypto.h>
 #include <openssl/rsa.h>
 #include <openssl/aes.h>
+#include <openssl/x509.h>
 #include <openssl/err.h>
 #include "internal/tsan_assist.h"
 #include "internal/nelem.h"
@@ -531,6 +532,54 @@ static int test_multi_shared_pkey(void)
     return test_multi_shared_pkey_common(&thread_shared_evp_pkey);
 }
 
+static X509_PUBKEY *shared_x509_pubkey = NULL;
+
+static void thread_shared_x509_pubkey(void)
+{
+    EVP_PKEY *pkey = X509_PUBKEY_get0(shared_x509_pubkey);
+
+    if (!TEST_ptr(pkey)
+            || !TEST_int_eq(EVP_PKEY_eq(pkey, shared_evp_pkey), 1))
+        multi_success = 0;
+}
+
+/*
+ * The key of a parsed X509_PUBKEY is only decoded when it's first asked for,
+ * which may happen in any of the threads sharing it.
+ */
+static int test_multi_shared_x509_pubkey(void)
+{
+    unsigned char *der = NULL;
+    const unsigned char *p;
+    int derlen, testresult = 0;
+
+    multi_intialise();
+    if (!thread_setup_libctx(1, default_provider)
+            || !TEST_ptr(shared_evp_pkey = load_pkey_pem(privkey, multi_libctx))
+            || !TEST_int_gt(derlen = i2d_PUBKEY(shared_evp_pkey, &der), 0)
+            || !TEST_ptr(shared_x509_pubkey = X509_PUBKEY_new_ex(multi_libctx,
+                                                                 NULL)))
+        goto err;
+    p = der;
+    if (!TEST_ptr(d2i_X509_PUBKEY(&shared_x509_pubkey, &p, derlen))
+            || !start_threads(2, &thread_shared_x509_pubkey))
+        goto err;
+
+    thread_shared_x509_pubkey();
+
+    if (!teardown_threads()
+            || !TEST_true(multi_success))
+        goto err;
+    testresult = 1;
+ err:
+    OPENSSL_free(der);
+    X509_PUBKEY_free(shared_x509_pubkey);
+    shared_x509_pubkey = NULL;
+    EVP_PKEY_free(shared_evp_pkey);
+    thead_teardown_libctx();
+    return testresult;
+}
+
 static int test_multi_load_unload_provider(void)
 {
     EVP_MD *sha256 = NULL;
@@ -713,6 +762,7 @@ int setup_tests(void)
 #ifndef OPENSSL_NO_DEPRECATED_3_0
     ADD_TEST(test_multi_downgrade_shared_pkey);
 #endif
+    ADD_TEST(test_multi_shared_x509_pubkey);
     ADD_TEST(test_multi_load_unload_provider);
     ADD_TEST(test_obj_add);
     ADD_TEST(test_lib_ctx_load_config);
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * ASYNC job benchmark.  Starts a number of jobs that are all paused at the
+ * same time, then resumes them round robin until each has paused the
+ * requested number of times, and reports the rate of context switches (a
+ * pause or a resume each count as one) and of job creation.
+ */
+
+#ifdef _WIN32
+# include <windows.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <openssl/async.h>
+#include <openssl/crypto.h>
+
+static int pauses = 1000;
+
+static int pause_loop(void *args)
+{
+    int i;
+
+    for (i = 0; i < pauses; i++)
+        ASYNC_pause_job();
+    return 1;
+}
+
+static double now_cpu(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char **argv)
+{
+    ASYNC_JOB **jobs = NULL;
+    ASYNC_WAIT_CTX *waitctx = NULL;
+    int njobs = 1000, i, r, running, funcret, ret = EXIT_FAILURE;
+    double t, tc;
+
+    if (argc > 3) {
+        fprintf(stderr, "Usage: %s [jobs [pauses-per-job]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (argc > 1 && (njobs = atoi(argv[1])) <= 0)
+        njobs = 1000;
+    if (argc > 2 && (pauses = atoi(argv[2])) <= 0)
+        pauses = 1000;
+    if (!ASYNC_is_capable()) {
+        fprintf(stderr, "This platform is not ASYNC capable\n");
+        return EXIT_FAILURE;
+    }
+
+    jobs = OPENSSL_zalloc(sizeof(*jobs) * njobs);
+    if (jobs == NULL || (waitctx = ASYNC_WAIT_CTX_new()) == NULL)
+        goto err;
+
+    /* Pre-create the jobs and their stacks */
+    t = now_cpu();
+    if (!ASYNC_init_thread(njobs, njobs))
+        goto err;
+    tc = now_cpu() - t;
+
+    t = now_cpu();
+    for (i = 0; i < njobs; i++)
+        if (ASYNC_start_job(&jobs[i], waitctx, &funcret, pause_loop,
+                            NULL, 0) != ASYNC_PAUSE)
+            goto err;
+    do {
+        running = 0;
+        for (i = 0; i < njobs; i++) {
+            if (jobs[i] == NULL)
+                continue;
+            r = ASYNC_start_job(&jobs[i], waitctx, &funcret, pause_loop,
+                                NULL, 0);
+            if (r == ASYNC_PAUSE)
+                running = 1;
+            else if (r != ASYNC_FINISH || funcret != 1)
+                goto err;
+        }
+    } while (running);
+    t = now_cpu() - t;
+
+    printf("%d jobs, %d pauses each\n", njobs, pauses);
+    printf("job creation %12.0f jobs/s\n", tc > 0 ? njobs / tc : 0.0);
+    /* Every pause is one switch out of the job and one back in */
+    printf("switches     %12.0f switches/s\n",
+           t > 0 ? 2.0 * njobs * (pauses + 1) / t : 0.0);
+    ret = EXIT_SUCCESS;
+ err:
+    if (ret != EXIT_SUCCESS)
+        fprintf(stderr, "Benchmark failed\n");
+    ASYNC_WAIT_CTX_free(waitctx);
+    ASYNC_cleanup_thread();
+    OPENSSL_free(jobs);
+    return ret;
+}
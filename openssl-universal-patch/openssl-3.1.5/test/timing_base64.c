@@ -0,0 +1,246 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Base64 throughput benchmark.  A buffer of random bytes is encoded and
+ * decoded over and over again through EVP_EncodeBlock()/EVP_DecodeBlock(),
+ * the streaming EVP_EncodeUpdate()/EVP_DecodeUpdate() interface, the base64
+ * BIO and PEM_read_bio().  Throughput is reported in MB/s of binary data.
+ * On x86_64 the vectorised code can be turned off for comparison by running
+ * with OPENSSL_ia32cap=:~0x20 (i.e. with the AVX2 capability bit cleared).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+#include <openssl/evp.h>
+#include <openssl/bio.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/err.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L
+#  define BASE64_BENCH
+
+static char *prog;
+
+static unsigned char *bin, *blk, *b64, *pem, *tmp;
+static int binlen, blklen, b64len, pemlen;
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static int block_encode(void)
+{
+    return EVP_EncodeBlock(tmp, bin, binlen) > 0;
+}
+
+static int block_decode(void)
+{
+    return EVP_DecodeBlock(tmp, blk, blklen) >= binlen;
+}
+
+static int stream_encode(void)
+{
+    EVP_ENCODE_CTX *ctx = EVP_ENCODE_CTX_new();
+    int len, total = 0, ok = 0;
+
+    if (ctx == NULL)
+        return 0;
+    EVP_EncodeInit(ctx);
+    if (EVP_EncodeUpdate(ctx, tmp, &len, bin, binlen)) {
+        total = len;
+        EVP_EncodeFinal(ctx, tmp + total, &len);
+        ok = total + len == b64len;
+    }
+    EVP_ENCODE_CTX_free(ctx);
+    return ok;
+}
+
+static int stream_decode(void)
+{
+    EVP_ENCODE_CTX *ctx = EVP_ENCODE_CTX_new();
+    int len, total, ok = 0;
+
+    if (ctx == NULL)
+        return 0;
+    EVP_DecodeInit(ctx);
+    if (EVP_DecodeUpdate(ctx, tmp, &len, b64, b64len) >= 0) {
+        total = len;
+        ok = EVP_DecodeFinal(ctx, tmp + total, &len) > 0
+             && total + len == binlen;
+    }
+    EVP_ENCODE_CTX_free(ctx);
+    return ok;
+}
+
+static int bio_decode(void)
+{
+    BIO *mem = BIO_new_mem_buf(b64, b64len), *b = BIO_new(BIO_f_base64());
+    int n, total = 0;
+
+    if (mem == NULL || b == NULL) {
+        BIO_free(mem);
+        BIO_free(b);
+        return 0;
+    }
+    b = BIO_push(b, mem);
+    while ((n = BIO_read(b, tmp + total, binlen - total)) > 0)
+        total += n;
+    BIO_free_all(b);
+    return total == binlen;
+}
+
+static int pem_decode(void)
+{
+    BIO *mem = BIO_new_mem_buf(pem, pemlen);
+    char *name = NULL, *header = NULL;
+    unsigned char *data = NULL;
+    long len = 0;
+    int ok;
+
+    if (mem == NULL)
+        return 0;
+    ok = PEM_read_bio(mem, &name, &header, &data, &len) && len == binlen;
+    OPENSSL_free(name);
+    OPENSSL_free(header);
+    OPENSSL_free(data);
+    BIO_free(mem);
+    return ok;
+}
+
+static const struct {
+    const char *name;
+    int (*fn)(void);
+} tests[] = {
+    { "EVP_EncodeBlock", block_encode },
+    { "EVP_DecodeBlock", block_decode },
+    { "EVP_EncodeUpdate", stream_encode },
+    { "EVP_DecodeUpdate", stream_decode },
+    { "BIO_f_base64 read", bio_decode },
+    { "PEM_read_bio", pem_decode },
+};
+#  define NTESTS (sizeof(tests) / sizeof(tests[0]))
+
+static int setup(int size)
+{
+    EVP_ENCODE_CTX *ctx = EVP_ENCODE_CTX_new();
+    BIO *mem = NULL;
+    char *data;
+    int len, ok = 0;
+
+    binlen = size;
+    b64len = 0;
+    /* Room for the encoding with line breaks, and then some */
+    if (ctx == NULL
+        || (bin = OPENSSL_malloc(binlen)) == NULL
+        || (blk = OPENSSL_malloc(binlen * 2 + 64)) == NULL
+        || (b64 = OPENSSL_malloc(binlen * 2 + 64)) == NULL
+        || (tmp = OPENSSL_malloc(binlen * 2 + 64)) == NULL
+        || RAND_bytes(bin, binlen) <= 0)
+        goto err;
+
+    blklen = EVP_EncodeBlock(blk, bin, binlen);
+    EVP_EncodeInit(ctx);
+    if (!EVP_EncodeUpdate(ctx, b64, &len, bin, binlen))
+        goto err;
+    b64len = len;
+    EVP_EncodeFinal(ctx, b64 + b64len, &len);
+    b64len += len;
+
+    if ((mem = BIO_new(BIO_s_mem())) == NULL
+        || !PEM_write_bio(mem, "DATA", "", bin, binlen)
+        || (pemlen = BIO_get_mem_data(mem, &data)) <= 0
+        || (pem = OPENSSL_memdup(data, pemlen)) == NULL)
+        goto err;
+    ok = 1;
+ err:
+    BIO_free(mem);
+    EVP_ENCODE_CTX_free(ctx);
+    return ok;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags]\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -s #  Size of the binary data (default 1048576)\n");
+    fprintf(stderr, "  -n #  Number of passes over the data (default 200)\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef BASE64_BENCH
+    int i, size = 1 << 20, count = 200, ret = EXIT_FAILURE;
+    size_t t;
+    double start, elapsed;
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "s:n:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 's':
+            if ((size = atoi(optarg)) <= 0 || size > (1 << 28))
+                usage();
+            break;
+        case 'n':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        }
+    }
+    if (optind != ac)
+        usage();
+
+    if (!setup(size))
+        goto err;
+
+    printf("%-20s %12s\n", "operation", "MB/s");
+    for (t = 0; t < NTESTS; t++) {
+        start = now_wall();
+        for (i = 0; i < count; i++) {
+            if (!tests[t].fn()) {
+                fprintf(stderr, "%s failed\n", tests[t].name);
+                goto err;
+            }
+        }
+        elapsed = now_wall() - start;
+        printf("%-20s %12.1f\n", tests[t].name,
+               (double)size * count / elapsed / 1e6);
+    }
+    ret = EXIT_SUCCESS;
+ err:
+    if (ret != EXIT_SUCCESS)
+        ERR_print_errors_fp(stderr);
+    OPENSSL_free(bin);
+    OPENSSL_free(blk);
+    OPENSSL_free(b64);
+    OPENSSL_free(pem);
+    OPENSSL_free(tmp);
+    return ret;
+#else
+    fprintf(stderr, "This benchmark requires POSIX APIs\n");
+    return EXIT_FAILURE;
+#endif
+}
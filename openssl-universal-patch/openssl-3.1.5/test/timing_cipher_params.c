@@ -0,0 +1,149 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Benchmark for passing parameters to and from cipher implementations.
+ * EVP_CIPHER_CTX_get_params() and EVP_CIPHER_CTX_set_params() are called
+ * over and over again on an initialised cipher context, with the handful of
+ * parameters the library itself asks for on its hot paths.  The cost is
+ * mostly that of the implementation finding the parameters it knows in the
+ * array it's given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+#include <openssl/evp.h>
+#include <openssl/core_names.h>
+#include <openssl/err.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L
+#  define CIPHER_PARAMS_BENCH
+
+static char *prog;
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static int get_params(EVP_CIPHER_CTX *ctx)
+{
+    size_t ivlen = 0, keylen = 0;
+    unsigned int pad = 0, num = 0;
+    OSSL_PARAM params[5];
+
+    params[0] = OSSL_PARAM_construct_size_t(OSSL_CIPHER_PARAM_IVLEN, &ivlen);
+    params[1] = OSSL_PARAM_construct_size_t(OSSL_CIPHER_PARAM_KEYLEN,
+                                            &keylen);
+    params[2] = OSSL_PARAM_construct_uint(OSSL_CIPHER_PARAM_PADDING, &pad);
+    params[3] = OSSL_PARAM_construct_uint(OSSL_CIPHER_PARAM_NUM, &num);
+    params[4] = OSSL_PARAM_construct_end();
+    return EVP_CIPHER_CTX_get_params(ctx, params);
+}
+
+static int set_params(EVP_CIPHER_CTX *ctx)
+{
+    unsigned int pad = 1, num = 0;
+    OSSL_PARAM params[3];
+
+    params[0] = OSSL_PARAM_construct_uint(OSSL_CIPHER_PARAM_PADDING, &pad);
+    params[1] = OSSL_PARAM_construct_uint(OSSL_CIPHER_PARAM_NUM, &num);
+    params[2] = OSSL_PARAM_construct_end();
+    return EVP_CIPHER_CTX_set_params(ctx, params);
+}
+
+static int run(const char *name, int count)
+{
+    static const unsigned char key[32] = { 0 }, iv[16] = { 0 };
+    EVP_CIPHER *cipher = EVP_CIPHER_fetch(NULL, name, NULL);
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    double start, get_elapsed, set_elapsed;
+    int i, ok = 0;
+
+    if (cipher == NULL || ctx == NULL
+        || !EVP_EncryptInit_ex2(ctx, cipher, key, iv, NULL))
+        goto err;
+
+    start = now_wall();
+    for (i = 0; i < count; i++)
+        if (!get_params(ctx))
+            goto err;
+    get_elapsed = now_wall() - start;
+
+    start = now_wall();
+    for (i = 0; i < count; i++)
+        if (!set_params(ctx))
+            goto err;
+    set_elapsed = now_wall() - start;
+
+    printf("%-16s %12.1f %12.1f\n", name, get_elapsed * 1e9 / count,
+           set_elapsed * 1e9 / count);
+    ok = 1;
+ err:
+    EVP_CIPHER_CTX_free(ctx);
+    EVP_CIPHER_free(cipher);
+    return ok;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags]\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -n #  Number of calls per case (default 1000000)\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef CIPHER_PARAMS_BENCH
+    static const char *ciphers[] = {
+        "AES-128-CBC", "AES-256-CTR", "CHACHA20", "AES-128-GCM"
+    };
+    size_t c;
+    int i, count = 1000000;
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "n:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'n':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        }
+    }
+    if (optind != ac)
+        usage();
+
+    printf("%-16s %12s %12s\n", "cipher", "get (ns)", "set (ns)");
+    for (c = 0; c < sizeof(ciphers) / sizeof(ciphers[0]); c++) {
+        if (!run(ciphers[c], count)) {
+            ERR_print_errors_fp(stderr);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+#else
+    fprintf(stderr, "This benchmark requires POSIX APIs\n");
+    return EXIT_FAILURE;
+#endif
+}
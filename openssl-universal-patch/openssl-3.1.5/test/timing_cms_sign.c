@@ -0,0 +1,181 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Benchmark for CMS signing with several signers, each with its own digest
+ * algorithm.  The same content is signed with the worker thread pool of the
+ * library context disabled, and then with it enabled, so that the digests
+ * and signatures can be computed at the same time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+#include <openssl/bio.h>
+#include <openssl/cms.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <openssl/thread.h>
+#include <openssl/err.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L
+#  define CMS_SIGN_BENCH
+
+static char *prog;
+
+#  define NSIGNERS 4
+
+static const char *digests[NSIGNERS] = {
+    "SHA256", "SHA384", "SHA3-256", "SHA512"
+};
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static X509 *make_cert(EVP_PKEY *pkey)
+{
+    X509 *x = X509_new();
+    X509_NAME *name;
+
+    if (x == NULL
+        || !X509_set_version(x, X509_VERSION_3)
+        || !ASN1_INTEGER_set(X509_get_serialNumber(x), 1)
+        || X509_gmtime_adj(X509_getm_notBefore(x), 0) == NULL
+        || X509_gmtime_adj(X509_getm_notAfter(x), 3600) == NULL
+        || !X509_set_pubkey(x, pkey)
+        || (name = X509_get_subject_name(x)) == NULL
+        || !X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                       (unsigned char *)"bench", -1, -1, 0)
+        || !X509_set_issuer_name(x, name)
+        || X509_sign(x, pkey, EVP_sha256()) <= 0) {
+        X509_free(x);
+        return NULL;
+    }
+    return x;
+}
+
+static int sign(const unsigned char *content, size_t len, X509 **certs,
+                EVP_PKEY **keys, EVP_MD **mds)
+{
+    const unsigned int flags = CMS_BINARY | CMS_PARTIAL;
+    CMS_ContentInfo *cms;
+    BIO *in = BIO_new_mem_buf(content, len), *out = BIO_new(BIO_s_null());
+    int i, ok;
+
+    ok = in != NULL && out != NULL
+        && (cms = CMS_sign(NULL, NULL, NULL, NULL, flags)) != NULL;
+    for (i = 0; ok && i < NSIGNERS; i++)
+        ok = CMS_add1_signer(cms, certs[i], keys[i], mds[i], flags) != NULL;
+    ok = ok && CMS_final(cms, in, NULL, CMS_BINARY)
+        && i2d_CMS_bio(out, cms);
+    CMS_ContentInfo_free(cms);
+    BIO_free(in);
+    BIO_free(out);
+    return ok;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags]\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -m #  MiB of content (default 64)\n");
+    fprintf(stderr, "  -n #  Number of signings per case (default 10)\n");
+    fprintf(stderr, "  -t #  Number of worker threads (default 4)\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef CMS_SIGN_BENCH
+    EVP_PKEY *keys[NSIGNERS] = { NULL };
+    X509 *certs[NSIGNERS] = { NULL };
+    EVP_MD *mds[NSIGNERS] = { NULL };
+    unsigned char *content = NULL;
+    size_t len;
+    long mbytes = 64;
+    int i, j, count = 10, threads = 4, ret = EXIT_FAILURE;
+    double start, elapsed;
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "m:n:t:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'm':
+            if ((mbytes = atol(optarg)) <= 0)
+                usage();
+            break;
+        case 'n':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 't':
+            if ((threads = atoi(optarg)) <= 0)
+                usage();
+            break;
+        }
+    }
+    if (optind != ac)
+        usage();
+
+    len = (size_t)mbytes << 20;
+    if ((content = OPENSSL_malloc(len)) == NULL)
+        goto err;
+    memset(content, 'x', len);
+    for (i = 0; i < NSIGNERS; i++) {
+        keys[i] = i % 2 == 0 ? EVP_PKEY_Q_keygen(NULL, NULL, "RSA",
+                                                 (size_t)3072)
+                             : EVP_PKEY_Q_keygen(NULL, NULL, "EC", "P-384");
+        if (keys[i] == NULL
+            || (certs[i] = make_cert(keys[i])) == NULL
+            || (mds[i] = EVP_MD_fetch(NULL, digests[i], NULL)) == NULL)
+            goto err;
+    }
+
+    printf("%-8s %10s %12s\n", "threads", "ms/sign", "MiB/s");
+    for (j = 0; j < 2; j++) {
+        if (!OSSL_set_max_threads(NULL, j == 0 ? 0 : threads))
+            goto err;
+        start = now_wall();
+        for (i = 0; i < count; i++)
+            if (!sign(content, len, certs, keys, mds))
+                goto err;
+        elapsed = now_wall() - start;
+        printf("%-8d %10.1f %12.1f\n", j == 0 ? 0 : threads,
+               elapsed * 1e3 / count, mbytes * count / elapsed);
+    }
+    ret = EXIT_SUCCESS;
+ err:
+    if (ret != EXIT_SUCCESS)
+        ERR_print_errors_fp(stderr);
+    for (i = 0; i < NSIGNERS; i++) {
+        EVP_PKEY_free(keys[i]);
+        X509_free(certs[i]);
+        EVP_MD_free(mds[i]);
+    }
+    OPENSSL_free(content);
+    return ret;
+#else
+    fprintf(stderr, "This benchmark requires POSIX APIs\n");
+    return EXIT_FAILURE;
+#endif
+}
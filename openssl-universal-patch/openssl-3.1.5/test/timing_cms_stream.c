@@ -0,0 +1,177 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Benchmark for decrypting large CMS encrypted data.  A child process
+ * encrypts generated content and streams the encoding through a pipe to
+ * this process, which decrypts it either as it arrives, with
+ * d2i_CMS_bio_stream(), or after reading all of it into memory, with
+ * d2i_CMS_bio().  The throughput and the peak memory use are reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+#include <openssl/bio.h>
+#include <openssl/cms.h>
+#include <openssl/evp.h>
+#include <openssl/err.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# include <sys/resource.h>
+# include <sys/wait.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L
+#  define CMS_STREAM_BENCH
+
+static char *prog;
+
+static const unsigned char key[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* Write encrypted data with |mbytes| MiB of content to |out| */
+static int produce(BIO *out, long mbytes)
+{
+    unsigned char buf[65536];
+    CMS_ContentInfo *cms;
+    BIO *in = BIO_new(BIO_s_null()), *cmsbio = NULL, *next;
+    long i;
+    int ok = 0;
+
+    memset(buf, 'x', sizeof(buf));
+    cms = CMS_EncryptedData_encrypt(in, EVP_aes_128_cbc(), key, sizeof(key),
+                                    CMS_BINARY | CMS_STREAM);
+    if (cms == NULL || (cmsbio = BIO_new_CMS(out, cms)) == NULL)
+        goto err;
+    for (i = 0; i < mbytes * 16; i++)
+        if (BIO_write(cmsbio, buf, sizeof(buf)) != (int)sizeof(buf))
+            goto err;
+    ok = BIO_flush(cmsbio) > 0;
+ err:
+    while (cmsbio != NULL && cmsbio != out) {
+        next = BIO_pop(cmsbio);
+        BIO_free(cmsbio);
+        cmsbio = next;
+    }
+    CMS_ContentInfo_free(cms);
+    BIO_free(in);
+    return ok;
+}
+
+static int consume(BIO *in, int stream)
+{
+    CMS_ContentInfo *cms = NULL;
+    BIO *content = NULL, *out = BIO_new(BIO_s_null());
+    int ok;
+
+    if (stream)
+        cms = d2i_CMS_bio_stream(in, &content, NULL, NULL);
+    else
+        cms = d2i_CMS_bio(in, NULL);
+    ok = cms != NULL && out != NULL
+        && CMS_EncryptedData_decrypt(cms, key, sizeof(key), content, out,
+                                     CMS_BINARY);
+    CMS_ContentInfo_free(cms);
+    BIO_free(content);
+    BIO_free(out);
+    return ok;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags]\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -m #  MiB of content (default 1024)\n");
+    fprintf(stderr, "  -b    Read all of it into memory first\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef CMS_STREAM_BENCH
+    long mbytes = 1024;
+    int i, stream = 1, fds[2], status, ok;
+    struct rusage ru;
+    double start, elapsed;
+    pid_t pid;
+    BIO *bio;
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "m:b")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'm':
+            if ((mbytes = atol(optarg)) <= 0)
+                usage();
+            break;
+        case 'b':
+            stream = 0;
+            break;
+        }
+    }
+    if (optind != ac)
+        usage();
+
+    if (pipe(fds) != 0 || (pid = fork()) < 0) {
+        perror(prog);
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        bio = BIO_new_fd(fds[1], BIO_CLOSE);
+        ok = bio != NULL && produce(bio, mbytes);
+        BIO_free(bio);
+        _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    close(fds[1]);
+
+    /*
+     * d2i_CMS_bio() can't cope with the short reads of a pipe, unlike
+     * d2i_CMS_bio_stream(), so let stdio do full reads for it
+     */
+    start = now_wall();
+    bio = BIO_new_fp(fdopen(fds[0], "rb"), BIO_CLOSE);
+    ok = bio != NULL && consume(bio, stream);
+    elapsed = now_wall() - start;
+    BIO_free(bio);
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)
+        || WEXITSTATUS(status) != EXIT_SUCCESS)
+        ok = 0;
+    if (!ok) {
+        ERR_print_errors_fp(stderr);
+        return EXIT_FAILURE;
+    }
+
+    getrusage(RUSAGE_SELF, &ru);
+    printf("%-10s %8ld MiB %10.1f MiB/s %10ld KiB max RSS\n",
+           stream ? "streamed" : "buffered", mbytes, mbytes / elapsed,
+           (long)ru.ru_maxrss);
+    return EXIT_SUCCESS;
+#else
+    fprintf(stderr, "This benchmark requires POSIX APIs\n");
+    return EXIT_FAILURE;
+#endif
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Benchmark for signing with keys that belong to another provider.  Keys are
+ * generated in one library context and used to sign in a second one, which
+ * has its own instance of the default provider.  The key then has to be made
+ * available to that second provider before it can sign, either once for a
+ * key that is used over and over again, or for every signature when each
+ * one is made with a new key, as happens with keys loaded per connection.
+ * The same is done in a child of the key's library context, whose default
+ * provider is the very one that holds the key.  Signing in the key's own
+ * library context is measured for comparison.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+#include <openssl/evp.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/provider.h>
+#include <openssl/err.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L
+#  define CROSS_SIGN_BENCH
+
+static char *prog;
+
+enum mode {
+    SAME_PROVIDER, OTHER_PROVIDER, OTHER_PROVIDER_NEW_KEY,
+    CHILD_CONTEXT, CHILD_CONTEXT_NEW_KEY
+};
+
+static const char *modes[] = {
+    "same provider", "other provider", "other, new key",
+    "child context", "child, new key"
+};
+#  define NMODES (sizeof(modes) / sizeof(modes[0]))
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static void child_teardown(void *provctx)
+{
+    OSSL_LIB_CTX_free(provctx);
+}
+
+static const OSSL_DISPATCH child_dispatch_table[] = {
+    { OSSL_FUNC_PROVIDER_TEARDOWN, (void (*)(void))child_teardown },
+    { 0, NULL }
+};
+
+/* A provider that does nothing but give us a child library context */
+static int child_provider_init(const OSSL_CORE_HANDLE *handle,
+                               const OSSL_DISPATCH *in,
+                               const OSSL_DISPATCH **out, void **provctx)
+{
+    if ((*provctx = OSSL_LIB_CTX_new_child(handle, in)) == NULL)
+        return 0;
+    *out = child_dispatch_table;
+    return 1;
+}
+
+static int sign(OSSL_LIB_CTX *libctx, EVP_PKEY *pkey, const char *md)
+{
+    static const unsigned char tbs[32] = { 0 };
+    unsigned char sig[256];
+    size_t siglen = sizeof(sig);
+    EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
+    int ok;
+
+    ok = mdctx != NULL
+        && EVP_DigestSignInit_ex(mdctx, NULL, md, libctx, NULL, pkey,
+                                 NULL) > 0
+        && EVP_DigestSign(mdctx, sig, &siglen, tbs, sizeof(tbs)) > 0;
+    EVP_MD_CTX_free(mdctx);
+    return ok;
+}
+
+static int run(const char *name, OSSL_LIB_CTX *keyctx, OSSL_LIB_CTX *signctx,
+               OSSL_LIB_CTX *childctx, EVP_PKEY *pkey, const char *md,
+               int count)
+{
+    EVP_PKEY *key;
+    size_t m;
+    int i, ok;
+    double start, elapsed;
+
+    for (m = 0; m < NMODES; m++) {
+        OSSL_LIB_CTX *libctx = m == SAME_PROVIDER ? keyctx
+                               : m >= CHILD_CONTEXT ? childctx : signctx;
+
+        start = now_wall();
+        for (i = 0; i < count; i++) {
+            if (m == OTHER_PROVIDER_NEW_KEY || m == CHILD_CONTEXT_NEW_KEY) {
+                if ((key = EVP_PKEY_dup(pkey)) == NULL)
+                    return 0;
+                ok = sign(libctx, key, md);
+                EVP_PKEY_free(key);
+            } else {
+                ok = sign(libctx, pkey, md);
+            }
+            if (!ok)
+                return 0;
+        }
+        elapsed = now_wall() - start;
+        printf("%-8s %-16s %12.2f %12.0f\n", name, modes[m],
+               elapsed * 1e6 / count, count / elapsed);
+    }
+    return 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags]\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -n #  Number of signatures per case (default 2000)\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef CROSS_SIGN_BENCH
+    OSSL_LIB_CTX *keyctx = NULL, *signctx = NULL;
+    OSSL_LIB_CTX *childctx;
+    OSSL_PROVIDER *keyprov = NULL, *signprov = NULL, *childprov = NULL;
+    EVP_PKEY *ec = NULL, *ed25519 = NULL;
+    int i, count = 2000, ret = EXIT_FAILURE;
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "n:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'n':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        }
+    }
+    if (optind != ac)
+        usage();
+
+    if ((keyctx = OSSL_LIB_CTX_new()) == NULL
+        || (signctx = OSSL_LIB_CTX_new()) == NULL
+        || (keyprov = OSSL_PROVIDER_load(keyctx, "default")) == NULL
+        || (signprov = OSSL_PROVIDER_load(signctx, "default")) == NULL
+        || !OSSL_PROVIDER_add_builtin(keyctx, "child", child_provider_init)
+        || (childprov = OSSL_PROVIDER_load(keyctx, "child")) == NULL
+        || (childctx = OSSL_PROVIDER_get0_provider_ctx(childprov)) == NULL
+        || (ec = EVP_PKEY_Q_keygen(keyctx, NULL, "EC", "P-256")) == NULL
+        || (ed25519 = EVP_PKEY_Q_keygen(keyctx, NULL, "ED25519")) == NULL)
+        goto err;
+
+    printf("%-8s %-16s %12s %12s\n", "key", "signing in", "us/sign",
+           "signs/s");
+    if (run("EC", keyctx, signctx, childctx, ec, "SHA256", count)
+        && run("Ed25519", keyctx, signctx, childctx, ed25519, NULL, count))
+        ret = EXIT_SUCCESS;
+ err:
+    if (ret != EXIT_SUCCESS)
+        ERR_print_errors_fp(stderr);
+    EVP_PKEY_free(ec);
+    EVP_PKEY_free(ed25519);
+    OSSL_PROVIDER_unload(childprov);
+    OSSL_PROVIDER_unload(keyprov);
+    OSSL_PROVIDER_unload(signprov);
+    OSSL_LIB_CTX_free(keyctx);
+    OSSL_LIB_CTX_free(signctx);
+    return ret;
+#else
+    fprintf(stderr, "This benchmark requires POSIX APIs\n");
+    return EXIT_FAILURE;
+#endif
+}
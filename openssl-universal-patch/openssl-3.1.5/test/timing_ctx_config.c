@@ -0,0 +1,252 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Configuration benchmark.  Measures the latency and the number of heap
+ * allocations of creating an SSL_CTX and setting its cipher list, TLSv1.3
+ * ciphersuites, groups and signature algorithms, as a multi-tenant server
+ * does for each tenant, and of overriding the cipher list and groups of a
+ * new SSL object, as it does per connection.  The configuration strings are
+ * made unique per tenant by an unknown cipher name, which is ignored; with
+ * more tenants than the parsed list cache holds, every string is parsed
+ * again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# include <openssl/ssl.h>
+# include <openssl/err.h>
+# include <openssl/bio.h>
+# include <openssl/crypto.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L \
+     && defined(OPENSSL_THREADS)
+#  include <pthread.h>
+#  define CTX_CONFIG_BENCH
+
+static char *prog;
+
+static const char cipher_list[] =
+    "ECDHE+AESGCM:ECDHE+CHACHA20:DHE+AESGCM:DHE+CHACHA20:!aNULL:!SHA1";
+static const char ciphersuites[] =
+    "TLS_AES_256_GCM_SHA384:TLS_CHACHA20_POLY1305_SHA256";
+static const char groups[] = "X25519:P-256:P-384";
+static const char sigalgs[] =
+    "ECDSA+SHA256:rsa_pss_rsae_sha256:RSA+SHA256:ECDSA+SHA384";
+
+/*
+ * Allocation counting.  The counters are only approximate if the compiler
+ * provides no atomic builtins, which is good enough for a benchmark.
+ */
+static size_t num_allocs = 0;
+
+static void count_alloc(void)
+{
+#  if defined(__GNUC__)
+    __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+#  else
+    num_allocs++;
+#  endif
+}
+
+static void *bench_malloc(size_t num, const char *file, int line)
+{
+    count_alloc();
+    return malloc(num);
+}
+
+static void *bench_realloc(void *addr, size_t num, const char *file, int line)
+{
+    count_alloc();
+    return realloc(addr, num);
+}
+
+static void bench_free(void *addr, const char *file, int line)
+{
+    free(addr);
+}
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* The cipher list of |tenant| */
+static void tenant_cipher_list(char *buf, size_t len, int tenant)
+{
+    BIO_snprintf(buf, len, "%s:TENANT%d", cipher_list, tenant);
+}
+
+static int configure_ctx(int tenant)
+{
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    char buf[256];
+    int ok;
+
+    tenant_cipher_list(buf, sizeof(buf), tenant);
+    ok = ctx != NULL
+        && SSL_CTX_set_cipher_list(ctx, buf)
+        && SSL_CTX_set_ciphersuites(ctx, ciphersuites)
+        && SSL_CTX_set1_groups_list(ctx, groups)
+        && SSL_CTX_set1_sigalgs_list(ctx, sigalgs);
+    SSL_CTX_free(ctx);
+    return ok;
+}
+
+static int configure_ssl(SSL_CTX *ctx, int tenant)
+{
+    SSL *s = SSL_new(ctx);
+    char buf[256];
+    int ok;
+
+    tenant_cipher_list(buf, sizeof(buf), tenant);
+    ok = s != NULL
+        && SSL_set_cipher_list(s, buf)
+        && SSL_set1_groups_list(s, groups);
+    SSL_free(s);
+    return ok;
+}
+
+struct job {
+    SSL_CTX *ctx;               /* NULL to configure new SSL_CTXs */
+    int count;
+    int tenants;
+    int ok;
+    pthread_t thread;
+};
+
+static void *worker(void *arg)
+{
+    struct job *job = arg;
+    int i, tenant;
+
+    for (i = 0; i < job->count; i++) {
+        tenant = i % job->tenants;
+        if (job->ctx == NULL ? !configure_ctx(tenant)
+                             : !configure_ssl(job->ctx, tenant))
+            return NULL;
+    }
+    job->ok = 1;
+    return NULL;
+}
+
+static int bench(const char *name, SSL_CTX *ctx, int nthreads, int count,
+                 int tenants)
+{
+    struct job *jobs = OPENSSL_zalloc(nthreads * sizeof(*jobs));
+    double start, elapsed;
+    size_t allocs;
+    int i, ok = 1;
+
+    if (jobs == NULL)
+        return 0;
+    /* Warm up, so that one-off initialisation is not counted */
+    jobs[0].ctx = ctx;
+    jobs[0].count = 10;
+    jobs[0].tenants = tenants;
+    worker(&jobs[0]);
+
+    allocs = num_allocs;
+    start = now_wall();
+    for (i = 0; i < nthreads; i++) {
+        jobs[i].ctx = ctx;
+        jobs[i].count = count;
+        jobs[i].tenants = tenants;
+        jobs[i].ok = 0;
+        if (pthread_create(&jobs[i].thread, NULL, worker, &jobs[i]) != 0)
+            ok = jobs[i].count = 0;
+    }
+    for (i = 0; i < nthreads; i++)
+        if (jobs[i].count > 0)
+            pthread_join(jobs[i].thread, NULL);
+    elapsed = now_wall() - start;
+    allocs = num_allocs - allocs;
+    for (i = 0; i < nthreads; i++)
+        ok &= jobs[i].ok;
+    OPENSSL_free(jobs);
+    if (!ok)
+        return 0;
+
+    printf("%-8s %3d threads %10.0f configs/s %8.2f us %7zu allocs\n",
+           name, nthreads, (double)count * nthreads / elapsed,
+           elapsed * 1e6 / count, allocs / ((size_t)count * nthreads));
+    return 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags]\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -c #  Configurations per thread (default 10000)\n");
+    fprintf(stderr, "  -t #  Number of threads (default 1)\n");
+    fprintf(stderr, "  -n #  Number of distinct tenants (default 1)\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef CTX_CONFIG_BENCH
+    SSL_CTX *ctx = NULL;
+    int i, count = 10000, nthreads = 1, tenants = 1, ret = EXIT_FAILURE;
+
+    /* Must happen before the first allocation */
+    if (!CRYPTO_set_mem_functions(bench_malloc, bench_realloc, bench_free)) {
+        fprintf(stderr, "Cannot install allocation counters\n");
+        return EXIT_FAILURE;
+    }
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "c:t:n:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'c':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 't':
+            if ((nthreads = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 'n':
+            if ((tenants = atoi(optarg)) <= 0)
+                usage();
+            break;
+        }
+    }
+    if (optind != ac)
+        usage();
+
+    if ((ctx = SSL_CTX_new(TLS_server_method())) == NULL)
+        goto err;
+    if (bench("SSL_CTX", NULL, nthreads, count, tenants)
+        && bench("SSL", ctx, nthreads, count, tenants))
+        ret = EXIT_SUCCESS;
+ err:
+    if (ret != EXIT_SUCCESS)
+        ERR_print_errors_fp(stderr);
+    SSL_CTX_free(ctx);
+    return ret;
+#else
+    fprintf(stderr, "This benchmark requires POSIX threads\n");
+    return EXIT_FAILURE;
+#endif
+}
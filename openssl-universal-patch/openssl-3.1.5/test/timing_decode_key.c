@@ -0,0 +1,221 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Key decoding benchmark.  Freshly generated RSA, EC and Ed25519 keys are
+ * encoded once, as PEM and DER private keys, as DER SubjectPublicKeyInfo and
+ * as a self-signed DER certificate, and then decoded over and over again
+ * through the usual d2i and PEM functions.  Each of those sets up a decoder
+ * context, so this measures the cost of finding the decoders as much as that
+ * of the decoding itself.  The certificate is only parsed, its key is never
+ * used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/err.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L
+#  define DECODE_KEY_BENCH
+
+static char *prog;
+
+enum encoding { PEM_PRIVATE, DER_PRIVATE, DER_PUBLIC, DER_CERT };
+
+static const char *encodings[] = {
+    "PEM private", "DER private", "DER SPKI", "DER cert"
+};
+#  define NENCODINGS (sizeof(encodings) / sizeof(encodings[0]))
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static X509 *self_signed(EVP_PKEY *pkey)
+{
+    X509 *x = X509_new();
+    X509_NAME *name = NULL;
+
+    if (x == NULL
+        || !ASN1_INTEGER_set(X509_get_serialNumber(x), 1)
+        || (name = X509_NAME_new()) == NULL
+        || !X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                       (unsigned char *)"timing", -1, -1, 0)
+        || !X509_set_subject_name(x, name)
+        || !X509_set_issuer_name(x, name)
+        || X509_gmtime_adj(X509_getm_notBefore(x), 0) == NULL
+        || X509_gmtime_adj(X509_getm_notAfter(x), 86400) == NULL
+        || !X509_set_pubkey(x, pkey)
+        || X509_sign(x, pkey, EVP_PKEY_is_a(pkey, "ED25519")
+                              ? NULL : EVP_sha256()) <= 0) {
+        X509_free(x);
+        x = NULL;
+    }
+    X509_NAME_free(name);
+    return x;
+}
+
+static int encode(EVP_PKEY *pkey, enum encoding enc,
+                  unsigned char **out, long *outlen)
+{
+    BIO *mem = NULL;
+    X509 *x;
+    char *data;
+    int len = -1;
+
+    *out = NULL;
+    switch (enc) {
+    case PEM_PRIVATE:
+        if ((mem = BIO_new(BIO_s_mem())) == NULL
+            || !PEM_write_bio_PrivateKey(mem, pkey, NULL, NULL, 0, NULL, NULL)
+            || (*outlen = BIO_get_mem_data(mem, &data)) <= 0
+            || (*out = OPENSSL_memdup(data, *outlen)) == NULL)
+            len = -1;
+        else
+            len = (int)*outlen;
+        BIO_free(mem);
+        break;
+    case DER_PRIVATE:
+        len = i2d_PrivateKey(pkey, out);
+        break;
+    case DER_PUBLIC:
+        len = i2d_PUBKEY(pkey, out);
+        break;
+    case DER_CERT:
+        if ((x = self_signed(pkey)) != NULL)
+            len = i2d_X509(x, out);
+        X509_free(x);
+        break;
+    }
+    *outlen = len;
+    return len > 0;
+}
+
+static int decode(const unsigned char *in, long inlen, enum encoding enc)
+{
+    const unsigned char *p = in;
+    EVP_PKEY *pkey = NULL;
+    X509 *x;
+    BIO *mem;
+
+    switch (enc) {
+    case PEM_PRIVATE:
+        if ((mem = BIO_new_mem_buf(in, (int)inlen)) != NULL)
+            pkey = PEM_read_bio_PrivateKey(mem, NULL, NULL, NULL);
+        BIO_free(mem);
+        break;
+    case DER_PRIVATE:
+        pkey = d2i_AutoPrivateKey(NULL, &p, inlen);
+        break;
+    case DER_PUBLIC:
+        pkey = d2i_PUBKEY(NULL, &p, inlen);
+        break;
+    case DER_CERT:
+        if ((x = d2i_X509(NULL, &p, inlen)) == NULL)
+            return 0;
+        X509_free(x);
+        return 1;
+    }
+    EVP_PKEY_free(pkey);
+    return pkey != NULL;
+}
+
+static int run(const char *name, EVP_PKEY *pkey, int count)
+{
+    unsigned char *data;
+    long len;
+    size_t e;
+    int i;
+    double start, elapsed;
+
+    for (e = 0; e < NENCODINGS; e++) {
+        if (!encode(pkey, (enum encoding)e, &data, &len))
+            return 0;
+        start = now_wall();
+        for (i = 0; i < count; i++) {
+            if (!decode(data, len, (enum encoding)e)) {
+                OPENSSL_free(data);
+                return 0;
+            }
+        }
+        elapsed = now_wall() - start;
+        OPENSSL_free(data);
+        printf("%-8s %-12s %12.2f %12.0f\n", name, encodings[e],
+               elapsed * 1e6 / count, count / elapsed);
+    }
+    return 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags]\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -n #  Number of decodes of each key (default 2000)\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef DECODE_KEY_BENCH
+    EVP_PKEY *rsa = NULL, *ec = NULL, *ed25519 = NULL;
+    int i, count = 2000, ret = EXIT_FAILURE;
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "n:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'n':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        }
+    }
+    if (optind != ac)
+        usage();
+
+    if ((rsa = EVP_PKEY_Q_keygen(NULL, NULL, "RSA", (size_t)2048)) == NULL
+        || (ec = EVP_PKEY_Q_keygen(NULL, NULL, "EC", "P-256")) == NULL
+        || (ed25519 = EVP_PKEY_Q_keygen(NULL, NULL, "ED25519")) == NULL)
+        goto err;
+
+    printf("%-8s %-12s %12s %12s\n", "key", "encoding", "us/decode",
+           "decodes/s");
+    if (run("RSA", rsa, count)
+        && run("EC", ec, count)
+        && run("Ed25519", ed25519, count))
+        ret = EXIT_SUCCESS;
+ err:
+    if (ret != EXIT_SUCCESS)
+        ERR_print_errors_fp(stderr);
+    EVP_PKEY_free(rsa);
+    EVP_PKEY_free(ec);
+    EVP_PKEY_free(ed25519);
+    return ret;
+#else
+    fprintf(stderr, "This benchmark requires POSIX APIs\n");
+    return EXIT_FAILURE;
+#endif
+}
@@ -0,0 +1,448 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * In-process TLS handshake benchmark.  Client and server SSL objects are
+ * connected with a BIO pair, so no sockets or peer process are involved and
+ * the numbers reflect the library cost only.  For every combination of
+ * protocol version, key exchange group and server signature algorithm a
+ * number of full and resumed handshakes are timed, optionally on several
+ * threads sharing the same SSL_CTX pair.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# include <sys/resource.h>
+# include <openssl/ssl.h>
+# include <openssl/err.h>
+# include <openssl/bio.h>
+# include <openssl/pem.h>
+# include <openssl/crypto.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L \
+     && defined(OPENSSL_THREADS)
+#  include <pthread.h>
+#  define HANDSHAKE_BENCH
+
+#  if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <x86intrin.h>
+#   define HAVE_CYCLES
+static unsigned long long cycles(void)
+{
+    return __rdtsc();
+}
+#  endif
+
+static char *prog;
+static const char *certsdir;
+
+static const struct {
+    const char *name;
+    int version;
+} versions[] = {
+    { "TLSv1.2", TLS1_2_VERSION },
+    { "TLSv1.3", TLS1_3_VERSION },
+};
+
+static const char *groups[] = {
+    "x25519", "secp256r1", "secp384r1", "ffdhe2048"
+};
+
+static const struct {
+    const char *sigalg;
+    const char *cert;
+    const char *key;
+} sigalgs[] = {
+    { "rsa_pss_rsae_sha256", "servercert.pem", "serverkey.pem" },
+    { "ecdsa_secp256r1_sha256", "server-ecdsa-cert.pem",
+      "server-ecdsa-key.pem" },
+    { "ed25519", "server-ed25519-cert.pem", "server-ed25519-key.pem" },
+};
+
+/*
+ * Allocation counting.  The counters are only approximate if the compiler
+ * provides no atomic builtins, which is good enough for a benchmark.
+ */
+static size_t num_allocs = 0;
+
+static void count_alloc(void)
+{
+#  if defined(__GNUC__)
+    __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+#  else
+    num_allocs++;
+#  endif
+}
+
+static void *bench_malloc(size_t num, const char *file, int line)
+{
+    count_alloc();
+    return malloc(num);
+}
+
+static void *bench_realloc(void *addr, size_t num, const char *file, int line)
+{
+    count_alloc();
+    return realloc(addr, num);
+}
+
+static void bench_free(void *addr, const char *file, int line)
+{
+    free(addr);
+}
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static double now_cpu(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6
+        + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+}
+
+static char *certfile(const char *name)
+{
+    size_t len = strlen(certsdir) + strlen(name) + 2;
+    char *path = OPENSSL_malloc(len);
+
+    if (path != NULL)
+        BIO_snprintf(path, len, "%s/%s", certsdir, name);
+    return path;
+}
+
+static SSL_CTX *server_ctx(int version, const char *group, int sigalg)
+{
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    char *cert = certfile(sigalgs[sigalg].cert);
+    char *key = certfile(sigalgs[sigalg].key);
+    char *chain = certfile("ca-cert.pem");
+    X509 *ca = NULL;
+    BIO *in = NULL;
+    int ok = 0;
+
+    if (ctx == NULL || cert == NULL || key == NULL || chain == NULL)
+        goto err;
+    if (!SSL_CTX_set_min_proto_version(ctx, version)
+        || !SSL_CTX_set_max_proto_version(ctx, version)
+        || !SSL_CTX_set1_groups_list(ctx, group)
+        || !SSL_CTX_set1_sigalgs_list(ctx, sigalgs[sigalg].sigalg)
+        || SSL_CTX_use_certificate_file(ctx, cert, SSL_FILETYPE_PEM) <= 0
+        || SSL_CTX_use_PrivateKey_file(ctx, key, SSL_FILETYPE_PEM) <= 0
+        || (in = BIO_new_file(chain, "r")) == NULL
+        || (ca = PEM_read_bio_X509(in, NULL, NULL, NULL)) == NULL
+        || !SSL_CTX_add0_chain_cert(ctx, ca))
+        goto err;
+    ca = NULL;
+    if (version == TLS1_2_VERSION && strncmp(group, "ffdhe", 5) == 0
+        && (!SSL_CTX_set_cipher_list(ctx, "DHE-RSA-AES128-GCM-SHA256")
+            || !SSL_CTX_set_dh_auto(ctx, 1)))
+        goto err;
+    SSL_CTX_set_session_id_context(ctx, (const unsigned char *)prog,
+                                   strlen(prog));
+    ok = 1;
+ err:
+    X509_free(ca);
+    BIO_free(in);
+    OPENSSL_free(cert);
+    OPENSSL_free(key);
+    OPENSSL_free(chain);
+    if (!ok) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static SSL_CTX *client_ctx(int version, const char *group, int sigalg)
+{
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    char *root = certfile("rootcert.pem");
+    char groups[64];
+    int ok = 0;
+
+    /*
+     * In TLSv1.2 an ECDSA certificate can only be used if its curve is
+     * supported by the client.  The server only knows |group|, so this does
+     * not change the key exchange group.
+     */
+    if (version == TLS1_2_VERSION && strcmp(group, "secp256r1") != 0
+        && strncmp(sigalgs[sigalg].sigalg, "ecdsa", 5) == 0)
+        BIO_snprintf(groups, sizeof(groups), "%s:secp256r1", group);
+    else
+        BIO_snprintf(groups, sizeof(groups), "%s", group);
+
+    if (ctx == NULL || root == NULL)
+        goto err;
+    if (!SSL_CTX_set_min_proto_version(ctx, version)
+        || !SSL_CTX_set_max_proto_version(ctx, version)
+        || !SSL_CTX_set1_groups_list(ctx, groups)
+        || !SSL_CTX_set1_sigalgs_list(ctx, sigalgs[sigalg].sigalg)
+        || !SSL_CTX_load_verify_file(ctx, root))
+        goto err;
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+    ok = 1;
+ err:
+    OPENSSL_free(root);
+    if (!ok) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+/*
+ * Perform one handshake between new SSL objects over a BIO pair.  If
+ * |sess| is not NULL it is offered for resumption; if |out| is not NULL
+ * the resulting client session is returned in it.
+ */
+static int handshake(SSL_CTX *sctx, SSL_CTX *cctx, SSL_SESSION *sess,
+                     SSL_SESSION **out)
+{
+    SSL *server = SSL_new(sctx), *client = SSL_new(cctx);
+    BIO *sbio = NULL, *cbio = NULL;
+    int cret = 0, sret = 0, i, ok = 0;
+    unsigned char buf;
+
+    if (server == NULL || client == NULL
+        || !BIO_new_bio_pair(&sbio, 0, &cbio, 0))
+        goto err;
+    SSL_set_bio(server, sbio, sbio);
+    SSL_set_bio(client, cbio, cbio);
+    if (sess != NULL && !SSL_set_session(client, sess))
+        goto err;
+
+    for (i = 0; i < 64 && (cret <= 0 || sret <= 0); i++) {
+        if (cret <= 0) {
+            cret = SSL_connect(client);
+            if (cret <= 0 && SSL_get_error(client, cret) != SSL_ERROR_WANT_READ)
+                goto err;
+        }
+        if (sret <= 0) {
+            sret = SSL_accept(server);
+            if (sret <= 0 && SSL_get_error(server, sret) != SSL_ERROR_WANT_READ)
+                goto err;
+        }
+    }
+    if (cret <= 0 || sret <= 0)
+        goto err;
+    if (sess != NULL && !SSL_session_reused(client))
+        goto err;
+    if (out != NULL) {
+        /* Let the client process any TLSv1.3 NewSessionTicket messages */
+        if (SSL_read(client, &buf, sizeof(buf)) > 0)
+            goto err;
+        if ((*out = SSL_get1_session(client)) == NULL)
+            goto err;
+    }
+    /* An unclean shutdown would make the session non-resumable */
+    if (SSL_shutdown(client) < 0 || SSL_shutdown(server) < 0)
+        goto err;
+    ok = 1;
+ err:
+    SSL_free(client);
+    SSL_free(server);
+    return ok;
+}
+
+/*
+ * Cycles are counted per thread from the time stamp counter, so with more
+ * threads than CPUs they include time spent waiting to be scheduled.
+ */
+typedef struct bench_thread_st {
+    pthread_t thread;
+    SSL_CTX *sctx, *cctx;
+    SSL_SESSION *sess;
+    int count;
+    int ok;
+    unsigned long long cycles;
+} BENCH_THREAD;
+
+static void *bench_run(void *arg)
+{
+    BENCH_THREAD *t = arg;
+    int i;
+#  ifdef HAVE_CYCLES
+    unsigned long long start = cycles();
+#  endif
+
+    for (i = 0; i < t->count; i++)
+        if (!handshake(t->sctx, t->cctx, t->sess, NULL))
+            break;
+    t->ok = i == t->count;
+#  ifdef HAVE_CYCLES
+    t->cycles = cycles() - start;
+#  endif
+    return NULL;
+}
+
+static int bench(int version, const char *group, int sigalg, int resume,
+                 int nthreads, int count)
+{
+    SSL_CTX *sctx = server_ctx(versions[version].version, group, sigalg);
+    SSL_CTX *cctx = client_ctx(versions[version].version, group, sigalg);
+    SSL_SESSION *sess = NULL;
+    BENCH_THREAD *t = NULL;
+    double wall, cpu;
+    size_t allocs;
+    unsigned long long cyc = 0;
+    int i, started = 0, ok = 0, total = nthreads * count;
+
+    if (sctx == NULL || cctx == NULL)
+        goto err;
+    if (!resume) {
+        SSL_CTX_set_options(sctx, SSL_OP_NO_TICKET);
+        SSL_CTX_set_session_cache_mode(sctx, SSL_SESS_CACHE_OFF);
+    }
+    if ((resume && !handshake(sctx, cctx, NULL, &sess))
+        || (t = OPENSSL_zalloc(nthreads * sizeof(*t))) == NULL)
+        goto err;
+
+    allocs = num_allocs;
+    wall = now_wall();
+    cpu = now_cpu();
+    for (started = 0; started < nthreads; started++) {
+        t[started].sctx = sctx;
+        t[started].cctx = cctx;
+        t[started].sess = sess;
+        t[started].count = count;
+        if (pthread_create(&t[started].thread, NULL, bench_run,
+                           &t[started]) != 0)
+            break;
+    }
+    for (i = 0; i < started; i++)
+        pthread_join(t[i].thread, NULL);
+    wall = now_wall() - wall;
+    cpu = now_cpu() - cpu;
+    allocs = num_allocs - allocs;
+    if (started < nthreads)
+        goto err;
+    for (i = 0; i < nthreads; i++) {
+        if (!t[i].ok)
+            goto err;
+        cyc += t[i].cycles;
+    }
+
+    printf("%s %-10s %-23s %-7s %10.1f handshakes/s %9.1f us CPU",
+           versions[version].name, group, sigalgs[sigalg].sigalg,
+           resume ? "resumed" : "full", total / wall, cpu * 1e6 / total);
+#  ifdef HAVE_CYCLES
+    printf(" %10llu cycles", cyc / total);
+#  endif
+    printf(" %7zu allocs\n", allocs / total);
+    ok = 1;
+ err:
+    if (!ok) {
+        printf("%s %-10s %-23s %-7s failed\n", versions[version].name, group,
+               sigalgs[sigalg].sigalg, resume ? "resumed" : "full");
+        ERR_print_errors_fp(stdout);
+    }
+    OPENSSL_free(t);
+    SSL_SESSION_free(sess);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return ok;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags] certs-dir\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -c #  Handshakes per thread and test (default 100)\n");
+    fprintf(stderr, "  -t #  Number of threads (default 1)\n");
+    fprintf(stderr, "  -v V  Only test protocol version V (TLSv1.2 or TLSv1.3)\n");
+    fprintf(stderr, "  -g G  Only test key exchange group G\n");
+    fprintf(stderr, "  -s S  Only test server signature algorithm S\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef HANDSHAKE_BENCH
+    int i, v, g, s, resume, count = 100, nthreads = 1, ret = EXIT_SUCCESS;
+    const char *only_version = NULL, *only_group = NULL, *only_sigalg = NULL;
+
+    /* Must happen before the first allocation */
+    if (!CRYPTO_set_mem_functions(bench_malloc, bench_realloc, bench_free)) {
+        fprintf(stderr, "Cannot install allocation counters\n");
+        return EXIT_FAILURE;
+    }
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "c:t:v:g:s:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'c':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 't':
+            if ((nthreads = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 'v':
+            only_version = optarg;
+            break;
+        case 'g':
+            only_group = optarg;
+            break;
+        case 's':
+            only_sigalg = optarg;
+            break;
+        }
+    }
+    if (optind != ac - 1)
+        usage();
+    certsdir = av[optind];
+
+    for (v = 0; v < (int)(sizeof(versions) / sizeof(versions[0])); v++) {
+        if (only_version != NULL && strcmp(only_version, versions[v].name) != 0)
+            continue;
+        for (g = 0; g < (int)(sizeof(groups) / sizeof(groups[0])); g++) {
+            if (only_group != NULL && strcmp(only_group, groups[g]) != 0)
+                continue;
+            for (s = 0; s < (int)(sizeof(sigalgs) / sizeof(sigalgs[0])); s++) {
+                if (only_sigalg != NULL
+                        && strcmp(only_sigalg, sigalgs[s].sigalg) != 0)
+                    continue;
+                /* Finite field DHE in TLSv1.2 is only defined with RSA */
+                if (versions[v].version == TLS1_2_VERSION
+                        && strncmp(groups[g], "ffdhe", 5) == 0
+                        && s != 0)
+                    continue;
+                for (resume = 0; resume <= 1; resume++)
+                    if (!bench(v, groups[g], s, resume, nthreads, count))
+                        ret = EXIT_FAILURE;
+            }
+        }
+    }
+    return ret;
+#else
+    fprintf(stderr,
+            "This benchmark requires POSIX threads and resource usage APIs\n");
+    return EXIT_FAILURE;
+#endif
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Hash table benchmark.  Inserts a set of algorithm-name-like string keys
+ * into an LHASH and into the internal open addressing table, then looks up
+ * every key (hits) and the same number of absent keys (misses), and reports
+ * the throughput of each phase.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <openssl/crypto.h>
+#include <openssl/bio.h>
+#include <openssl/lhash.h>
+#include "crypto/hashtable.h"
+
+typedef struct {
+    char name[24];
+    int number;
+} NAME;
+
+DEFINE_LHASH_OF_EX(NAME);
+DEFINE_HASHTABLE_OF(NAME);
+
+static unsigned long name_hash(const NAME *n)
+{
+    return OPENSSL_LH_strhash(n->name);
+}
+
+static int name_cmp(const NAME *a, const NAME *b)
+{
+    return strcmp(a->name, b->name);
+}
+
+static double now_cpu(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void report(const char *impl, const char *phase, size_t ops, double t)
+{
+    printf("%-6s %-8s %12.0f ops/s\n", impl, phase, t > 0 ? ops / t : 0.0);
+}
+
+static int bench_lhash(NAME *keys, NAME *absent, size_t n, int rounds)
+{
+    LHASH_OF(NAME) *lh = NULL;
+    double t;
+    size_t i, found = 0;
+    int r, ok = 0;
+
+    t = now_cpu();
+    for (r = 0; r < rounds; r++) {
+        lh_NAME_free(lh);
+        if ((lh = lh_NAME_new(name_hash, name_cmp)) == NULL)
+            return 0;
+        for (i = 0; i < n; i++)
+            if (lh_NAME_insert(lh, &keys[i]) != NULL || lh_NAME_error(lh))
+                goto err;
+    }
+    report("lhash", "insert", n * rounds, now_cpu() - t);
+
+    t = now_cpu();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < n; i++)
+            found += lh_NAME_retrieve(lh, &keys[i]) != NULL;
+    report("lhash", "hit", n * rounds, now_cpu() - t);
+
+    t = now_cpu();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < n; i++)
+            found += lh_NAME_retrieve(lh, &absent[i]) != NULL;
+    report("lhash", "miss", n * rounds, now_cpu() - t);
+
+    ok = found == n * rounds;
+ err:
+    lh_NAME_free(lh);
+    return ok;
+}
+
+static int bench_ht(NAME *keys, NAME *absent, size_t n, int rounds)
+{
+    HASHTABLE_OF(NAME) *ht = NULL;
+    double t;
+    size_t i, found = 0;
+    int r, ok = 0;
+
+    t = now_cpu();
+    for (r = 0; r < rounds; r++) {
+        ossl_ht_NAME_free(ht);
+        if ((ht = ossl_ht_NAME_new(name_hash, name_cmp)) == NULL)
+            return 0;
+        for (i = 0; i < n; i++)
+            if (ossl_ht_NAME_insert(ht, &keys[i]) != NULL
+                    || ossl_ht_NAME_error(ht))
+                goto err;
+    }
+    report("ht", "insert", n * rounds, now_cpu() - t);
+
+    t = now_cpu();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < n; i++)
+            found += ossl_ht_NAME_retrieve(ht, &keys[i]) != NULL;
+    report("ht", "hit", n * rounds, now_cpu() - t);
+
+    t = now_cpu();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < n; i++)
+            found += ossl_ht_NAME_retrieve(ht, &absent[i]) != NULL;
+    report("ht", "miss", n * rounds, now_cpu() - t);
+
+    ok = found == n * rounds;
+ err:
+    ossl_ht_NAME_free(ht);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    size_t i, n = 1000;
+    int rounds, ret = EXIT_FAILURE;
+    NAME *keys = NULL, *absent = NULL;
+
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [number-of-keys]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (argc == 2 && (n = strtoul(argv[1], NULL, 0)) == 0)
+        n = 1000;
+    /* Aim for a similar amount of work whatever the table size */
+    rounds = (int)(2000000 / n) + 1;
+
+    keys = OPENSSL_malloc(sizeof(*keys) * n);
+    absent = OPENSSL_malloc(sizeof(*absent) * n);
+    if (keys == NULL || absent == NULL)
+        goto err;
+    for (i = 0; i < n; i++) {
+        BIO_snprintf(keys[i].name, sizeof(keys[i].name), "ALG-%zu-SHA", i);
+        BIO_snprintf(absent[i].name, sizeof(absent[i].name), "alg-%zu-sha", i);
+        keys[i].number = absent[i].number = (int)i;
+    }
+
+    printf("%zu keys, %d rounds\n", n, rounds);
+    if (bench_lhash(keys, absent, n, rounds)
+            && bench_ht(keys, absent, n, rounds))
+        ret = EXIT_SUCCESS;
+ err:
+    OPENSSL_free(keys);
+    OPENSSL_free(absent);
+    return ret;
+}
@@ -0,0 +1,342 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Session ticket resumption benchmark.  Client and server SSL objects are
+ * connected with a BIO pair and resume a session from a stateless ticket
+ * over and over again, optionally on several threads sharing the same
+ * SSL_CTX pair.  The server has no session cache, so every resumption opens
+ * a ticket, and in TLSv1.3 also seals a new one.  Ticket key rotation can be
+ * turned on to see what it costs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# include <openssl/ssl.h>
+# include <openssl/err.h>
+# include <openssl/bio.h>
+# include <openssl/crypto.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L \
+     && defined(OPENSSL_THREADS)
+#  include <pthread.h>
+#  define RESUMPTION_BENCH
+
+static char *prog;
+static const char *certsdir;
+
+static const struct {
+    const char *name;
+    int version;
+} modes[] = {
+    { "TLSv1.2", TLS1_2_VERSION },
+    { "TLSv1.3", TLS1_3_VERSION },
+};
+
+/*
+ * Allocation counting.  The counters are only approximate if the compiler
+ * provides no atomic builtins, which is good enough for a benchmark.
+ */
+static size_t num_allocs = 0;
+
+static void count_alloc(void)
+{
+#  if defined(__GNUC__)
+    __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+#  else
+    num_allocs++;
+#  endif
+}
+
+static void *bench_malloc(size_t num, const char *file, int line)
+{
+    count_alloc();
+    return malloc(num);
+}
+
+static void *bench_realloc(void *addr, size_t num, const char *file, int line)
+{
+    count_alloc();
+    return realloc(addr, num);
+}
+
+static void bench_free(void *addr, const char *file, int line)
+{
+    free(addr);
+}
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static char *certfile(const char *name)
+{
+    size_t len = strlen(certsdir) + strlen(name) + 2;
+    char *path = OPENSSL_malloc(len);
+
+    if (path != NULL)
+        BIO_snprintf(path, len, "%s/%s", certsdir, name);
+    return path;
+}
+
+static SSL_CTX *server_ctx(int mode, long interval, int num_keys)
+{
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    char *cert = certfile("servercert.pem"), *key = certfile("serverkey.pem");
+    int ok = 0;
+
+    if (ctx == NULL || cert == NULL || key == NULL
+        || !SSL_CTX_set_min_proto_version(ctx, modes[mode].version)
+        || !SSL_CTX_set_max_proto_version(ctx, modes[mode].version)
+        || SSL_CTX_use_certificate_file(ctx, cert, SSL_FILETYPE_PEM) <= 0
+        || SSL_CTX_use_PrivateKey_file(ctx, key, SSL_FILETYPE_PEM) <= 0
+        || !SSL_CTX_set_ticket_key_rotation(ctx, interval, num_keys)
+        || !SSL_CTX_set_num_tickets(ctx, 1))
+        goto err;
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_session_id_context(ctx, (const unsigned char *)prog,
+                                   strlen(prog));
+    ok = 1;
+ err:
+    OPENSSL_free(cert);
+    OPENSSL_free(key);
+    if (!ok) {
+        SSL_CTX_free(ctx);
+        ctx = NULL;
+    }
+    return ctx;
+}
+
+static SSL_CTX *client_ctx(int mode)
+{
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+
+    if (ctx == NULL
+        || !SSL_CTX_set_min_proto_version(ctx, modes[mode].version)
+        || !SSL_CTX_set_max_proto_version(ctx, modes[mode].version)) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+/*
+ * Perform one handshake between new SSL objects over a BIO pair.  If
+ * |sess| is not NULL it must be resumed; if |out| is not NULL the resulting
+ * client session is returned in it.
+ */
+static int handshake(SSL_CTX *sctx, SSL_CTX *cctx, SSL_SESSION *sess,
+                     SSL_SESSION **out)
+{
+    SSL *server = SSL_new(sctx), *client = SSL_new(cctx);
+    BIO *sbio = NULL, *cbio = NULL;
+    int cret = 0, sret = 0, i, ok = 0;
+    unsigned char buf;
+
+    if (server == NULL || client == NULL
+        || !BIO_new_bio_pair(&sbio, 0, &cbio, 0))
+        goto err;
+    SSL_set_bio(server, sbio, sbio);
+    SSL_set_bio(client, cbio, cbio);
+    if (sess != NULL && !SSL_set_session(client, sess))
+        goto err;
+
+    for (i = 0; i < 64 && (cret <= 0 || sret <= 0); i++) {
+        if (cret <= 0) {
+            cret = SSL_connect(client);
+            if (cret <= 0 && SSL_get_error(client, cret) != SSL_ERROR_WANT_READ)
+                goto err;
+        }
+        if (sret <= 0) {
+            sret = SSL_accept(server);
+            if (sret <= 0 && SSL_get_error(server, sret) != SSL_ERROR_WANT_READ)
+                goto err;
+        }
+    }
+    if (cret <= 0 || sret <= 0)
+        goto err;
+    if (sess != NULL && !SSL_session_reused(client))
+        goto err;
+    /* Let the client process any TLSv1.3 NewSessionTicket messages */
+    if (SSL_read(client, &buf, sizeof(buf)) > 0)
+        goto err;
+    if (out != NULL && (*out = SSL_get1_session(client)) == NULL)
+        goto err;
+    /* An unclean shutdown would make the session non-resumable */
+    if (SSL_shutdown(client) < 0 || SSL_shutdown(server) < 0)
+        goto err;
+    ok = 1;
+ err:
+    SSL_free(client);
+    SSL_free(server);
+    return ok;
+}
+
+typedef struct bench_thread_st {
+    pthread_t thread;
+    SSL_CTX *sctx, *cctx;
+    SSL_SESSION *sess;
+    int count;
+    int ok;
+} BENCH_THREAD;
+
+/*
+ * Like a real client, each thread resumes with the newest ticket it got, so
+ * that tickets don't expire when the keys are rotated.
+ */
+static void *bench_run(void *arg)
+{
+    BENCH_THREAD *t = arg;
+    SSL_SESSION *sess;
+    int i;
+
+    for (i = 0; i < t->count; i++) {
+        if (!handshake(t->sctx, t->cctx, t->sess, &sess))
+            break;
+        SSL_SESSION_free(t->sess);
+        t->sess = sess;
+    }
+    t->ok = i == t->count;
+    return NULL;
+}
+
+static int bench(int mode, long interval, int num_keys, int nthreads,
+                 int count)
+{
+    SSL_CTX *sctx = server_ctx(mode, interval, num_keys);
+    SSL_CTX *cctx = client_ctx(mode);
+    SSL_SESSION *sess = NULL;
+    BENCH_THREAD *t = NULL;
+    double wall;
+    size_t allocs;
+    int i, started = 0, ok = 0, total = nthreads * count;
+
+    if (sctx == NULL || cctx == NULL
+        || !handshake(sctx, cctx, NULL, &sess)
+        || (t = OPENSSL_zalloc(nthreads * sizeof(*t))) == NULL)
+        goto err;
+    /* Warm up, so that the first ticket contexts are not counted */
+    for (i = 0; i < 10; i++)
+        if (!handshake(sctx, cctx, sess, NULL))
+            goto err;
+
+    allocs = num_allocs;
+    wall = now_wall();
+    for (started = 0; started < nthreads; started++) {
+        t[started].sctx = sctx;
+        t[started].cctx = cctx;
+        t[started].count = count;
+        if (!SSL_SESSION_up_ref(sess))
+            break;
+        t[started].sess = sess;
+        if (pthread_create(&t[started].thread, NULL, bench_run,
+                           &t[started]) != 0)
+            break;
+    }
+    for (i = 0; i < started; i++)
+        pthread_join(t[i].thread, NULL);
+    wall = now_wall() - wall;
+    allocs = num_allocs - allocs;
+    if (started < nthreads)
+        goto err;
+    for (i = 0; i < nthreads; i++)
+        if (!t[i].ok)
+            goto err;
+
+    printf("%-8s %3d threads %10.1f resumptions/s %8.2f us %7zu allocs\n",
+           modes[mode].name, nthreads, total / wall, wall * 1e6 / count,
+           allocs / total);
+    ok = 1;
+ err:
+    if (!ok) {
+        printf("%-8s failed\n", modes[mode].name);
+        ERR_print_errors_fp(stdout);
+    }
+    for (i = 0; t != NULL && i < nthreads; i++)
+        SSL_SESSION_free(t[i].sess);
+    OPENSSL_free(t);
+    SSL_SESSION_free(sess);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return ok;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags] certs-dir\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -c #  Resumptions per thread and test (default 1000)\n");
+    fprintf(stderr, "  -t #  Number of threads (default 1)\n");
+    fprintf(stderr, "  -r #  Ticket key rotation interval in seconds "
+                    "(default 0, no rotation)\n");
+    fprintf(stderr, "  -k #  Number of ticket keys kept (default 1)\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef RESUMPTION_BENCH
+    int i, count = 1000, nthreads = 1, num_keys = 1, ret = EXIT_SUCCESS;
+    long interval = 0;
+
+    /* Must happen before the first allocation */
+    if (!CRYPTO_set_mem_functions(bench_malloc, bench_realloc, bench_free)) {
+        fprintf(stderr, "Cannot install allocation counters\n");
+        return EXIT_FAILURE;
+    }
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "c:t:r:k:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'c':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 't':
+            if ((nthreads = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 'r':
+            if ((interval = atol(optarg)) < 0)
+                usage();
+            break;
+        case 'k':
+            if ((num_keys = atoi(optarg)) <= 0)
+                usage();
+            break;
+        }
+    }
+    if (optind != ac - 1)
+        usage();
+    certsdir = av[optind];
+
+    for (i = 0; i < (int)(sizeof(modes) / sizeof(modes[0])); i++)
+        if (!bench(i, interval, num_keys, nthreads, count))
+            ret = EXIT_FAILURE;
+    return ret;
+#else
+    fprintf(stderr, "This benchmark requires POSIX threads\n");
+    return EXIT_FAILURE;
+#endif
+}
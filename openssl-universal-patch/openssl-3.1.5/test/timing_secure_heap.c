@@ -0,0 +1,169 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Secure heap contention benchmark.  Every thread repeatedly allocates and
+ * frees a small set of buffers of the sizes typically used for private key
+ * BIGNUMs, first from the ordinary heap and then from the secure heap, with
+ * 1, 2, 4, ... threads up to the requested maximum.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <openssl/e_os2.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# include <openssl/crypto.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L \
+     && defined(OPENSSL_THREADS)
+#  include <pthread.h>
+#  define SECURE_HEAP_BENCH
+
+static char *prog;
+
+static const size_t sizes[] = { 32, 64, 128, 256, 512 };
+#  define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+typedef struct bench_thread_st {
+    pthread_t thread;
+    int count;
+    int ok;
+} BENCH_THREAD;
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void *bench_run(void *arg)
+{
+    BENCH_THREAD *t = arg;
+    void *p[NUM_SIZES];
+    size_t j;
+    int i;
+
+    for (i = 0; i < t->count; i++) {
+        for (j = 0; j < NUM_SIZES; j++)
+            if ((p[j] = OPENSSL_secure_malloc(sizes[j])) == NULL)
+                break;
+        t->ok = j == NUM_SIZES;
+        while (j > 0)
+            OPENSSL_secure_free(p[--j]);
+        if (!t->ok)
+            break;
+    }
+    return NULL;
+}
+
+static int bench(const char *name, int nthreads, int count)
+{
+    BENCH_THREAD *t;
+    double wall;
+    int i, started, ok = 1;
+
+    if ((t = calloc(nthreads, sizeof(*t))) == NULL)
+        return 0;
+
+    wall = now_wall();
+    for (started = 0; started < nthreads; started++) {
+        t[started].count = count;
+        if (pthread_create(&t[started].thread, NULL, bench_run,
+                           &t[started]) != 0)
+            break;
+    }
+    for (i = 0; i < started; i++)
+        pthread_join(t[i].thread, NULL);
+    wall = now_wall() - wall;
+    if (started < nthreads)
+        ok = 0;
+    for (i = 0; i < started; i++)
+        if (!t[i].ok)
+            ok = 0;
+
+    if (ok)
+        printf("%-7s %3d threads %12.0f allocations/s\n", name, nthreads,
+               (double)nthreads * count * NUM_SIZES / wall);
+    else
+        printf("%-7s %3d threads failed\n", name, nthreads);
+    free(t);
+    return ok;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags]\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -c #  Allocation rounds per thread (default 200000)\n");
+    fprintf(stderr, "  -t #  Maximum number of threads (default 4)\n");
+    fprintf(stderr, "  -s #  Secure heap size, a power of 2 (default 1048576)\n");
+    fprintf(stderr, "  -m #  Secure heap minimum allocation (default 16)\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef SECURE_HEAP_BENCH
+    int i, n, count = 200000, nthreads = 4, ret = EXIT_SUCCESS;
+    size_t size = 1 << 20, minsize = 16;
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "c:t:s:m:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'c':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 't':
+            if ((nthreads = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 's':
+            size = strtoul(optarg, NULL, 0);
+            break;
+        case 'm':
+            minsize = strtoul(optarg, NULL, 0);
+            break;
+        }
+    }
+    if (optind != ac)
+        usage();
+
+    for (n = 1; n <= nthreads; n *= 2)
+        if (!bench("malloc", n, count))
+            ret = EXIT_FAILURE;
+
+    if (!CRYPTO_secure_malloc_init(size, minsize)) {
+        fprintf(stderr, "Cannot initialise a %zu byte secure heap\n", size);
+        return EXIT_FAILURE;
+    }
+    for (n = 1; n <= nthreads; n *= 2)
+        if (!bench("secure", n, count))
+            ret = EXIT_FAILURE;
+    if (!CRYPTO_secure_malloc_done()) {
+        fprintf(stderr, "Secure heap still in use: %zu bytes\n",
+                CRYPTO_secure_used());
+        ret = EXIT_FAILURE;
+    }
+    return ret;
+#else
+    fprintf(stderr, "This benchmark requires POSIX threads\n");
+    return EXIT_FAILURE;
+#endif
+}
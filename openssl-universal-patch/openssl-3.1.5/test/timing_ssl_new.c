@@ -0,0 +1,259 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * SSL object creation benchmark.  Measures the latency and the number of
+ * heap allocations of an SSL_new() and SSL_free() pair for a typical server
+ * SSL_CTX (certificate chain, private key, client CA list) and a typical
+ * client SSL_CTX (trust store, groups, ALPN), optionally on several threads
+ * sharing the same SSL_CTX.  No handshake is performed, this is the fixed
+ * cost every connection pays before the first byte is exchanged.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# include <openssl/ssl.h>
+# include <openssl/err.h>
+# include <openssl/bio.h>
+# include <openssl/crypto.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L \
+     && defined(OPENSSL_THREADS)
+#  include <pthread.h>
+#  define SSL_NEW_BENCH
+
+static char *prog;
+static const char *certsdir;
+
+/*
+ * Allocation counting.  The counters are only approximate if the compiler
+ * provides no atomic builtins, which is good enough for a benchmark.
+ */
+static size_t num_allocs = 0;
+
+static void count_alloc(void)
+{
+#  if defined(__GNUC__)
+    __atomic_add_fetch(&num_allocs, 1, __ATOMIC_RELAXED);
+#  else
+    num_allocs++;
+#  endif
+}
+
+static void *bench_malloc(size_t num, const char *file, int line)
+{
+    count_alloc();
+    return malloc(num);
+}
+
+static void *bench_realloc(void *addr, size_t num, const char *file, int line)
+{
+    count_alloc();
+    return realloc(addr, num);
+}
+
+static void bench_free(void *addr, const char *file, int line)
+{
+    free(addr);
+}
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static char *certfile(const char *name)
+{
+    size_t len = strlen(certsdir) + strlen(name) + 2;
+    char *path = OPENSSL_malloc(len);
+
+    if (path != NULL)
+        BIO_snprintf(path, len, "%s/%s", certsdir, name);
+    return path;
+}
+
+static SSL_CTX *server_ctx(void)
+{
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    STACK_OF(X509_NAME) *cas = NULL;
+    char *cert = certfile("servercert.pem"), *key = certfile("serverkey.pem");
+    char *root = certfile("rootcert.pem");
+    int ok = 0;
+
+    if (ctx == NULL || cert == NULL || key == NULL || root == NULL
+        || SSL_CTX_use_certificate_chain_file(ctx, cert) <= 0
+        || SSL_CTX_use_PrivateKey_file(ctx, key, SSL_FILETYPE_PEM) <= 0
+        || (cas = SSL_load_client_CA_file(root)) == NULL)
+        goto err;
+    SSL_CTX_set_client_CA_list(ctx, cas);
+    ok = 1;
+ err:
+    OPENSSL_free(cert);
+    OPENSSL_free(key);
+    OPENSSL_free(root);
+    if (!ok) {
+        SSL_CTX_free(ctx);
+        ctx = NULL;
+    }
+    return ctx;
+}
+
+static SSL_CTX *client_ctx(void)
+{
+    static const unsigned char alpn[] = "\x02h2\x08http/1.1";
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    char *root = certfile("rootcert.pem");
+    int ok = 0;
+
+    if (ctx == NULL || root == NULL
+        || !SSL_CTX_load_verify_file(ctx, root)
+        || !SSL_CTX_set1_groups_list(ctx, "x25519:secp256r1:secp384r1")
+        || SSL_CTX_set_alpn_protos(ctx, alpn, sizeof(alpn) - 1) != 0)
+        goto err;
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+    ok = 1;
+ err:
+    OPENSSL_free(root);
+    if (!ok) {
+        SSL_CTX_free(ctx);
+        ctx = NULL;
+    }
+    return ctx;
+}
+
+struct job {
+    SSL_CTX *ctx;
+    int count;
+    int ok;
+    pthread_t thread;
+};
+
+static void *worker(void *arg)
+{
+    struct job *job = arg;
+    SSL *s;
+    int i;
+
+    for (i = 0; i < job->count; i++) {
+        if ((s = SSL_new(job->ctx)) == NULL)
+            return NULL;
+        SSL_free(s);
+    }
+    job->ok = 1;
+    return NULL;
+}
+
+static int bench(const char *name, SSL_CTX *ctx, int nthreads, int count)
+{
+    struct job *jobs = OPENSSL_zalloc(nthreads * sizeof(*jobs));
+    double start, elapsed;
+    size_t allocs;
+    int i, ok = 1;
+
+    if (jobs == NULL)
+        return 0;
+    /* Warm up, so that one-off initialisation is not counted */
+    jobs[0].ctx = ctx;
+    jobs[0].count = 10;
+    worker(&jobs[0]);
+
+    allocs = num_allocs;
+    start = now_wall();
+    for (i = 0; i < nthreads; i++) {
+        jobs[i].ctx = ctx;
+        jobs[i].count = count;
+        jobs[i].ok = 0;
+        if (pthread_create(&jobs[i].thread, NULL, worker, &jobs[i]) != 0)
+            ok = jobs[i].count = 0;
+    }
+    for (i = 0; i < nthreads; i++)
+        if (jobs[i].count > 0)
+            pthread_join(jobs[i].thread, NULL);
+    elapsed = now_wall() - start;
+    allocs = num_allocs - allocs;
+    for (i = 0; i < nthreads; i++)
+        ok &= jobs[i].ok;
+    OPENSSL_free(jobs);
+    if (!ok)
+        return 0;
+
+    printf("%-8s %3d threads %10.0f new+free/s %8.2f us %7zu allocs\n",
+           name, nthreads, (double)count * nthreads / elapsed,
+           elapsed * 1e6 / count, allocs / ((size_t)count * nthreads));
+    return 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags] certs-dir\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -c #  SSL objects per thread (default 100000)\n");
+    fprintf(stderr, "  -t #  Number of threads (default 1)\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef SSL_NEW_BENCH
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    int i, count = 100000, nthreads = 1, ret = EXIT_FAILURE;
+
+    /* Must happen before the first allocation */
+    if (!CRYPTO_set_mem_functions(bench_malloc, bench_realloc, bench_free)) {
+        fprintf(stderr, "Cannot install allocation counters\n");
+        return EXIT_FAILURE;
+    }
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "c:t:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'c':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 't':
+            if ((nthreads = atoi(optarg)) <= 0)
+                usage();
+            break;
+        }
+    }
+    if (optind != ac - 1)
+        usage();
+    certsdir = av[optind];
+
+    if ((sctx = server_ctx()) == NULL || (cctx = client_ctx()) == NULL)
+        goto err;
+    if (bench("server", sctx, nthreads, count)
+        && bench("client", cctx, nthreads, count))
+        ret = EXIT_SUCCESS;
+ err:
+    if (ret != EXIT_SUCCESS)
+        ERR_print_errors_fp(stderr);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return ret;
+#else
+    fprintf(stderr, "This benchmark requires POSIX threads\n");
+    return EXIT_FAILURE;
+#endif
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Startup latency benchmark.  Every iteration forks a fresh child process
+ * in which the library has not been initialised yet, so each run pays the
+ * full cost a short-lived program pays: library and configuration
+ * initialisation, activation of the default provider, the first algorithm
+ * fetches, SSL_CTX setup with a certificate and key, and finally one TLS
+ * handshake over a BIO pair.  The time to reach each of those points is
+ * reported separately, averaged over all children.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/e_os2.h>
+
+#ifdef OPENSSL_SYS_UNIX
+# include <unistd.h>
+# include <sys/time.h>
+# include <sys/wait.h>
+# include <openssl/ssl.h>
+# include <openssl/err.h>
+# include <openssl/evp.h>
+# include <openssl/bio.h>
+# include <openssl/crypto.h>
+# if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L
+#  define STARTUP_BENCH
+
+static char *prog;
+static const char *certsdir;
+
+static const char *phases[] = {
+    "OPENSSL_init_ssl",
+    "first EVP fetch",
+    "SSL_CTX setup",
+    "first handshake",
+};
+#  define NPHASES (sizeof(phases) / sizeof(phases[0]))
+
+static double now_wall(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static char *certfile(const char *name)
+{
+    size_t len = strlen(certsdir) + strlen(name) + 2;
+    char *path = OPENSSL_malloc(len);
+
+    if (path != NULL)
+        BIO_snprintf(path, len, "%s/%s", certsdir, name);
+    return path;
+}
+
+static int handshake(SSL_CTX *sctx, SSL_CTX *cctx)
+{
+    SSL *server = SSL_new(sctx), *client = SSL_new(cctx);
+    BIO *sbio = NULL, *cbio = NULL;
+    int cret = 0, sret = 0, i, ok = 0;
+
+    if (server == NULL || client == NULL
+        || !BIO_new_bio_pair(&sbio, 0, &cbio, 0))
+        goto err;
+    SSL_set_bio(server, sbio, sbio);
+    SSL_set_bio(client, cbio, cbio);
+
+    for (i = 0; i < 64 && (cret <= 0 || sret <= 0); i++) {
+        if (cret <= 0) {
+            cret = SSL_connect(client);
+            if (cret <= 0 && SSL_get_error(client, cret) != SSL_ERROR_WANT_READ)
+                goto err;
+        }
+        if (sret <= 0) {
+            sret = SSL_accept(server);
+            if (sret <= 0 && SSL_get_error(server, sret) != SSL_ERROR_WANT_READ)
+                goto err;
+        }
+    }
+    ok = cret > 0 && sret > 0;
+ err:
+    SSL_free(client);
+    SSL_free(server);
+    return ok;
+}
+
+/*
+ * The body of each child.  The elapsed time at the end of every phase is
+ * stored in |t|.  Returns 1 on success.
+ */
+static int startup(double t[NPHASES])
+{
+    double start = now_wall();
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    EVP_MD *md = NULL;
+    char *cert = NULL, *key = NULL, *root = NULL;
+    int ok = 0;
+
+    if (!OPENSSL_init_ssl(OPENSSL_INIT_LOAD_CONFIG, NULL))
+        goto err;
+    t[0] = now_wall() - start;
+
+    if ((md = EVP_MD_fetch(NULL, "SHA256", NULL)) == NULL)
+        goto err;
+    t[1] = now_wall() - start;
+
+    if ((cert = certfile("servercert.pem")) == NULL
+        || (key = certfile("serverkey.pem")) == NULL
+        || (root = certfile("rootcert.pem")) == NULL
+        || (sctx = SSL_CTX_new(TLS_server_method())) == NULL
+        || (cctx = SSL_CTX_new(TLS_client_method())) == NULL
+        || SSL_CTX_use_certificate_chain_file(sctx, cert) <= 0
+        || SSL_CTX_use_PrivateKey_file(sctx, key, SSL_FILETYPE_PEM) <= 0
+        || !SSL_CTX_load_verify_file(cctx, root))
+        goto err;
+    SSL_CTX_set_verify(cctx, SSL_VERIFY_PEER, NULL);
+    t[2] = now_wall() - start;
+
+    if (!handshake(sctx, cctx))
+        goto err;
+    t[3] = now_wall() - start;
+    ok = 1;
+ err:
+    if (!ok)
+        ERR_print_errors_fp(stderr);
+    OPENSSL_free(cert);
+    OPENSSL_free(key);
+    OPENSSL_free(root);
+    EVP_MD_free(md);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return ok;
+}
+
+/* Fork a child to run startup() and collect its timings through a pipe */
+static int run_child(double t[NPHASES])
+{
+    int fds[2], status;
+    ssize_t n;
+    pid_t pid;
+
+    if (pipe(fds) != 0)
+        return 0;
+    if ((pid = fork()) < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return 0;
+    }
+    if (pid == 0) {
+        double ct[NPHASES];
+
+        close(fds[0]);
+        if (!startup(ct)
+            || write(fds[1], ct, sizeof(ct)) != (ssize_t)sizeof(ct))
+            _exit(EXIT_FAILURE);
+        _exit(EXIT_SUCCESS);
+    }
+    close(fds[1]);
+    n = read(fds[0], t, NPHASES * sizeof(*t));
+    close(fds[0]);
+    if (waitpid(pid, &status, 0) != pid)
+        return 0;
+    return n == (ssize_t)(NPHASES * sizeof(*t))
+        && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags] certs-dir\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -c #  Number of child processes (default 50)\n");
+    exit(EXIT_FAILURE);
+}
+# endif
+#endif
+
+int main(int ac, char **av)
+{
+#ifdef STARTUP_BENCH
+    double t[NPHASES], sum[NPHASES], min[NPHASES];
+    int i, count = 50;
+    size_t p;
+
+    prog = av[0];
+    while ((i = getopt(ac, av, "c:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'c':
+            if ((count = atoi(optarg)) <= 0)
+                usage();
+            break;
+        }
+    }
+    if (optind != ac - 1)
+        usage();
+    certsdir = av[optind];
+
+    /*
+     * The parent must not touch the library, or the children would inherit
+     * an initialised one.
+     */
+    for (i = 0; i < count; i++) {
+        if (!run_child(t)) {
+            fprintf(stderr, "Child %d failed\n", i);
+            return EXIT_FAILURE;
+        }
+        for (p = 0; p < NPHASES; p++) {
+            if (i == 0 || t[p] < min[p])
+                min[p] = t[p];
+            sum[p] = (i == 0 ? 0 : sum[p]) + t[p];
+        }
+    }
+
+    printf("%-20s %12s %12s\n", "time to", "mean (us)", "min (us)");
+    for (p = 0; p < NPHASES; p++)
+        printf("%-20s %12.1f %12.1f\n", phases[p], sum[p] * 1e6 / count,
+               min[p] * 1e6);
+    return EXIT_SUCCESS;
+#else
+    fprintf(stderr, "This benchmark requires POSIX process APIs\n");
+    return EXIT_FAILURE;
+#endif
+}
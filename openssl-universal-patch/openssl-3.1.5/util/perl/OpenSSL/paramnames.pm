@@ -0,0 +1,158 @@
+#! /usr/bin/env perl
+# Copyright 2024 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+
+package OpenSSL::paramnames;
+
+use strict;
+use warnings;
+
+require Exporter;
+our @ISA = qw(Exporter);
+our @EXPORT_OK = qw(produce_param_indexes produce_param_decoder);
+
+# Expand the definition of a macro, which may be a sequence of string
+# literals and other macros.  Returns undef if it isn't a string.
+sub resolve {
+    my ($macros, $value, $seen) = @_;
+    my $result = '';
+
+    while ($value ne '') {
+        if ($value =~ s|^"([^"\\]*)"\s*||) {
+            $result .= $1;
+        } elsif ($value =~ s|^(OSSL_\w+)\s*||) {
+            my $macro = $1;
+
+            return undef unless defined $macros->{$macro};
+            die "Loop in the definition of $macro\n" if $seen->{$macro};
+            my $expansion = resolve($macros, $macros->{$macro},
+                                    { %$seen, $macro => 1 });
+            return undef unless defined $expansion;
+            $result .= $expansion;
+        } else {
+            return undef;
+        }
+    }
+    return $result;
+}
+
+# Read the OSSL_*_PARAM_* macros from core_names.h and return a hash that
+# maps each macro name (without the OSSL_ prefix) to the parameter name it
+# expands to.  Macros defined in terms of other macros are resolved.
+sub read_param_names {
+    my $file = shift;
+    my %macros = ();
+    my %names = ();
+
+    open my $fh, '<', $file or die "Couldn't open $file: $!\n";
+    my $text = do { local $/; <$fh> };
+    close $fh;
+
+    $text =~ s|\\\n||g;
+    $text =~ s|/\*.*?\*/||gs;
+    foreach (split /\n/, $text) {
+        $macros{$1} = $2
+            if m|^\s*#\s*define\s+(OSSL_\w*PARAM\w*)\s+(\S.*?)\s*$|;
+    }
+    foreach my $macro (keys %macros) {
+        my $name = resolve(\%macros, $macros{$macro}, {});
+
+        next unless defined $name;
+        (my $pidx = $macro) =~ s|^OSSL_||;
+        $names{$pidx} = $name;
+    }
+    return %names;
+}
+
+# The parameter names in the order of their index
+sub index_names {
+    my %names = @_;
+    my %unique = map { $_ => 1 } values %names;
+
+    return sort keys %unique;
+}
+
+# Produce one PIDX_ macro for every parameter name macro.  Macros that
+# expand to the same name get the same index.
+sub produce_param_indexes {
+    my $file = shift;
+    my %names = read_param_names($file);
+    my @index = index_names(%names);
+    my %idx = map { $index[$_] => $_ } 0 .. $#index;
+    my $out = '';
+
+    foreach my $pidx (sort keys %names) {
+        $out .= sprintf("#define PIDX_%-40s %d\n", $pidx, $idx{$names{$pidx}});
+    }
+    $out .= sprintf("#define PIDX_%-40s %d\n", "NUM_PARAMS", scalar @index);
+    return $out;
+}
+
+sub c_char {
+    my $c = shift;
+
+    return "'\\0'" if $c eq '';
+    return "'\\''" if $c eq "'";
+    return "'\\\\'" if $c eq '\\';
+    return "'$c'";
+}
+
+# Produce the body of a decision tree that switches on one character at
+# a time until only one name is left, which is then compared in full.
+sub produce_switch {
+    my ($depth, $indent, $idx, @names) = @_;
+    my $pad = ' ' x $indent;
+    my $out = '';
+
+    if (scalar @names == 1) {
+        my $rest = substr($names[0], $depth);
+
+        return "${pad}if (s[$depth] == '\\0')\n"
+            . "${pad}    return $idx->{$names[0]};\n"
+            if $rest eq '';
+        return "${pad}if (strcmp(\"$rest\", s + $depth) == 0)\n"
+            . "${pad}    return $idx->{$names[0]};\n";
+    }
+
+    my %groups = ();
+    push @{$groups{substr($_, $depth, 1)}}, $_ foreach @names;
+
+    $out .= "${pad}switch (s[$depth]) {\n";
+    $out .= "${pad}default:\n";
+    $out .= "${pad}    break;\n";
+    foreach my $c (sort keys %groups) {
+        $out .= "${pad}case " . c_char($c) . ":\n";
+        if ($c eq '') {
+            $out .= "${pad}    return $idx->{$groups{$c}->[0]};\n";
+        } else {
+            $out .= produce_switch($depth + 1, $indent + 4, $idx,
+                                   @{$groups{$c}});
+            $out .= "${pad}    break;\n";
+        }
+    }
+    $out .= "${pad}}\n";
+    return $out;
+}
+
+# Produce the function that maps a parameter name to its index, or -1 if it
+# isn't a known name.
+sub produce_param_decoder {
+    my ($file, $func) = @_;
+    my %names = read_param_names($file);
+    my @index = index_names(%names);
+    my %idx = ();
+
+    # Refer to each name by the first of its PIDX_ macros
+    foreach my $pidx (sort keys %names) {
+        $idx{$names{$pidx}} = "PIDX_$pidx" unless defined $idx{$names{$pidx}};
+    }
+    return "int $func(const char *s)\n{\n"
+        . produce_switch(0, 4, \%idx, @index)
+        . "    return -1;\n}\n";
+}
+
+1;
@@ -1,5 +1,5 @@
 #! /usr/bin/env perl
-# Copyright 2015-2018 The OpenSSL Project Authors. All Rights Reserved.
+# Copyright 2015-2024 The OpenSSL Project Authors. All Rights Reserved.
 #
 # Licensed under the Apache License 2.0 (the "License").  You may not use
 # this file except in compliance with the License.  You can obtain a copy
@@ -54,7 +54,9 @@ use constant {
     PSK_KEX_MODES_EXTENSION => 0x00040000,
     KEY_SHARE_HRR_EXTENSION => 0x00080000,
     SUPPORTED_GROUPS_SRV_EXTENSION => 0x00100000,
-    POST_HANDSHAKE_AUTH_CLI_EXTENSION => 0x00200000
+    POST_HANDSHAKE_AUTH_CLI_EXTENSION => 0x00200000,
+    CERT_COMP_CLI_EXTENSION => 0x00400000,
+    CERT_COMP_SRV_EXTENSION => 0x00800000
 };
 
 our @handmessages = ();
@@ -70,6 +72,12 @@ sub checkhandshake($$$$)
         my $extcount;
         my $clienthelloseen = 0;
 
+        #TLSv1.3 peers offer certificate compression whenever it's available
+        $exttype |= CERT_COMP_CLI_EXTENSION | CERT_COMP_SRV_EXTENSION
+            if (TLSProxy::Proxy::is_tls13()
+                && (!disabled("zlib") || !disabled("brotli")
+                    || !disabled("zstd")));
+
         my $lastmt = 0;
         my $numsh = 0;
         if (TLSProxy::Proxy::is_tls13()) {